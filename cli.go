@@ -47,7 +47,15 @@ const (
 	CMD_CREATE_CURSOR   = 9
 	CMD_DELETE_CURSOR   = 10
 	CMD_DATA_NOT_FOUND  = 11
-	CMD_INVALID_COMMAND = 12
+	CMD_MSET            = 12
+	CMD_MGET            = 13
+	CMD_SET_TTL         = 14
+	CMD_INCR            = 15
+	CMD_APPEND          = 16
+	CMD_STATS           = 17
+	CMD_CHECKPOINT      = 18
+	CMD_INGEST          = 19
+	CMD_INVALID_COMMAND = 20
 )
 
 const (
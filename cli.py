@@ -30,6 +30,14 @@ CMD_REMOVE = "REMOVE"
 CMD_CREATE_CURSOR = "CREATE_CURSOR"
 CMD_DELETE_CURSOR = "DELETE_CURSOR"
 CMD_DATA_NOT_FOUND = "DATA_NOT_FOUND"
+CMD_MSET = "MSET"
+CMD_MGET = "MGET"
+CMD_SET_TTL = "SET_TTL"
+CMD_INCR = "INCR"
+CMD_APPEND = "APPEND"
+CMD_STATS = "STATS"
+CMD_CHECKPOINT = "CHECKPOINT"
+CMD_INGEST = "INGEST"
 CMD_INVALID_COMMAND = "INVALID_COMMAND"
 
 # numeric -> name mapping (must match the server/protocol)
@@ -46,7 +54,15 @@ COMMAND_CODES = {
     9: CMD_CREATE_CURSOR,
     10: CMD_DELETE_CURSOR,
     11: CMD_DATA_NOT_FOUND,
-    12: CMD_INVALID_COMMAND,
+    12: CMD_MSET,
+    13: CMD_MGET,
+    14: CMD_SET_TTL,
+    15: CMD_INCR,
+    16: CMD_APPEND,
+    17: CMD_STATS,
+    18: CMD_CHECKPOINT,
+    19: CMD_INGEST,
+    20: CMD_INVALID_COMMAND,
 }
 # name -> numeric
 COMMAND_IDS = {v: k for k, v in COMMAND_CODES.items()}
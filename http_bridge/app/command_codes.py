@@ -10,4 +10,12 @@ COMMAND_CODE_REMOVE = 8
 CREATE_CURSOR = 9
 DELETE_CURSOR = 10
 COMMAND_CODE_DATA_NOT_FOUND = 11
-INVALID_COMMAND_CODE = 12
+COMMAND_CODE_MSET = 12
+COMMAND_CODE_MGET = 13
+COMMAND_CODE_SET_TTL = 14
+COMMAND_CODE_INCR = 15
+COMMAND_CODE_APPEND = 16
+COMMAND_CODE_STATS = 17
+COMMAND_CODE_CHECKPOINT = 18
+COMMAND_CODE_INGEST = 19
+INVALID_COMMAND_CODE = 20
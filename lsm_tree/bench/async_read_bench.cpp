@@ -0,0 +1,99 @@
+// Compares random reads through ifstream, the way SS_Table reads today, with Async_Reader batches at growing queue depths
+// the file is dropped from the page cache before every run, so the numbers include device latency
+// usage: ./bin/async_read_bench [file_size_mb] [read_count]
+
+#include "../include/async_reader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#define ASYNC_READ_BENCH_FILE "./async_read_bench.dat"
+#define ASYNC_READ_BENCH_BLOCK_SIZE 4096
+
+static void drop_page_cache(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return;
+    }
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void print_result(const std::string& name, uint64_t read_count, double seconds) {
+    std::cout << name << "\t" << read_count / seconds << " reads/s\t" << seconds * 1e6 / read_count << " us/read" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t file_size_mb = argc > 1 ? std::stoull(argv[1]) : 256;
+    uint64_t read_count = argc > 2 ? std::stoull(argv[2]) : 20000;
+    uint64_t block_count = file_size_mb * 1024 * 1024 / ASYNC_READ_BENCH_BLOCK_SIZE;
+
+    {
+        std::ofstream out(ASYNC_READ_BENCH_FILE, std::ios::binary | std::ios::trunc);
+        std::string block(ASYNC_READ_BENCH_BLOCK_SIZE, 'x');
+        for(uint64_t i = 0; i < block_count; ++i) {
+            out.write(block.data(), block.size());
+        }
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> offsets(read_count);
+    for(uint64_t& offset : offsets) {
+        offset = (rng() % block_count) * ASYNC_READ_BENCH_BLOCK_SIZE;
+    }
+
+    std::vector<char> buffer(ASYNC_READ_BENCH_BLOCK_SIZE);
+
+    drop_page_cache(ASYNC_READ_BENCH_FILE);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        std::ifstream in(ASYNC_READ_BENCH_FILE, std::ios::binary);
+        for(uint64_t offset : offsets) {
+            in.seekg(offset, std::ios::beg);
+            in.read(buffer.data(), buffer.size());
+        }
+    }
+    print_result("ifstream", read_count, seconds_since(start));
+
+    for(uint32_t queue_depth : {1u, 4u, 16u, 64u, 128u}) {
+        Async_Reader reader(queue_depth);
+        if(!reader.is_async()) {
+            std::cout << "io_uring is not available, only the pread fallback is measured" << std::endl;
+        }
+
+        std::vector<std::vector<char>> buffers(queue_depth, std::vector<char>(ASYNC_READ_BENCH_BLOCK_SIZE));
+        std::vector<Async_Read_Request> requests;
+
+        int fd = open(ASYNC_READ_BENCH_FILE, O_RDONLY);
+        drop_page_cache(ASYNC_READ_BENCH_FILE);
+        start = std::chrono::steady_clock::now();
+        for(uint64_t i = 0; i < read_count; i += queue_depth) {
+            requests.clear();
+            for(uint64_t j = i; j < std::min<uint64_t>(read_count, i + queue_depth); ++j) {
+                requests.push_back(Async_Read_Request{fd, offsets[j], ASYNC_READ_BENCH_BLOCK_SIZE, buffers[j - i].data(), 0});
+            }
+            reader.read_batch(requests);
+        }
+        print_result(std::string(reader.is_async() ? "io_uring" : "pread") + " qd=" + std::to_string(queue_depth), read_count, seconds_since(start));
+        close(fd);
+
+        if(!reader.is_async()) {
+            break;
+        }
+    }
+
+    std::remove(ASYNC_READ_BENCH_FILE);
+    return 0;
+}
@@ -0,0 +1,422 @@
+// Throughput and latency of LSM_Tree workloads, in the spirit of leveldb's db_bench
+// the tree keeps its files inside --db, every fill workload starts from an empty tree, the others run on what the fills left behind
+// writers take turns under a lock and readers go straight to the tree, the same way Partition_Server drives it
+// results are printed as one JSON document
+// usage: ./bin/db_bench [--benchmarks=fillseq,readrandom,...] [--num=N] [--reads=N] [--threads=N] [--key_size=N] [--value_size=N]
+//                       [--distribution=uniform|zipfian] [--zipf_theta=X] [--scan_length=N] [--seed=N] [--db=PATH]
+
+#include "../include/lsm_tree.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DB_BENCH_DEFAULT_BENCHMARKS "fillseq,fillrandom,overwrite,readrandom,readmissing,seekrandom,readreverse,prefixscan"
+#define DB_BENCH_DEFAULT_DB "./db_bench_data"
+#define DB_BENCH_DEFAULT_NUM 100000
+#define DB_BENCH_DEFAULT_KEY_SIZE 16
+#define DB_BENCH_DEFAULT_VALUE_SIZE 100
+#define DB_BENCH_DEFAULT_ZIPF_THETA 0.99
+#define DB_BENCH_DEFAULT_SCAN_LENGTH 16
+
+// values are cut out of a random block this large, so generating them costs next to nothing
+#define DB_BENCH_VALUE_POOL_SIZE (1 << 20)
+
+// the last character of a missing key, stored keys are made of digits only
+#define DB_BENCH_MISSING_KEY_SUFFIX 'x'
+
+struct Bench_Config {
+    std::vector<std::string> benchmarks;
+    std::string db;
+    uint64_t num;
+    uint64_t reads;
+    uint32_t threads;
+    uint32_t key_size;
+    uint32_t value_size;
+    bool zipfian;
+    double zipf_theta;
+    uint16_t scan_length;
+    uint64_t seed;
+};
+
+struct Bench_Result {
+    std::string name;
+    uint64_t ops;
+    uint64_t found;
+    uint64_t bytes;
+    double seconds;
+    std::vector<uint64_t> latencies_ns;
+};
+
+// YCSB style zipfian generator over [0, n), small ranks are the hot ones
+// ranks are scattered over the key space afterwards, so hot keys do not all sit in one table
+class Zipfian_Generator {
+    private:
+        uint64_t n;
+        double theta;
+        double alpha;
+        double zeta_n;
+        double eta;
+
+        static double zeta(uint64_t n, double theta) {
+            double sum = 0;
+            for(uint64_t i = 1; i <= n; ++i) {
+                sum += 1.0 / std::pow((double)i, theta);
+            }
+            return sum;
+        }
+
+    public:
+        Zipfian_Generator(uint64_t _n, double _theta) : n(std::max<uint64_t>(_n, 2)), theta(_theta) {
+            double zeta_2 = zeta(2, this -> theta);
+            this -> zeta_n = zeta(this -> n, this -> theta);
+            this -> alpha = 1.0 / (1.0 - this -> theta);
+            this -> eta = (1.0 - std::pow(2.0 / this -> n, 1.0 - this -> theta)) / (1.0 - zeta_2 / this -> zeta_n);
+        }
+
+        uint64_t next(std::mt19937_64& rng) const {
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            double uz = u * this -> zeta_n;
+
+            if(uz < 1.0) {
+                return 0;
+            }
+            if(uz < 1.0 + std::pow(0.5, this -> theta)) {
+                return 1;
+            }
+
+            uint64_t rank = (uint64_t)(this -> n * std::pow(this -> eta * u - this -> eta + 1.0, this -> alpha));
+            return std::min(rank, this -> n - 1);
+        }
+};
+
+// the tree together with the lock the writers go through, readers need none
+struct Bench_Db {
+    std::unique_ptr<LSM_Tree> tree;
+    std::mutex write_mutex;
+};
+
+static uint64_t scatter_rank(uint64_t rank, uint64_t num) {
+    // fnv-1a of the rank, keeps the hot ranks of the zipfian apart in the key space
+    uint64_t hash = 14695981039346656037ULL;
+    for(uint8_t i = 0; i < sizeof(rank); ++i) {
+        hash ^= (rank >> (i * 8)) & 0xff;
+        hash *= 1099511628211ULL;
+    }
+    return hash % num;
+}
+
+// zero padded decimal of index, key_size wide
+static std::string make_key(uint64_t index, uint32_t key_size) {
+    std::string digits = std::to_string(index);
+    if(digits.size() >= key_size) {
+        return digits.substr(digits.size() - key_size);
+    }
+    return std::string(key_size - digits.size(), '0') + digits;
+}
+
+static std::vector<std::string> split(const std::string& str, char delimiter) {
+    std::vector<std::string> parts;
+    std::stringstream stream(str);
+    std::string part;
+    while(std::getline(stream, part, delimiter)) {
+        if(!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void open_db(Bench_Db& db, const Bench_Config& config, bool fresh) {
+    db.tree.reset();
+
+    LSM_Options options = LSM_Options::from_environment();
+    options.data_dir = std::filesystem::path(config.db) / "val";
+    options.wal_dir = std::filesystem::path(config.db) / "wal";
+
+    if(fresh) {
+        std::filesystem::remove_all(options.data_dir);
+        std::filesystem::remove_all(options.wal_dir);
+    }
+
+    db.tree = std::make_unique<LSM_Tree>(options);
+}
+
+static bool is_write_benchmark(const std::string& name) {
+    return name == "fillseq" || name == "fillrandom" || name == "overwrite";
+}
+
+// runs ops operations of one workload on a single thread
+// fillseq writes the keys from first_index on, the other workloads pick theirs at random
+static void run_thread(Bench_Db& db, const Bench_Config& config, const std::string& name, const Zipfian_Generator* zipfian, const std::string& value_pool, uint32_t thread_index, uint64_t first_index, uint64_t ops, Bench_Result& result) {
+    std::mt19937_64 rng(config.seed + thread_index);
+    result.latencies_ns.reserve(ops);
+
+    for(uint64_t i = 0; i < ops; ++i) {
+        uint64_t index = 0;
+        if(name == "fillseq") {
+            index = first_index + i;
+        }
+        else if(zipfian) {
+            index = scatter_rank(zipfian -> next(rng), config.num);
+        }
+        else {
+            index = rng() % config.num;
+        }
+
+        std::string key = make_key(index, config.key_size);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        if(is_write_benchmark(name)) {
+            uint64_t value_offset = rng() % (value_pool.size() - config.value_size);
+            std::string value = value_pool.substr(value_offset, config.value_size);
+            {
+                std::lock_guard<std::mutex> lock(db.write_mutex);
+                db.tree -> set(key, value);
+            }
+            ++result.found;
+            result.bytes += key.size() + value.size();
+        }
+        else if(name == "readrandom" || name == "readmissing") {
+            if(name == "readmissing") {
+                key.back() = DB_BENCH_MISSING_KEY_SUFFIX;
+            }
+
+            Entry entry = db.tree -> get(key);
+
+            if(!entry.is_deleted() && entry.get_string_key_bytes() != ENTRY_PLACEHOLDER_KEY) {
+                ++result.found;
+                result.bytes += entry.get_key_length() + entry.get_value_length();
+            }
+        }
+        else if(name == "seekrandom" || name == "readreverse") {
+            std::pair<std::set<Entry>, std::string> entries = name == "seekrandom" ? db.tree -> get_ff(key, config.scan_length) : db.tree -> get_fb(key, config.scan_length);
+
+            for(const Entry& entry : entries.first) {
+                ++result.found;
+                result.bytes += entry.get_key_length() + entry.get_value_length();
+            }
+        }
+        else if(name == "prefixscan") {
+            // drops as many trailing digits as it takes for the prefix to cover about scan_length keys
+            uint32_t dropped_digits = std::max<uint32_t>(1, (uint32_t)std::ceil(std::log10((double)config.scan_length)));
+            std::string prefix = key.substr(0, config.key_size - std::min(dropped_digits, config.key_size));
+
+            std::pair<std::set<Bits>, std::string> keys = db.tree -> get_keys_cursor_prefix(prefix, prefix, config.scan_length);
+
+            for(const Bits& found_key : keys.first) {
+                ++result.found;
+                result.bytes += found_key.size();
+            }
+        }
+
+        result.latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        ++result.ops;
+    }
+}
+
+static Bench_Result run_benchmark(Bench_Db& db, const Bench_Config& config, const std::string& name, const std::string& value_pool) {
+    if(name == "fillseq" || name == "fillrandom") {
+        open_db(db, config, true);
+    }
+
+    uint64_t total_ops = is_write_benchmark(name) ? config.num : config.reads;
+
+    std::unique_ptr<Zipfian_Generator> zipfian;
+    if(config.zipfian && name != "fillseq") {
+        zipfian = std::make_unique<Zipfian_Generator>(config.num, config.zipf_theta);
+    }
+
+    std::vector<Bench_Result> thread_results(config.threads);
+    std::vector<std::thread> threads;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t first_index = 0;
+    for(uint32_t i = 0; i < config.threads; ++i) {
+        // the first thread picks up what does not divide evenly
+        uint64_t ops = total_ops / config.threads + (i == 0 ? total_ops % config.threads : 0);
+        threads.emplace_back(run_thread, std::ref(db), std::cref(config), std::cref(name), zipfian.get(), std::cref(value_pool), i, first_index, ops, std::ref(thread_results[i]));
+        first_index += ops;
+    }
+    for(std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Bench_Result result{name, 0, 0, 0, seconds_since(start), {}};
+    for(Bench_Result& thread_result : thread_results) {
+        result.ops += thread_result.ops;
+        result.found += thread_result.found;
+        result.bytes += thread_result.bytes;
+        result.latencies_ns.insert(result.latencies_ns.end(), thread_result.latencies_ns.begin(), thread_result.latencies_ns.end());
+    }
+
+    std::sort(result.latencies_ns.begin(), result.latencies_ns.end());
+    return result;
+}
+
+static double percentile_us(const std::vector<uint64_t>& sorted_ns, double percentile) {
+    if(sorted_ns.empty()) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * sorted_ns.size());
+    return sorted_ns[std::max<uint64_t>(rank, 1) - 1] / 1000.0;
+}
+
+static void print_result(const Bench_Result& result, bool last) {
+    std::cout << "    {\"name\": \"" << result.name << "\""
+              << ", \"ops\": " << result.ops
+              << ", \"found\": " << result.found
+              << ", \"seconds\": " << result.seconds
+              << ", \"ops_per_sec\": " << (result.seconds > 0 ? result.ops / result.seconds : 0)
+              << ", \"mb_per_sec\": " << (result.seconds > 0 ? result.bytes / 1048576.0 / result.seconds : 0)
+              << ", \"latency_us\": {\"p50\": " << percentile_us(result.latencies_ns, 50)
+              << ", \"p95\": " << percentile_us(result.latencies_ns, 95)
+              << ", \"p99\": " << percentile_us(result.latencies_ns, 99)
+              << ", \"p99.9\": " << percentile_us(result.latencies_ns, 99.9)
+              << ", \"max\": " << (result.latencies_ns.empty() ? 0 : result.latencies_ns.back() / 1000.0)
+              << "}}" << (last ? "" : ",") << std::endl;
+}
+
+// @returns false if an argument is not understood
+static bool parse_args(int argc, char* argv[], Bench_Config& config) {
+    config.benchmarks = split(DB_BENCH_DEFAULT_BENCHMARKS, ',');
+    config.db = DB_BENCH_DEFAULT_DB;
+    config.num = DB_BENCH_DEFAULT_NUM;
+    config.reads = 0;
+    config.threads = 1;
+    config.key_size = DB_BENCH_DEFAULT_KEY_SIZE;
+    config.value_size = DB_BENCH_DEFAULT_VALUE_SIZE;
+    config.zipfian = false;
+    config.zipf_theta = DB_BENCH_DEFAULT_ZIPF_THETA;
+    config.scan_length = DB_BENCH_DEFAULT_SCAN_LENGTH;
+    config.seed = 42;
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        if(arg.rfind("--", 0) != 0 || equals == std::string::npos) {
+            return false;
+        }
+
+        std::string flag = arg.substr(2, equals - 2);
+        std::string value = arg.substr(equals + 1);
+
+        try {
+            if(flag == "benchmarks") {
+                config.benchmarks = split(value, ',');
+            }
+            else if(flag == "db") {
+                config.db = value;
+            }
+            else if(flag == "num") {
+                config.num = std::stoull(value);
+            }
+            else if(flag == "reads") {
+                config.reads = std::stoull(value);
+            }
+            else if(flag == "threads") {
+                config.threads = std::stoul(value);
+            }
+            else if(flag == "key_size") {
+                config.key_size = std::stoul(value);
+            }
+            else if(flag == "value_size") {
+                config.value_size = std::stoul(value);
+            }
+            else if(flag == "distribution" && (value == "uniform" || value == "zipfian")) {
+                config.zipfian = value == "zipfian";
+            }
+            else if(flag == "zipf_theta") {
+                config.zipf_theta = std::stod(value);
+            }
+            else if(flag == "scan_length") {
+                config.scan_length = std::stoul(value);
+            }
+            else if(flag == "seed") {
+                config.seed = std::stoull(value);
+            }
+            else {
+                return false;
+            }
+        }
+        catch(const std::exception& e) {
+            return false;
+        }
+    }
+
+    if(config.reads == 0) {
+        config.reads = config.num;
+    }
+
+    // keys must be able to tell every index apart and values must fit in the pool
+    uint64_t distinct_keys = config.key_size >= 19 ? UINT64_MAX : (uint64_t)std::pow(10.0, config.key_size);
+    return config.num > 0 && config.key_size > 0 && config.threads > 0 && config.scan_length > 0 && config.num <= distinct_keys && config.value_size < DB_BENCH_VALUE_POOL_SIZE && config.zipf_theta > 0 && config.zipf_theta < 1;
+}
+
+int main(int argc, char* argv[]) {
+    Bench_Config config;
+    if(!parse_args(argc, argv, config)) {
+        std::cerr << "usage: " << argv[0] << " [--benchmarks=" << DB_BENCH_DEFAULT_BENCHMARKS << "] [--num=N] [--reads=N] [--threads=N] [--key_size=N] [--value_size=N] [--distribution=uniform|zipfian] [--zipf_theta=X] [--scan_length=N] [--seed=N] [--db=PATH]" << std::endl;
+        return 1;
+    }
+
+    for(const std::string& name : config.benchmarks) {
+        if(name != "fillseq" && name != "fillrandom" && name != "overwrite" && name != "readrandom" && name != "readmissing" && name != "seekrandom" && name != "readreverse" && name != "prefixscan") {
+            std::cerr << "unknown benchmark: " << name << std::endl;
+            return 1;
+        }
+    }
+
+    std::string value_pool(DB_BENCH_VALUE_POOL_SIZE, '\0');
+    std::mt19937_64 value_rng(config.seed);
+    for(char& c : value_pool) {
+        c = 'a' + value_rng() % 26;
+    }
+
+    Bench_Db db;
+    open_db(db, config, false);
+
+    std::cout << "{" << std::endl;
+    std::cout << "  \"config\": {\"num\": " << config.num
+              << ", \"reads\": " << config.reads
+              << ", \"threads\": " << config.threads
+              << ", \"key_size\": " << config.key_size
+              << ", \"value_size\": " << config.value_size
+              << ", \"distribution\": \"" << (config.zipfian ? "zipfian" : "uniform") << "\""
+              << ", \"zipf_theta\": " << config.zipf_theta
+              << ", \"scan_length\": " << config.scan_length << "}," << std::endl;
+
+    std::cout << "  \"results\": [" << std::endl;
+    for(uint64_t i = 0; i < config.benchmarks.size(); ++i) {
+        Bench_Result result = run_benchmark(db, config, config.benchmarks[i], value_pool);
+        print_result(result, i + 1 == config.benchmarks.size());
+    }
+    std::cout << "  ]," << std::endl;
+
+    // what the engine counted over the whole run, since the last fill reopened it
+    std::map<std::string, uint64_t> statistics = db.tree -> get_statistics();
+    Statistics::summarize_histograms(statistics);
+
+    std::cout << "  \"statistics\": {";
+    bool first = true;
+    for(const std::pair<const std::string, uint64_t>& counter : statistics) {
+        std::cout << (first ? "" : ", ") << "\"" << counter.first << "\": " << counter.second;
+        first = false;
+    }
+    std::cout << "}" << std::endl << "}" << std::endl;
+
+    return 0;
+}
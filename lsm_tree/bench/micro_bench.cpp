@@ -0,0 +1,323 @@
+// Nanoseconds and heap allocations per operation for the code every request goes through:
+// Bits and Entry construction, Entry serialization and parsing, crc32 and AVL_Tree insert / search
+// every case runs for each key / value size pair, results are written as tab separated lines to --out
+// with --baseline the results are compared against an earlier --out file, slower or more allocating cases are reported and the exit code is 2
+// usage: ./bin/micro_bench [--out=PATH] [--baseline=PATH] [--threshold=PERCENT] [--filter=SUBSTRING] [--min_time_ms=N]
+
+#include "../include/avl_tree.h"
+#include "../include/bits.h"
+#include "../include/crc32.h"
+#include "../include/entry.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define MICRO_BENCH_DEFAULT_OUT "./micro_bench.tsv"
+#define MICRO_BENCH_DEFAULT_THRESHOLD 10.0
+#define MICRO_BENCH_DEFAULT_MIN_TIME_MS 200
+
+// a case is timed this many times and the fastest run is kept, the others are noise from the rest of the machine
+#define MICRO_BENCH_REPETITIONS 3
+
+// keys held by the AVL_Tree cases
+#define MICRO_BENCH_AVL_TREE_SIZE 10000
+
+// an allocation count this much over the baseline is a regression even if the time did not move
+#define MICRO_BENCH_ALLOCATION_SLACK 0.5
+
+static std::atomic<uint64_t> allocation_count(0);
+
+// every allocation of the process goes through here, so the cases can count the ones they cause
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size ? size : 1);
+    if(!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+// gcc can not tell that the replaced operator new hands out malloc memory
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+    std::free(ptr);
+}
+#pragma GCC diagnostic pop
+
+struct Micro_Result {
+    std::string name;
+    double ns_per_op;
+    double allocations_per_op;
+};
+
+// keeps the compiler from dropping the work of a case
+static volatile uint64_t sink;
+
+static std::string random_string(std::mt19937_64& rng, uint64_t length) {
+    std::string str(length, '\0');
+    for(char& c : str) {
+        c = 'a' + rng() % 26;
+    }
+    return str;
+}
+
+// @brief runs op until min_time has passed, MICRO_BENCH_REPETITIONS times
+// @returns the fastest run
+static Micro_Result run_case(const std::string& name, std::chrono::milliseconds min_time, const std::function<void(uint64_t)>& op) {
+    // a short warm up finds how many iterations fill about min_time
+    uint64_t iterations = 1;
+    while(true) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(uint64_t i = 0; i < iterations; ++i) {
+            op(i);
+        }
+        std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+        if(elapsed >= min_time / 10 || iterations >= (1ULL << 40)) {
+            iterations = std::max<uint64_t>(1, iterations * (min_time / std::max<std::chrono::steady_clock::duration>(elapsed, std::chrono::nanoseconds(1))));
+            break;
+        }
+        iterations *= 10;
+    }
+
+    Micro_Result best{name, 0, 0};
+    for(uint32_t repetition = 0; repetition < MICRO_BENCH_REPETITIONS; ++repetition) {
+        uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(uint64_t i = 0; i < iterations; ++i) {
+            op(i);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        uint64_t allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+
+        double ns_per_op = ns / iterations;
+        if(repetition == 0 || ns_per_op < best.ns_per_op) {
+            best.ns_per_op = ns_per_op;
+        }
+        best.allocations_per_op = (double)allocations / iterations;
+    }
+
+    return best;
+}
+
+static std::vector<Micro_Result> run_cases(const std::string& filter, std::chrono::milliseconds min_time) {
+    std::vector<Micro_Result> results;
+    std::mt19937_64 rng(42);
+
+    // small keys with growing values, then growing keys with a small value
+    const std::vector<std::pair<uint32_t, uint32_t>> sizes = {{16, 16}, {16, 128}, {16, 1024}, {16, 8192}, {64, 128}, {256, 128}};
+
+    for(const std::pair<uint32_t, uint32_t>& size : sizes) {
+        std::string suffix = "/k" + std::to_string(size.first) + "/v" + std::to_string(size.second);
+
+        std::string key = random_string(rng, size.first);
+        std::string value = random_string(rng, size.second);
+        Entry entry = Entry(Bits(key), Bits(value));
+        entry.set_sequence_number(1);
+        std::string data_string = entry.get_string_data_bytes();
+        std::string checked = key + value;
+
+        std::vector<std::pair<std::string, std::function<void(uint64_t)>>> cases;
+
+        cases.emplace_back("bits_construct", [&](uint64_t) {
+            Bits bits(key);
+            sink = sink + bits.size();
+        });
+
+        cases.emplace_back("entry_construct", [&](uint64_t) {
+            Entry constructed = Entry(Bits(key), Bits(value));
+            sink = sink + constructed.get_value_length();
+        });
+
+        cases.emplace_back("entry_get_ostream_bytes", [&](uint64_t) {
+            std::ostringstream bytes = entry.get_ostream_bytes();
+            sink = sink + bytes.tellp();
+        });
+
+        cases.emplace_back("entry_get_string_data_bytes", [&](uint64_t) {
+            sink = sink + entry.get_string_data_bytes().size();
+        });
+
+        cases.emplace_back("entry_parse", [&](uint64_t) {
+            Entry parsed(key, data_string);
+            sink = sink + parsed.get_value_length();
+        });
+
+        cases.emplace_back("crc32", [&](uint64_t) {
+            sink = sink + crc32(checked);
+        });
+
+        // the AVL_Tree cases work on a tree of MICRO_BENCH_AVL_TREE_SIZE random keys of this size
+        std::vector<Entry> tree_entries;
+        std::vector<Bits> tree_keys;
+        AVL_Tree tree;
+        tree_entries.reserve(MICRO_BENCH_AVL_TREE_SIZE);
+        tree_keys.reserve(MICRO_BENCH_AVL_TREE_SIZE);
+        for(uint64_t i = 0; i < MICRO_BENCH_AVL_TREE_SIZE; ++i) {
+            tree_keys.emplace_back(random_string(rng, size.first));
+            tree_entries.emplace_back(tree_keys.back(), Bits(value));
+            tree_entries.back().set_sequence_number(i + 1);
+            tree.insert(tree_entries.back());
+        }
+
+        // overwrites keys that are already in the tree, so its size stays put
+        sequence_number_type next_sequence_number = MICRO_BENCH_AVL_TREE_SIZE + 1;
+        cases.emplace_back("avl_tree_insert", [&](uint64_t i) {
+            Entry& inserted = tree_entries[i % MICRO_BENCH_AVL_TREE_SIZE];
+            inserted.set_sequence_number(next_sequence_number++);
+            tree.insert(inserted);
+        });
+
+        cases.emplace_back("avl_tree_search", [&](uint64_t i) {
+            bool found = false;
+            Entry searched = tree.search(tree_keys[i % MICRO_BENCH_AVL_TREE_SIZE], found);
+            sink = sink + found;
+        });
+
+        for(std::pair<std::string, std::function<void(uint64_t)>>& micro_case : cases) {
+            std::string name = micro_case.first + suffix;
+            if(!filter.empty() && name.find(filter) == std::string::npos) {
+                continue;
+            }
+
+            results.push_back(run_case(name, min_time, micro_case.second));
+            std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1) << std::setw(12) << results.back().ns_per_op << " ns/op" << std::setprecision(2) << std::setw(10) << results.back().allocations_per_op << " allocs/op" << std::endl;
+        }
+    }
+
+    return results;
+}
+
+static bool write_results(const std::string& path, const std::vector<Micro_Result>& results) {
+    std::ofstream out(path, std::ios::trunc);
+    if(!out) {
+        return false;
+    }
+
+    out << "name\tns_per_op\tallocations_per_op" << std::endl;
+    for(const Micro_Result& result : results) {
+        out << result.name << "\t" << result.ns_per_op << "\t" << result.allocations_per_op << std::endl;
+    }
+    return static_cast<bool>(out);
+}
+
+// @returns false if path can not be read, malformed lines are skipped
+static bool read_results(const std::string& path, std::map<std::string, Micro_Result>& results) {
+    std::ifstream in(path);
+    if(!in) {
+        return false;
+    }
+
+    std::string line;
+    std::getline(in, line);
+    while(std::getline(in, line)) {
+        std::istringstream fields(line);
+        Micro_Result result;
+        if(std::getline(fields, result.name, '\t') && fields >> result.ns_per_op >> result.allocations_per_op) {
+            results[result.name] = result;
+        }
+    }
+    return true;
+}
+
+// @returns the number of cases that got slower by more than threshold percent or allocate more than before
+static uint64_t compare_results(const std::vector<Micro_Result>& results, const std::map<std::string, Micro_Result>& baseline, double threshold) {
+    uint64_t regressions = 0;
+    std::cout << std::endl << "compared to the baseline, regressions over " << threshold << "%:" << std::endl;
+
+    for(const Micro_Result& result : results) {
+        std::map<std::string, Micro_Result>::const_iterator base_it = baseline.find(result.name);
+        if(base_it == baseline.end()) {
+            std::cout << std::left << std::setw(40) << result.name << " not in the baseline" << std::endl;
+            continue;
+        }
+
+        double change = base_it -> second.ns_per_op > 0 ? (result.ns_per_op / base_it -> second.ns_per_op - 1.0) * 100.0 : 0;
+        bool slower = change > threshold;
+        bool allocates_more = result.allocations_per_op > base_it -> second.allocations_per_op + MICRO_BENCH_ALLOCATION_SLACK;
+
+        std::cout << std::left << std::setw(40) << result.name << std::right << std::showpos << std::setprecision(1) << std::setw(10) << change << "%" << std::noshowpos << std::setprecision(2) << std::setw(10) << base_it -> second.allocations_per_op << " -> " << result.allocations_per_op << " allocs/op";
+        if(slower || allocates_more) {
+            std::cout << "  REGRESSION";
+            ++regressions;
+        }
+        std::cout << std::endl;
+    }
+
+    return regressions;
+}
+
+int main(int argc, char* argv[]) {
+    std::string out_path = MICRO_BENCH_DEFAULT_OUT;
+    std::string baseline_path;
+    std::string filter;
+    double threshold = MICRO_BENCH_DEFAULT_THRESHOLD;
+    uint64_t min_time_ms = MICRO_BENCH_DEFAULT_MIN_TIME_MS;
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string flag = arg.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+        try {
+            if(flag == "--out" && !value.empty()) {
+                out_path = value;
+            }
+            else if(flag == "--baseline" && !value.empty()) {
+                baseline_path = value;
+            }
+            else if(flag == "--filter") {
+                filter = value;
+            }
+            else if(flag == "--threshold") {
+                threshold = std::stod(value);
+            }
+            else if(flag == "--min_time_ms") {
+                min_time_ms = std::max<uint64_t>(1, std::stoull(value));
+            }
+            else {
+                throw std::invalid_argument(arg);
+            }
+        }
+        catch(const std::exception& e) {
+            std::cerr << "usage: " << argv[0] << " [--out=PATH] [--baseline=PATH] [--threshold=PERCENT] [--filter=SUBSTRING] [--min_time_ms=N]" << std::endl;
+            return 1;
+        }
+    }
+
+    // the baseline is read first, it may be the file the results are about to replace
+    std::map<std::string, Micro_Result> baseline;
+    if(!baseline_path.empty() && !read_results(baseline_path, baseline)) {
+        std::cerr << "could not read the baseline " << baseline_path << std::endl;
+        return 1;
+    }
+
+    std::vector<Micro_Result> results = run_cases(filter, std::chrono::milliseconds(min_time_ms));
+
+    if(!write_results(out_path, results)) {
+        std::cerr << "could not write " << out_path << std::endl;
+        return 1;
+    }
+
+    if(!baseline_path.empty() && compare_results(results, baseline, threshold) > 0) {
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#ifndef YSQL_ASYNC_READER_H_INCLUDED
+#define YSQL_ASYNC_READER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// how many reads one reader keeps in flight at most
+#define ASYNC_READER_DEFAULT_QUEUE_DEPTH 64
+
+// set this enviroment variable to 1 to always use the synchronous pread path
+#define ASYNC_READER_DISABLE_ENV_VAR "LSM_TREE_DISABLE_IO_URING"
+
+// io_uring_enter failing this many times in a row for lack of resources sends the rest of the batch to pread
+#define ASYNC_READER_MAX_FAILED_ENTERS 8
+
+#define ASYNC_READER_FAILED_ENTER_ERR_MSG "Async reader failed to submit reads: "
+
+// one positional read, result is the number of bytes read or -errno
+struct Async_Read_Request {
+    int fd;
+    uint64_t offset;
+    uint32_t length;
+    char* buffer;
+    int64_t result;
+};
+
+// Submits groups of independent file reads at once through io_uring, so a single thread keeps many of them in flight
+// when io_uring is not available (old kernel, seccomp, disabled through ASYNC_READER_DISABLE_ENV_VAR) the reads are done one by one with pread
+// a reader is not thread safe, use for_this_thread() to get the one owned by the calling thread
+class Async_Reader {
+    private:
+        int ring_fd;
+        uint32_t queue_depth;
+
+        // mapped io_uring memory, see io_uring_setup(2)
+        void* sq_ring;
+        void* cq_ring;
+        void* sqes;
+        uint64_t sq_ring_size;
+        uint64_t cq_ring_size;
+        uint64_t sqes_size;
+
+        uint32_t* sq_head;
+        uint32_t* sq_tail;
+        uint32_t* sq_mask;
+        uint32_t* sq_array;
+        uint32_t* cq_head;
+        uint32_t* cq_tail;
+        uint32_t* cq_mask;
+        void* cqes;
+
+        // @returns false if io_uring could not be set up, the reader then stays synchronous
+        bool setup_ring();
+
+        void close_ring();
+
+        // @brief reads the requests from first on one by one with pread
+        void read_batch_sync(std::vector<Async_Read_Request>& requests, size_t first = 0) const;
+
+        // @brief sets the result of every request in the completion queue and consumes its entries
+        // @returns the number of completions reaped
+        uint32_t reap_completions(std::vector<Async_Read_Request>& requests);
+
+        // THROWS
+        // @brief called once io_uring_enter keeps failing, takes back the unsubmitted entries and reads them and every request after them with pread
+        // then waits for the reads already in flight, throws if even waiting for them fails
+        void finish_batch_sync(std::vector<Async_Read_Request>& requests, size_t first_unsubmitted, uint32_t unsubmitted, uint32_t in_flight);
+
+    public:
+        explicit Async_Reader(uint32_t _queue_depth = ASYNC_READER_DEFAULT_QUEUE_DEPTH);
+
+        ~Async_Reader();
+
+        Async_Reader(const Async_Reader&) = delete;
+        Async_Reader& operator=(const Async_Reader&) = delete;
+
+        // @returns true if reads go through io_uring
+        bool is_async() const;
+
+        uint32_t get_queue_depth() const;
+
+        // THROWS
+        // @brief reads every request, up to the queue depth at a time, and returns once all of them completed
+        // sets result of every request, a read past the end of the file returns fewer bytes than asked for
+        void read_batch(std::vector<Async_Read_Request>& requests);
+
+        // @brief the reader owned by the calling thread, created on first use
+        static Async_Reader& for_this_thread();
+};
+
+#endif // YSQL_ASYNC_READER_H_INCLUDED
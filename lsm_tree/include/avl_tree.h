@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include "entry.h"
+#include "snapshot.h"
+#include "entry_iterator.h"
 #include <algorithm>
 #include <vector>
 #include <set>
@@ -15,6 +17,8 @@ class AVL_Tree
     struct Node
     {
         Entry data;
+        // older versions of the key still needed by live snapshots, newest first
+        std::vector<Entry> history;
         Node* left;
         Node* right;
         int32_t height;
@@ -29,7 +33,13 @@ class AVL_Tree
     Node* right_rotate(Node* node);
     Node* left_rotate(Node* node);
 
-    Node* insert(Node* node, Entry& entry);
+    Node* insert(Node* node, Entry& entry, const std::vector<sequence_number_type>& live_snapshots);
+
+    // @brief replaces the nodes newest version with entry, keeping the older versions a live snapshot can still see
+    void replace_version(Node* node, Entry& entry, const std::vector<sequence_number_type>& live_snapshots);
+
+    // @returns the newest version of the node visible at snapshot, nullptr if every version is newer than the snapshot
+    static Entry* visible_version(Node* node, sequence_number_type snapshot);
     Node* delete_node(Node* root, Entry& entry);
     Node* delete_node(Node* root, Bits& key);
 
@@ -37,105 +47,70 @@ class AVL_Tree
 
     void inorder(Node* root, std::vector<Entry>& result);
 
-    Entry search(Node* root, Bits& key, bool& found);
+    Node* find_node(Node* root, const Bits& key) const;
 
     // destroys the entire tree
     void make_empty(Node*& node);
 
     Entry pop_last(Node*& node);
 
-    template <typename T, typename Extractor>
-    void collect_larger(Node* node, const Bits& threshold_key, uint32_t count, std::vector<T>& results, std::set<Bits>& dead_keys, Extractor extractor) const {
-        if (!node || results.size() >= count) {
-            return;
-        }
-
-        const Bits& current_key = node -> data.get_key();
-
-        if (current_key >= threshold_key) {
-            if(current_key > threshold_key) {
-                collect_larger(node -> left, threshold_key, count, results, dead_keys, extractor);
-            }
-
-            if (results.size() >= count) {
-                return;
-            }
-
-            if (!node -> data.is_deleted()) {
-                results.push_back(extractor(node -> data));
-            }
-            else {
-                dead_keys.emplace(node -> data.get_key());
-            }
-
-            if (results.size() >= count) return;
-
-            collect_larger(node -> right, threshold_key, count, results, dead_keys, extractor);
-        } 
-        else {
-            collect_larger(node -> right, threshold_key, count, results, dead_keys, extractor);
-        }
-    }
-
-    template <typename T, typename Extractor>
-    void collect_smaller(Node* node, const Bits& threshold_key, uint32_t count, std::vector<T>& results, std::set<Bits>& dead_keys, Extractor extractor) const {
-        if (!node || results.size() >= count) {
-            return;
-        }
-
-        const Bits& current_key = node -> data.get_key();
-
-        if (current_key <= threshold_key) {
-            if(current_key < threshold_key) {
-                collect_smaller(node -> right, threshold_key, count, results, dead_keys, extractor);
-            }
-
-            if (results.size() >= count) {
-                return;
-            }
-
-            if (!node -> data.is_deleted()) {
-                results.push_back(extractor(node -> data));
-            }
-            else {
-                dead_keys.emplace(node -> data.get_key());
-            }
-
-            if (results.size() >= count) return;
-
-            collect_smaller(node -> left, threshold_key, count, results, dead_keys, extractor);
-        } 
-        else {
-            collect_smaller(node -> left, threshold_key, count, results, dead_keys, extractor);
-        }
-    }
-
     public:
+        // Walks the tree in key order using an explicit stack of the nodes still to be visited
+        // the tree must not be modified while the iterator is in use
+        class Iterator : public Entry_Iterator {
+            private:
+                Node* root;
+                sequence_number_type snapshot;
+                Iterator_Direction direction;
+                std::vector<Node*> stack;
+                Entry* current_entry;
+
+                // @brief pushes node and its left spine when going forward, its right spine when going backward
+                void push_spine(Node* node);
+
+                // @brief settles on the top of the stack, skipping keys with no version visible at snapshot
+                void settle();
+
+            public:
+                Iterator(Node* _root, sequence_number_type _snapshot);
+
+                void seek(const Bits& target, Iterator_Direction _direction) override;
+
+                bool valid() const override;
+
+                void next() override;
+
+                const Entry& entry() const override;
+        };
+
         AVL_Tree(Entry& entry);
         AVL_Tree();
         ~AVL_Tree();
 
         void insert(Entry& entry);
+
+        // @brief inserts entry, older versions of its key survive if a snapshot in live_snapshots (sorted ascending) can still see them
+        void insert(Entry& entry, const std::vector<sequence_number_type>& live_snapshots);
         void remove(Entry& entry);
         void remove(Bits& key);
 
         // found is set to true if the given entry was found, and false otherwise
-        Entry search(Bits& key, bool& found);
+        // only versions written at or before snapshot are considered
+        Entry search(Bits& key, bool& found, sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER);
+
+        // @returns the combined length of every version kept for key, 0 if the key is not in the tree
+        uint64_t get_versions_length(const Bits& key);
 
         void print_inorder();
 
         void make_empty();
         Entry pop_last();
 
+    	// @returns every kept version ordered by key ascending, versions of the same key newest first
     	std::vector<Entry> inorder();
 
-        std::vector<Entry> get_entries_larger_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys) const;
-
-        std::vector<Bits> get_keys_larger_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys) const;
-
-        std::vector<Entry> get_entries_smaller_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys) const;
-
-        std::vector<Bits> get_keys_smaller_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys) const;
+        // @returns an iterator over the versions visible at snapshot, it has to be positioned with seek() first
+        Iterator get_iterator(sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER) const;
 };
 
 #endif // YSQL_AVL_TREE_INCLUDED
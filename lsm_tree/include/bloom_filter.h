@@ -0,0 +1,40 @@
+#ifndef YSQL_BLOOM_FILTER_H_INCLUDED
+#define YSQL_BLOOM_FILTER_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// about 1% false positives
+#define BLOOM_FILTER_DEFAULT_BITS_PER_KEY 10
+#define BLOOM_FILTER_MIN_BITS 64
+#define BLOOM_FILTER_MAX_HASH_COUNT 30
+
+// Set membership test with no false negatives, a key that was added is always reported
+// every key sets hash_count bits, picked with double hashing of one 64 bit hash
+class Bloom_Filter {
+    private:
+        std::string bits;
+        uint8_t hash_count;
+
+    public:
+        // @brief an empty filter, reports every key as absent
+        Bloom_Filter();
+
+        // @returns the hash build() expects for key
+        static uint64_t hash_key(const std::string& key);
+
+        // @brief builds a filter over keys given by their hash_key() hashes, duplicates are allowed
+        static Bloom_Filter build(const std::vector<uint64_t>& key_hashes, uint32_t bits_per_key = BLOOM_FILTER_DEFAULT_BITS_PER_KEY);
+
+        // @returns false only if key was definitely not added
+        bool may_contain(const std::string& key) const;
+
+        // @returns [u8 hash_count][bits]
+        std::string encode() const;
+
+        // @returns false if encoded is not something encode() produced
+        bool decode(const std::string& encoded);
+};
+
+#endif // YSQL_BLOOM_FILTER_H_INCLUDED
@@ -0,0 +1,86 @@
+#ifndef YSQL_BUFFERED_FILE_WRITER_H_INCLUDED
+#define YSQL_BUFFERED_FILE_WRITER_H_INCLUDED
+
+#include <cstdint>
+#include <filesystem>
+
+// size of the in memory buffer, data reaches the file in writes of this size
+#define BUFFERED_FILE_WRITER_BUFFER_SIZE (1 << 20)
+
+// buffer address, buffer size and file offsets are kept aligned to this, as O_DIRECT requires
+#define BUFFERED_FILE_WRITER_ALIGNMENT 4096
+
+// writeback of the written data is started every time this many bytes pile up
+#define BUFFERED_FILE_WRITER_BYTES_PER_SYNC (8 << 20)
+
+#define BUFFERED_FILE_WRITER_FAILED_OPEN_ERR_MSG "Buffered file writer failed to open the file\n"
+#define BUFFERED_FILE_WRITER_FAILED_ALLOC_ERR_MSG "Buffered file writer failed to allocate its buffer\n"
+#define BUFFERED_FILE_WRITER_FAILED_WRITE_ERR_MSG "Buffered file writer failed to write to the file\n"
+#define BUFFERED_FILE_WRITER_CLOSED_ERR_MSG "Buffered file writer was already closed\n"
+
+// how a file written in bulk (compaction output) or read in bulk (compaction input) treats the page cache
+enum File_Io_Mode : uint8_t {
+    // plain buffered io, pages stay cached until the kernel evicts them
+    FILE_IO_BUFFERED,
+    // pages are written back while writing and dropped with posix_fadvise(DONTNEED) once they are not needed
+    FILE_IO_DROP_CACHE,
+    // writes bypass the page cache with O_DIRECT, falls back to FILE_IO_DROP_CACHE where the file system does not support it
+    FILE_IO_DIRECT
+};
+
+// Appends to a new file through one large aligned buffer, so a stream of small records turns into a few large write() calls
+// writeback is started with sync_file_range every BUFFERED_FILE_WRITER_BYTES_PER_SYNC bytes, so close() and the final fdatasync do not stall on the whole file
+// the writer does not sync the file itself
+class Buffered_File_Writer {
+    private:
+        std::filesystem::path file;
+        int fd;
+        File_Io_Mode io_mode;
+
+        char* buffer;
+        uint64_t buffer_used;
+
+        // bytes already handed to the file
+        uint64_t file_offset;
+        // writeback was started for everything before this offset
+        uint64_t synced_offset;
+        // everything before this offset was dropped from the page cache
+        uint64_t dropped_offset;
+
+        // THROWS
+        void write_all(const char* data, uint64_t length);
+
+        // THROWS
+        // @brief writes out the buffer, must only be called with a full buffer in FILE_IO_DIRECT mode
+        void flush_buffer();
+
+        // @brief starts writeback of the bytes written since the last call
+        // in FILE_IO_DROP_CACHE mode also waits for the previous range and drops it from the page cache
+        void start_writeback();
+
+    public:
+        // THROWS
+        // @brief creates (or truncates) file
+        Buffered_File_Writer(const std::filesystem::path& _file, File_Io_Mode _io_mode);
+
+        // closes the file without writing out what is left in the buffer
+        ~Buffered_File_Writer();
+
+        Buffered_File_Writer(const Buffered_File_Writer&) = delete;
+        Buffered_File_Writer& operator=(const Buffered_File_Writer&) = delete;
+
+        // THROWS
+        void append(const char* data, uint64_t length);
+
+        // @returns the size of the file once everything appended so far is written out
+        uint64_t position() const;
+
+        // @brief writes out the buffer and closes the file
+        // @returns false if any of it failed
+        bool close();
+
+        // @returns the mode actually in use, FILE_IO_DIRECT may have been downgraded when opening
+        File_Io_Mode get_io_mode() const;
+};
+
+#endif // YSQL_BUFFERED_FILE_WRITER_H_INCLUDED
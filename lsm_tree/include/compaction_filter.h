@@ -0,0 +1,32 @@
+#ifndef YSQL_COMPACTION_FILTER_H_INCLUDED
+#define YSQL_COMPACTION_FILTER_H_INCLUDED
+
+#include "ss_table.h"
+#include <cstdint>
+#include <string>
+
+enum Compaction_Filter_Decision : uint8_t {
+    COMPACTION_FILTER_KEEP,
+    // the key goes away as if it was removed, older versions below stay hidden
+    COMPACTION_FILTER_DROP,
+    // the record is written with new_value instead, keeping its sequence number and expiry time
+    COMPACTION_FILTER_CHANGE_VALUE
+};
+
+// Hook compaction calls for the newest version of every key it rewrites, so records can be dropped or rewritten without a separate scan
+// tombstones, expired records and versions a live snapshot can still see are never handed to the filter
+// it is called without any lock held and possibly from several compactions at once, so filter() must not touch the tree
+class Compaction_Filter {
+    public:
+        virtual ~Compaction_Filter() = default;
+
+        // @brief decides what happens to a record, value is the real value even if it was moved to the value log
+        // @param level - the level the compaction writes to
+        // @param new_value - set it when returning COMPACTION_FILTER_CHANGE_VALUE
+        virtual Compaction_Filter_Decision filter(level_index_type level, const std::string& key, const std::string& value, std::string& new_value) const = 0;
+
+        // @returns a name for logs
+        virtual const char* name() const = 0;
+};
+
+#endif // YSQL_COMPACTION_FILTER_H_INCLUDED
@@ -2,6 +2,7 @@
 #define YSQL_ENTRY_H_INCLUDED
 
 #include "crc32.h"
+#include <chrono>
 #include <sstream>
 #include <stdexcept>
 
@@ -21,30 +22,55 @@
 #define ENTRY_FAILED_READ_VALUE_MSG "Entry failed to read value\n"
 #define ENTRY_FAILED_READ_VALUE_LENGTH_MSG "Entry failed to read value_length\n"
 #define ENTRY_FAILED_READ_TOMBSTONE_FLAG_MSG "Entry failed to read tombstone_flag\n"
+#define ENTRY_FAILED_READ_SEQUENCE_NUMBER_MSG "Entry failed to read sequence_number\n"
+#define ENTRY_FAILED_READ_EXPIRY_TIME_MSG "Entry failed to read expiry_time\n"
 #define ENTRY_FAILED_READ_CHECKSUM_MSG "Entry failed to read checksum\n"
 #define ENTRY_DATA_TOO_SHORT_ERR_MSG "Entry data string is too short\n"
 
 #define ENTRY_TOMBSTONE_OFF 0
 #define ENTRY_TOMBSTONE_ON 1
+// set in the same byte as the tombstone, the value is a Value_Pointer into the value log instead of the value itself
+#define ENTRY_VALUE_POINTER_FLAG 2
+// set in the same byte as the tombstone, a [u64 expiry_time] follows the sequence number
+#define ENTRY_EXPIRY_FLAG 4
+// set in the same byte as the tombstone, the value is a merge operand to be folded into the older versions on read
+#define ENTRY_MERGE_OPERAND_FLAG 8
+
+// entries without a ttl never expire
+#define ENTRY_NO_EXPIRY 0
+
+// entries that were never assigned a sequence number, older than every write
+#define ENTRY_NO_SEQUENCE_NUMBER 0
+// reading at this sequence number sees the newest version of every key
+#define ENTRY_MAX_SEQUENCE_NUMBER UINT64_MAX
 
 // localisation for constant size_type between different systems
 using key_len_type = uint16_t;
 using value_len_type = uint32_t;
+using sequence_number_type = uint64_t;
 
 class Entry {
 	private:
 		uint64_t entry_length;
+		// bit 0 - ENTRY_TOMBSTONE_ON, bit 1 - ENTRY_VALUE_POINTER_FLAG, bit 2 - ENTRY_EXPIRY_FLAG, bit 3 - ENTRY_MERGE_OPERAND_FLAG
 		uint8_t tombstone_flag;
+		// order of the write that produced this version, larger is newer
+		sequence_number_type sequence_number;
+		// milliseconds since the unix epoch after which the entry reads as deleted, only serialized if ENTRY_EXPIRY_FLAG is set
+		uint64_t expiry_time;
 		Bits key;
 		Bits value;
 		uint32_t checksum;
 
-		//@brief uses crc32 hashing to calculate the checksum by concatenating the string conversions of key and value
-		//@note updates the checksum member variable
+		//@brief uses crc32 hashing to calculate the checksum over tombstone_flag, sequence_number, expiry_time (if set), key and value
+		//@note updates the checksum member variable, every setter of these fields calls it
 		void calculate_checksum();
 
+		//@returns the checksum calculate_checksum() would store, without storing it
+		uint32_t compute_checksum() const;
+
 		//@brief calculates the length of the entry in Bytes
-		//@note includes sizes of: entry_length, tombstone_flag, key_size, key data, value_size, value data, and checksum
+		//@note includes sizes of: entry_length, tombstone_flag, sequence_number, expiry_time (if set), key_size, key data, value_size, value data, and checksum
 		void calculate_entry_length();
 
 	public:
@@ -57,20 +83,20 @@ class Entry {
 		//@brief constructs Entry from Bits key and value
 		//@throws std::length_error if _key.size() > ENTRY_MAX_KEY_LEN
 		//@throws std::length_error if _value.size() > ENTRY_MAX_VALUE_LEN
-		//@note automatically calculates checksum and entry_length, sets tombstone_flag to 0
+		//@note automatically calculates checksum and entry_length, sets tombstone_flag and sequence_number to 0
 		Entry(Bits _key, Bits _value);
 		// Copy constructor
 		Entry(const Entry& other);
 		//THROWS
 		//@brief constructs Entry from stringstream containing serialized entry data
 		//@throws std::runtime_error if any field fails to read from stream
-		//@note reads in order: entry_length, tombstone_flag, key_size, key data, value_size, value data, checksum
+		//@note reads in order: entry_length, tombstone_flag, sequence_number, expiry_time (if flagged), key_size, key data, value_size, value data, checksum
 		Entry(std::stringstream& file_entry);
 		//THROWS
 		//@brief constructs Entry from separate key and data strings
 		//@throws std::runtime_error if file_entry_key is empty
 		//@throws std::runtime_error if file_entry_data is too short for expected fields
-		//@note data string contains: tombstone_flag, value_size, value data, checksum (excludes key data)
+		//@note data string contains: tombstone_flag, sequence_number, expiry_time (if flagged), value_size, value data, checksum (excludes key data)
 		Entry(std::string& file_entry_key, std::string& file_entry_data);
 		// -------------------------------------
 			
@@ -81,8 +107,8 @@ class Entry {
 
 		//@returns the size of the entry length in Bytes
 		uint64_t get_entry_length();
-		//@returns true if the entry is marked for deletion (tombstone_flag is set)
-		bool is_deleted();
+		//@returns true if the entry is marked for deletion (tombstone_flag is set) or its ttl ran out
+		bool is_deleted() const;
 		//@returns key as Bits class
 		Bits get_key() const;
 		//@returns value as Bits class
@@ -95,10 +121,34 @@ class Entry {
 		//@brief sets tombstone_flag to _tombstone_flag value
 		//@note converts bool to ENTRY_TOMBSTONE_ON (true) or ENTRY_TOMBSTONE_OFF (false)
 		void set_tombstone(bool _tombstone_flag);
+		//@returns true if the value is a pointer into the value log, LSM_Tree reads replace it with the value
+		bool is_value_pointer() const;
+		//@brief marks the value as a pointer into the value log (or as the value itself)
+		void set_value_pointer(bool _value_pointer);
+		//@returns true if the value is a merge operand, LSM_Tree reads fold it into the versions below it
+		bool is_merge_operand() const;
+		//@brief marks the value as a merge operand (or as the value itself)
+		void set_merge_operand(bool _merge_operand);
+		//@returns the sequence number of the write that produced this entry
+		sequence_number_type get_sequence_number() const;
+
+		void set_sequence_number(sequence_number_type _sequence_number);
+		//@returns the expiry time in milliseconds since the unix epoch, ENTRY_NO_EXPIRY if the entry never expires
+		uint64_t get_expiry_time() const;
+		//@brief sets the expiry time and recalculates entry_length, ENTRY_NO_EXPIRY removes it
+		void set_expiry_time(uint64_t _expiry_time);
+		//@returns true if the entry has an expiry time that is not after now
+		bool is_expired(uint64_t now) const;
+		//@returns the current time in milliseconds since the unix epoch, the clock expiry times are measured with
+		static uint64_t current_time();
+		//@returns the expiry time stored in a data string made by get_string_data_bytes(), without parsing the rest of it
+		static uint64_t read_expiry_time(const std::string& file_entry_data);
+		//@returns true if a data string made by get_string_data_bytes() holds a merge operand, without parsing the rest of it
+		static bool read_merge_operand(const std::string& file_entry_data);
 		//@brief sets new value and recalculates checksum and entry_length
 		void update_value(Bits _value);
 		//@returns true if checksum is still valid, false if data corruption appeared
-		//@note recalculates checksum from current key and value, compares with stored checksum
+		//@note recalculates checksum from current flags, sequence number, expiry time, key and value, compares with stored checksum
 		bool check_checksum();
 		//@returns the length of the saved key as key_len_type (uint16_t)
 		key_len_type get_key_length() const;
@@ -110,10 +160,10 @@ class Entry {
 		std::string get_key_string() const; 
 
 		//@brief serializes complete entry to ostringstream
-		//@returns ostringstream containing: entry_length, tombstone_flag, key_size, key data, value_size, value data, checksum
+		//@returns ostringstream containing: entry_length, tombstone_flag, sequence_number, expiry_time (if set), key_size, key data, value_size, value data, checksum
 		std::ostringstream get_ostream_bytes();
 		//@brief serializes entry data without key to string using memcpy
-		//@returns string containing: tombstone_flag, value_size, value data, checksum
+		//@returns string containing: tombstone_flag, sequence_number, expiry_time (if set), value_size, value data, checksum
 		//@note excludes entry_length and key fields
 		std::string get_string_data_bytes() const;
 		//@brief serializes key bytes only to string using memcpy
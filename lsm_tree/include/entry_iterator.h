@@ -0,0 +1,36 @@
+#ifndef YSQL_ENTRY_ITERATOR_H_INCLUDED
+#define YSQL_ENTRY_ITERATOR_H_INCLUDED
+
+#include "bits.h"
+#include "entry.h"
+#include <cstdint>
+
+enum Iterator_Direction : uint8_t {
+    ITERATOR_FORWARD,
+    ITERATOR_BACKWARD
+};
+
+// Walks the keys of a sorted source in one direction, one key at a time
+// every key is reported once, with the newest version visible at the snapshot the iterator was created with
+// tombstones are reported as well, it is up to the caller to skip them
+class Entry_Iterator {
+    public:
+        virtual ~Entry_Iterator() = default;
+
+        // THROWS
+        // @brief positions the iterator on the first key >= target when going forward, or the last key <= target when going backward
+        // following next() calls keep moving in the same direction
+        virtual void seek(const Bits& target, Iterator_Direction direction) = 0;
+
+        // @returns false once the iterator has run past the end of its source
+        virtual bool valid() const = 0;
+
+        // THROWS
+        // @brief moves to the next key in the direction of the last seek
+        virtual void next() = 0;
+
+        // @brief the current entry, only meaningful while valid() is true
+        virtual const Entry& entry() const = 0;
+};
+
+#endif // YSQL_ENTRY_ITERATOR_H_INCLUDED
@@ -0,0 +1,43 @@
+#ifndef YSQL_LEVEL_ITERATOR_H_INCLUDED
+#define YSQL_LEVEL_ITERATOR_H_INCLUDED
+
+#include "entry_iterator.h"
+#include "ss_table.h"
+#include <memory>
+#include <vector>
+
+// Walks a level whose tables do not overlap as one sorted run
+// only the table the iterator is currently in is open, the others are skipped by their key ranges
+class Level_Iterator : public Entry_Iterator {
+    private:
+        // tables of the level ordered by their first key
+        std::vector<const SS_Table*> ss_tables;
+        sequence_number_type snapshot;
+        Iterator_Direction direction;
+
+        size_t table_position;
+        // nullptr once the iterator ran past the last table
+        std::unique_ptr<SS_Table::Iterator> table_iterator;
+
+        // THROWS
+        // @brief opens the table at position and seeks it to target
+        void open_table(size_t position, const Bits& target);
+
+        // THROWS
+        // @brief while the current table is exhausted moves on to the next table in the direction of the scan
+        void skip_exhausted_tables();
+
+    public:
+        // @param _ss_tables - tables of the level ordered by their first key
+        Level_Iterator(const std::vector<const SS_Table*>& _ss_tables, sequence_number_type _snapshot);
+
+        void seek(const Bits& target, Iterator_Direction _direction) override;
+
+        bool valid() const override;
+
+        void next() override;
+
+        const Entry& entry() const override;
+};
+
+#endif // YSQL_LEVEL_ITERATOR_H_INCLUDED
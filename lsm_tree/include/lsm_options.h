@@ -0,0 +1,79 @@
+#ifndef YSQL_LSM_OPTIONS_H_INCLUDED
+#define YSQL_LSM_OPTIONS_H_INCLUDED
+
+#include "bloom_filter.h"
+#include "buffered_file_writer.h"
+#include "mem_table.h"
+#include "prefix_extractor.h"
+#include "ss_table_controller.h"
+#include <cstdint>
+#include <filesystem>
+
+#define LSM_OPTIONS_DEFAULT_DATA_DIR "./data/val"
+#define LSM_OPTIONS_DEFAULT_WAL_DIR "./data/wal"
+
+// every option can be overridden through the environment by LSM_Options::from_environment(), a value that does not parse keeps the default
+#define LSM_TREE_DATA_DIR_ENV_VAR "LSM_TREE_DATA_DIR"
+#define LSM_TREE_WAL_DIR_ENV_VAR "LSM_TREE_WAL_DIR"
+#define LSM_TREE_MEM_TABLE_SIZE_ENV_VAR "LSM_TREE_MEM_TABLE_SIZE"
+#define LSM_TREE_LEVEL_SIZE_RATIO_ENV_VAR "LSM_TREE_LEVEL_SIZE_RATIO"
+#define LSM_TREE_LEVEL_SIZE_BASE_ENV_VAR "LSM_TREE_LEVEL_SIZE_BASE"
+#define LSM_TREE_PREFIX_FILTER_BITS_PER_KEY_ENV_VAR "LSM_TREE_PREFIX_FILTER_BITS_PER_KEY"
+
+// how compaction reads its inputs and writes its output: "buffered", "drop_cache" (default) or "direct"
+// anything but "buffered" keeps compaction from pushing the tables foreground reads need out of the page cache
+#define LSM_TREE_COMPACTION_IO_ENV_VAR "LSM_TREE_COMPACTION_IO"
+#define LSM_TREE_DEFAULT_COMPACTION_IO_MODE FILE_IO_DROP_CACHE
+
+// prefix the per table prefix filters are built over, "fixed:<length>" or "delimiter:<char>", unset means no filters
+// prefix scans skip the tables whose filter rules their prefix out
+#define LSM_TREE_PREFIX_EXTRACTOR_ENV_VAR "LSM_TREE_PREFIX_EXTRACTOR"
+
+// values at least this many bytes long are moved to the value log when the mem_table is flushed, 0 keeps every value in the tables
+#define LSM_TREE_VALUE_LOG_THRESHOLD_ENV_VAR "LSM_TREE_VALUE_LOG_THRESHOLD"
+#define LSM_TREE_DEFAULT_VALUE_LOG_THRESHOLD 65536
+
+// threads the tables are opened with at startup, each reads the prefix filters and, without a manifest, the first and last keys of its share
+#define LSM_TREE_TABLE_OPEN_THREADS_ENV_VAR "LSM_TREE_TABLE_OPEN_THREADS"
+#define LSM_TREE_DEFAULT_TABLE_OPEN_THREADS 8
+
+// "1" opens the tables lazily, a prefix filter is read by the first prefix scan reaching its table instead of at startup
+// with a manifest startup then reads no table file at all
+#define LSM_TREE_LAZY_TABLE_OPEN_ENV_VAR "LSM_TREE_LAZY_TABLE_OPEN"
+
+// Everything an LSM_Tree can be tuned with, fixed for the lifetime of the tree
+// trees with different data_dir and wal_dir are independent of each other and can live in one process
+struct LSM_Options {
+    // levels, the manifest, the value log and quarantined tables go here
+    std::filesystem::path data_dir;
+    std::filesystem::path wal_dir;
+
+    // the mem_table is flushed once it holds this many bytes
+    uint64_t mem_table_max_size;
+
+    // level n may grow to level_size_base * level_size_ratio^(n + 1) bytes before it is compacted into the next one
+    uint16_t level_size_ratio;
+    uint64_t level_size_base;
+
+    // new tables get a prefix filter over what prefix_extractor extracts, none by default
+    Prefix_Extractor prefix_extractor;
+    uint32_t prefix_filter_bits_per_key;
+
+    // values at least this long are moved to the value log on flush, 0 keeps every value in the tables
+    uint64_t value_log_threshold;
+
+    // page cache policy of compaction reads and writes, flushes always go through the cache as fresh tables are the hot ones
+    File_Io_Mode compaction_io_mode;
+
+    // startup only, see LSM_TREE_TABLE_OPEN_THREADS_ENV_VAR and LSM_TREE_LAZY_TABLE_OPEN_ENV_VAR
+    uint32_t table_open_threads;
+    bool lazy_table_open;
+
+    // @brief the compiled in defaults, the environment is not looked at
+    LSM_Options();
+
+    // @returns the defaults with the LSM_TREE_* environment variables applied on top
+    static LSM_Options from_environment();
+};
+
+#endif // YSQL_LSM_OPTIONS_H_INCLUDED
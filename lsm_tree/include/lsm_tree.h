@@ -7,11 +7,25 @@
 
 #include "bits.h"
 #include "entry.h"
+#include "lsm_options.h"
 #include "wal.h"
 #include "mem_table.h"
 #include "ss_table_controller.h"
+#include "tree_version.h"
+#include "manifest.h"
+#include "snapshot.h"
+#include "merging_iterator.h"
+#include "write_batch.h"
+#include "value_log.h"
+#include "compaction_filter.h"
+#include "merge_operator.h"
+#include "table_scrubber.h"
+#include "statistics.h"
 #include <thread>
 #include <limits>
+#include <memory>
+#include <atomic>
+#include <mutex>
 #include <algorithm>
 
 #include "../include/min_heap.h"
@@ -20,6 +34,7 @@
 #include <fstream>
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
 #include <set>
 #include <regex>
 #include <map>
@@ -28,67 +43,344 @@
 #define LSM_TREE_SS_TABLE_FILE_NAME_DATA ".sst_l%u_data_%lu.bin"
 #define LSM_TREE_SS_TABLE_FILE_NAME_INDEX ".sst_l%u_index_%lu.bin"
 #define LSM_TREE_SS_TABLE_FILE_NAME_OFFSET ".sst_l%u_offset_%lu.bin"
-#define LSM_TREE_LEVEL_DIR "./data/val/Level_%u"
+#define LSM_TREE_SS_TABLE_FILE_NAME_FILTER ".sst_l%u_filter_%lu.bin"
+#define LSM_TREE_LEVEL_DIR "Level_%u"
 #define LSM_TREE_SS_TABLE_MAX_LENGTH 35
-#define LSM_TREE_SS_LEVEL_PATH "./data/val/"
 #define LSM_TREE_TYPE_DATA "data"
 #define LSM_TREE_TYPE_INDEX "index"
 #define LSM_TREE_TYPE_OFFSET "offset"
+#define LSM_TREE_TYPE_FILTER "filter"
 
 
 #define LSM_TREE_EMPTY_SS_TABLE_CONTROLLERS_ERR_MSG "LSM_Tree ss_table_controller vector is empty\n"
 #define LSM_TREE_EMPTY_ENTRY_VECTOR_ERR_MSG "LSM_Tree empty entries vector, could not fill ss table\n"
 #define LSM_TREE_GETRLIMIT_ERR_MSG "Failed getrlimit() call\n"
 #define LSM_TREE_FAILED_COMPACTION_ERR_MSG "Failed to compact levels\n"
+#define LSM_TREE_RECONSTRUCT_FAILED_ERR_MSG "LSM_Tree failed to rebuild its levels from disk, refusing to open\n"
+#define LSM_TREE_MANIFEST_MISSING_TABLE_ERR_MSG "LSM_Tree table listed in the manifest is missing files, dropping it: "
+#define LSM_TREE_UNKNOWN_MERGE_OPERATOR_ERR_MSG "LSM_Tree merge operand names a merge operator that is not registered\n"
+#define LSM_TREE_CHECKPOINT_EXISTS_ERR_MSG "LSM_Tree checkpoint directory already exists\n"
+#define LSM_TREE_CHECKPOINT_FAILED_SYNC_ERR_MSG "LSM_Tree failed to sync a checkpoint file\n"
+#define LSM_TREE_INGEST_BAD_FILE_NAME_ERR_MSG "LSM_Tree can only ingest table data files named like the ones of a level directory\n"
+#define LSM_TREE_INGEST_LIVE_SNAPSHOT_ERR_MSG "LSM_Tree can not ingest tables while a snapshot is live\n"
 
-#define LSM_TREE_LEVEL_0_PATH "./data/val/Level_0"
-#define LSM_TREE_CORRUPT_FILES_PATH "./data/val/corrupted"
+// a blob file is rewritten once at least this part of it is no longer referenced
+#define LSM_TREE_VALUE_LOG_GC_MIN_GARBAGE_RATIO 0.5
+
+// reading at this snapshot sees every write
+#define LSM_TREE_LATEST_SNAPSHOT ENTRY_MAX_SEQUENCE_NUMBER
+
+// ttl of a set that never expires
+#define LSM_TREE_NO_TTL 0
+
+// tables that can not be read are moved here, inside LSM_Options::data_dir
+#define LSM_TREE_CORRUPT_FILES_DIR "corrupted"
+#define LSM_TREE_QUARANTINED_TABLE_MSG "LSM_Tree table failed its scrub, its records are gone and its files were moved to "
+
+// a checkpoint mirrors LSM_Options: the tables, manifest and value log go to <checkpoint>/val, the wal to <checkpoint>/wal
+#define LSM_TREE_CHECKPOINT_DATA_DIR_NAME "val"
+#define LSM_TREE_CHECKPOINT_WAL_DIR_NAME "wal"
+
+// ingested tables are never placed deeper than this, even if the levels above could not hold them
+#define LSM_TREE_INGEST_MAX_LEVEL 16
+
+// tables are scrubbed again once this much time passed since the last scrub, well inside the period lookups trust a scrub for
+#define LSM_TREE_SCRUB_INTERVAL_MS (SS_TABLE_SCRUB_TRUST_PERIOD_MS / 2)
+
+// read amplification of point lookups, tables_probed / gets is the average number of tables searched per GET
+struct LSM_Tree_Read_Amplification{
+    uint64_t gets;
+    uint64_t tables_probed;
+};
+
+// tables_skipped / prefix_scans is the average number of tables a prefix scan did not have to open thanks to the prefix filters
+struct LSM_Tree_Prefix_Scan_Stats{
+    uint64_t prefix_scans;
+    uint64_t tables_skipped;
+};
+
+// tables_quarantined out of the tables_scrubbed, bytes_scrubbed covers every record checked
+struct LSM_Tree_Scrub_Stats{
+    uint64_t tables_scrubbed;
+    uint64_t bytes_scrubbed;
+    uint64_t tables_quarantined;
+};
+
+// records_dropped and values_changed out of the records_filtered the compaction filter was asked about
+struct LSM_Tree_Compaction_Filter_Stats{
+    uint64_t records_filtered;
+    uint64_t records_dropped;
+    uint64_t values_changed;
+};
+
+// where the time opening the tree went, level_recovery covers reading the manifest (or listing the levels without one) and writing it anew
+// table_open covers reading the tables on options.table_open_threads threads, deferred_filters of the tables were left to their first prefix scan
+struct LSM_Tree_Startup_Stats{
+    uint64_t wal_replay_micros;
+    uint64_t level_recovery_micros;
+    uint64_t table_open_micros;
+    uint64_t tables;
+    uint64_t deferred_filters;
+};
+
+// the files of one table, the filter file may be missing
+struct SS_Table_Files{
+    std::filesystem::path data_file;
+    std::filesystem::path index_file;
+    std::filesystem::path offset_file;
+    std::filesystem::path filter_file;
+};
 
 class LSM_Tree{
     private:
+        // fixed at construction, declared first as the members below are built from it
+        const LSM_Options options;
+
+        // filled in while the tree is opened, declared before the mem_table whose wal replay it times
+        LSM_Tree_Startup_Stats startup_stats;
+
         Wal write_ahead_log;
-        Mem_Table mem_table;
-        // one contrller per each level
+        // the mem_table writes go to, shared with the current version
+        std::shared_ptr<Mem_Table> mem_table;
+        // durable record of which tables make up each level
+        Manifest manifest;
+        // large values, the tables only keep pointers to them
+        Value_Log value_log;
+        // one contrller per each level, changed by flush and compaction only, readers go through current_version
         std::vector<SS_Table_Controller> ss_table_controllers;
+
+        // what readers see, swapped with std::atomic_store by install_version() and loaded with std::atomic_load
+        std::shared_ptr<const Tree_Version> current_version;
         uint16_t ratio;
         uint64_t max_files_count;
 
+        // sequence number of the newest write, every write takes the next one
+        std::atomic<sequence_number_type> last_sequence_number;
+
+        // counters and latencies of reads, writes, flushes and compactions, readers update it concurrently
+        Statistics statistics;
+
+        // counted by get_keys_cursor_prefix()
+        std::atomic<uint64_t> prefix_scan_count;
+        std::atomic<uint64_t> prefix_scan_tables_skipped;
+
+        // asked about the newest version of every key compaction rewrites, none by default
+        std::shared_ptr<const Compaction_Filter> compaction_filter;
+        std::atomic<uint64_t> compaction_filter_records;
+        std::atomic<uint64_t> compaction_filter_dropped;
+        std::atomic<uint64_t> compaction_filter_changed;
+
+        // counted by the scrub functions, which run concurrently with readers
+        std::atomic<uint64_t> scrub_tables;
+        std::atomic<uint64_t> scrub_bytes;
+        std::atomic<uint64_t> scrub_quarantined;
+
+        // operators folding merge operands, by the id every operand starts with
+        std::map<merge_operator_id_type, std::shared_ptr<const Merge_Operator>> merge_operators;
+
+        // snapshots handed out and not released yet, compaction and the mem_table keep the versions they can see
+        std::mutex live_snapshots_mutex;
+        std::multiset<sequence_number_type> live_snapshots;
+
+        // @returns a sorted copy of the live snapshots
+        std::vector<sequence_number_type> get_live_snapshots();
+
+        // @brief publishes mem_table and a copy of ss_table_controllers as the version readers load from now on
+        // every change to the levels is followed by it, readers never see a level half way through a change
+        void install_version();
+
+        // @returns the current version, it stays readable for as long as the caller holds it
+        std::shared_ptr<const Tree_Version> get_version() const;
+
         // returns Max open files per process
         uint64_t get_max_file_limit();
 
-        struct SS_Table_Files{
-            std::filesystem::path data_file;
-            std::filesystem::path index_file;
-            std::filesystem::path offset_file;
-        };
+        // @returns the directory holding the tables of level inside options.data_dir
+        std::filesystem::path get_level_dir(level_index_type level) const;
+
+        // @returns the directory unreadable tables are moved to
+        std::filesystem::path get_corrupt_files_dir() const;
+
+        // THROWS
+        // @brief appends a record to the wal, timing it and counting its bytes
+        void append_to_wal(std::ostringstream& bytes);
+
+        // THROWS
+        // @brief the newest version of key in version visible at snapshot, values in the value log are left as pointers
+        Entry find_entry(const Tree_Version& version, const Bits& key_bits, sequence_number_type snapshot, uint64_t* tables_probed = nullptr);
+
+        // THROWS
+        // @brief get_iterator() over the mem_table and tables of version, it must not outlive version
+        std::unique_ptr<Entry_Iterator> get_iterator(const Tree_Version& version, sequence_number_type snapshot, const std::string& prefix = "", uint64_t* tables_skipped = nullptr);
+
+        // @returns paths of the files backing table table_id on a given level
+        SS_Table_Files get_ss_table_files(level_index_type level, uint64_t table_id);
+
+        // @brief creates the level directory if needed and returns a new empty table
+        std::shared_ptr<SS_Table> create_ss_table(level_index_type level, uint64_t table_id);
+
+        // THROWS
+        // @brief rebuilds the levels from the manifest without opening any table files
+        // files that the manifest does not know about are leftovers of an unfinished flush or compaction and are removed
+        void reconstruct_from_manifest();
+
+        // THROWS
+        // @brief rebuilds the levels by scanning the level directories, used when there is no manifest yet
+        void reconstruct_from_files();
 
-        // performs validation with given set and inserts if operation matches
-        void forward_validate(std::set<Entry>& entries, const Entry& entry_to_append, bool is_greater_operation, const Bits key_value);
+        // THROWS
+        // @returns the mem_table rebuilt from the wal, the time it took goes to startup_stats
+        std::shared_ptr<Mem_Table> replay_wal();
 
-        // performs cleaning operation on the given set to keep only the n number of entries
-        Bits clean_forward_set(std::set<Entry>& set_to_clean,const bool is_greater_operation, uint16_t n);
+        // THROWS
+        // @brief reads the prefix filters of tables that have one (the second of each pair) on options.table_open_threads threads
+        // with options.lazy_table_open the filters are left to the first prefix scan instead, with reconstruct the first and last keys are read too
+        void open_ss_tables(const std::vector<std::pair<std::shared_ptr<SS_Table>, bool>>& tables, bool reconstruct);
 
-        // performs cleaning operation on the given set to keep only the n number of entries
-        Bits clean_forward_set_keys(std::set<Bits>& set_to_clean, uint16_t n);
+        // THROWS
+        // @returns the operator registered under id
+        const Merge_Operator* get_merge_operator(merge_operator_id_type id) const;
 
-        // calculate the next possible string
-        std::string next_prefix(const std::string& prefix);
+        // THROWS
+        // @brief applies encoded operands (newest first) on top of existing_value, an operand that does not apply is skipped
+        // @returns false if no value comes out, there was no existing value and no operand applied
+        bool apply_merge_operands(const std::string& key, const std::string* existing_value, const std::vector<std::string>& operands, std::string& value) const;
 
-        // returns a filtered set with correct prefix
-        std::set<Bits> clear_larger_prefix(const std::set<Bits>& keys,const std::string& prefix);
+        // THROWS
+        // @brief combines two encoded operands into one if they use the same operator and it can combine them
+        bool combine_merge_operands(const std::string& key, const std::string& older_operand, const std::string& newer_operand, std::string& combined_operand) const;
+
+        // THROWS
+        // @brief walks down from a merge operand to the version it applies to, collecting the operands on the way newest first
+        // @returns the version below the operands, a placeholder if there is none
+        Entry find_merge_base(const Tree_Version& version, const Bits& key_bits, const Entry& operand, std::vector<std::string>& operands, uint64_t* tables_probed = nullptr);
+
+        // THROWS
+        // @brief turns a merge operand into the value it stands for, or a tombstone if nothing comes out, other entries are left alone
+        void fold_merge_operands(const Tree_Version& version, Entry& entry, uint64_t* tables_probed = nullptr);
+
+        // THROWS
+        // @brief folds the merge operand on top of a key being compacted with the older versions of it still on the heap
+        // the versions it used are taken off the heap, without the version below the operands they are only combined where possible
+        // @returns the data strings to write newest first, nothing if the key goes away
+        std::vector<std::string> merge_compaction_operands(const Bits& key, std::string& key_string, std::string& newest_data_string, Min_Heap& heap, bool bottom_level);
+
+        // THROWS
+        // @brief runs the expiry check and the compaction filter over the newest version of a key being compacted
+        // a value changed by the filter is written back into data_string
+        // @returns true if the version has to go
+        bool filter_compaction_record(level_index_type output_level, std::string& key, std::string& data_string, sequence_number_type version_sequence_number, const std::vector<sequence_number_type>& snapshots, uint64_t now);
+
+        // THROWS
+        // @brief deletes every table whose records have all expired without reading it
+        // a table is only dropped if no older table holds any of its keys, otherwise the older versions would come back
+        void drop_expired_ss_tables();
 
     public:
-        // default constructor initializes mem_table 
+        // @returns paths of the files backing table table_id of level inside dir, named the way every level directory names them
+        static SS_Table_Files get_ss_table_files(const std::filesystem::path& dir, level_index_type level, uint64_t table_id);
+
+        // @brief opens the tree with LSM_Options::from_environment()
         LSM_Tree();
 
+        // @brief opens the tree kept in options.data_dir and options.wal_dir, creating them if needed
+        explicit LSM_Tree(const LSM_Options& _options);
+
         // destructor deallocates mem_table
         ~LSM_Tree();
 
-        // returns an Entry object with provided key
-        Entry get(std::string key);
+        // returns an Entry object with provided key, as it was when snapshot was acquired
+        // get, multi_get, the scans, get_iterator and get_statistics read a version of the tree without locking it
+        // so they may run concurrently with each other and with one writer, flush and compaction never make them wait
+        Entry get(std::string key, sequence_number_type snapshot = LSM_TREE_LATEST_SNAPSHOT);
+
+        // @brief get() for many keys at once, returns one entry per key in the order of keys
+        // the keys are sorted first so every table is opened and searched once for all of the keys in its range
+        // missing keys get the same placeholder get() returns
+        std::vector<Entry> multi_get(const std::vector<std::string>& keys, sequence_number_type snapshot = LSM_TREE_LATEST_SNAPSHOT);
+
+        // @returns how many tables point lookups had to search so far
+        LSM_Tree_Read_Amplification get_read_amplification() const;
+
+        // @brief every counter of the tree by name, the statistics together with the mem_table size, the size and table count of every level
+        // and the prefix scan, compaction filter and scrub counts, histograms come as buckets (see Statistics::add_counters)
+        // like get() it may run concurrently with other readers
+        std::map<std::string, uint64_t> get_statistics();
+
+        // @returns how many tables prefix scans skipped so far
+        LSM_Tree_Prefix_Scan_Stats get_prefix_scan_stats() const;
+
+        // @brief installs the filter compactions started from now on run records through, nullptr removes it
+        // like set() it must not run concurrently with writes
+        void set_compaction_filter(std::shared_ptr<const Compaction_Filter> filter);
+
+        // @returns how many records the compaction filter saw, dropped and changed so far
+        LSM_Tree_Compaction_Filter_Stats get_compaction_filter_stats() const;
+
+        // THROWS
+        // @brief opens the table scrubbed longest ago for a scrub, tables scrubbed within LSM_TREE_SCRUB_INTERVAL_MS are left alone
+        // may run concurrently with readers, the returned scrubber is then stepped without holding anything
+        // @returns nullptr if there is nothing to scrub
+        std::unique_ptr<Table_Scrubber> start_scrub();
+
+        // @brief records the result of a finished scrub, lookups stop checking checksums of an intact table for a while
+        // may run concurrently with readers
+        // @returns false if the table is corrupted and has to be quarantined with quarantine_ss_table()
+        bool finish_scrub(const Table_Scrubber& scrubber);
+
+        // THROWS
+        // @brief takes a corrupted table out of the tree and moves its files to LSM_TREE_CORRUPT_FILES_DIR, older versions of its keys show again
+        // like set() it must not run concurrently with other calls
+        // @returns false if the table is not part of the tree any more
+        bool quarantine_ss_table(level_index_type level, uint64_t table_id);
+
+        // @returns how many tables were scrubbed and quarantined so far
+        LSM_Tree_Scrub_Stats get_scrub_stats() const;
+
+        // @returns how long the phases of opening the tree took
+        LSM_Tree_Startup_Stats get_startup_stats() const;
+
+        // THROWS
+        // @brief replaces the value of an entry that points into the value log with the value itself
+        // get, multi_get, get_ff and get_fb do this already, entries coming from get_iterator() may still hold pointers
+        void resolve_value(Entry& entry) const;
+
+        // @brief rewrites the still referenced blobs of every value log file that is at least min_garbage_ratio garbage and deletes the file
+        // the rewritten keys are flushed into a new table, so like set() it must not run concurrently with other calls
+        // readers included, one still holding an older version could follow a pointer into a deleted file
+        // nothing is collected while a snapshot is live
+        // @returns the number of bytes reclaimed
+        uint64_t collect_value_log_garbage(double min_garbage_ratio = LSM_TREE_VALUE_LOG_GC_MIN_GARBAGE_RATIO);
+
+        // THROWS
+        // @brief writes a copy of the tree to checkpoint_dir that an LSM_Tree opened on its val and wal directories reads as this one
+        // the live tables and sealed value log files are hard linked (copied if the filesystem can not link them), only the wal is copied
+        // and a new manifest lists the tables, so it takes about as long as the wal copy whatever the size of the tree
+        // the linked files are never written again, compaction and garbage collection only unlink them, so the checkpoint stays intact
+        // like set() it must not run concurrently with writes, checkpoint_dir must not exist yet and is removed again if anything fails
+        void create_checkpoint(const std::filesystem::path& checkpoint_dir);
+
+        // THROWS
+        // @brief adds tables written outside of the tree (see SS_Table_Writer) without rewriting them, data_files name their data files
+        // the tables are linked in (copied across filesystems) and recorded in the manifest with one edit, later files count as newer
+        // a table overlapping level 0 becomes its newest table, others sink while the next level has nothing overlapping them,
+        // down to the deepest existing level, level 1 or the first level that could hold all of them, whichever is deepest
+        // a mem_table overlapping them is flushed first, with move_files the original files are removed once the tables are in
+        // records keep ENTRY_NO_SEQUENCE_NUMBER, their order against other writes comes from where they are placed
+        // so a snapshot taken before the ingest would see them, ingesting while one is live throws
+        // like set() it must not run concurrently with writes
+        void ingest_files(const std::vector<std::filesystem::path>& data_files, bool move_files = false);
+
+        // THROWS
+        // @brief returns an iterator over the whole tree as it was at snapshot, every key once with its newest version
+        // tombstones are returned too, the iterator has to be positioned with seek(), it keeps the tables it reads alive so writes may go on meanwhile
+        // with a prefix only the keys starting with it are guaranteed to be there, tables that can not hold any of them are left out
+        // if tables_skipped is given it is increased by the number of tables left out
+        std::unique_ptr<Entry_Iterator> get_iterator(sequence_number_type snapshot = LSM_TREE_LATEST_SNAPSHOT, const std::string& prefix = "", uint64_t* tables_skipped = nullptr);
 
         // returns true if inserting a value was successful
-        bool set(std::string key, std::string value);
+        // with a ttl (in milliseconds) the key reads as deleted once it runs out and compaction drops it
+        bool set(std::string key, std::string value, uint64_t ttl = LSM_TREE_NO_TTL);
 
         // Returns a pair containing a set of up to n keys and the skip value for the next call
         // @param n - number of keys to return
@@ -104,9 +396,11 @@ class LSM_Tree{
         // @note For pagination: use the returned uint16_t as skip_n in the next call to get the next batch
         std::pair<std::set<Bits>, uint16_t> get_keys(std::string prefix, uint16_t n, uint16_t skip_n = 0);
 
-        std::pair<std::set<Bits>, std::string> get_keys_cursor(std::string cursor, uint16_t n);
+        std::pair<std::set<Bits>, std::string> get_keys_cursor(std::string cursor, uint16_t n, sequence_number_type snapshot = LSM_TREE_LATEST_SNAPSHOT);
 
-        std::pair<std::set<Bits>, std::string> get_keys_cursor_prefix(std::string prefix,std::string cursor, uint16_t n);
+        // @brief like get_keys_cursor, limited to the keys starting with prefix
+        // if tables_skipped is given it is set to the number of tables the scan skipped thanks to their prefix filters
+        std::pair<std::set<Bits>, std::string> get_keys_cursor_prefix(std::string prefix,std::string cursor, uint16_t n, sequence_number_type snapshot = LSM_TREE_LATEST_SNAPSHOT, uint64_t* tables_skipped = nullptr);
 
         // Returns up to n entries with keys greater than or equal to the given key (forward pagination)
         // @param _key - the starting key (inclusive) for the search
@@ -115,7 +409,8 @@ class LSM_Tree{
         // @note For pagination: use the returned string as _key in the next call to get the next batch
         // @note The next key is the first key that was excluded (boundary key), or empty if no more entries
         // @note Searches both mem_table and all SS_Tables, with newer entries taking precedence
-        std::pair<std::set<Entry>, std::string> get_ff(std::string _key, uint16_t n);
+        // @note Only writes made before snapshot was acquired are visible
+        std::pair<std::set<Entry>, std::string> get_ff(std::string _key, uint16_t n, sequence_number_type snapshot = LSM_TREE_LATEST_SNAPSHOT);
 
         // Returns up to n entries with keys less than or equal to the given key (backward pagination)
         // @param _key - the starting key (inclusive) for the search
@@ -124,11 +419,34 @@ class LSM_Tree{
         // @note For pagination: use the returned string as _key in the next call to get the previous batch
         // @note The next key is the last key that was excluded (boundary key), or empty if no more entries
         // @note Searches both mem_table and all SS_Tables, with newer entries taking precedence
-        std::pair<std::set<Entry>, std::string> get_fb(std::string _key, uint16_t n);
+        // @note Only writes made before snapshot was acquired are visible
+        std::pair<std::set<Entry>, std::string> get_fb(std::string _key, uint16_t n, sequence_number_type snapshot = LSM_TREE_LATEST_SNAPSHOT);
 
         // returns true if removing an entry with provided key was successful
         bool remove(std::string key);
 
+        // @brief writes operand without reading the key, reads fold it into the value below with the operator registered under merge_operator_id
+        // an operand landing on a key the mem_table holds is folded right away, so the mem_table keeps one version per key
+        // @returns false if the operator is unknown, refuses the operand or the operand does not apply to a value already known
+        bool merge(std::string key, merge_operator_id_type merge_operator_id, std::string operand);
+
+        // @brief makes operands written with id fold with merge_operator, MERGE_OPERATOR_INT64_ADD and MERGE_OPERATOR_APPEND are there from the start
+        // operands stay on disk, so an id must keep its operator across restarts, like set() it must not run concurrently with other calls
+        void register_merge_operator(merge_operator_id_type id, std::shared_ptr<const Merge_Operator> merge_operator);
+
+        // @brief applies every put and remove of batch as one write, logged as a single wal record
+        // after a crash either the whole batch is recovered or none of it
+        // @returns true if the batch was applied
+        bool write(const Write_Batch& batch);
+
+        // @brief pins the current state of the tree, reads given the returned snapshot ignore every later write
+        // the versions the snapshot can see are kept until it is released
+        // it must not run concurrently with writes, a write numbered but not yet in the mem_table would show up later
+        sequence_number_type acquire_snapshot();
+
+        // @brief releases a snapshot returned by acquire_snapshot
+        void release_snapshot(sequence_number_type snapshot);
+
         // flushes MemTable to SStable
         void flush_mem_table();
 
@@ -141,6 +459,9 @@ class LSM_Tree{
         // returns a pair <level, ratio> of the highest fill ratio on whole LSM tree
         std::pair<uint16_t, double> get_max_fill_ratio();
 
+        // returns the size, table count and fill ratio of every level, level 0 first
+        std::vector<SS_Table_Controller_Stats> get_level_stats() const;
+
         // reconstructs LSM tree in case of a crash
         bool reconstruct_tree();
 };
@@ -0,0 +1,137 @@
+#ifndef YSQL_MANIFEST_H_INCLUDED
+#define YSQL_MANIFEST_H_INCLUDED
+
+#include "ss_table.h"
+#include "crc32.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#define MANIFEST_FILE_PATH "./data/val/MANIFEST"
+#define MANIFEST_TMP_FILE_PATH "./data/val/MANIFEST.tmp"
+#define MANIFEST_FILE_NAME "MANIFEST"
+#define MANIFEST_TMP_FILE_NAME "MANIFEST.tmp"
+
+// once the log grows past this many bytes it is rewritten as a single snapshot record
+#define MANIFEST_REWRITE_THRESHOLD 4000000
+
+#define MANIFEST_FAILED_TO_OPEN_ERR_MSG "Manifest failed to open the manifest file\n"
+#define MANIFEST_FAILED_WRITE_ERR_MSG "Manifest failed to write a version edit\n"
+#define MANIFEST_FAILED_SYNC_ERR_MSG "Manifest failed to sync the manifest file\n"
+#define MANIFEST_FAILED_RENAME_ERR_MSG "Manifest failed to install the rewritten manifest\n"
+#define MANIFEST_NOT_OPEN_ERR_MSG "Manifest was not opened before logging an edit\n"
+#define MANIFEST_TORN_TAIL_MSG "Manifest ends in a torn record, it was dropped\n"
+#define MANIFEST_CORRUPTED_ERR_MSG "Manifest has a corrupted record before its end, refusing to replay it\n"
+
+// tag of every edit inside a manifest record, unknown tags are skipped on replay
+enum Manifest_Edit_Tag : uint8_t {
+    MANIFEST_EDIT_ADD_TABLE = 1,
+    MANIFEST_EDIT_REMOVE_TABLE,
+    MANIFEST_EDIT_LAST_SEQUENCE_NUMBER
+};
+
+// @brief everything needed to bring an SS_Table back without opening its files
+struct Manifest_Table_Record {
+    level_index_type level;
+    uint64_t table_id;
+    uint64_t record_count;
+    uint64_t data_file_size;
+    uint64_t index_file_size;
+    uint64_t index_offset_file_size;
+    std::string first_key;
+    std::string last_key;
+    // written after the keys, records from before ttls existed lack them and never expire
+    uint64_t min_expiry_time = SS_TABLE_NEVER_EXPIRES;
+    uint64_t max_expiry_time = SS_TABLE_NEVER_EXPIRES;
+};
+
+// @brief snapshots the metadata of a table
+Manifest_Table_Record make_manifest_table_record(const SS_Table* ss_table);
+
+// @brief a group of table additions and removals that is applied all at once
+// a compaction is logged as one edit, so after a crash either all of it is visible or none of it is
+struct Manifest_Version_Edit {
+    std::vector<Manifest_Table_Record> added_tables;
+    std::vector<std::pair<level_index_type, uint64_t>> removed_tables;
+
+    // every sequence number up to this one is covered by the tables, numbering resumes after it
+    bool has_last_sequence_number = false;
+    sequence_number_type last_sequence_number = ENTRY_NO_SEQUENCE_NUMBER;
+
+    void add_table(const SS_Table* ss_table);
+    void remove_table(const SS_Table* ss_table);
+    void set_last_sequence_number(sequence_number_type _last_sequence_number);
+    bool empty() const;
+};
+
+// Append only log of version edits describing which tables belong to which level
+// record on disk: [u32 payload_length][u32 crc32(payload)][payload]
+// payload: repeated [u8 tag][u32 body_length][body]
+class Manifest {
+    private:
+        std::filesystem::path manifest_file;
+        std::filesystem::path manifest_tmp_file;
+        int fd;
+        uint64_t file_size;
+
+        // live tables per level in install order (oldest first), same order as the controllers
+        std::vector<std::vector<Manifest_Table_Record>> levels;
+
+        sequence_number_type last_sequence_number;
+
+        // set by recover() if the last record was torn and dropped
+        bool torn_tail;
+
+        void apply(const Manifest_Version_Edit& edit);
+
+        std::string encode_edit(const Manifest_Version_Edit& edit) const;
+
+        // THROWS
+        // @returns false if payload is malformed
+        bool decode_edit(const std::string& payload, Manifest_Version_Edit& edit) const;
+
+        // THROWS
+        // @brief writes one framed record and syncs it
+        void write_record(int target_fd, const std::string& payload);
+
+        void close_fd();
+
+    public:
+        Manifest();
+
+        Manifest(const std::filesystem::path& _manifest_file, const std::filesystem::path& _manifest_tmp_file);
+
+        ~Manifest();
+
+        Manifest(const Manifest&) = delete;
+        Manifest& operator=(const Manifest&) = delete;
+
+        // @returns true if a manifest file is present on disk
+        bool exists() const;
+
+        // THROWS
+        // @brief replays the manifest, a short or corrupted record is only dropped if nothing follows it (a write torn by a crash)
+        // anywhere else it throws, as every table added after it would be lost
+        // @returns live tables per level, in the order they were installed
+        const std::vector<std::vector<Manifest_Table_Record>>& recover();
+
+        // THROWS
+        // @brief replaces the in memory state with tables and rewrites the manifest as a single snapshot record
+        // the new file is written next to the old one and renamed over it, then opened for appending
+        void rewrite(const std::vector<std::vector<Manifest_Table_Record>>& tables);
+
+        // THROWS
+        // @brief durably appends an edit, once this returns the edit survives a crash
+        void log_edit(const Manifest_Version_Edit& edit);
+
+        const std::vector<std::vector<Manifest_Table_Record>>& get_levels() const;
+
+        // @returns the largest sequence number recorded so far
+        sequence_number_type get_last_sequence_number() const;
+
+        // @returns true if recover() dropped a torn record at the end of the file
+        bool has_torn_tail() const;
+};
+
+#endif // YSQL_MANIFEST_H_INCLUDED
@@ -6,19 +6,68 @@
 #include "wal.h"
 #include <filesystem>
 #include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 
+// default size limit, LSM_Options::mem_table_max_size picks it per tree
 #define MEM_TABLE_BYTES_MAX_SIZE 1000000 // 1mb, (rocksDB uses 64mb)
 
+// The newest writes of the tree, readers share it with the single writer so every member function takes the lock it needs
 class Mem_Table{
     private:
+        // the avl tree is not safe to read while it is rebalanced, inserts take it unique and lookups shared
+        mutable std::shared_mutex mutex;
         AVL_Tree avl_tree;
         int entry_array_length;
         uint64_t total_mem_table_size;
+        // is_full() once total_mem_table_size reaches it
+        uint64_t max_size;
+        // newest sequence number inserted, used to resume numbering after replaying the wal
+        sequence_number_type max_sequence_number;
+        // bumped by every change of the avl tree, iterators find their place again once it moved on
+        uint64_t modification_count;
+
+        // @brief insert_entry() for a caller already holding the unique lock
+        bool insert_entry_locked(Entry& entry, const std::vector<sequence_number_type>& live_snapshots);
+
+        // THROWS
+        // @brief replays a wal batch record whose marker was already read
+        // @returns false if the record is cut short, nothing of it is applied then
+        bool replay_batch(std::ifstream& input);
     public:
-        // default constructor
-        Mem_Table();
+        // Walks the mem_table while writes keep going, the current entry is a copy so inserts can not pull it away
+        // after a write the walk carries on from the key it was on, later writes inside the snapshot may show up
+        class Iterator : public Entry_Iterator {
+            private:
+                const Mem_Table& mem_table;
+                sequence_number_type snapshot;
+                Iterator_Direction direction;
+                AVL_Tree::Iterator avl_iterator;
+                // modification_count of the mem_table the avl iterator was positioned at
+                uint64_t modification_count;
+                bool is_valid;
+                Entry current_entry;
 
-        Mem_Table(Wal& wal);
+                // @brief copies the entry the avl iterator is on, the caller holds the shared lock
+                void copy_current();
+
+            public:
+                Iterator(const Mem_Table& _mem_table, sequence_number_type _snapshot);
+
+                void seek(const Bits& target, Iterator_Direction _direction) override;
+
+                bool valid() const override;
+
+                void next() override;
+
+                const Entry& entry() const override;
+        };
+
+        // @brief an empty mem_table, used once the previous one was flushed
+        explicit Mem_Table(uint64_t _max_size = MEM_TABLE_BYTES_MAX_SIZE);
+
+        Mem_Table(Wal& wal, uint64_t _max_size = MEM_TABLE_BYTES_MAX_SIZE);
 
         // destructor, clears avl tree
         ~Mem_Table();
@@ -30,7 +79,12 @@ class Mem_Table{
         uint64_t get_total_mem_table_size();
 
         // returns true if entry was inserted correctly
-        bool insert_entry(Entry entry);
+        // older versions of the key are kept while a snapshot in live_snapshots (sorted ascending) can still see them
+        bool insert_entry(Entry entry, const std::vector<sequence_number_type>& live_snapshots = std::vector<sequence_number_type>());
+
+        // @brief inserts every entry under one lock, readers see all of them or none
+        // returns true if every entry was inserted correctly
+        bool insert_entries(std::vector<Entry>& entries, const std::vector<sequence_number_type>& live_snapshots = std::vector<sequence_number_type>());
 
         // returns true if entry was removed correctly
         bool remove_find_entry(Bits key);
@@ -38,27 +92,25 @@ class Mem_Table{
         // returns true if entry was removed correctly
         bool remove_entry(Entry& entry);
 
-        // returns an Entry with parameter key
-        Entry find(Bits key, bool& found);
+        // returns an Entry with parameter key, as it was at snapshot
+        Entry find(Bits key, bool& found, sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER);
+
+        // returns the largest sequence number held by the mem_table
+        sequence_number_type get_max_sequence_number() const;
 
-        // returns true if total_mem_table_size has exceeded MEM_TABLE_BYTES_MAX_SIZE
-        bool is_full();
+        // returns true if total_mem_table_size has exceeded max_size
+        bool is_full() const;
 
         std::vector<Bits> get_keys();
 
-        // get all entries from AVL tree
+        // get all entries from AVL tree, versions of the same key are ordered newest first
         std::vector<Entry> dump_entries();
 
         // clears the internal entries of the mem_table
         void make_empty();
 
-        std::vector<Bits> get_keys_larger_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys);
-
-        std::vector<Entry> get_entries_larger_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys);
-
-        std::vector<Bits> get_keys_smaller_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys);
-
-        std::vector<Entry> get_entries_smaller_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys);
+        // returns an iterator over the entries visible at snapshot, it may be used while the mem_table is written to
+        std::unique_ptr<Entry_Iterator> get_iterator(sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER) const;
 };
 
 #endif
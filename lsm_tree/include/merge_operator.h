@@ -0,0 +1,64 @@
+#ifndef YSQL_MERGE_OPERATOR_H_INCLUDED
+#define YSQL_MERGE_OPERATOR_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+// a merge operand is stored as [u8 merge_operator_id][operand], the id picks the operator that folds it
+using merge_operator_id_type = uint8_t;
+
+// ids of the operators every LSM_Tree has, others can be registered under the remaining ids
+enum Merge_Operator_Id : merge_operator_id_type {
+    MERGE_OPERATOR_INT64_ADD = 1,
+    MERGE_OPERATOR_APPEND = 2
+};
+
+// Folds merge operands into values, so read-modify-write updates are written blindly and applied on read and in compaction
+// an operator may be used from several readers at once, so it must not keep state
+class Merge_Operator {
+    public:
+        virtual ~Merge_Operator() = default;
+
+        // @brief applies operand on top of existing_value
+        // @param existing_value - nullptr if the key has no value (never written, removed or expired)
+        // @returns false if the operand does not apply to the existing value, the value is then left as it was
+        virtual bool full_merge(const std::string& key, const std::string* existing_value, const std::string& operand, std::string& new_value) const = 0;
+
+        // @brief combines two operands into one with the same effect as applying older_operand and then newer_operand
+        // @returns false if they can not be combined, both are then kept
+        virtual bool partial_merge(const std::string& key, const std::string& older_operand, const std::string& newer_operand, std::string& new_operand) const = 0;
+
+        // @returns false if operand can never be applied, such writes are refused
+        virtual bool is_valid_operand(const std::string& operand) const;
+
+        // @returns a name for logs
+        virtual const char* name() const = 0;
+};
+
+// values and operands are signed 64 bit integers written in decimal, a missing value counts as 0
+// merging into a value that is not such a number or overflows fails
+class Int64_Add_Merge_Operator : public Merge_Operator {
+    public:
+        // @returns false if str is not a decimal int64
+        static bool parse(const std::string& str, int64_t& number);
+
+        bool full_merge(const std::string& key, const std::string* existing_value, const std::string& operand, std::string& new_value) const override;
+
+        bool partial_merge(const std::string& key, const std::string& older_operand, const std::string& newer_operand, std::string& new_operand) const override;
+
+        bool is_valid_operand(const std::string& operand) const override;
+
+        const char* name() const override;
+};
+
+// the operand is appended to the end of the value, a missing value counts as empty
+class Append_Merge_Operator : public Merge_Operator {
+    public:
+        bool full_merge(const std::string& key, const std::string* existing_value, const std::string& operand, std::string& new_value) const override;
+
+        bool partial_merge(const std::string& key, const std::string& older_operand, const std::string& newer_operand, std::string& new_operand) const override;
+
+        const char* name() const override;
+};
+
+#endif // YSQL_MERGE_OPERATOR_H_INCLUDED
@@ -0,0 +1,38 @@
+#ifndef YSQL_MERGING_ITERATOR_H_INCLUDED
+#define YSQL_MERGING_ITERATOR_H_INCLUDED
+
+#include "entry_iterator.h"
+#include <memory>
+#include <vector>
+
+// Merges several sorted iterators into one, every key is reported once
+// when more than one child holds a key the entry of the child added first wins, so children go in newest first
+class Merging_Iterator : public Entry_Iterator {
+    private:
+        std::vector<std::unique_ptr<Entry_Iterator>> children;
+        Iterator_Direction direction;
+
+        // indexes of the valid children kept as a heap, the child with the next key in the scan direction on top
+        std::vector<size_t> heap;
+
+        // @brief heap ordering, true if child a comes after child b
+        bool comes_after(size_t a, size_t b) const;
+
+        void push_child(size_t child_index);
+
+        size_t pop_child();
+
+    public:
+        // @param _children - iterators ordered newest first
+        Merging_Iterator(std::vector<std::unique_ptr<Entry_Iterator>> _children);
+
+        void seek(const Bits& target, Iterator_Direction _direction) override;
+
+        bool valid() const override;
+
+        void next() override;
+
+        const Entry& entry() const override;
+};
+
+#endif // YSQL_MERGING_ITERATOR_H_INCLUDED
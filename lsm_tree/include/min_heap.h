@@ -37,6 +37,9 @@ class Min_Heap{
         void push(Bits key, level_index_type level, table_index_type file_index, SS_Table::Keynator* keynatorlevel_index_type);
         void pop();
 
+        // @brief pops the top element and pushes the next key of its keynator in its place
+        void advance_top();
+
         // for when we need to pop all of the elements with the same key
         void remove_by_key(Bits& key);
 };
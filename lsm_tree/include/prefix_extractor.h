@@ -0,0 +1,48 @@
+#ifndef YSQL_PREFIX_EXTRACTOR_H_INCLUDED
+#define YSQL_PREFIX_EXTRACTOR_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+
+#define PREFIX_EXTRACTOR_FIXED_NAME "fixed"
+#define PREFIX_EXTRACTOR_DELIMITER_NAME "delimiter"
+
+enum Prefix_Extractor_Type : uint8_t {
+    PREFIX_EXTRACTOR_NONE,
+    // the first length bytes of the key
+    PREFIX_EXTRACTOR_FIXED,
+    // the key up to and including the first delimiter
+    PREFIX_EXTRACTOR_DELIMITER
+};
+
+// Maps a key to the prefix the per table prefix filters are built over
+// keys without such a prefix (shorter than length, no delimiter) are left out of the filters
+class Prefix_Extractor {
+    private:
+        Prefix_Extractor_Type type;
+        uint16_t length;
+        char delimiter;
+
+    public:
+        // @brief an extractor that extracts nothing, tables get no prefix filter
+        Prefix_Extractor();
+
+        static Prefix_Extractor fixed(uint16_t _length);
+
+        static Prefix_Extractor delimited(char _delimiter);
+
+        // @brief parses what name() returns, "fixed:<length>" or "delimiter:<char>"
+        // anything else gives an extractor that extracts nothing
+        static Prefix_Extractor from_name(const std::string& name);
+
+        // @returns a description that from_name() turns back into the same extractor
+        std::string name() const;
+
+        bool enabled() const;
+
+        // @brief also used on the prefix of a scan, it extracts only if every key starting with key has the same prefix
+        // @returns false if key has no prefix
+        bool extract(const std::string& key, std::string& prefix) const;
+};
+
+#endif // YSQL_PREFIX_EXTRACTOR_H_INCLUDED
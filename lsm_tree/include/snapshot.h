@@ -0,0 +1,18 @@
+#ifndef YSQL_SNAPSHOT_H_INCLUDED
+#define YSQL_SNAPSHOT_H_INCLUDED
+
+#include "entry.h"
+#include <algorithm>
+#include <vector>
+
+// @brief decides if an older version of a key is still needed by a live snapshot
+// a version is visible to every snapshot taken after it was written and before the next newer version of the same key
+// @param live_snapshots - sequence numbers of the live snapshots, sorted ascending
+// @param version_sequence_number - sequence number of the version in question
+// @param newer_sequence_number - sequence number of the next newer version of the same key
+inline bool snapshot_needs_version(const std::vector<sequence_number_type>& live_snapshots, sequence_number_type version_sequence_number, sequence_number_type newer_sequence_number) {
+    std::vector<sequence_number_type>::const_iterator it = std::lower_bound(live_snapshots.begin(), live_snapshots.end(), version_sequence_number);
+    return it != live_snapshots.end() && *it < newer_sequence_number;
+}
+
+#endif // YSQL_SNAPSHOT_H_INCLUDED
@@ -2,9 +2,17 @@
 #define SS_TABLE_H_INCLUDED
 
 #include "entry.h"
+#include "entry_iterator.h"
+#include "async_reader.h"
+#include "buffered_file_writer.h"
+#include "bloom_filter.h"
+#include "prefix_extractor.h"
+#include <atomic>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <set>
 
@@ -35,9 +43,25 @@
 
 #define SS_TABLE_INDEX_SEEK0_FAILED_ERR_MSG "SS_Table failed to seek to the index file beggining\n"
 #define SS_TABLE_INDEX_OFFSET_SEEK0_FAILED_ERR_MSG "SS_Table failed to seek to the index offset file beggining\n"
+#define SS_TABLE_FAILED_SYNC_ERR_MSG "SS_Table failed to sync a file to disk\n"
+#define SS_TABLE_FAILED_PREFIX_FILTER_WRITE_ERR_MSG "SS_Table failed to write the prefix filter file\n"
+#define SS_TABLE_CHECKSUM_MISMATCH_ERR_MSG "SS_Table record was corrupted - checksum missmatch encountered\n"
+
+// batched lookups read this much of a record at once, larger records take a second read
+#define SS_TABLE_ASYNC_DATA_READ_SIZE 4096
+
+// a keynator that does not keep its input cached drops what it has read every time this many data bytes go by
+#define SS_TABLE_KEYNATOR_DROP_BEHIND_SIZE (8 << 20)
 
 #define SS_TABLE_LEVEL_SIZE_BASE 1000000
 
+// expiry bound standing for a record without a ttl, also used when the bounds of a table are not known
+#define SS_TABLE_NEVER_EXPIRES UINT64_MAX
+
+// for this long after a scrub found every checksum of a table intact, lookups stop checking the records they read from it
+#define SS_TABLE_SCRUB_TRUST_PERIOD_MS (24ULL * 60 * 60 * 1000)
+#define SS_TABLE_NEVER_SCRUBBED 0
+
 using table_index_type = uint16_t;
 using level_index_type = uint16_t;
 
@@ -64,6 +88,13 @@ class SS_Table{
         const std::filesystem::path data_file;
         const std::filesystem::path index_file;
         const std::filesystem::path index_offset_file;
+        // [u32 crc32(payload)][payload], payload: [u16 name_length][prefix extractor name][bloom filter]
+        // optional, a table without it is never skipped by prefix scans
+        const std::filesystem::path prefix_filter_file;
+
+        // identify the table in the manifest
+        level_index_type level;
+        uint64_t table_id;
         
         // ??? for level compaction to check for overlapping rnges
         Bits first_index;
@@ -76,40 +107,107 @@ class SS_Table{
         uint64_t index_file_size;
         uint64_t index_offset_file_size;
 
-        std::ofstream data_ofstream;
-        std::ofstream index_ofstream;
-        std::ofstream index_offset_ofstream;
+        // earliest and latest expiry time of the records, once max_expiry_time has passed every record reads as deleted
+        uint64_t min_expiry_time;
+        uint64_t max_expiry_time;
+
+        // when a scrub last checked the whole table, set from scrubbing threads while lookups read it
+        // not kept across restarts, every table starts out unscrubbed
+        mutable std::atomic<uint64_t> last_scrub_time;
+
+        // set once the table is no longer part of the tree, its files are removed when the last reference to it goes away
+        mutable std::atomic<bool> obsolete;
+
+        std::unique_ptr<Buffered_File_Writer> data_writer;
+        std::unique_ptr<Buffered_File_Writer> index_writer;
+        std::unique_ptr<Buffered_File_Writer> index_offset_writer;
+
+        // the filter is built over prefix_extractor prefixes of the keys, set before writing or read back from the filter file
+        // a deferred filter is read back by the first may_contain_prefix(), hence mutable
+        mutable Prefix_Extractor prefix_extractor;
+        uint32_t prefix_filter_bits_per_key;
+        mutable Bloom_Filter prefix_filter;
+        mutable bool has_prefix_filter;
+        bool prefix_filter_deferred;
+        mutable std::once_flag prefix_filter_once;
+
+        // @brief reads the prefix filter file, see load_prefix_filter()
+        bool read_prefix_filter() const;
+
+        // hashes of the prefixes written so far, consecutive keys mostly share a prefix so last_prefix filters most repeats
+        std::vector<uint64_t> prefix_hashes;
+        std::string last_prefix;
+
+        // @brief remembers the prefix of key for the filter built once writing is done
+        void add_key_to_prefix_filter(const std::string& key);
+
+        // @brief widens the expiry bounds by the expiry time of a written record
+        void add_expiry_time(uint64_t expiry_time);
+
+        // THROWS
+        // @brief builds the prefix filter of everything written and saves it in the filter file
+        void write_prefix_filter();
 
         // returns a stream from n bytes with a certain offset
         // the stringstream can be used directly to construct an entry after reading the key
         std::string read_stream_at_offset(uint64_t& offset) const;
 
+        // THROWS
+        // same as above, but reads from data_in so a group of lookups can share one open data file
+        // if data_in is not open, opens it
+        std::string read_stream_at_offset(std::ifstream& data_in, uint64_t offset) const;
+
+        // THROWS
+        // @brief checks the checksum of a record a lookup read, unless the table was scrubbed recently
+        void verify_record(Entry& entry) const;
+
+        // THROWS
+        // @brief walks the versions of key starting at key_index, the index of the first record >= key
+        // @returns the newest version written at or before snapshot, found is false if there is none
+        Entry read_visible_version(std::ifstream& index_in, std::ifstream& index_offset_in, std::ifstream& data_in, const Bits& key, uint64_t key_index, bool& found, sequence_number_type snapshot) const;
+
+        // THROWS
+        // multi_get one key after another through ifstreams
+        void multi_get_sync(const std::vector<Bits>& keys, const std::vector<size_t>& key_indexes, std::vector<Entry>& entries, std::vector<bool>& found, sequence_number_type snapshot) const;
+
+        // THROWS
+        // multi_get with the binary searches of all keys run in lockstep, every step of every search goes into one reader batch
+        // then the newest version of every key is fetched with a few more batches
+        void multi_get_async(Async_Reader& reader, const std::vector<Bits>& keys, const std::vector<size_t>& key_indexes, std::vector<Entry>& entries, std::vector<bool>& found, sequence_number_type snapshot) const;
+
         // THROWS
         // returns the key index of the key that is larger or smaller than the key depending on the type than the target key
         // if ifstreams are not open, opens them
-        uint64_t binary_search_nearest(std::ifstream& index_ifstream, std::ifstream& offset_ifstream, const Bits& target_key, SS_Table_Binary_Search_Type search_type) const;
+        // search_left narrows the search to the records from that index on, when it is known the result can not be before it
+        uint64_t binary_search_nearest(std::ifstream& index_ifstream, std::ifstream& offset_ifstream, const Bits& target_key, SS_Table_Binary_Search_Type search_type, uint64_t search_left = 0) const;
+
+        // @brief used by forward scans to pick the version of each key visible at snapshot
+        // versions of a key are stored newest first, once one of them was accepted the rest are shadowed by it
+        // previous_visible_key holds the key of the last accepted version, empty before the first one
+        static bool is_visible_version(const Entry& entry, const std::string& key, sequence_number_type snapshot, std::string& previous_visible_key);
 
         //THROWS
         // returns UP TO count entries, if less entries are returned (because n entries dont exist in this table, the next key is a placeholder)
-        std::vector<Entry> get_entries_key_smaller_or_equal(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys) const;
+        std::vector<Entry> get_entries_key_smaller_or_equal(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys, sequence_number_type snapshot) const;
 
         // returns UP TO count entries, if less entries are returned (because n entries dont exist in this table, the next key is a placeholder)
-        std::vector<Entry> get_entries_key_larger_or_equal(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys) const;
+        std::vector<Entry> get_entries_key_larger_or_equal(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys, sequence_number_type snapshot) const;
         
         // returns UP TO count entries, if less entries are returned (because n entries dont exist in this table, the next key is a placeholder)
         // if you want deleted keys, simply pass an empty container, it will be ignored
-        std::vector<Entry> get_n_entries(SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys) const;
+        std::vector<Entry> get_n_entries(SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys, sequence_number_type snapshot) const;
 
-        std::vector<Bits> get_all_keys(SS_Table_Entry_Filter key_filter, std::set<Bits>& dead_keys) const;
+        std::vector<Bits> get_all_keys(SS_Table_Entry_Filter key_filter, std::set<Bits>& dead_keys, sequence_number_type snapshot) const;
 
-        std::vector<Bits> get_n_next_keys(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys) const;
+        std::vector<Bits> get_n_next_keys(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys, sequence_number_type snapshot) const;
 
     public:
         std::filesystem::path data_path() const;
         std::filesystem::path index_path() const;
         std::filesystem::path offset_path() const;
+        std::filesystem::path prefix_filter_path() const;
 
-        SS_Table(const std::filesystem::path& _data_file, const std::filesystem::path& _index_file, std::filesystem::path& _index_offset_file);
+        SS_Table(const std::filesystem::path& _data_file, const std::filesystem::path& _index_file, std::filesystem::path& _index_offset_file, const std::filesystem::path& _prefix_filter_file, level_index_type _level, uint64_t _table_id);
 
         // no copying allowed
         SS_Table(const SS_Table&) = delete;
@@ -124,7 +222,15 @@ class SS_Table{
         // returns a specific entry at specific index
         // Entry read_entry_at_offset(uint64_t offset);
         // returns entry with a given key. if entry is not there, returns placeolder entry and found = false
-        Entry get(const Bits& key, bool& found) const;
+        // the newest version written at or before snapshot is returned
+        Entry get(const Bits& key, bool& found, sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER) const;
+
+        // THROWS
+        // @brief looks up keys[i] for every i in key_indexes with the files opened once for the whole group
+        // keys must be sorted and key_indexes ascending
+        // with io_uring the reads of all keys are submitted together, otherwise every binary search starts where the previous key was found
+        // entries[i] and found[i] are set for the keys that have a version visible at snapshot, the other slots are left as they were
+        void multi_get(const std::vector<Bits>& keys, const std::vector<size_t>& key_indexes, std::vector<Entry>& entries, std::vector<bool>& found, sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER) const;
 
         // returns the first index in the ss_table
         Bits get_last_index() const;
@@ -143,20 +249,87 @@ class SS_Table{
 
         void reconstruct_ss_table();
 
+        // @brief restores the table from metadata kept in the manifest, does not touch the files
+        void restore_metadata(const Bits& _first_index, const Bits& _last_index, uint64_t _record_count, uint64_t _data_file_size, uint64_t _index_file_size, uint64_t _index_offset_file_size, uint64_t _min_expiry_time = SS_TABLE_NEVER_EXPIRES, uint64_t _max_expiry_time = SS_TABLE_NEVER_EXPIRES);
+
+        // THROWS
+        // @brief flushes all three files (and the prefix filter) to disk, must be called before the table is recorded in the manifest
+        void sync_files() const;
+
+        // @brief tables written after this get a prefix filter over the prefixes extractor extracts
+        void set_prefix_extractor(const Prefix_Extractor& extractor, uint32_t bits_per_key = BLOOM_FILTER_DEFAULT_BITS_PER_KEY);
+
+        // @brief reads the prefix filter file, the filter carries the extractor it was built with
+        // @returns false if there is no usable filter, the table is then never skipped
+        bool load_prefix_filter();
+
+        // @brief leaves reading the prefix filter file to the first may_contain_prefix(), which may run on any reader thread
+        void defer_prefix_filter();
+
+        // @returns false only if no key of the table starts with prefix
+        bool may_contain_prefix(const std::string& prefix) const;
+
+        level_index_type get_level() const;
+
+        uint64_t get_table_id() const;
+
+        uint64_t get_record_count() const;
+
+        uint64_t get_data_file_size() const;
+
+        uint64_t get_index_file_size() const;
+
+        uint64_t get_index_offset_file_size() const;
+
+        // @returns the earliest expiry time of a record, SS_TABLE_NEVER_EXPIRES if none of them has a ttl
+        uint64_t get_min_expiry_time() const;
+
+        // @returns the latest expiry time of a record, SS_TABLE_NEVER_EXPIRES if any of them has no ttl
+        uint64_t get_max_expiry_time() const;
+
+        // @returns true if every record of the table has expired by now, found without reading the table
+        bool is_fully_expired(uint64_t now) const;
+
+        // @returns when a scrub last found the table intact, SS_TABLE_NEVER_SCRUBBED if it did not yet
+        uint64_t get_last_scrub_time() const;
+
+        // @brief records a scrub that found the table intact, safe to call while the table is being read
+        void set_last_scrub_time(uint64_t _last_scrub_time) const;
+
+        // @returns true if the table was found intact less than SS_TABLE_SCRUB_TRUST_PERIOD_MS before now
+        bool is_recently_scrubbed(uint64_t now) const;
+
+        // @brief makes the destructor remove the files of the table, readers still holding it keep reading them until then
+        void mark_obsolete() const;
+
 
         class Keynator {
             private:
                 std::ifstream index_stream;
                 std::ifstream index_offset_stream;
+                std::ifstream data_stream;
 
+                const std::filesystem::path index_file;
+                const std::filesystem::path index_offset_file;
                 const std::filesystem::path data_file;
 
+                File_Io_Mode io_mode;
+
                 // THROWS
-                Keynator(const std::filesystem::path& index_file, const std::filesystem::path& index_offset_file, const std::filesystem::path& data_file, uint64_t record_count);
+                Keynator(const std::filesystem::path& index_file, const std::filesystem::path& index_offset_file, const std::filesystem::path& data_file, uint64_t record_count, File_Io_Mode io_mode);
 
                 uint64_t current_data_offset;
                 uint64_t records_read;
                 uint64_t record_count;
+
+                // where the data stream is positioned, saves a seek when versions are read in file order
+                uint64_t data_stream_offset;
+
+                // data file offset up to which the pages were dropped from the page cache
+                uint64_t dropped_data_offset;
+
+                // @brief drops the pages read so far of all three files from the page cache, length 0 drops the whole files
+                void drop_read_pages(uint64_t data_length);
             public:
                 ~Keynator();
                 // THROWS
@@ -177,12 +350,76 @@ class SS_Table{
 
         // THROWS
         // @brief returns Keynator type for key value merging logic
-        Keynator get_keynator() const;
+        // unless io_mode is FILE_IO_BUFFERED the keynator drops the table from the page cache behind itself as it reads
+        Keynator get_keynator(File_Io_Mode io_mode = FILE_IO_BUFFERED) const;
+
+        // Walks the table one key at a time in either direction, reading only the records it passes over
+        // of the versions of a key only the newest one visible at snapshot is returned
+        class Iterator : public Entry_Iterator {
+            private:
+                const SS_Table* ss_table;
+                sequence_number_type snapshot;
+                Iterator_Direction direction;
+
+                std::ifstream index_stream;
+                std::ifstream index_offset_stream;
+                std::ifstream data_stream;
+
+                // going forward the next record to read, going backward one past it
+                uint64_t position;
+                bool is_valid;
+                Entry current_entry;
+
+                // THROWS
+                // @brief opens the table files, called on the first seek
+                void open_streams();
+
+                // THROWS
+                // @returns the key of the record at record_index, data_offset is set to where its data starts
+                std::string read_key(uint64_t record_index, uint64_t& data_offset);
+
+                // THROWS
+                std::string read_data(uint64_t data_offset);
+
+                // THROWS
+                // @brief reads the versions of the key stored at group_start, current_entry is set to the first visible one
+                // @returns false if none of the versions is visible, group_end is set to one past the last version
+                bool read_group(uint64_t group_start, uint64_t& group_end);
+
+                // THROWS
+                void step_forward();
+
+                // THROWS
+                void step_backward();
+
+            public:
+                Iterator(const SS_Table* _ss_table, sequence_number_type _snapshot);
+
+                // allow move
+                Iterator(Iterator&&) = default;
+                Iterator& operator=(Iterator&&) = default;
+
+                // delete old on copy
+                Iterator(const Iterator&) = delete;
+                Iterator& operator=(const Iterator&) = delete;
+
+                void seek(const Bits& target, Iterator_Direction _direction) override;
+
+                bool valid() const override;
+
+                void next() override;
+
+                const Entry& entry() const override;
+        };
+
+        // @returns an iterator over the versions visible at snapshot, it has to be positioned with seek() first
+        Iterator get_iterator(sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER) const;
 
         // THROWS
         // @brief initializes internal files for writing
         // allow the function write(const Bits&, const string&) to be called
-        int8_t init_writing();
+        // records are gathered in large buffers, io_mode decides if the written files stay in the page cache
+        int8_t init_writing(File_Io_Mode io_mode = FILE_IO_BUFFERED);
 
         // THROWS
         // @brief writes the key and data string to internal files
@@ -197,6 +434,7 @@ class SS_Table{
         // if second bit is set - index file closing failed
         // if third bit is set - index offset file closing failed
         // @return 0 - if success  > 0 if failed to close the files 
+        // THROWS if the files closed fine but the prefix filter could not be written
         int8_t stop_writing();
 
         // @brief returns true if provided indexes (keys) overlap with this tables indexes
@@ -206,11 +444,6 @@ class SS_Table{
         // @brief returns all the keys contained in a table
         std::vector<Bits> get_all_keys() const;
 
-        // THROWS
-        std::vector<Bits> get_all_keys_alive(std::set<Bits>& dead_keys) const;
- 
-        std::vector<Bits> get_n_next_keys_alive(const Bits& target_key, uint32_t count, std::set<Bits>& dead_keys) const;
-
         // used for testing
         std::vector<Bits> get_n_next_keys(const Bits& target_key, uint32_t count) const;
 
@@ -222,18 +455,6 @@ class SS_Table{
         // returns UP TO count entries, if less entries are returned (because n entries dont exist in this table, the next key is a placeholder)
         std::vector<Entry> get_entries_key_larger_or_equal(const Bits& target_key, uint32_t count) const;
 
-        // THROWS
-        // returns UP TO count entries, if less entries are returned (because n entries dont exist in this table, the next key is a placeholder)
-        std::vector<Entry> get_entries_key_smaller_or_equal_alive(const Bits& target_key, uint32_t count, std::set<Bits>& dead_keys) const;
-
-        // THROWS
-        // returns UP TO count entries, if less entries are returned (because n entries dont exist in this table, the next key is a placeholder)
-        std::vector<Entry> get_entries_key_larger_or_equal_alive(const Bits& target_key, uint32_t count, std::set<Bits>& dead_keys) const;
-
-        // THROWS
-        // returns UP TO count entries, if less entries are returned (because n entries dont exist in this table, the next key is a placeholder)
-        std::vector<Entry> get_n_entries_alive(uint32_t count, std::set<Bits>& dead_keys) const;
-
         // THROWS
         // returns UP TO count entries, if less entries are returned (because n entries dont exist in this table, the next key is a placeholder)
         std::vector<Entry> get_n_entries(uint32_t count) const;
@@ -5,8 +5,10 @@
 #include <memory>
 #include <string>
 #include "ss_table.h"
+#include "level_iterator.h"
 #include "file_exception.h"
 #include <cmath>
+#include <algorithm>
 
     #include <iostream>
 
@@ -14,47 +16,86 @@
 #define SS_TABLE_CONTROLLER_MAX_SIZE 0xffffffffffffffff
 #define SS_TABLE_CONTROLLER_RATIO 10
 
-// 1MB LIKE IN MEMTABLE
+// 1MB LIKE IN MEMTABLE, defaults, LSM_Options picks the ratio and base per tree
 #define SS_TABLE_CONTROLLER_LEVEL_SIZE_BASE 1000000
 
+// key range of a table kept in memory, so finding the table that can hold a key does not touch any files
+// ss_table is owned by the sstables of the same controller
+struct SS_Table_Key_Range{
+    Bits first_key;
+    Bits last_key;
+    const SS_Table* ss_table;
+};
+
+// point in time numbers of one level
+struct SS_Table_Controller_Stats{
+    level_index_type level;
+    uint64_t table_count;
+    uint64_t size_bytes;
+    uint64_t max_size_bytes;
+    double fill_ratio;
+};
+
+// The tables of one level, copies share the tables so every tree version can hold its own list cheaply
 class SS_Table_Controller{
     private:
-        std::vector<const SS_Table*> sstables;
+        std::vector<std::shared_ptr<const SS_Table>> sstables;
+        // the same tables ordered by first key, on levels >= 1 compaction keeps the ranges disjoint
+        std::vector<SS_Table_Key_Range> key_ranges;
         level_index_type level;
         uint16_t ratio;
         // ideally not fixed for every level (the higher the level, more tables)
         uint64_t max_size;
+        // combined size of the files of every table, kept up to date by add_sstable and delete_sstable
+        uint64_t size_bytes;
         uint64_t current_name_counter;
 
-
+        // @returns the only table of a level >= 1 whose range covers key, nullptr if there is none
+        const SS_Table* find_table(const Bits& key) const;
 
     public:
-        SS_Table_Controller(uint16_t ratio, level_index_type current_level);
+        SS_Table_Controller(uint16_t ratio, level_index_type current_level, uint64_t level_size_base = SS_TABLE_CONTROLLER_LEVEL_SIZE_BASE);
         ~SS_Table_Controller();
-        void add_sstable(const SS_Table* sstable);
-        Entry get(const Bits& key, bool& found) const;
+        void add_sstable(std::shared_ptr<const SS_Table> sstable);
+        // level 0 tables overlap and are searched newest first, on deeper levels only the table covering key is searched
+        // if tables_probed is given it is increased by the number of tables that were searched
+        Entry get(const Bits& key, bool& found, sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER, uint64_t* tables_probed = nullptr) const;
+
+        // THROWS
+        // @brief get() for many keys, keys must be sorted and only the slots with found[i] == false are searched
+        // every table is searched at most once, with all of the missing keys that fall in its range
+        void multi_get(const std::vector<Bits>& keys, std::vector<Entry>& entries, std::vector<bool>& found, sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER, uint64_t* tables_probed = nullptr) const;
 
-        uint64_t calculate_size_bytes();
+        // @brief appends iterators covering this level to iterators, newest data first
+        // tables of level 0 overlap and get one iterator each, deeper levels are walked by a single Level_Iterator
+        // with a prefix, tables whose prefix filter rules it out are left out, if tables_skipped is given it is increased by their number
+        void add_iterators(std::vector<std::unique_ptr<Entry_Iterator>>& iterators, sequence_number_type snapshot = ENTRY_MAX_SEQUENCE_NUMBER, const std::string& prefix = "", uint64_t* tables_skipped = nullptr) const;
 
-        bool is_over_limit();
+        // returns the combined size of the level files, does not touch the filesystem
+        uint64_t calculate_size_bytes() const;
 
-        uint16_t get_ss_tables_count();
+        bool is_over_limit() const;
 
-        const SS_Table* operator[](std::size_t index);
+        uint16_t get_ss_tables_count() const;
 
-        const SS_Table*& at(table_index_type index);
+        const SS_Table* operator[](std::size_t index) const;
+
+        const SS_Table* at(table_index_type index) const;
         
-        const SS_Table*& front();
+        const SS_Table* front() const;
 
-        uint16_t get_level();
+        uint16_t get_level() const;
 
-        void delete_sstable(table_index_type index);
+        // @brief removes the table from the level, with remove_files its files go too once no copy of the level holds it any more
+        void delete_sstable(table_index_type index, bool remove_files = true);
 
         uint64_t get_current_name_counter() const;
 
         bool empty() const; 
 
-        double get_fill_ratio();
+        double get_fill_ratio() const;
+
+        SS_Table_Controller_Stats get_stats() const;
         /*
         for()
         std::vector<SS_table> check_overlapping_key_range(Bits firs_index, Bits last_index, SS_Table_Controller ss_controller);
@@ -0,0 +1,62 @@
+#ifndef YSQL_SS_TABLE_WRITER_H_INCLUDED
+#define YSQL_SS_TABLE_WRITER_H_INCLUDED
+
+#include "lsm_tree.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// a table is finished once its records take this many bytes
+#define SS_TABLE_WRITER_DEFAULT_TABLE_SIZE (64 << 20)
+
+#define SS_TABLE_WRITER_UNSORTED_KEY_ERR_MSG "SS_Table_Writer keys have to be added in strictly increasing order\n"
+#define SS_TABLE_WRITER_FINISHED_ERR_MSG "SS_Table_Writer can not add records after finish()\n"
+
+// Writes sorted records into tables in the on disk format away from any tree, to be added to one with LSM_Tree::ingest_files()
+// tables are named like the ones of level 0 and numbered from 0 in output_dir, as the keys only grow they never overlap each other
+// records get no sequence number and values stay in the tables whatever their size
+class SS_Table_Writer {
+    private:
+        std::filesystem::path output_dir;
+        uint64_t table_size;
+
+        // every table gets a prefix filter like the ones the tree would build
+        Prefix_Extractor prefix_extractor;
+        uint32_t prefix_filter_bits_per_key;
+
+        // records of the table being built
+        std::vector<Entry> entries;
+        uint64_t entries_size;
+
+        std::string last_key;
+        bool finished;
+
+        std::vector<std::filesystem::path> data_files;
+
+        // THROWS
+        void add(Entry&& entry);
+
+        // THROWS
+        // @brief writes the buffered records as the next table and syncs it
+        void write_table();
+
+    public:
+        // THROWS
+        // @brief creates output_dir if needed, the prefix filter settings are taken from options
+        explicit SS_Table_Writer(const std::filesystem::path& _output_dir, const LSM_Options& options = LSM_Options(), uint64_t _table_size = SS_TABLE_WRITER_DEFAULT_TABLE_SIZE);
+
+        // THROWS
+        void put(const std::string& key, const std::string& value);
+
+        // THROWS
+        // @brief writes a tombstone, it hides the older versions of key in the tree the tables are ingested into
+        void remove(const std::string& key);
+
+        // THROWS
+        // @brief writes what is still buffered
+        // @returns the data files of every table written, in key order, as LSM_Tree::ingest_files() takes them
+        std::vector<std::filesystem::path> finish();
+};
+
+#endif // YSQL_SS_TABLE_WRITER_H_INCLUDED
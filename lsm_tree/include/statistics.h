@@ -0,0 +1,116 @@
+#ifndef YSQL_STATISTICS_H_INCLUDED
+#define YSQL_STATISTICS_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// writers are spread over this many shards, each thread keeps to the one it was handed first
+#define STATISTICS_SHARD_COUNT 16
+
+// bucket 0 holds 0, bucket i > 0 holds [2^(i - 1), 2^i)
+#define STATISTICS_HISTOGRAM_BUCKET_COUNT 64
+
+// bytes written to deeper levels are counted with the last one
+#define STATISTICS_MAX_LEVELS 16
+
+// counter names ending with this are merged by taking the largest value, every other counter is summed
+#define STATISTICS_MAX_SUFFIX ".max"
+#define STATISTICS_BUCKET_INFIX ".bucket."
+
+enum Statistics_Ticker : uint8_t {
+    // point lookups and the tables they had to search
+    STATISTICS_GETS,
+    STATISTICS_GET_TABLES_PROBED,
+    // keys looked up through multi_get
+    STATISTICS_MULTI_GET_KEYS,
+    // set, remove, merge and write calls, and the bytes they logged to the wal
+    STATISTICS_WRITES,
+    STATISTICS_WAL_BYTES,
+    STATISTICS_FLUSHES,
+    STATISTICS_COMPACTIONS,
+    STATISTICS_TICKER_COUNT
+};
+
+enum Statistics_Histogram : uint8_t {
+    STATISTICS_GET_MICROS,
+    STATISTICS_WRITE_MICROS,
+    // until a wal record was handed to the operating system, the wal does not fsync
+    STATISTICS_WAL_SYNC_MICROS,
+    STATISTICS_FLUSH_MICROS,
+    STATISTICS_COMPACTION_MICROS,
+    STATISTICS_HISTOGRAM_COUNT
+};
+
+// Counters and latency histograms updated without locks from any number of threads
+// every thread adds to its own shard, so writers do not fight over cache lines, reads add the shards up
+class Statistics {
+    private:
+        struct Histogram {
+            std::atomic<uint64_t> count;
+            std::atomic<uint64_t> sum;
+            std::atomic<uint64_t> max;
+            std::atomic<uint64_t> buckets[STATISTICS_HISTOGRAM_BUCKET_COUNT];
+        };
+
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> tickers[STATISTICS_TICKER_COUNT];
+            std::atomic<uint64_t> level_bytes_written[STATISTICS_MAX_LEVELS];
+            Histogram histograms[STATISTICS_HISTOGRAM_COUNT];
+        };
+
+        Shard shards[STATISTICS_SHARD_COUNT];
+
+        // @returns the shard of the calling thread
+        Shard& get_shard();
+
+        static uint8_t get_bucket(uint64_t value);
+
+    public:
+        Statistics();
+
+        Statistics(const Statistics&) = delete;
+        Statistics& operator=(const Statistics&) = delete;
+
+        void record(Statistics_Ticker ticker, uint64_t count = 1);
+
+        void record_level_bytes_written(uint16_t level, uint64_t bytes);
+
+        void record_time(Statistics_Histogram histogram, uint64_t micros);
+
+        uint64_t get_ticker(Statistics_Ticker ticker) const;
+
+        // @brief adds every counter to counters under its name, histograms as <name>.count, .sum, .max and .bucket.<i> for the used buckets
+        void add_counters(std::map<std::string, uint64_t>& counters) const;
+
+        static const char* get_ticker_name(Statistics_Ticker ticker);
+
+        static const char* get_histogram_name(Statistics_Histogram histogram);
+
+        // @brief adds counters of another source (e.g. another partition) to into, by the rule of STATISTICS_MAX_SUFFIX
+        static void merge_counters(std::map<std::string, uint64_t>& into, const std::map<std::string, uint64_t>& counters);
+
+        // @brief replaces the buckets of every histogram in counters with its .p50, .p95 and .p99
+        // a percentile is the upper bound of the bucket it falls in, never more than the .max of the histogram
+        static void summarize_histograms(std::map<std::string, uint64_t>& counters);
+};
+
+// Records the time from its construction to its destruction into a histogram
+class Statistics_Timer {
+    private:
+        Statistics& statistics;
+        Statistics_Histogram histogram;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        Statistics_Timer(Statistics& _statistics, Statistics_Histogram _histogram);
+
+        ~Statistics_Timer();
+
+        Statistics_Timer(const Statistics_Timer&) = delete;
+        Statistics_Timer& operator=(const Statistics_Timer&) = delete;
+};
+
+#endif // YSQL_STATISTICS_H_INCLUDED
@@ -0,0 +1,47 @@
+#ifndef YSQL_TABLE_SCRUBBER_H_INCLUDED
+#define YSQL_TABLE_SCRUBBER_H_INCLUDED
+
+#include "ss_table.h"
+#include <cstdint>
+#include <string>
+
+// Reads one table front to back a step at a time, checking the checksum of every record and that the keys are in order
+// it holds its own open files, so steps can run without any lock even if the table is deleted in between
+// a scrubber is used by a single thread
+// reads go through the page cache without dropping anything, the table may be one lookups keep hot
+class Table_Scrubber {
+    private:
+        level_index_type level;
+        uint64_t table_id;
+
+        uint64_t record_count;
+        uint64_t records_checked;
+        uint64_t bytes_checked;
+        bool corrupted;
+
+        std::string previous_key;
+        SS_Table::Keynator keynator;
+
+    public:
+        // THROWS
+        // @brief opens the table files, the table may be deleted once this returns
+        explicit Table_Scrubber(const SS_Table& ss_table);
+
+        // @brief checks records until at least max_bytes more were read, the end of the table or the first bad record
+        // @returns true once the scrub is over
+        bool step(uint64_t max_bytes);
+
+        // @returns true once every record was checked or corruption was found
+        bool is_done() const;
+
+        // @returns true if a record failed its checksum or could not be read
+        bool is_corrupted() const;
+
+        level_index_type get_level() const;
+
+        uint64_t get_table_id() const;
+
+        uint64_t get_bytes_checked() const;
+};
+
+#endif // YSQL_TABLE_SCRUBBER_H_INCLUDED
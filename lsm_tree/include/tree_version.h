@@ -0,0 +1,40 @@
+#ifndef YSQL_TREE_VERSION_H_INCLUDED
+#define YSQL_TREE_VERSION_H_INCLUDED
+
+#include "mem_table.h"
+#include "ss_table_controller.h"
+#include "entry_iterator.h"
+#include <memory>
+#include <vector>
+
+// The mem_table and the tables of every level as they were at one point in time
+// an installed version is never changed, flush and compaction install a new one instead
+// readers load the current version once and read from it without taking any lock of the tree
+// a table dropped from the tree keeps its files until the last version holding it goes away
+struct Tree_Version {
+    // the only part of a version that still changes, it takes its own lock
+    std::shared_ptr<Mem_Table> mem_table;
+    // one controller per level
+    std::vector<SS_Table_Controller> ss_table_controllers;
+};
+
+// Keeps the version an iterator reads from alive for as long as the iterator itself
+class Version_Iterator : public Entry_Iterator {
+    private:
+        std::shared_ptr<const Tree_Version> version;
+        std::unique_ptr<Entry_Iterator> iterator;
+
+    public:
+        // @param _iterator - an iterator over the mem_table and tables of _version
+        Version_Iterator(std::shared_ptr<const Tree_Version> _version, std::unique_ptr<Entry_Iterator> _iterator);
+
+        void seek(const Bits& target, Iterator_Direction direction) override;
+
+        bool valid() const override;
+
+        void next() override;
+
+        const Entry& entry() const override;
+};
+
+#endif // YSQL_TREE_VERSION_H_INCLUDED
@@ -0,0 +1,101 @@
+#ifndef YSQL_VALUE_LOG_H_INCLUDED
+#define YSQL_VALUE_LOG_H_INCLUDED
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#define VALUE_LOG_DIR "./data/val/value_log"
+#define VALUE_LOG_DIR_NAME "value_log"
+#define VALUE_LOG_FILE_NAME "blob_%lu.bin"
+#define VALUE_LOG_FILE_NAME_MAX_LENGTH 32
+
+// once the active file grows past this a new one is started
+#define VALUE_LOG_MAX_FILE_SIZE (64 << 20)
+
+#define VALUE_LOG_FAILED_OPEN_ERR_MSG "Value log failed to open a blob file\n"
+#define VALUE_LOG_FAILED_WRITE_ERR_MSG "Value log failed to write to a blob file\n"
+#define VALUE_LOG_FAILED_SYNC_ERR_MSG "Value log failed to sync a blob file\n"
+#define VALUE_LOG_FAILED_READ_ERR_MSG "Value log failed to read a blob\n"
+#define VALUE_LOG_CHECKSUM_MISMATCH_ERR_MSG "Value log blob was corrupted - checksum missmatch encountered\n"
+#define VALUE_LOG_BAD_POINTER_ERR_MSG "Value log pointer is malformed\n"
+
+// where a value moved to the value log lives, stored in the tables instead of the value
+// encoded as [u64 file_id][u64 offset][u64 length], length covers the whole blob record
+struct Value_Pointer {
+    uint64_t file_id;
+    uint64_t offset;
+    uint64_t length;
+
+    std::string encode() const;
+
+    // @returns false if encoded is not something encode() produced
+    static bool decode(const std::string& encoded, Value_Pointer& pointer);
+};
+
+// a blob found while walking a blob file, without the value
+struct Value_Log_Record {
+    std::string key;
+    Value_Pointer pointer;
+};
+
+// Append only files holding large values away from the tables, so compaction only moves small pointers around
+// blob record: [u32 crc32(key + value)][u16 key_length][u32 value_length][key][value]
+// the key is kept so the garbage collector can find out if the blob is still referenced
+// appending is not thread safe, reads are
+class Value_Log {
+    private:
+        std::filesystem::path directory;
+
+        // file new blobs go to, it is created on the first append
+        uint64_t active_file_id;
+        uint64_t active_file_size;
+        int active_fd;
+
+        void close_active_file();
+
+    public:
+        // THROWS
+        // @brief creates the directory if needed, new blobs go to a file after every existing one
+        Value_Log();
+
+        explicit Value_Log(const std::filesystem::path& _directory);
+
+        ~Value_Log();
+
+        Value_Log(const Value_Log&) = delete;
+        Value_Log& operator=(const Value_Log&) = delete;
+
+        // THROWS
+        // @brief appends a blob, it is durable only after sync()
+        Value_Pointer append(const std::string& key, const std::string& value);
+
+        // THROWS
+        // @brief flushes the active file to disk, must be called before a table pointing into it is recorded in the manifest
+        void sync();
+
+        // THROWS
+        // @brief closes the active file, the following appends start a new one
+        void seal();
+
+        // THROWS
+        // @returns the value pointer points to, checked against the blob checksum
+        std::string read(const Value_Pointer& pointer) const;
+
+        // @returns ids of the files that are not appended to any more, oldest first
+        std::vector<uint64_t> get_sealed_file_ids() const;
+
+        // THROWS
+        // @returns every complete blob of a file in file order, a torn tail left by a crash is ignored
+        std::vector<Value_Log_Record> read_records(uint64_t file_id) const;
+
+        uint64_t get_file_size(uint64_t file_id) const;
+
+        std::filesystem::path get_file_path(uint64_t file_id) const;
+
+        // @brief deletes a sealed file, every pointer into it must be gone already
+        void remove_file(uint64_t file_id);
+};
+
+#endif // YSQL_VALUE_LOG_H_INCLUDED
@@ -7,8 +7,14 @@
 #include <vector>
 #include <sstream>
 #include <filesystem>
+#include <cstdint>
 
 #define WAL_FOLDER_PATH "./data/wal/"
+#define WAL_FILE_NAME "wal.log"
+
+// a batch record starts with this in place of an entry length, no single entry can be this long
+// [u64 WAL_BATCH_MARKER][u64 payload_length][u32 entry_count][payload = entry_count serialized entries]
+#define WAL_BATCH_MARKER UINT64_MAX
 
 class Wal{
     private:
@@ -31,6 +37,8 @@ class Wal{
 		//@brief constructs Wal using custom file structure
 		//@note initializes entry_count to 0 and is_read_only to false
 		Wal(std::string _wal_name, std::string _wal_file_location);
+		//@brief constructs Wal keeping "wal.log" in wal_dir, creates wal_dir if needed
+		explicit Wal(const std::filesystem::path& wal_dir);
 		// -------------------------------------
 			
 		~Wal();
@@ -49,6 +57,9 @@ class Wal{
 		//@brief appends an entry to the wal file
 		//@note opens file in binary append mode and writes ostringstream buffer
 		void append_entry(std::ostringstream& entry);
+		//@brief appends serialized entries as one batch record with a single write and flush
+		//@note replay applies a batch only if the whole record made it to disk
+		void append_batch(const std::string& entries_bytes, uint32_t entry_count);
 		//@brief removes all entries from the wal file
 		void clear_entries();
 		// -------------------------------------
@@ -0,0 +1,39 @@
+#ifndef YSQL_WRITE_BATCH_H_INCLUDED
+#define YSQL_WRITE_BATCH_H_INCLUDED
+
+#include "bits.h"
+#include "entry.h"
+#include <string>
+#include <vector>
+
+// Puts and removes collected by the caller and applied by LSM_Tree::write all at once
+// the whole batch goes into a single wal record, after a crash either every operation is replayed or none
+class Write_Batch{
+    private:
+        std::vector<Entry> entries;
+
+    public:
+        // THROWS
+        // @brief queues key to be set to value
+        // @throws std::length_error if the key or the value are too long for an Entry
+        void put(const std::string& key, const std::string& value);
+
+        // THROWS
+        // @brief queues key to be removed
+        void remove(const std::string& key);
+
+        // @brief queues every operation of other after the ones already queued
+        void append(const Write_Batch& other);
+
+        // @returns number of queued operations
+        size_t size() const;
+
+        bool empty() const;
+
+        void clear();
+
+        // @returns the queued operations in the order they were added, later ones win over earlier ones
+        const std::vector<Entry>& get_entries() const;
+};
+
+#endif // YSQL_WRITE_BATCH_H_INCLUDED
@@ -0,0 +1,275 @@
+#include "../include/async_reader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+    #include <linux/io_uring.h>
+    #define ASYNC_READER_HAS_IO_URING 1
+#else
+    #define ASYNC_READER_HAS_IO_URING 0
+#endif
+
+Async_Reader::Async_Reader(uint32_t _queue_depth) : ring_fd(-1), queue_depth(_queue_depth == 0 ? 1 : _queue_depth), sq_ring(MAP_FAILED), cq_ring(MAP_FAILED), sqes(MAP_FAILED), sq_ring_size(0), cq_ring_size(0), sqes_size(0),
+    sq_head(nullptr), sq_tail(nullptr), sq_mask(nullptr), sq_array(nullptr), cq_head(nullptr), cq_tail(nullptr), cq_mask(nullptr), cqes(nullptr) {
+    const char* disable_str = std::getenv(ASYNC_READER_DISABLE_ENV_VAR);
+    if(disable_str && std::string(disable_str) == "1") {
+        return;
+    }
+
+    if(!this -> setup_ring()) {
+        this -> close_ring();
+    }
+}
+
+Async_Reader::~Async_Reader() {
+    this -> close_ring();
+}
+
+bool Async_Reader::is_async() const {
+    return this -> ring_fd >= 0;
+}
+
+uint32_t Async_Reader::get_queue_depth() const {
+    return this -> queue_depth;
+}
+
+Async_Reader& Async_Reader::for_this_thread() {
+    thread_local Async_Reader reader;
+    return reader;
+}
+
+#if ASYNC_READER_HAS_IO_URING
+
+bool Async_Reader::setup_ring() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    this -> ring_fd = syscall(__NR_io_uring_setup, this -> queue_depth, &params);
+    if(this -> ring_fd < 0) {
+        this -> ring_fd = -1;
+        return false;
+    }
+
+    this -> queue_depth = params.sq_entries;
+    this -> sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    this -> cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    // newer kernels map both rings with one call
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap) {
+        this -> sq_ring_size = std::max(this -> sq_ring_size, this -> cq_ring_size);
+        this -> cq_ring_size = this -> sq_ring_size;
+    }
+
+    this -> sq_ring = mmap(nullptr, this -> sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this -> ring_fd, IORING_OFF_SQ_RING);
+    if(this -> sq_ring == MAP_FAILED) {
+        return false;
+    }
+
+    if(single_mmap) {
+        this -> cq_ring = this -> sq_ring;
+    }
+    else {
+        this -> cq_ring = mmap(nullptr, this -> cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this -> ring_fd, IORING_OFF_CQ_RING);
+        if(this -> cq_ring == MAP_FAILED) {
+            return false;
+        }
+    }
+
+    this -> sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    this -> sqes = mmap(nullptr, this -> sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this -> ring_fd, IORING_OFF_SQES);
+    if(this -> sqes == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq_ptr = static_cast<char*>(this -> sq_ring);
+    this -> sq_head = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.head);
+    this -> sq_tail = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.tail);
+    this -> sq_mask = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.ring_mask);
+    this -> sq_array = reinterpret_cast<uint32_t*>(sq_ptr + params.sq_off.array);
+
+    char* cq_ptr = static_cast<char*>(this -> cq_ring);
+    this -> cq_head = reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.head);
+    this -> cq_tail = reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.tail);
+    this -> cq_mask = reinterpret_cast<uint32_t*>(cq_ptr + params.cq_off.ring_mask);
+    this -> cqes = cq_ptr + params.cq_off.cqes;
+
+    return true;
+}
+
+void Async_Reader::close_ring() {
+    if(this -> sqes != MAP_FAILED) {
+        munmap(this -> sqes, this -> sqes_size);
+        this -> sqes = MAP_FAILED;
+    }
+
+    if(this -> cq_ring != MAP_FAILED && this -> cq_ring != this -> sq_ring) {
+        munmap(this -> cq_ring, this -> cq_ring_size);
+    }
+    this -> cq_ring = MAP_FAILED;
+
+    if(this -> sq_ring != MAP_FAILED) {
+        munmap(this -> sq_ring, this -> sq_ring_size);
+        this -> sq_ring = MAP_FAILED;
+    }
+
+    if(this -> ring_fd >= 0) {
+        close(this -> ring_fd);
+        this -> ring_fd = -1;
+    }
+}
+
+uint32_t Async_Reader::reap_completions(std::vector<Async_Read_Request>& requests) {
+    io_uring_cqe* cqe_array = static_cast<io_uring_cqe*>(this -> cqes);
+
+    uint32_t reaped = 0;
+    uint32_t head = *this -> cq_head;
+    while(head != __atomic_load_n(this -> cq_tail, __ATOMIC_ACQUIRE)) {
+        io_uring_cqe& cqe = cqe_array[head & *this -> cq_mask];
+        Async_Read_Request& request = requests[cqe.user_data];
+
+        // IORING_OP_READ is missing before linux 5.6, such reads are redone synchronously
+        if(cqe.res == -EINVAL) {
+            ssize_t bytes_read = pread(request.fd, request.buffer, request.length, request.offset);
+            request.result = bytes_read < 0 ? -errno : bytes_read;
+        }
+        else {
+            request.result = cqe.res;
+        }
+
+        ++head;
+        ++reaped;
+    }
+    __atomic_store_n(this -> cq_head, head, __ATOMIC_RELEASE);
+
+    return reaped;
+}
+
+void Async_Reader::read_batch(std::vector<Async_Read_Request>& requests) {
+    if(!this -> is_async()) {
+        this -> read_batch_sync(requests);
+        return;
+    }
+
+    io_uring_sqe* sqe_array = static_cast<io_uring_sqe*>(this -> sqes);
+
+    size_t next_request = 0;
+    size_t completed = 0;
+    uint32_t in_flight = 0;
+    // queued but not taken by the kernel yet, always the last ones queued, they are passed to the next io_uring_enter again
+    uint32_t unsubmitted = 0;
+    uint32_t failed_enters = 0;
+
+    while(completed < requests.size()) {
+        // fill the submission queue up to the queue depth
+        uint32_t tail = *this -> sq_tail;
+        while(next_request < requests.size() && in_flight + unsubmitted < this -> queue_depth) {
+            Async_Read_Request& request = requests[next_request];
+            uint32_t index = tail & *this -> sq_mask;
+
+            io_uring_sqe& sqe = sqe_array[index];
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = request.fd;
+            sqe.off = request.offset;
+            sqe.addr = reinterpret_cast<uint64_t>(request.buffer);
+            sqe.len = request.length;
+            sqe.user_data = next_request;
+
+            this -> sq_array[index] = index;
+            ++tail;
+            ++unsubmitted;
+            ++next_request;
+        }
+        __atomic_store_n(this -> sq_tail, tail, __ATOMIC_RELEASE);
+
+        int submitted = 0;
+        do {
+            submitted = syscall(__NR_io_uring_enter, this -> ring_fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        } while(submitted < 0 && errno == EINTR);
+
+        if(submitted < 0 || (submitted == 0 && unsubmitted > 0)) {
+            int enter_error = submitted < 0 ? errno : EAGAIN;
+
+            // the kernel is short of memory or of room for completions, both free up as the reads in flight complete
+            bool transient = enter_error == EAGAIN || enter_error == EBUSY;
+            if(!transient || ++failed_enters >= ASYNC_READER_MAX_FAILED_ENTERS) {
+                this -> finish_batch_sync(requests, next_request - unsubmitted, unsubmitted, in_flight);
+
+                // io_uring_enter will not start working again, the later batches go straight to pread
+                if(!transient) {
+                    this -> close_ring();
+                }
+                return;
+            }
+        }
+        else {
+            failed_enters = 0;
+            in_flight += submitted;
+            unsubmitted -= submitted;
+        }
+
+        // reap everything that has completed so far
+        uint32_t reaped = this -> reap_completions(requests);
+        completed += reaped;
+        in_flight -= reaped;
+    }
+}
+
+void Async_Reader::finish_batch_sync(std::vector<Async_Read_Request>& requests, size_t first_unsubmitted, uint32_t unsubmitted, uint32_t in_flight) {
+    // without SQPOLL the kernel only looks at the submission queue inside io_uring_enter, so the entries it did not take can be taken back
+    __atomic_store_n(this -> sq_tail, *this -> sq_tail - unsubmitted, __ATOMIC_RELEASE);
+
+    this -> read_batch_sync(requests, first_unsubmitted);
+
+    // the reads in flight still write into the buffers, they have to complete before the batch returns
+    while(in_flight > 0) {
+        int waited = 0;
+        do {
+            waited = syscall(__NR_io_uring_enter, this -> ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        } while(waited < 0 && errno == EINTR);
+        int enter_error = errno;
+
+        uint32_t reaped = this -> reap_completions(requests);
+        in_flight -= reaped;
+
+        if(waited < 0 && reaped == 0) {
+            throw std::runtime_error(std::string(ASYNC_READER_FAILED_ENTER_ERR_MSG) + strerror(enter_error));
+        }
+    }
+}
+
+#else
+
+bool Async_Reader::setup_ring() {
+    return false;
+}
+
+void Async_Reader::close_ring() {
+
+}
+
+void Async_Reader::read_batch(std::vector<Async_Read_Request>& requests) {
+    this -> read_batch_sync(requests);
+}
+
+#endif
+
+void Async_Reader::read_batch_sync(std::vector<Async_Read_Request>& requests, size_t first) const {
+    for(size_t i = first; i < requests.size(); ++i) {
+        Async_Read_Request& request = requests[i];
+        ssize_t bytes_read = 0;
+        do {
+            bytes_read = pread(request.fd, request.buffer, request.length, request.offset);
+        } while(bytes_read < 0 && errno == EINTR);
+
+        request.result = bytes_read < 0 ? -errno : bytes_read;
+    }
+}
@@ -56,7 +56,7 @@ AVL_Tree::Node* AVL_Tree::left_rotate(AVL_Tree::Node* node) {
 	return r_node;
 }
 
-AVL_Tree::Node* AVL_Tree::insert(AVL_Tree::Node* node, Entry& entry) {
+AVL_Tree::Node* AVL_Tree::insert(AVL_Tree::Node* node, Entry& entry, const std::vector<sequence_number_type>& live_snapshots) {
 	if(!entry.check_checksum()) {
 		std::cerr << ENTRY_CHECKSUM_MISMATCH;
 		return nullptr;
@@ -72,13 +72,13 @@ AVL_Tree::Node* AVL_Tree::insert(AVL_Tree::Node* node, Entry& entry) {
 	}
 
 	if(entry < node -> data) {
-		node -> left = insert(node -> left, entry);
+		node -> left = insert(node -> left, entry, live_snapshots);
 	}	
 	else if (entry > node -> data) {
-		node -> right = insert(node -> right, entry);
+		node -> right = insert(node -> right, entry, live_snapshots);
 	}
 	else {
-		node -> data = entry;
+		this -> replace_version(node, entry, live_snapshots);
 		return node; 
 	}
 	
@@ -108,6 +108,43 @@ AVL_Tree::Node* AVL_Tree::insert(AVL_Tree::Node* node, Entry& entry) {
 	return node;
 }
 
+void AVL_Tree::replace_version(AVL_Tree::Node* node, Entry& entry, const std::vector<sequence_number_type>& live_snapshots) {
+	std::vector<Entry> kept_versions;
+
+	if(!live_snapshots.empty()) {
+		sequence_number_type newer_sequence_number = entry.get_sequence_number();
+
+		if(snapshot_needs_version(live_snapshots, node -> data.get_sequence_number(), newer_sequence_number)) {
+			kept_versions.push_back(node -> data);
+		}
+		newer_sequence_number = node -> data.get_sequence_number();
+
+		for(const Entry& version : node -> history) {
+			if(snapshot_needs_version(live_snapshots, version.get_sequence_number(), newer_sequence_number)) {
+				kept_versions.push_back(version);
+			}
+			newer_sequence_number = version.get_sequence_number();
+		}
+	}
+
+	node -> data = entry;
+	node -> history = std::move(kept_versions);
+}
+
+Entry* AVL_Tree::visible_version(AVL_Tree::Node* node, sequence_number_type snapshot) {
+	if(node -> data.get_sequence_number() <= snapshot) {
+		return &node -> data;
+	}
+
+	for(Entry& version : node -> history) {
+		if(version.get_sequence_number() <= snapshot) {
+			return &version;
+		}
+	}
+
+	return nullptr;
+}
+
 AVL_Tree::Node* AVL_Tree::min_value_node(AVL_Tree::Node* node) {
 	if(!node) {
 		return nullptr;
@@ -148,6 +185,7 @@ AVL_Tree::Node* AVL_Tree::delete_node(AVL_Tree::Node* node, Bits& key) {
 		else {
 			AVL_Tree::Node* temp = min_value_node(node -> right);
 			node -> data = temp -> data;
+			node -> history = temp -> history;
 			Bits temp_key = temp -> data.get_key();
 			node -> right = this -> delete_node(node -> right, temp_key);
 		}
@@ -211,6 +249,7 @@ AVL_Tree::Node* AVL_Tree::delete_node(AVL_Tree::Node* node, Entry& entry) {
 		else {
 			AVL_Tree::Node* temp = min_value_node(node -> right);
 			node -> data = temp -> data;
+			node -> history = temp -> history;
 			node -> right = this -> delete_node(node -> right, temp -> data);
 		}
 	}
@@ -248,6 +287,7 @@ void AVL_Tree::inorder(AVL_Tree::Node* node, std::vector<Entry>& result) {
 	if(node) {
 		this -> inorder(node -> left, result);
 		result.push_back(node -> data);
+		result.insert(result.end(), node -> history.begin(), node -> history.end());
 		this -> inorder(node -> right, result);
 	}	
 }
@@ -260,23 +300,16 @@ void AVL_Tree::print_inorder() {
 	}
 }
 
-Entry AVL_Tree::search(AVL_Tree::Node* node, Bits& key, bool& found) {
-	if(!node) {
-		found = false;
-		std::string key(ENTRY_PLACEHOLDER_KEY);
-		std::string value(ENTRY_PLACEHOLDER_VALUE);
-		return Entry(Bits(key), Bits(value));
-	}
-	if(node -> data.get_key() == key) {
-		found = true;
-		return node -> data;
-	}
+AVL_Tree::Node* AVL_Tree::find_node(AVL_Tree::Node* node, const Bits& key) const {
+	while(node) {
+		if(node -> data.get_key() == key) {
+			return node;
+		}
 
-	if(key < node -> data.get_key()) {
-		return this -> search(node -> left, key, found);
+		node = key < node -> data.get_key()? node -> left : node -> right;
 	}
 
-	return this -> search(node -> right, key, found);
+	return nullptr;
 }
 
 AVL_Tree::AVL_Tree() : root(nullptr) {
@@ -292,7 +325,12 @@ AVL_Tree::AVL_Tree(Entry& entry) {
 }
 
 void AVL_Tree::insert(Entry& entry) {
-	AVL_Tree::Node* new_root = this -> insert(this -> root, entry);
+	std::vector<sequence_number_type> no_snapshots;
+	this -> insert(entry, no_snapshots);
+}
+
+void AVL_Tree::insert(Entry& entry, const std::vector<sequence_number_type>& live_snapshots) {
+	AVL_Tree::Node* new_root = this -> insert(this -> root, entry, live_snapshots);
 	
 	if(!new_root) {
 		std::cerr << AVL_TREE_INSERTION_FAILED_ERR;
@@ -323,8 +361,33 @@ void AVL_Tree::remove(Bits& key) {
 	this -> root = new_root;
 }
 
-Entry AVL_Tree::search(Bits& key, bool& found) {
-	return this -> search(this -> root, key, found);
+Entry AVL_Tree::search(Bits& key, bool& found, sequence_number_type snapshot) {
+	AVL_Tree::Node* node = this -> find_node(this -> root, key);
+	Entry* visible_entry = node? visible_version(node, snapshot) : nullptr;
+
+	if(!visible_entry) {
+		found = false;
+		std::string key(ENTRY_PLACEHOLDER_KEY);
+		std::string value(ENTRY_PLACEHOLDER_VALUE);
+		return Entry(Bits(key), Bits(value));
+	}
+
+	found = true;
+	return *visible_entry;
+}
+
+uint64_t AVL_Tree::get_versions_length(const Bits& key) {
+	AVL_Tree::Node* node = this -> find_node(this -> root, key);
+	if(!node) {
+		return 0;
+	}
+
+	uint64_t versions_length = node -> data.get_entry_length();
+	for(Entry& version : node -> history) {
+		versions_length += version.get_entry_length();
+	}
+
+	return versions_length;
 }
 
 std::vector<Entry> AVL_Tree::inorder() {
@@ -400,34 +463,86 @@ Entry AVL_Tree::pop_last(AVL_Tree::Node*& node) {
 	return result;
 }
 
-std::vector<Entry> AVL_Tree::get_entries_larger_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys) const {
-	std::vector<Entry> entries;
-	this -> collect_larger(this -> root, key, count, entries, dead_keys, [](const Entry& e) {
-		return e;
-	});
-	return entries;
+AVL_Tree::Iterator AVL_Tree::get_iterator(sequence_number_type snapshot) const {
+	return Iterator(this -> root, snapshot);
+}
+
+AVL_Tree::Iterator::Iterator(AVL_Tree::Node* _root, sequence_number_type _snapshot) : root(_root), snapshot(_snapshot), direction(ITERATOR_FORWARD), current_entry(nullptr) {
+
+}
+
+void AVL_Tree::Iterator::push_spine(AVL_Tree::Node* node) {
+	while(node) {
+		this -> stack.push_back(node);
+		node = this -> direction == ITERATOR_FORWARD? node -> left : node -> right;
+	}
 }
 
-std::vector<Bits> AVL_Tree::get_keys_larger_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys) const {
-	std::vector<Bits> keys;
-	this -> collect_larger(this -> root, key, count, keys, dead_keys, [](const Entry& e){
-		return e.get_key();
-	});
-	return keys;
+void AVL_Tree::Iterator::settle() {
+	this -> current_entry = nullptr;
+
+	while(!this -> stack.empty()) {
+		Entry* visible_entry = visible_version(this -> stack.back(), this -> snapshot);
+		if(visible_entry) {
+			this -> current_entry = visible_entry;
+			return;
+		}
+
+		// every version of this key is newer than the snapshot, move on
+		Node* node = this -> stack.back();
+		this -> stack.pop_back();
+		this -> push_spine(this -> direction == ITERATOR_FORWARD? node -> right : node -> left);
+	}
 }
 
-std::vector<Entry> AVL_Tree::get_entries_smaller_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys) const {
-	std::vector<Entry> entries;
-	this -> collect_smaller(this -> root, key, count, entries, dead_keys, [](const Entry& e) {
-		return e;
-	});
-	return entries;
+void AVL_Tree::Iterator::seek(const Bits& target, Iterator_Direction _direction) {
+	this -> direction = _direction;
+	this -> stack.clear();
+
+	// keep the path to the nearest key, nodes on the wrong side of target are never visited
+	Node* node = this -> root;
+	while(node) {
+		const Bits& current_key = node -> data.get_key();
+		if(this -> direction == ITERATOR_FORWARD) {
+			if(current_key >= target) {
+				this -> stack.push_back(node);
+				node = node -> left;
+			}
+			else {
+				node = node -> right;
+			}
+		}
+		else {
+			if(current_key <= target) {
+				this -> stack.push_back(node);
+				node = node -> right;
+			}
+			else {
+				node = node -> left;
+			}
+		}
+	}
+
+	this -> settle();
+}
+
+bool AVL_Tree::Iterator::valid() const {
+	return this -> current_entry != nullptr;
+}
+
+void AVL_Tree::Iterator::next() {
+	if(this -> stack.empty()) {
+		this -> current_entry = nullptr;
+		return;
+	}
+
+	Node* node = this -> stack.back();
+	this -> stack.pop_back();
+	this -> push_spine(this -> direction == ITERATOR_FORWARD? node -> right : node -> left);
+
+	this -> settle();
 }
 
-std::vector<Bits> AVL_Tree::get_keys_smaller_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys) const {
-	std::vector<Bits> keys;
-	this -> collect_smaller(this -> root, key, count, keys, dead_keys, [](const Entry& e){
-		return e.get_key();
-	});
-	return keys;
+const Entry& AVL_Tree::Iterator::entry() const {
+	return *this -> current_entry;
 }
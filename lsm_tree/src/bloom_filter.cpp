@@ -0,0 +1,85 @@
+#include "../include/bloom_filter.h"
+#include <algorithm>
+
+Bloom_Filter::Bloom_Filter() : bits(BLOOM_FILTER_MIN_BITS / 8, '\0'), hash_count(1) {
+
+}
+
+uint64_t Bloom_Filter::hash_key(const std::string& key) {
+    // 64 bit FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char byte : key) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+Bloom_Filter Bloom_Filter::build(const std::vector<uint64_t>& key_hashes, uint32_t bits_per_key) {
+    Bloom_Filter filter;
+
+    // k = ln(2) * bits per key gives the fewest false positives
+    filter.hash_count = static_cast<uint8_t>(std::clamp<uint32_t>(bits_per_key * 69 / 100, 1, BLOOM_FILTER_MAX_HASH_COUNT));
+
+    uint64_t bit_count = std::max<uint64_t>(key_hashes.size() * bits_per_key, BLOOM_FILTER_MIN_BITS);
+    bit_count = (bit_count + 7) / 8 * 8;
+    filter.bits.assign(bit_count / 8, '\0');
+
+    for(uint64_t hash : key_hashes) {
+        uint32_t h = static_cast<uint32_t>(hash);
+        uint32_t delta = static_cast<uint32_t>(hash >> 32) | 1;
+
+        for(uint8_t i = 0; i < filter.hash_count; ++i) {
+            uint64_t bit = h % bit_count;
+            filter.bits[bit / 8] |= static_cast<char>(1 << (bit % 8));
+            h += delta;
+        }
+    }
+
+    return filter;
+}
+
+bool Bloom_Filter::may_contain(const std::string& key) const {
+    uint64_t bit_count = this -> bits.size() * 8;
+    if(bit_count == 0) {
+        return true;
+    }
+
+    uint64_t hash = Bloom_Filter::hash_key(key);
+    uint32_t h = static_cast<uint32_t>(hash);
+    uint32_t delta = static_cast<uint32_t>(hash >> 32) | 1;
+
+    for(uint8_t i = 0; i < this -> hash_count; ++i) {
+        uint64_t bit = h % bit_count;
+        if((this -> bits[bit / 8] & (1 << (bit % 8))) == 0) {
+            return false;
+        }
+        h += delta;
+    }
+
+    return true;
+}
+
+std::string Bloom_Filter::encode() const {
+    std::string encoded;
+    encoded.reserve(1 + this -> bits.size());
+    encoded.push_back(static_cast<char>(this -> hash_count));
+    encoded.append(this -> bits);
+    return encoded;
+}
+
+bool Bloom_Filter::decode(const std::string& encoded) {
+    if(encoded.size() < 2) {
+        return false;
+    }
+
+    uint8_t decoded_hash_count = static_cast<uint8_t>(encoded[0]);
+    if(decoded_hash_count == 0 || decoded_hash_count > BLOOM_FILTER_MAX_HASH_COUNT) {
+        return false;
+    }
+
+    this -> hash_count = decoded_hash_count;
+    this -> bits = encoded.substr(1);
+    return true;
+}
@@ -0,0 +1,175 @@
+#include "../include/buffered_file_writer.h"
+#include "../include/file_exception.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+Buffered_File_Writer::Buffered_File_Writer(const std::filesystem::path& _file, File_Io_Mode _io_mode) : file(_file), fd(-1), io_mode(_io_mode), buffer(nullptr), buffer_used(0), file_offset(0), synced_offset(0), dropped_offset(0) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+#ifdef O_DIRECT
+    if(this -> io_mode == FILE_IO_DIRECT) {
+        this -> fd = ::open(this -> file.c_str(), flags | O_DIRECT, 0644);
+
+        // tmpfs and a few others refuse O_DIRECT, still keep the writes out of the cache as well as we can
+        if(this -> fd < 0 && errno == EINVAL) {
+            this -> io_mode = FILE_IO_DROP_CACHE;
+        }
+    }
+#else
+    if(this -> io_mode == FILE_IO_DIRECT) {
+        this -> io_mode = FILE_IO_DROP_CACHE;
+    }
+#endif
+
+    if(this -> fd < 0) {
+        this -> fd = ::open(this -> file.c_str(), flags, 0644);
+    }
+
+    if(this -> fd < 0) {
+        throw File_Exception(BUFFERED_FILE_WRITER_FAILED_OPEN_ERR_MSG, this -> file.generic_string().c_str());
+    }
+
+    void* aligned_buffer = nullptr;
+    if(::posix_memalign(&aligned_buffer, BUFFERED_FILE_WRITER_ALIGNMENT, BUFFERED_FILE_WRITER_BUFFER_SIZE) != 0) {
+        ::close(this -> fd);
+        this -> fd = -1;
+        throw File_Exception(BUFFERED_FILE_WRITER_FAILED_ALLOC_ERR_MSG, this -> file.generic_string().c_str());
+    }
+
+    this -> buffer = static_cast<char*>(aligned_buffer);
+}
+
+Buffered_File_Writer::~Buffered_File_Writer() {
+    if(this -> fd >= 0) {
+        ::close(this -> fd);
+    }
+
+    std::free(this -> buffer);
+}
+
+void Buffered_File_Writer::write_all(const char* data, uint64_t length) {
+    while(length > 0) {
+        ssize_t written = ::write(this -> fd, data, length);
+
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            throw File_Exception(BUFFERED_FILE_WRITER_FAILED_WRITE_ERR_MSG, this -> file.generic_string().c_str());
+        }
+
+        data += written;
+        length -= written;
+        this -> file_offset += written;
+    }
+}
+
+void Buffered_File_Writer::flush_buffer() {
+    if(this -> buffer_used == 0) {
+        return;
+    }
+
+    this -> write_all(this -> buffer, this -> buffer_used);
+    this -> buffer_used = 0;
+
+    if(this -> file_offset - this -> synced_offset >= BUFFERED_FILE_WRITER_BYTES_PER_SYNC) {
+        this -> start_writeback();
+    }
+}
+
+void Buffered_File_Writer::start_writeback() {
+    // O_DIRECT writes are on the disk once write() returns
+    if(this -> io_mode == FILE_IO_DIRECT) {
+        this -> synced_offset = this -> file_offset;
+        return;
+    }
+
+    // both calls are only hints, if they fail the final fdatasync still reports any write error
+#ifdef SYNC_FILE_RANGE_WRITE
+    ::sync_file_range(this -> fd, this -> synced_offset, this -> file_offset - this -> synced_offset, SYNC_FILE_RANGE_WRITE);
+
+    // the previous range had a whole BUFFERED_FILE_WRITER_BYTES_PER_SYNC to be written back, so waiting on it is cheap
+    // dirty pages are not dropped by DONTNEED, which is why only ranges that are known to be written back are advised
+    if(this -> io_mode == FILE_IO_DROP_CACHE && this -> synced_offset > this -> dropped_offset) {
+        ::sync_file_range(this -> fd, this -> dropped_offset, this -> synced_offset - this -> dropped_offset, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        ::posix_fadvise(this -> fd, this -> dropped_offset, this -> synced_offset - this -> dropped_offset, POSIX_FADV_DONTNEED);
+        this -> dropped_offset = this -> synced_offset;
+    }
+#endif
+
+    this -> synced_offset = this -> file_offset;
+}
+
+void Buffered_File_Writer::append(const char* data, uint64_t length) {
+    if(this -> fd < 0) {
+        throw File_Exception(BUFFERED_FILE_WRITER_CLOSED_ERR_MSG, this -> file.generic_string().c_str());
+    }
+
+    while(length > 0) {
+        uint64_t copy_length = std::min<uint64_t>(length, BUFFERED_FILE_WRITER_BUFFER_SIZE - this -> buffer_used);
+        std::memcpy(this -> buffer + this -> buffer_used, data, copy_length);
+
+        this -> buffer_used += copy_length;
+        data += copy_length;
+        length -= copy_length;
+
+        if(this -> buffer_used == BUFFERED_FILE_WRITER_BUFFER_SIZE) {
+            this -> flush_buffer();
+        }
+    }
+}
+
+uint64_t Buffered_File_Writer::position() const {
+    return this -> file_offset + this -> buffer_used;
+}
+
+bool Buffered_File_Writer::close() {
+    if(this -> fd < 0) {
+        return false;
+    }
+
+    bool success = true;
+
+#ifdef O_DIRECT
+    // the tail is not a whole block, O_DIRECT would refuse it
+    if(this -> io_mode == FILE_IO_DIRECT && this -> buffer_used % BUFFERED_FILE_WRITER_ALIGNMENT != 0) {
+        int flags = ::fcntl(this -> fd, F_GETFL);
+        if(flags < 0 || ::fcntl(this -> fd, F_SETFL, flags & ~O_DIRECT) < 0) {
+            success = false;
+        }
+    }
+#endif
+
+    try {
+        if(success) {
+            this -> flush_buffer();
+        }
+    }
+    catch(const File_Exception&) {
+        success = false;
+    }
+
+    // drop whatever is still cached, including the unaligned tail of an O_DIRECT file
+    if(success && this -> io_mode != FILE_IO_BUFFERED) {
+#ifdef SYNC_FILE_RANGE_WRITE
+        ::sync_file_range(this -> fd, this -> dropped_offset, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#endif
+        ::posix_fadvise(this -> fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    if(::close(this -> fd) != 0) {
+        success = false;
+    }
+    this -> fd = -1;
+
+    return success;
+}
+
+File_Io_Mode Buffered_File_Writer::get_io_mode() const {
+    return this -> io_mode;
+}
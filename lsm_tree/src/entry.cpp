@@ -3,24 +3,36 @@
 #include <stdexcept>
 
 void Entry::calculate_checksum(){
-    std::string key_string = key.get_string();
-    std::string value_string = value.get_string();
+    checksum = compute_checksum();
 
-    std::string string_to_hash = key_string;
-    string_to_hash += value_string;
-    uint32_t hashed_string = crc32(string_to_hash);
+    return;
+};
 
-    checksum = hashed_string;
+uint32_t Entry::compute_checksum() const{
+    // the flags, sequence number and expiry time decide which version a read sees and how its value is read, so they are covered too
+    bool has_expiry_time = tombstone_flag & ENTRY_EXPIRY_FLAG;
 
-    return;
+    std::string string_to_hash;
+    string_to_hash.reserve(sizeof(tombstone_flag) + sizeof(sequence_number) + sizeof(expiry_time) + key.size() + value.size());
+    string_to_hash.append(reinterpret_cast<const char*>(&tombstone_flag), sizeof(tombstone_flag));
+    string_to_hash.append(reinterpret_cast<const char*>(&sequence_number), sizeof(sequence_number));
+    if(has_expiry_time) {
+        string_to_hash.append(reinterpret_cast<const char*>(&expiry_time), sizeof(expiry_time));
+    }
+    string_to_hash += key.get_string();
+    string_to_hash += value.get_string();
+
+    return crc32(string_to_hash);
 };
 
 void Entry::calculate_entry_length(){
     entry_length =  sizeof(uint64_t)
                     + sizeof(tombstone_flag)
+                    + sizeof(sequence_number)
+                    + ((tombstone_flag & ENTRY_EXPIRY_FLAG)? sizeof(expiry_time) : 0)
                     + sizeof(key_len_type)
                     + key.size()
-                    + sizeof(key_len_type)
+                    + sizeof(value_len_type)
                     + value.size()
                     + sizeof(checksum);
 };
@@ -39,6 +51,8 @@ Entry::Entry(Bits _key, Bits _value) : key(ENTRY_PLACEHOLDER_KEY), value(ENTRY_P
 
     entry_length = 0;
     tombstone_flag = ENTRY_TOMBSTONE_OFF;;
+    sequence_number = ENTRY_NO_SEQUENCE_NUMBER;
+    expiry_time = ENTRY_NO_EXPIRY;
     checksum = 0;
 
     calculate_checksum();
@@ -51,6 +65,8 @@ Entry::~Entry(){
 Entry::Entry(const Entry& other) : key(other.key), value(other.value){
     entry_length = other.entry_length;
     tombstone_flag = other.tombstone_flag;
+    sequence_number = other.sequence_number;
+    expiry_time = other.expiry_time;
     checksum = other.checksum;
 }
 
@@ -58,8 +74,32 @@ uint64_t Entry::get_entry_length(){
     return entry_length;
 };
 
-bool Entry::is_deleted(){
-    return tombstone_flag;
+bool Entry::is_deleted() const{
+    if(tombstone_flag & ENTRY_TOMBSTONE_ON){
+        return true;
+    }
+
+    return (tombstone_flag & ENTRY_EXPIRY_FLAG) && this -> is_expired(Entry::current_time());
+};
+
+bool Entry::is_value_pointer() const{
+    return tombstone_flag & ENTRY_VALUE_POINTER_FLAG;
+};
+
+void Entry::set_value_pointer(bool _value_pointer){
+    tombstone_flag = _value_pointer? (tombstone_flag | ENTRY_VALUE_POINTER_FLAG) : (tombstone_flag & ~ENTRY_VALUE_POINTER_FLAG);
+    calculate_checksum();
+    return;
+};
+
+bool Entry::is_merge_operand() const{
+    return tombstone_flag & ENTRY_MERGE_OPERAND_FLAG;
+};
+
+void Entry::set_merge_operand(bool _merge_operand){
+    tombstone_flag = _merge_operand? (tombstone_flag | ENTRY_MERGE_OPERAND_FLAG) : (tombstone_flag & ~ENTRY_MERGE_OPERAND_FLAG);
+    calculate_checksum();
+    return;
 };
 
 Bits Entry::get_key() const {
@@ -75,15 +115,66 @@ uint32_t Entry::get_checksum(){
 };
 
 void Entry::set_tombstone(){
-    tombstone_flag = tombstone_flag == ENTRY_TOMBSTONE_OFF? ENTRY_TOMBSTONE_ON : ENTRY_TOMBSTONE_OFF;
+    tombstone_flag ^= ENTRY_TOMBSTONE_ON;
+    calculate_checksum();
     return;
 };
 
 void Entry::set_tombstone(bool _tombstone_flag){
-    tombstone_flag = _tombstone_flag? ENTRY_TOMBSTONE_ON : ENTRY_TOMBSTONE_OFF;
+    tombstone_flag = _tombstone_flag? (tombstone_flag | ENTRY_TOMBSTONE_ON) : (tombstone_flag & ~ENTRY_TOMBSTONE_ON);
+    calculate_checksum();
     return;
 };
 
+sequence_number_type Entry::get_sequence_number() const {
+    return this -> sequence_number;
+}
+
+void Entry::set_sequence_number(sequence_number_type _sequence_number) {
+    this -> sequence_number = _sequence_number;
+    calculate_checksum();
+}
+
+uint64_t Entry::get_expiry_time() const {
+    return this -> expiry_time;
+}
+
+void Entry::set_expiry_time(uint64_t _expiry_time) {
+    this -> expiry_time = _expiry_time;
+    this -> tombstone_flag = _expiry_time != ENTRY_NO_EXPIRY? (this -> tombstone_flag | ENTRY_EXPIRY_FLAG) : (this -> tombstone_flag & ~ENTRY_EXPIRY_FLAG);
+    calculate_checksum();
+    calculate_entry_length();
+}
+
+bool Entry::is_expired(uint64_t now) const {
+    return this -> expiry_time != ENTRY_NO_EXPIRY && this -> expiry_time <= now;
+}
+
+uint64_t Entry::current_time() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t Entry::read_expiry_time(const std::string& file_entry_data) {
+    uint8_t flag = 0;
+    uint64_t stored_expiry_time = ENTRY_NO_EXPIRY;
+
+    if(file_entry_data.size() < sizeof(flag) + sizeof(sequence_number_type) + sizeof(stored_expiry_time)) {
+        return ENTRY_NO_EXPIRY;
+    }
+
+    memcpy(&flag, file_entry_data.data(), sizeof(flag));
+    if(!(flag & ENTRY_EXPIRY_FLAG)) {
+        return ENTRY_NO_EXPIRY;
+    }
+
+    memcpy(&stored_expiry_time, file_entry_data.data() + sizeof(flag) + sizeof(sequence_number_type), sizeof(stored_expiry_time));
+    return stored_expiry_time;
+}
+
+bool Entry::read_merge_operand(const std::string& file_entry_data) {
+    return !file_entry_data.empty() && (static_cast<uint8_t>(file_entry_data[0]) & ENTRY_MERGE_OPERAND_FLAG);
+}
+
 void Entry::update_value(Bits _value){
     value = _value;
     calculate_checksum();
@@ -94,6 +185,8 @@ void Entry::update_value(Bits _value){
 Entry& Entry::operator=(const Entry& other){
     entry_length = other.entry_length;
     tombstone_flag = other.tombstone_flag;
+    sequence_number = other.sequence_number;
+    expiry_time = other.expiry_time;
     key = other.key;
     value = other.value;
     checksum = other.checksum;
@@ -107,8 +200,12 @@ std::ostringstream Entry::get_ostream_bytes(){
     key_len_type key_size = key.size();
     value_len_type value_size = value.size();
 
+    bool has_expiry_time = tombstone_flag & ENTRY_EXPIRY_FLAG;
+
     entry_length =  sizeof(entry_length)
             + sizeof(tombstone_flag)
+            + sizeof(sequence_number)
+            + (has_expiry_time? sizeof(expiry_time) : 0)
             + sizeof(key_len_type)
             + key_size
             + sizeof(value_len_type)
@@ -117,6 +214,10 @@ std::ostringstream Entry::get_ostream_bytes(){
 
     ostream_bytes.write(reinterpret_cast<const char*>(&entry_length), sizeof(entry_length));
     ostream_bytes.write(reinterpret_cast<const char*>(&tombstone_flag), sizeof(tombstone_flag));
+    ostream_bytes.write(reinterpret_cast<const char*>(&sequence_number), sizeof(sequence_number));
+    if(has_expiry_time) {
+        ostream_bytes.write(reinterpret_cast<const char*>(&expiry_time), sizeof(expiry_time));
+    }
     ostream_bytes.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
     ostream_bytes.write(key.get_string().data(), key_size);
     ostream_bytes.write(reinterpret_cast<const char*>(&value_size), sizeof(value_size));
@@ -135,7 +236,11 @@ std::string Entry::get_string_data_bytes() const {
     // key_len_type key_size = this -> key.size();
     // value_len_type value_size = this -> value.size();
 
+    bool has_expiry_time = tombstone_flag & ENTRY_EXPIRY_FLAG;
+
     uint64_t total_record_size = sizeof(tombstone_flag) +
+                                sizeof(sequence_number) +
+                                (has_expiry_time? sizeof(expiry_time) : 0) +
                                 sizeof(value_len) +
                                 value_len +
                                 sizeof(checksum);
@@ -148,6 +253,16 @@ std::string Entry::get_string_data_bytes() const {
     memcpy(ptr, &tombstone_flag, sizeof(tombstone_flag));
     ptr += sizeof(tombstone_flag);
 
+    // write the sequence number
+    memcpy(ptr, &sequence_number, sizeof(sequence_number));
+    ptr += sizeof(sequence_number);
+
+    // write the expiry time, entries without a ttl leave it out
+    if(has_expiry_time) {
+        memcpy(ptr, &expiry_time, sizeof(expiry_time));
+        ptr += sizeof(expiry_time);
+    }
+
     // write the value size
     memcpy(ptr, &value_len, sizeof(value_len));
     ptr += sizeof(value_len);
@@ -183,6 +298,15 @@ Entry::Entry(std::stringstream& file_entry) : key(ENTRY_PLACEHOLDER_KEY), value(
         throw std::runtime_error(ENTRY_FAILED_READ_TOMBSTONE_FLAG_MSG);
     }
 
+    if(!file_entry.read(reinterpret_cast<char*>(&sequence_number), sizeof(sequence_number))) {
+        throw std::runtime_error(ENTRY_FAILED_READ_SEQUENCE_NUMBER_MSG);
+    }
+
+    expiry_time = ENTRY_NO_EXPIRY;
+    if((tombstone_flag & ENTRY_EXPIRY_FLAG) && !file_entry.read(reinterpret_cast<char*>(&expiry_time), sizeof(expiry_time))) {
+        throw std::runtime_error(ENTRY_FAILED_READ_EXPIRY_TIME_MSG);
+    }
+
     key_len_type key_size;
     if(!file_entry.read(reinterpret_cast<char*>(&key_size), sizeof(key_size))) {
         throw std::runtime_error(ENTRY_FAILED_READ_KEY_LENGTH_MSG);
@@ -238,7 +362,7 @@ Entry::Entry(std::string& file_entry_key, std::string& file_entry_data) : key(EN
         throw std::runtime_error(ENTRY_FAILED_READ_KEY_MSG);
     }
 
-    if(file_entry_data.size() < sizeof(tombstone_flag) + sizeof(value_len_type)) {
+    if(file_entry_data.size() < sizeof(tombstone_flag) + sizeof(sequence_number) + sizeof(value_len_type)) {
         throw std::runtime_error(ENTRY_DATA_TOO_SHORT_ERR_MSG);
     }
 
@@ -246,12 +370,28 @@ Entry::Entry(std::string& file_entry_key, std::string& file_entry_data) : key(EN
     memcpy(&tombstone_flag, data_ptr, sizeof(tombstone_flag));
     data_ptr += sizeof(tombstone_flag);
 
+    memcpy(&sequence_number, data_ptr, sizeof(sequence_number));
+    data_ptr += sizeof(sequence_number);
+
+    // everything after the sequence number is shifted by the expiry time if there is one
+    uint64_t header_size = sizeof(tombstone_flag) + sizeof(sequence_number) + sizeof(value_len_type);
+    expiry_time = ENTRY_NO_EXPIRY;
+    if(tombstone_flag & ENTRY_EXPIRY_FLAG) {
+        header_size += sizeof(expiry_time);
+        if(file_entry_data.size() < header_size) {
+            throw std::runtime_error(ENTRY_DATA_TOO_SHORT_ERR_MSG);
+        }
+
+        memcpy(&expiry_time, data_ptr, sizeof(expiry_time));
+        data_ptr += sizeof(expiry_time);
+    }
+
     // read the size of the data
     value_len_type value_len = 0;
     memcpy(&value_len, data_ptr, sizeof(value_len));
     data_ptr += sizeof(value_len);
 
-    if(file_entry_data.size() < sizeof(tombstone_flag) + sizeof(value_len_type) + value_len) {
+    if(file_entry_data.size() < header_size + value_len) {
         throw std::runtime_error(ENTRY_DATA_TOO_SHORT_ERR_MSG);
     }
 
@@ -260,7 +400,7 @@ Entry::Entry(std::string& file_entry_key, std::string& file_entry_data) : key(EN
     memcpy(&value_str[0], data_ptr, value_len);
     data_ptr += value_len;
 
-    if(file_entry_data.size() < sizeof(tombstone_flag) + sizeof(value_len_type) + value_len + sizeof(checksum)) {
+    if(file_entry_data.size() < header_size + value_len + sizeof(checksum)) {
         throw std::runtime_error(ENTRY_DATA_TOO_SHORT_ERR_MSG);
     }
 
@@ -273,11 +413,7 @@ Entry::Entry(std::string& file_entry_key, std::string& file_entry_data) : key(EN
 
 
 bool Entry::check_checksum() {
-    std::string string_to_hash = this -> key.get_string();
-    string_to_hash += this -> value.get_string();
-    uint32_t new_checksum = crc32(string_to_hash);
-
-    return this -> checksum == new_checksum;
+    return this -> checksum == this -> compute_checksum();
 };
 
 key_len_type Entry::get_key_length() const {
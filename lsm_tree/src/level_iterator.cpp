@@ -0,0 +1,82 @@
+#include "../include/level_iterator.h"
+#include <algorithm>
+
+Level_Iterator::Level_Iterator(const std::vector<const SS_Table*>& _ss_tables, sequence_number_type _snapshot) : ss_tables(_ss_tables), snapshot(_snapshot), direction(ITERATOR_FORWARD), table_position(0) {
+
+}
+
+void Level_Iterator::open_table(size_t position, const Bits& target) {
+    this -> table_position = position;
+    this -> table_iterator = std::make_unique<SS_Table::Iterator>(this -> ss_tables.at(position) -> get_iterator(this -> snapshot));
+    this -> table_iterator -> seek(target, this -> direction);
+}
+
+void Level_Iterator::skip_exhausted_tables() {
+    while(this -> table_iterator && !this -> table_iterator -> valid()) {
+        if(this -> direction == ITERATOR_FORWARD) {
+            if(this -> table_position + 1 >= this -> ss_tables.size()) {
+                this -> table_iterator.reset();
+                return;
+            }
+
+            this -> open_table(this -> table_position + 1, this -> ss_tables.at(this -> table_position + 1) -> get_first_index());
+        }
+        else {
+            if(this -> table_position == 0) {
+                this -> table_iterator.reset();
+                return;
+            }
+
+            this -> open_table(this -> table_position - 1, this -> ss_tables.at(this -> table_position - 1) -> get_last_index());
+        }
+    }
+}
+
+void Level_Iterator::seek(const Bits& target, Iterator_Direction _direction) {
+    this -> direction = _direction;
+    this -> table_iterator.reset();
+
+    if(this -> direction == ITERATOR_FORWARD) {
+        // the first table that still has keys >= target
+        std::vector<const SS_Table*>::const_iterator it = std::partition_point(this -> ss_tables.begin(), this -> ss_tables.end(), [&](const SS_Table* ss_table) {
+            return ss_table -> get_last_index() < target;
+        });
+
+        if(it == this -> ss_tables.end()) {
+            return;
+        }
+
+        this -> open_table(it - this -> ss_tables.begin(), target);
+    }
+    else {
+        // the last table that has keys <= target
+        std::vector<const SS_Table*>::const_iterator it = std::partition_point(this -> ss_tables.begin(), this -> ss_tables.end(), [&](const SS_Table* ss_table) {
+            return ss_table -> get_first_index() <= target;
+        });
+
+        if(it == this -> ss_tables.begin()) {
+            return;
+        }
+
+        this -> open_table(it - this -> ss_tables.begin() - 1, target);
+    }
+
+    this -> skip_exhausted_tables();
+}
+
+bool Level_Iterator::valid() const {
+    return this -> table_iterator && this -> table_iterator -> valid();
+}
+
+void Level_Iterator::next() {
+    if(!this -> valid()) {
+        return;
+    }
+
+    this -> table_iterator -> next();
+    this -> skip_exhausted_tables();
+}
+
+const Entry& Level_Iterator::entry() const {
+    return this -> table_iterator -> entry();
+}
@@ -0,0 +1,96 @@
+#include "../include/lsm_options.h"
+#include <cstdlib>
+#include <string>
+
+// @returns true and sets value if the variable is set to a number
+static bool get_env_number(const char* name, uint64_t& value) {
+    const char* value_str = std::getenv(name);
+    if(!value_str) {
+        return false;
+    }
+
+    try {
+        value = std::stoull(value_str);
+        return true;
+    }
+    catch(const std::exception&) {
+        return false;
+    }
+}
+
+LSM_Options::LSM_Options() :
+    data_dir(LSM_OPTIONS_DEFAULT_DATA_DIR),
+    wal_dir(LSM_OPTIONS_DEFAULT_WAL_DIR),
+    mem_table_max_size(MEM_TABLE_BYTES_MAX_SIZE),
+    level_size_ratio(SS_TABLE_CONTROLLER_RATIO),
+    level_size_base(SS_TABLE_CONTROLLER_LEVEL_SIZE_BASE),
+    prefix_extractor(),
+    prefix_filter_bits_per_key(BLOOM_FILTER_DEFAULT_BITS_PER_KEY),
+    value_log_threshold(LSM_TREE_DEFAULT_VALUE_LOG_THRESHOLD),
+    compaction_io_mode(LSM_TREE_DEFAULT_COMPACTION_IO_MODE),
+    table_open_threads(LSM_TREE_DEFAULT_TABLE_OPEN_THREADS),
+    lazy_table_open(false)
+{
+
+}
+
+LSM_Options LSM_Options::from_environment() {
+    LSM_Options options;
+    uint64_t number = 0;
+
+    if(const char* data_dir_str = std::getenv(LSM_TREE_DATA_DIR_ENV_VAR)) {
+        options.data_dir = data_dir_str;
+    }
+
+    if(const char* wal_dir_str = std::getenv(LSM_TREE_WAL_DIR_ENV_VAR)) {
+        options.wal_dir = wal_dir_str;
+    }
+
+    if(get_env_number(LSM_TREE_MEM_TABLE_SIZE_ENV_VAR, number) && number > 0) {
+        options.mem_table_max_size = number;
+    }
+
+    // a ratio below 2 would never let a level outgrow the one above it
+    if(get_env_number(LSM_TREE_LEVEL_SIZE_RATIO_ENV_VAR, number) && number >= 2 && number <= UINT16_MAX) {
+        options.level_size_ratio = number;
+    }
+
+    if(get_env_number(LSM_TREE_LEVEL_SIZE_BASE_ENV_VAR, number) && number > 0) {
+        options.level_size_base = number;
+    }
+
+    if(const char* extractor_str = std::getenv(LSM_TREE_PREFIX_EXTRACTOR_ENV_VAR)) {
+        options.prefix_extractor = Prefix_Extractor::from_name(extractor_str);
+    }
+
+    if(get_env_number(LSM_TREE_PREFIX_FILTER_BITS_PER_KEY_ENV_VAR, number) && number > 0 && number <= UINT32_MAX) {
+        options.prefix_filter_bits_per_key = number;
+    }
+
+    if(get_env_number(LSM_TREE_VALUE_LOG_THRESHOLD_ENV_VAR, number)) {
+        options.value_log_threshold = number;
+    }
+
+    if(const char* mode_str = std::getenv(LSM_TREE_COMPACTION_IO_ENV_VAR)) {
+        std::string mode(mode_str);
+        if(mode == "buffered") {
+            options.compaction_io_mode = FILE_IO_BUFFERED;
+        }
+        else if(mode == "direct") {
+            options.compaction_io_mode = FILE_IO_DIRECT;
+        }
+        else if(mode == "drop_cache") {
+            options.compaction_io_mode = FILE_IO_DROP_CACHE;
+        }
+    }
+
+    if(get_env_number(LSM_TREE_TABLE_OPEN_THREADS_ENV_VAR, number) && number > 0 && number <= UINT16_MAX) {
+        options.table_open_threads = number;
+    }
+
+    if(get_env_number(LSM_TREE_LAZY_TABLE_OPEN_ENV_VAR, number)) {
+        options.lazy_table_open = number != 0;
+    }
+
+    return options;
+}
@@ -1,59 +1,405 @@
 #include "../include/lsm_tree.h"
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    // THROWS
+    // @brief hard links source to target, copies it where the filesystem can not link, e.g. across devices
+    void link_or_copy_file(const std::filesystem::path& source, const std::filesystem::path& target) {
+        std::error_code error;
+        std::filesystem::create_hard_link(source, target, error);
+        if(error) {
+            std::filesystem::copy_file(source, target);
+        }
+    }
+
+    // THROWS
+    // @brief makes a file or directory durable, a created or linked file only survives a crash once its directory is synced too
+    void sync_path(const std::filesystem::path& path, bool is_directory) {
+        int fd = ::open(path.c_str(), is_directory ? (O_RDONLY | O_DIRECTORY) : O_RDONLY);
+        if(fd < 0) {
+            throw File_Exception(LSM_TREE_CHECKPOINT_FAILED_SYNC_ERR_MSG, path.generic_string().c_str());
+        }
+
+        int result = ::fsync(fd);
+        ::close(fd);
+        if(result != 0) {
+            throw File_Exception(LSM_TREE_CHECKPOINT_FAILED_SYNC_ERR_MSG, path.generic_string().c_str());
+        }
+    }
+
+    uint64_t micros_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // THROWS
+    // @brief calls job(i) for every i < count on up to thread_count threads, the calling one included
+    // rethrows the first exception a job threw once every thread is done
+    void run_in_parallel(size_t count, uint32_t thread_count, const std::function<void(size_t)>& job) {
+        std::atomic<size_t> next_job(0);
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        auto worker = [&]() {
+            for(size_t i = next_job++; i < count; i = next_job++) {
+                try {
+                    job(i);
+                }
+                catch(...) {
+                    std::lock_guard<std::mutex> error_lock(error_mutex);
+                    if(!error) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(size_t i = 1; i < std::min<size_t>(thread_count, count); ++i) {
+            threads.emplace_back(worker);
+        }
 
-LSM_Tree::LSM_Tree():
-    write_ahead_log(),
-    mem_table(write_ahead_log),
-    max_files_count(get_max_file_limit())
+        worker();
+        for(std::thread& thread : threads) {
+            thread.join();
+        }
+
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+LSM_Tree::LSM_Tree() : LSM_Tree(LSM_Options::from_environment()){
+
+}
+
+LSM_Tree::LSM_Tree(const LSM_Options& _options):
+    options(_options),
+    startup_stats(),
+    write_ahead_log(options.wal_dir),
+    mem_table(replay_wal()),
+    manifest(options.data_dir / MANIFEST_FILE_NAME, options.data_dir / MANIFEST_TMP_FILE_NAME),
+    value_log(options.data_dir / VALUE_LOG_DIR_NAME),
+    max_files_count(get_max_file_limit()),
+    last_sequence_number(ENTRY_NO_SEQUENCE_NUMBER),
+    prefix_scan_count(0),
+    prefix_scan_tables_skipped(0),
+    compaction_filter_records(0),
+    compaction_filter_dropped(0),
+    compaction_filter_changed(0),
+    scrub_tables(0),
+    scrub_bytes(0),
+    scrub_quarantined(0)
 {
-    reconstruct_tree();
+    this -> register_merge_operator(MERGE_OPERATOR_INT64_ADD, std::make_shared<Int64_Add_Merge_Operator>());
+    this -> register_merge_operator(MERGE_OPERATOR_APPEND, std::make_shared<Append_Merge_Operator>());
+
+    std::filesystem::create_directories(this -> options.data_dir);
+
+    // starting without the tables on disk would hide their records and let new flushes overwrite their names
+    if(!reconstruct_tree()){
+        throw std::runtime_error(LSM_TREE_RECONSTRUCT_FAILED_ERR_MSG);
+    }
+    this -> install_version();
 };
 
 LSM_Tree::~LSM_Tree(){
 };
 
-Entry LSM_Tree::get(std::string key){
+std::shared_ptr<Mem_Table> LSM_Tree::replay_wal(){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::shared_ptr<Mem_Table> replayed_mem_table = std::make_shared<Mem_Table>(this -> write_ahead_log, this -> options.mem_table_max_size);
+    this -> startup_stats.wal_replay_micros = micros_since(start);
+    return replayed_mem_table;
+}
+
+Entry LSM_Tree::get(std::string key, sequence_number_type snapshot){
+    Statistics_Timer get_timer(this -> statistics, STATISTICS_GET_MICROS);
     Bits key_bits(key);
 
+    this -> statistics.record(STATISTICS_GETS);
+
+    std::shared_ptr<const Tree_Version> version = this -> get_version();
+
+    uint64_t tables_probed = 0;
+    Entry entry = this -> find_entry(*version, key_bits, snapshot, &tables_probed);
+    this -> fold_merge_operands(*version, entry, &tables_probed);
+
+    this -> statistics.record(STATISTICS_GET_TABLES_PROBED, tables_probed);
+
+    this -> resolve_value(entry);
+    return entry;
+};
+
+void LSM_Tree::append_to_wal(std::ostringstream& bytes){
+    {
+        Statistics_Timer wal_timer(this -> statistics, STATISTICS_WAL_SYNC_MICROS);
+        write_ahead_log.append_entry(bytes);
+    }
+
+    this -> statistics.record(STATISTICS_WAL_BYTES, bytes.tellp());
+};
+
+Entry LSM_Tree::find_entry(const Tree_Version& version, const Bits& key_bits, sequence_number_type snapshot, uint64_t* tables_probed){
     bool is_found = false;
 
-    Entry entry = mem_table.find(key_bits, is_found);
+    Entry entry = version.mem_table -> find(key_bits, is_found, snapshot);
 
     if(is_found){
         return entry;
     }
 
-    if(ss_table_controllers.size() > 0){
-        for(const SS_Table_Controller& ss_table_controller_level : ss_table_controllers){
-            entry = ss_table_controller_level.get(key_bits, is_found);
+    if(version.ss_table_controllers.size() > 0){
+        for(const SS_Table_Controller& ss_table_controller_level : version.ss_table_controllers){
+            entry = ss_table_controller_level.get(key_bits, is_found, snapshot, tables_probed);
             
             if(is_found){
-                return entry;
+                break;
             }
         }
     }
+
     return entry;
 };
 
-bool LSM_Tree::set(std::string key, std::string value){
+void LSM_Tree::resolve_value(Entry& entry) const{
+    if(!entry.is_value_pointer() || entry.is_deleted()){
+        return;
+    }
+
+    Value_Pointer pointer;
+    if(!Value_Pointer::decode(entry.get_value_string(), pointer)){
+        throw std::runtime_error(VALUE_LOG_BAD_POINTER_ERR_MSG);
+    }
+
+    entry.update_value(Bits(this -> value_log.read(pointer)));
+    entry.set_value_pointer(false);
+};
+
+const Merge_Operator* LSM_Tree::get_merge_operator(merge_operator_id_type id) const{
+    std::map<merge_operator_id_type, std::shared_ptr<const Merge_Operator>>::const_iterator it = this -> merge_operators.find(id);
+    if(it == this -> merge_operators.end()){
+        throw std::runtime_error(LSM_TREE_UNKNOWN_MERGE_OPERATOR_ERR_MSG);
+    }
+
+    return it -> second.get();
+};
+
+bool LSM_Tree::apply_merge_operands(const std::string& key, const std::string* existing_value, const std::vector<std::string>& operands, std::string& value) const{
+    bool has_value = existing_value != nullptr;
+    if(has_value){
+        value = *existing_value;
+    }
+
+    // the oldest operand goes first
+    for(std::vector<std::string>::const_reverse_iterator it = operands.rbegin(); it != operands.rend(); ++it){
+        if(it -> empty()){
+            continue;
+        }
+
+        const Merge_Operator* merge_operator = this -> get_merge_operator(static_cast<merge_operator_id_type>((*it)[0]));
+
+        std::string merged_value;
+        if(merge_operator -> full_merge(key, has_value? &value : nullptr, it -> substr(sizeof(merge_operator_id_type)), merged_value)){
+            value = std::move(merged_value);
+            has_value = true;
+        }
+    }
+
+    return has_value;
+};
+
+bool LSM_Tree::combine_merge_operands(const std::string& key, const std::string& older_operand, const std::string& newer_operand, std::string& combined_operand) const{
+    if(older_operand.empty() || newer_operand.empty() || older_operand[0] != newer_operand[0]){
+        return false;
+    }
+
+    const Merge_Operator* merge_operator = this -> get_merge_operator(static_cast<merge_operator_id_type>(newer_operand[0]));
+
+    std::string combined;
+    if(!merge_operator -> partial_merge(key, older_operand.substr(sizeof(merge_operator_id_type)), newer_operand.substr(sizeof(merge_operator_id_type)), combined)){
+        return false;
+    }
+
+    combined_operand = newer_operand.substr(0, sizeof(merge_operator_id_type)) + combined;
+    return true;
+};
+
+Entry LSM_Tree::find_merge_base(const Tree_Version& version, const Bits& key_bits, const Entry& operand, std::vector<std::string>& operands, uint64_t* tables_probed){
+    Entry older_version = operand;
+
+    // sequence numbers are unique, so the next older version is the newest one visible just below the operand
+    while(older_version.is_merge_operand()){
+        operands.push_back(older_version.get_value_string());
+
+        if(older_version.get_sequence_number() == ENTRY_NO_SEQUENCE_NUMBER){
+            return Entry(Bits(ENTRY_PLACEHOLDER_KEY), Bits(ENTRY_PLACEHOLDER_VALUE));
+        }
+
+        older_version = this -> find_entry(version, key_bits, older_version.get_sequence_number() - 1, tables_probed);
+    }
+
+    return older_version;
+};
+
+void LSM_Tree::fold_merge_operands(const Tree_Version& version, Entry& entry, uint64_t* tables_probed){
+    if(!entry.is_merge_operand()){
+        return;
+    }
+
+    std::string key = entry.get_key_string();
+    std::vector<std::string> operands;
+    Entry base = this -> find_merge_base(version, entry.get_key(), entry, operands, tables_probed);
+
+    std::string base_value;
+    const std::string* existing_value = nullptr;
+    if(base.get_key() == entry.get_key() && !base.is_deleted()){
+        this -> resolve_value(base);
+        base_value = base.get_value_string();
+        existing_value = &base_value;
+    }
+
+    std::string value;
+    bool has_value = this -> apply_merge_operands(key, existing_value, operands, value);
+
+    entry.set_merge_operand(false);
+    entry.update_value(has_value? Bits(value) : Bits(ENTRY_PLACEHOLDER_VALUE));
+    entry.set_tombstone(!has_value);
+};
+
+std::vector<Entry> LSM_Tree::multi_get(const std::vector<std::string>& keys, sequence_number_type snapshot){
+    std::vector<Bits> sorted_keys;
+    sorted_keys.reserve(keys.size());
+    for(const std::string& key : keys){
+        sorted_keys.emplace_back(key);
+    }
+
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    sorted_keys.erase(std::unique(sorted_keys.begin(), sorted_keys.end()), sorted_keys.end());
+
+    this -> statistics.record(STATISTICS_GETS, keys.size());
+    this -> statistics.record(STATISTICS_MULTI_GET_KEYS, keys.size());
+
+    Entry placeholder(Bits(ENTRY_PLACEHOLDER_KEY), Bits(ENTRY_PLACEHOLDER_VALUE));
+    std::vector<Entry> sorted_entries(sorted_keys.size(), placeholder);
+    std::vector<bool> found(sorted_keys.size(), false);
+    size_t missing = sorted_keys.size();
+
+    std::shared_ptr<const Tree_Version> version = this -> get_version();
+
+    for(size_t i = 0; i < sorted_keys.size(); ++i){
+        bool is_found = false;
+        Entry entry = version -> mem_table -> find(sorted_keys[i], is_found, snapshot);
+        if(is_found){
+            sorted_entries[i] = std::move(entry);
+            found[i] = true;
+            --missing;
+        }
+    }
+
+    uint64_t tables_probed = 0;
+    for(const SS_Table_Controller& ss_table_controller_level : version -> ss_table_controllers){
+        if(missing == 0){
+            break;
+        }
+
+        ss_table_controller_level.multi_get(sorted_keys, sorted_entries, found, snapshot, &tables_probed);
+        missing = std::count(found.begin(), found.end(), false);
+    }
+
+    this -> statistics.record(STATISTICS_GET_TABLES_PROBED, tables_probed);
+
+    std::vector<Entry> entries;
+    entries.reserve(keys.size());
+    for(const std::string& key : keys){
+        std::vector<Bits>::const_iterator it = std::lower_bound(sorted_keys.begin(), sorted_keys.end(), Bits(key));
+        entries.push_back(sorted_entries[it - sorted_keys.begin()]);
+        this -> fold_merge_operands(*version, entries.back());
+        this -> resolve_value(entries.back());
+    }
+
+    return entries;
+};
+
+LSM_Tree_Read_Amplification LSM_Tree::get_read_amplification() const{
+    LSM_Tree_Read_Amplification read_amplification;
+    read_amplification.gets = this -> statistics.get_ticker(STATISTICS_GETS);
+    read_amplification.tables_probed = this -> statistics.get_ticker(STATISTICS_GET_TABLES_PROBED);
+    return read_amplification;
+};
+
+std::map<std::string, uint64_t> LSM_Tree::get_statistics(){
+    std::map<std::string, uint64_t> counters;
+    this -> statistics.add_counters(counters);
+
+    counters["mem_table.bytes"] = this -> get_version() -> mem_table -> get_total_mem_table_size();
+
+    for(const SS_Table_Controller_Stats& level_stats : this -> get_level_stats()){
+        std::string level_name = "level." + std::to_string(level_stats.level);
+        counters[level_name + ".bytes"] = level_stats.size_bytes;
+        counters[level_name + ".tables"] = level_stats.table_count;
+    }
+
+    LSM_Tree_Prefix_Scan_Stats prefix_scan_stats = this -> get_prefix_scan_stats();
+    counters["prefix_scans"] = prefix_scan_stats.prefix_scans;
+    counters["prefix_scan_tables_skipped"] = prefix_scan_stats.tables_skipped;
+
+    LSM_Tree_Compaction_Filter_Stats compaction_filter_stats = this -> get_compaction_filter_stats();
+    counters["compaction_filter.records_filtered"] = compaction_filter_stats.records_filtered;
+    counters["compaction_filter.records_dropped"] = compaction_filter_stats.records_dropped;
+    counters["compaction_filter.values_changed"] = compaction_filter_stats.values_changed;
+
+    LSM_Tree_Scrub_Stats scrub_stats = this -> get_scrub_stats();
+    counters["scrub.tables_scrubbed"] = scrub_stats.tables_scrubbed;
+    counters["scrub.bytes_scrubbed"] = scrub_stats.bytes_scrubbed;
+    counters["scrub.tables_quarantined"] = scrub_stats.tables_quarantined;
+
+    counters["startup.wal_replay_micros"] = this -> startup_stats.wal_replay_micros;
+    counters["startup.level_recovery_micros"] = this -> startup_stats.level_recovery_micros;
+    counters["startup.table_open_micros"] = this -> startup_stats.table_open_micros;
+    counters["startup.tables"] = this -> startup_stats.tables;
+    counters["startup.deferred_filters"] = this -> startup_stats.deferred_filters;
+
+    return counters;
+};
+
+LSM_Tree_Prefix_Scan_Stats LSM_Tree::get_prefix_scan_stats() const{
+    LSM_Tree_Prefix_Scan_Stats prefix_scan_stats;
+    prefix_scan_stats.prefix_scans = this -> prefix_scan_count.load(std::memory_order_relaxed);
+    prefix_scan_stats.tables_skipped = this -> prefix_scan_tables_skipped.load(std::memory_order_relaxed);
+    return prefix_scan_stats;
+};
+
+bool LSM_Tree::set(std::string key, std::string value, uint64_t ttl){
+    Statistics_Timer write_timer(this -> statistics, STATISTICS_WRITE_MICROS);
+    this -> statistics.record(STATISTICS_WRITES);
+
     Bits key_bits(key);
     Bits value_bits(value);
 
     Entry entry(key_bits, value_bits);
+    entry.set_sequence_number(++this -> last_sequence_number);
+    if(ttl != LSM_TREE_NO_TTL){
+        entry.set_expiry_time(Entry::current_time() + ttl);
+    }
     std::ostringstream bytes = entry.get_ostream_bytes();
 
     try{
-        write_ahead_log.append_entry(bytes);
-        mem_table.insert_entry(entry);
+        this -> append_to_wal(bytes);
+        this -> mem_table -> insert_entry(entry, this -> get_live_snapshots());
     }
     catch(const std::exception& e){
         std::cerr<< e.what() <<std::endl;
         return false;
     }
 
-    if(mem_table.is_full()){
+    if(this -> mem_table -> is_full()){
         try{
             flush_mem_table();
-            this -> mem_table.make_empty();
             write_ahead_log.clear_entries();
         }
         catch(const std::exception& e){
@@ -145,223 +491,162 @@ std::pair<std::set<Bits>, uint16_t> LSM_Tree::get_keys(std::string prefix, uint1
     return std::make_pair(std::set<Bits>{}, 0);
 };
 
-std::pair<std::set<Bits>, std::string> LSM_Tree::get_keys_cursor(std::string cursor, uint16_t n){
-    Bits key_bits(cursor);
-    std::set<Bits> keys;
-    std::set<Bits> dead_keys;
-    Bits next_key(ENTRY_PLACEHOLDER_KEY);
+std::unique_ptr<Entry_Iterator> LSM_Tree::get_iterator(sequence_number_type snapshot, const std::string& prefix, uint64_t* tables_skipped){
+    std::shared_ptr<const Tree_Version> version = this -> get_version();
+    std::unique_ptr<Entry_Iterator> iterator = this -> get_iterator(*version, snapshot, prefix, tables_skipped);
+
+    return std::make_unique<Version_Iterator>(std::move(version), std::move(iterator));
+};
 
-    std::vector<Bits> mem_table_keys = mem_table.get_keys_larger_than_alive(key_bits, n+1, dead_keys);
+std::unique_ptr<Entry_Iterator> LSM_Tree::get_iterator(const Tree_Version& version, sequence_number_type snapshot, const std::string& prefix, uint64_t* tables_skipped){
+    std::vector<std::unique_ptr<Entry_Iterator>> iterators;
 
-    if(!mem_table_keys.empty()){
-        keys.insert(mem_table_keys.begin(), mem_table_keys.end());
-        next_key = clean_forward_set_keys(keys, n);
+    // newest data first, the merging iterator lets the first source holding a key win
+    iterators.push_back(version.mem_table -> get_iterator(snapshot));
+
+    for(const SS_Table_Controller& ss_table_controller : version.ss_table_controllers){
+        ss_table_controller.add_iterators(iterators, snapshot, prefix, tables_skipped);
     }
-    
-    for(SS_Table_Controller& ss_table_controller : ss_table_controllers) {
-        uint16_t sstable_count = ss_table_controller.get_ss_tables_count();
 
-        for(uint16_t i = sstable_count-1; i != UINT16_MAX; --i){
-            const SS_Table* ss_table = ss_table_controller.at(i);
+    return std::make_unique<Merging_Iterator>(std::move(iterators));
+};
 
-            std::vector<Bits> ss_table_keys = ss_table -> get_n_next_keys_alive(key_bits, n + 1, dead_keys);
+std::pair<std::set<Bits>, std::string> LSM_Tree::get_keys_cursor(std::string cursor, uint16_t n, sequence_number_type snapshot){
+    std::set<Bits> keys;
+    Bits next_key(ENTRY_PLACEHOLDER_KEY);
 
-            keys.insert(ss_table_keys.begin(), ss_table_keys.end());
-            
-            Bits temp_next_key = clean_forward_set_keys(keys, n);
-            if(temp_next_key.get_string() != ENTRY_PLACEHOLDER_KEY){
-                if(next_key.get_string() == ENTRY_PLACEHOLDER_KEY || next_key > temp_next_key){
-                    next_key = temp_next_key;
-                }
-            }
+    std::unique_ptr<Entry_Iterator> iterator = this -> get_iterator(snapshot);
+
+    for(iterator -> seek(Bits(cursor), ITERATOR_FORWARD); iterator -> valid(); iterator -> next()){
+        const Entry& entry = iterator -> entry();
+        if(entry.is_deleted()){
+            continue;
+        }
+
+        // the first key that did not fit is where the next page starts
+        if(keys.size() >= n){
+            next_key = entry.get_key();
+            break;
         }
+
+        keys.emplace(entry.get_key());
     }
+
     return std::make_pair(keys, next_key.get_string());
 };
 
-std::pair<std::set<Bits>, std::string> LSM_Tree::get_keys_cursor_prefix(std::string prefix,std::string cursor, uint16_t n){
+std::pair<std::set<Bits>, std::string> LSM_Tree::get_keys_cursor_prefix(std::string prefix,std::string cursor, uint16_t n, sequence_number_type snapshot, uint64_t* tables_skipped){
 
     if(cursor < prefix && cursor != ENTRY_PLACEHOLDER_KEY){
         cursor = prefix;
     }
 
-    Bits key_bits(cursor);
-    std::set<Bits> dead_keys;
     std::set<Bits> keys;
     Bits next_key(ENTRY_PLACEHOLDER_KEY);
 
-    std::vector<Bits> mem_table_keys = mem_table.get_keys_larger_than_alive(key_bits, n+1, dead_keys);
+    uint64_t skipped = 0;
+    std::unique_ptr<Entry_Iterator> iterator = this -> get_iterator(snapshot, prefix, &skipped);
 
-    if(!mem_table_keys.empty()){
-        keys.insert(mem_table_keys.begin(), mem_table_keys.end());
-        next_key = clean_forward_set_keys(keys, n);
+    ++this -> prefix_scan_count;
+    this -> prefix_scan_tables_skipped += skipped;
+    if(tables_skipped){
+        *tables_skipped = skipped;
     }
-    
-    for(SS_Table_Controller& ss_table_controller : ss_table_controllers) {
-        uint16_t sstable_count = ss_table_controller.get_ss_tables_count();
-
-        for(uint16_t i = sstable_count-1; i != UINT16_MAX; --i){
-            const SS_Table* ss_table = ss_table_controller.at(i);
 
-            std::vector<Bits> ss_table_keys = ss_table -> get_n_next_keys_alive(key_bits, n + 1, dead_keys);
+    for(iterator -> seek(Bits(cursor), ITERATOR_FORWARD); iterator -> valid(); iterator -> next()){
+        const Entry& entry = iterator -> entry();
+        std::string key = entry.get_key_string();
 
-            keys.insert(ss_table_keys.begin(), ss_table_keys.end());
-            
-            Bits temp_next_key = clean_forward_set_keys(keys, n);
-            if(temp_next_key.get_string() != ENTRY_PLACEHOLDER_KEY){
-                if(next_key.get_string() == ENTRY_PLACEHOLDER_KEY || next_key > temp_next_key){
-                    next_key = temp_next_key;
-                }
+        // keys with the prefix are next to each other, stop at the first one past them
+        if(key.compare(0, prefix.size(), prefix) != 0){
+            if(key < prefix){
+                continue;
             }
+            break;
         }
-    }
 
-    keys = clear_larger_prefix(keys, prefix);
+        if(entry.is_deleted()){
+            continue;
+        }
+
+        if(keys.size() >= n){
+            next_key = entry.get_key();
+            break;
+        }
 
-    if(next_key.get_string() != ENTRY_PLACEHOLDER_KEY && 
-        next_key.get_string() >= next_prefix(prefix)){
-        next_key = Bits(ENTRY_PLACEHOLDER_KEY);
+        keys.emplace(entry.get_key());
     }
+
     return std::make_pair(keys, next_key.get_string());
 };
 
 
-std::pair<std::set<Entry>, std::string> LSM_Tree::get_ff(std::string _key, uint16_t n){
+std::pair<std::set<Entry>, std::string> LSM_Tree::get_ff(std::string _key, uint16_t n, sequence_number_type snapshot){
     std::set<Entry> ff_entries;
-    Bits key_bits(_key);
-    std::set<Bits> dead_keys;
     Bits next_key(ENTRY_PLACEHOLDER_KEY);
 
-    std::vector<Entry> mem_table_entries = mem_table.get_entries_larger_than_alive(key_bits, n+1, dead_keys);
+    std::shared_ptr<const Tree_Version> version = this -> get_version();
+    std::unique_ptr<Entry_Iterator> iterator = this -> get_iterator(*version, snapshot);
 
-    if(!mem_table_entries.empty()){
-        ff_entries.insert(mem_table_entries.begin(), mem_table_entries.end());
-        next_key = clean_forward_set(ff_entries, true ,n);
-    }
-    
-    for(SS_Table_Controller& ss_table_controller : ss_table_controllers) {
-        uint16_t sstable_count = ss_table_controller.get_ss_tables_count();
+    for(iterator -> seek(Bits(_key), ITERATOR_FORWARD); iterator -> valid(); iterator -> next()){
+        const Entry& entry = iterator -> entry();
+        if(entry.is_deleted()){
+            continue;
+        }
 
-        for(uint16_t i = sstable_count-1; i != UINT16_MAX; --i){
-            const SS_Table* ss_table = ss_table_controller.at(i);
-            std::vector<Entry> ss_table_entries = ss_table -> get_entries_key_larger_or_equal_alive(key_bits, n + 1, dead_keys);
+        if(ff_entries.size() >= n){
+            next_key = entry.get_key();
+            break;
+        }
 
-            ff_entries.insert(ss_table_entries.begin(), ss_table_entries.end());
-            
-            Bits temp_next_key = clean_forward_set(ff_entries, true, n);
-            if(temp_next_key.get_string() != ENTRY_PLACEHOLDER_KEY){
-                if(next_key.get_string() == ENTRY_PLACEHOLDER_KEY || next_key > temp_next_key){
-                    next_key = temp_next_key;
-                }
-            }
+        Entry resolved_entry(entry);
+        this -> fold_merge_operands(*version, resolved_entry);
+        if(resolved_entry.is_deleted()){
+            continue;
         }
+
+        this -> resolve_value(resolved_entry);
+        ff_entries.emplace(std::move(resolved_entry));
     }
     
     return std::make_pair(ff_entries, next_key.get_string());
 };
 
-std::pair<std::set<Entry>, std::string> LSM_Tree::get_fb(std::string _key, uint16_t n){
+std::pair<std::set<Entry>, std::string> LSM_Tree::get_fb(std::string _key, uint16_t n, sequence_number_type snapshot){
     std::set<Entry> fb_entries;
-    Bits key_bits = Bits(_key);
-    std::set<Bits> dead_keys;
     Bits next_key(ENTRY_PLACEHOLDER_KEY);
 
-    std::vector<Entry> mem_table_entries = mem_table.get_entries_smaller_than_alive(key_bits, n+1, dead_keys);
-
-    if(!mem_table_entries.empty()){
-        fb_entries.insert(mem_table_entries.begin(), mem_table_entries.end());
-        next_key = clean_forward_set(fb_entries, false ,n);
-    }
-    
-    for(SS_Table_Controller& ss_table_controller : ss_table_controllers) {
-        uint16_t sstable_count = ss_table_controller.get_ss_tables_count();
-
-        for(uint16_t i = sstable_count-1; i != UINT16_MAX; --i){
-            const SS_Table* ss_table = ss_table_controller.at(i);
-
-            std::vector<Entry> ss_table_entries = ss_table -> get_entries_key_smaller_or_equal_alive(key_bits, n + 1, dead_keys);
-
-            fb_entries.insert(ss_table_entries.begin(), ss_table_entries.end());
-
-            Bits temp_next_key = clean_forward_set(fb_entries, false, n);
-            if(temp_next_key.get_string() != ENTRY_PLACEHOLDER_KEY){
-                if(next_key.get_string() == ENTRY_PLACEHOLDER_KEY || next_key < temp_next_key){
-                    next_key = temp_next_key;
-                }
-            }
-        }
-    }
-
-    return std::make_pair(fb_entries, next_key.get_string());
-};
+    std::shared_ptr<const Tree_Version> version = this -> get_version();
+    std::unique_ptr<Entry_Iterator> iterator = this -> get_iterator(*version, snapshot);
 
-void LSM_Tree::forward_validate(std::set<Entry>& entries,const Entry& entry_to_append,const bool is_greater_operation,const Bits key_value){
-    if(is_greater_operation){
-        if(entry_to_append.get_key() >= key_value){
-            entries.emplace(entry_to_append);
+    for(iterator -> seek(Bits(_key), ITERATOR_BACKWARD); iterator -> valid(); iterator -> next()){
+        const Entry& entry = iterator -> entry();
+        if(entry.is_deleted()){
+            continue;
         }
-    }else{
-        if(entry_to_append.get_key() <= key_value){
-            entries.emplace(entry_to_append);
-        }
-    }
-};
 
-Bits LSM_Tree::clean_forward_set(std::set<Entry>& set_to_clean,const bool is_greater_operation, uint16_t n){
-    Bits last_key(ENTRY_PLACEHOLDER_KEY);
-    if(set_to_clean.size() <= n){
-        return last_key;
-    };
-    if(is_greater_operation){
-        std::set<Entry>::iterator it = set_to_clean.begin();
-        for(uint16_t i = 0; i < n; ++i){
-            ++it;
+        // going backward the first key that did not fit is the largest one left out
+        if(fb_entries.size() >= n){
+            next_key = entry.get_key();
+            break;
         }
-        // std::set<Entry>::iterator last_kept_it = it;
-        // --last_kept_it;
 
-        last_key = it -> get_key();
-        //last_key = it -> get_key();
-        set_to_clean.erase(it, set_to_clean.end());
-    }
-    else{
-        uint16_t elements_to_skip = set_to_clean.size() - n;
-
-        std::set<Entry>::iterator it = set_to_clean.begin();
-        //uint16_t elements_to_skip = set_to_clean.size() - n;
-        for(uint16_t i = 0; i < elements_to_skip; ++i){
-            ++it;
+        Entry resolved_entry(entry);
+        this -> fold_merge_operands(*version, resolved_entry);
+        if(resolved_entry.is_deleted()){
+            continue;
         }
-        std::set<Entry>::iterator prev_it = it;
-        --prev_it;
-        last_key = prev_it -> get_key();
 
-        // last_key = it->get_key();
-        
-        set_to_clean.erase(set_to_clean.begin(), it);
-    }
-    return last_key;
-};
-Bits LSM_Tree::clean_forward_set_keys(std::set<Bits>& set_to_clean, uint16_t n){
-    Bits last_key(ENTRY_PLACEHOLDER_KEY);
-    if(set_to_clean.size() <= n){
-        return last_key;
-    };
-    std::set<Bits>::iterator it = set_to_clean.begin();
-    for(uint16_t i = 0; i < n; ++i){
-        ++it;
+        this -> resolve_value(resolved_entry);
+        fb_entries.emplace(std::move(resolved_entry));
     }
-    // std::set<Bits>::iterator prev_it = it;
-    // --prev_it;
-    // last_key = *prev_it;
 
-    last_key = *it;
-    set_to_clean.erase(it, set_to_clean.end());
-    return last_key;
+    return std::make_pair(fb_entries, next_key.get_string());
 };
 
-
 bool LSM_Tree::remove(std::string key){
+    Statistics_Timer write_timer(this -> statistics, STATISTICS_WRITE_MICROS);
+    this -> statistics.record(STATISTICS_WRITES);
 
     try{
         //Entry entry = get(key);
@@ -369,23 +654,23 @@ bool LSM_Tree::remove(std::string key){
         Bits v_val(ENTRY_PLACEHOLDER_VALUE);
         Entry entry(b_key, v_val);
         entry.set_tombstone(ENTRY_TOMBSTONE_ON);
+        entry.set_sequence_number(++this -> last_sequence_number);
         std::ostringstream bytes = entry.get_ostream_bytes();
 
         /*if(!entry.is_deleted()){
             entry.set_tombstone(true);
         }*/
-        write_ahead_log.append_entry(bytes);
-        mem_table.insert_entry(entry);
+        this -> append_to_wal(bytes);
+        this -> mem_table -> insert_entry(entry, this -> get_live_snapshots());
     }
     catch(const std::exception& e){
         std::cerr<< e.what() <<std::endl;
         return false;
     }
 
-    if(mem_table.is_full()){
+    if(this -> mem_table -> is_full()){
         try{
             flush_mem_table();
-            mem_table.make_empty();
             write_ahead_log.clear_entries();
         }
         catch(const std::exception& e){
@@ -397,84 +682,322 @@ bool LSM_Tree::remove(std::string key){
     return true;
 };
 
+bool LSM_Tree::merge(std::string key, merge_operator_id_type merge_operator_id, std::string operand){
+    std::map<merge_operator_id_type, std::shared_ptr<const Merge_Operator>>::const_iterator it = this -> merge_operators.find(merge_operator_id);
+    if(it == this -> merge_operators.end() || !it -> second -> is_valid_operand(operand)){
+        return false;
+    }
 
-// LSM_Tree
-// To do:
-// SSTable rasymas is MemTable
-// SSTable skaitymas
-// GET <key>
-// SET <key> <value>
-// Multithread SET method to write into WAL and MemTable at the same time
-// GETKEYS - grąžina visus raktus
-// GETKEYS <prefix> - grąžina visus raktus su duota pradžia
-// GETFF <key> - gauti raktų reikšmių poras nuo key
-// GETFB <key> - gauti raktų reikšmių poras nuo key atvirkščia tvarka
-// GETFF ir GETFB turi leisti puslapiuoti, t.y. gauti po n porų ir fektyviai tęsti toliau
-// REMOVE <key>
+    Statistics_Timer write_timer(this -> statistics, STATISTICS_WRITE_MICROS);
+    this -> statistics.record(STATISTICS_WRITES);
 
-void LSM_Tree::flush_mem_table(){
+    try{
+        Bits key_bits(key);
+        std::string encoded_operand(1, static_cast<char>(merge_operator_id));
+        encoded_operand += operand;
 
-    // check for compaction
-    if(!ss_table_controllers.empty()){
-        // check if levels has not reached a limit of file count 
-        for(uint16_t i = 0; i < ss_table_controllers.size(); ++i){
-            if((ss_table_controllers.at(i).get_ss_tables_count() * 3) > (this -> max_files_count / 2)){
-                if(!this -> compact_level(i)){
-                    throw std::runtime_error(LSM_TREE_FAILED_COMPACTION_ERR_MSG);
-                }
+        Entry entry(key_bits, Bits(encoded_operand));
+        entry.set_merge_operand(true);
+
+        // the mem_table keeps only the newest version of a key, so whatever it holds is folded in now instead of being replaced
+        bool is_found = false;
+        Entry current = this -> mem_table -> find(key_bits, is_found, LSM_TREE_LATEST_SNAPSHOT);
+        std::string combined_operand;
+
+        if(is_found && current.is_merge_operand() && this -> combine_merge_operands(key, current.get_value_string(), encoded_operand, combined_operand)){
+            entry.update_value(Bits(combined_operand));
+        }
+        else if(is_found){
+            this -> fold_merge_operands(*this -> get_version(), current);
+
+            std::string base_value;
+            const std::string* existing_value = nullptr;
+            if(!current.is_deleted()){
+                this -> resolve_value(current);
+                base_value = current.get_value_string();
+                existing_value = &base_value;
+            }
+
+            std::string value;
+            if(!it -> second -> full_merge(key, existing_value, operand, value)){
+                return false;
             }
+
+            entry.update_value(Bits(value));
+            entry.set_merge_operand(false);
         }
-        
+
+        entry.set_sequence_number(++this -> last_sequence_number);
+        std::ostringstream bytes = entry.get_ostream_bytes();
+
+        this -> append_to_wal(bytes);
+        this -> mem_table -> insert_entry(entry, this -> get_live_snapshots());
+    }
+    catch(const std::exception& e){
+        std::cerr<< e.what() <<std::endl;
+        return false;
     }
 
-    // compact level that is the most filled
-    std::pair<uint16_t, double> max_pair = this -> get_max_fill_ratio();
-    if(max_pair.second >= 1.0){
-        if(!this -> compact_level(max_pair.first)){
-            throw std::runtime_error(LSM_TREE_FAILED_COMPACTION_ERR_MSG);
+    if(this -> mem_table -> is_full()){
+        try{
+            flush_mem_table();
+            write_ahead_log.clear_entries();
+        }
+        catch(const std::exception& e){
+            std::cerr<< e.what() <<std::endl;
+            return false;
         }
     }
 
-    std::vector<Entry> entries = mem_table.dump_entries();
+    return true;
+};
+
+void LSM_Tree::register_merge_operator(merge_operator_id_type id, std::shared_ptr<const Merge_Operator> merge_operator){
+    this -> merge_operators[id] = std::move(merge_operator);
+};
 
-    // move to define
-    std::filesystem::path level0_dir = LSM_TREE_LEVEL_0_PATH;
-    if (!std::filesystem::exists(level0_dir)) {
-        std::filesystem::create_directories(level0_dir);
+bool LSM_Tree::write(const Write_Batch& batch){
+    if(batch.empty()){
+        return true;
     }
 
-    uint64_t current_name_index = ss_table_controllers.empty()? 0 : ss_table_controllers.front().get_current_name_counter();
-    std::string filename_data(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
-    std::string filename_index(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
-    std::string filename_offset(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
+    Statistics_Timer write_timer(this -> statistics, STATISTICS_WRITE_MICROS);
+    this -> statistics.record(STATISTICS_WRITES);
 
-    snprintf(&filename_data[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_DATA,  0, current_name_index);
-    snprintf(&filename_index[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_INDEX,  0, current_name_index);
-    snprintf(&filename_offset[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_OFFSET,  0, current_name_index);
+    try{
+        std::vector<Entry> entries = batch.get_entries();
 
-   
-    std::filesystem::path filepath_data = level0_dir / filename_data;
-    std::filesystem::path filepath_index = level0_dir / filename_index;
-    std::filesystem::path filepath_offset = level0_dir / filename_offset;
+        // consecutive sequence numbers, so a later operation on the same key wins over an earlier one
+        sequence_number_type sequence_number = this -> last_sequence_number.fetch_add(entries.size()) + 1;
 
-    SS_Table* ss_table = new SS_Table(filepath_data, filepath_index, filepath_offset);
+        std::string bytes;
+        for(Entry& entry : entries){
+            entry.set_sequence_number(sequence_number++);
+            bytes += entry.get_ostream_bytes().str();
+        }
 
-    uint16_t record_count = ss_table -> fill_ss_table(entries);
+        {
+            Statistics_Timer wal_timer(this -> statistics, STATISTICS_WAL_SYNC_MICROS);
+            write_ahead_log.append_batch(bytes, static_cast<uint32_t>(entries.size()));
+        }
+        this -> statistics.record(STATISTICS_WAL_BYTES, bytes.size());
 
-    if(record_count == 0){
-        throw std::runtime_error(LSM_TREE_EMPTY_ENTRY_VECTOR_ERR_MSG);
+        // readers see the whole batch or none of it
+        this -> mem_table -> insert_entries(entries, this -> get_live_snapshots());
     }
-
-    if(ss_table_controllers.size() == 0){
-        ss_table_controllers.emplace_back(SS_TABLE_CONTROLLER_RATIO, ss_table_controllers.size());
+    catch(const std::exception& e){
+        std::cerr<< e.what() <<std::endl;
+        return false;
+    }
+
+    if(this -> mem_table -> is_full()){
+        try{
+            flush_mem_table();
+            write_ahead_log.clear_entries();
+        }
+        catch(const std::exception& e){
+            std::cerr<< e.what() <<std::endl;
+            return false;
+        }
+    }
+
+    return true;
+};
+
+sequence_number_type LSM_Tree::acquire_snapshot(){
+    std::lock_guard<std::mutex> lock(this -> live_snapshots_mutex);
+    sequence_number_type snapshot = this -> last_sequence_number.load();
+    this -> live_snapshots.insert(snapshot);
+    return snapshot;
+};
+
+void LSM_Tree::release_snapshot(sequence_number_type snapshot){
+    std::lock_guard<std::mutex> lock(this -> live_snapshots_mutex);
+    std::multiset<sequence_number_type>::iterator it = this -> live_snapshots.find(snapshot);
+    if(it != this -> live_snapshots.end()){
+        this -> live_snapshots.erase(it);
+    }
+};
+
+std::vector<sequence_number_type> LSM_Tree::get_live_snapshots(){
+    std::lock_guard<std::mutex> lock(this -> live_snapshots_mutex);
+    return std::vector<sequence_number_type>(this -> live_snapshots.begin(), this -> live_snapshots.end());
+};
+
+void LSM_Tree::install_version(){
+    std::shared_ptr<Tree_Version> version = std::make_shared<Tree_Version>();
+    version -> mem_table = this -> mem_table;
+    version -> ss_table_controllers = this -> ss_table_controllers;
+
+    std::atomic_store(&this -> current_version, std::shared_ptr<const Tree_Version>(std::move(version)));
+};
+
+std::shared_ptr<const Tree_Version> LSM_Tree::get_version() const{
+    return std::atomic_load(&this -> current_version);
+};
+
+// LSM_Tree
+// To do:
+// SSTable rasymas is MemTable
+// SSTable skaitymas
+// GET <key>
+// SET <key> <value>
+// Multithread SET method to write into WAL and MemTable at the same time
+// GETKEYS - grąžina visus raktus
+// GETKEYS <prefix> - grąžina visus raktus su duota pradžia
+// GETFF <key> - gauti raktų reikšmių poras nuo key
+// GETFB <key> - gauti raktų reikšmių poras nuo key atvirkščia tvarka
+// GETFF ir GETFB turi leisti puslapiuoti, t.y. gauti po n porų ir fektyviai tęsti toliau
+// REMOVE <key>
+
+void LSM_Tree::flush_mem_table(){
+
+    // tables nothing can be read from any more go first, they need no compaction
+    this -> drop_expired_ss_tables();
+
+    // check for compaction
+    if(!ss_table_controllers.empty()){
+        // check if levels has not reached a limit of file count 
+        for(uint16_t i = 0; i < ss_table_controllers.size(); ++i){
+            if((ss_table_controllers.at(i).get_ss_tables_count() * 3) > (this -> max_files_count / 2)){
+                if(!this -> compact_level(i)){
+                    throw std::runtime_error(LSM_TREE_FAILED_COMPACTION_ERR_MSG);
+                }
+            }
+        }
+        
+    }
+
+    // compact level that is the most filled
+    std::pair<uint16_t, double> max_pair = this -> get_max_fill_ratio();
+    if(max_pair.second >= 1.0){
+        if(!this -> compact_level(max_pair.first)){
+            throw std::runtime_error(LSM_TREE_FAILED_COMPACTION_ERR_MSG);
+        }
+    }
+
+    // compactions above are timed on their own
+    Statistics_Timer flush_timer(this -> statistics, STATISTICS_FLUSH_MICROS);
+    std::vector<Entry> entries = this -> mem_table -> dump_entries();
+
+    // large values leave for the value log here, from now on compaction only moves their pointers
+    if(this -> options.value_log_threshold > 0){
+        bool moved_values = false;
+        for(Entry& entry : entries){
+            if(entry.is_deleted() || entry.is_value_pointer() || entry.is_merge_operand() || entry.get_value_length() < this -> options.value_log_threshold){
+                continue;
+            }
+
+            Value_Pointer pointer = this -> value_log.append(entry.get_key_string(), entry.get_value_string());
+            entry.update_value(Bits(pointer.encode()));
+            entry.set_value_pointer(true);
+            moved_values = true;
+        }
+
+        // the blobs have to be on disk before the table pointing at them is
+        if(moved_values){
+            this -> value_log.sync();
+        }
+    }
+
+    uint64_t current_name_index = ss_table_controllers.empty()? 0 : ss_table_controllers.front().get_current_name_counter();
+
+    std::shared_ptr<SS_Table> ss_table = this -> create_ss_table(0, current_name_index);
+
+    uint16_t record_count = ss_table -> fill_ss_table(entries);
+
+    if(record_count == 0){
+        throw std::runtime_error(LSM_TREE_EMPTY_ENTRY_VECTOR_ERR_MSG);
+    }
+
+    // the table only becomes part of the tree once the manifest knows about it
+    ss_table -> sync_files();
+
+    Manifest_Version_Edit edit;
+    edit.add_table(ss_table.get());
+    edit.set_last_sequence_number(this -> last_sequence_number);
+    this -> manifest.log_edit(edit);
+
+    if(ss_table_controllers.size() == 0){
+        ss_table_controllers.emplace_back(this -> options.level_size_ratio, ss_table_controllers.size(), this -> options.level_size_base);
     }
 
     // ss table controller level 0 add a table
     ss_table_controllers.at(0).add_sstable(ss_table);
 
+    // the table and an empty mem_table replace the flushed one in a single step, readers still holding it keep reading it
+    this -> mem_table = std::make_shared<Mem_Table>(this -> options.mem_table_max_size);
+    this -> install_version();
+
+    this -> statistics.record(STATISTICS_FLUSHES);
+    this -> statistics.record_level_bytes_written(0, ss_table -> get_data_file_size() + ss_table -> get_index_file_size() + ss_table -> get_index_offset_file_size());
+
     return;
  }
 
+void LSM_Tree::drop_expired_ss_tables(){
+    uint64_t now = Entry::current_time();
+    Manifest_Version_Edit edit;
+    std::vector<std::pair<level_index_type, table_index_type>> expired_tables;
+
+    // the deepest level first, dropping a table there can free the overlapping ones above it
+    for(level_index_type level = ss_table_controllers.size(); level-- > 0;){
+        SS_Table_Controller& ss_table_controller = ss_table_controllers.at(level);
+
+        for(table_index_type i = 0; i < ss_table_controller.get_ss_tables_count(); ++i){
+            const SS_Table* ss_table = ss_table_controller.at(i);
+            if(!ss_table -> is_fully_expired(now)){
+                continue;
+            }
+
+            Bits first_index = ss_table -> get_first_index();
+            Bits last_index = ss_table -> get_last_index();
+            bool has_older_data = false;
+
+            // older data lives in the deeper levels and, on level 0, in the tables installed before this one
+            // the tables already found expired do not count
+            for(level_index_type older_level = level; older_level < ss_table_controllers.size() && !has_older_data; ++older_level){
+                table_index_type table_count = older_level == level? (level == 0? i : 0) : ss_table_controllers.at(older_level).get_ss_tables_count();
+
+                for(table_index_type j = 0; j < table_count; ++j){
+                    if(std::find(expired_tables.begin(), expired_tables.end(), std::make_pair(older_level, j)) != expired_tables.end()){
+                        continue;
+                    }
+
+                    if(ss_table_controllers.at(older_level).at(j) -> overlap(first_index, last_index)){
+                        has_older_data = true;
+                        break;
+                    }
+                }
+            }
+
+            if(has_older_data){
+                continue;
+            }
+
+            expired_tables.emplace_back(level, i);
+            edit.remove_table(ss_table);
+        }
+    }
+
+    if(expired_tables.empty()){
+        return;
+    }
+
+    this -> manifest.log_edit(edit);
+
+    // the largest index first, so the indexes still to be deleted stay valid
+    std::sort(expired_tables.begin(), expired_tables.end(), [](const std::pair<level_index_type, table_index_type>& a, const std::pair<level_index_type, table_index_type>& b) {
+        return a.second > b.second;
+    });
+
+    for(const std::pair<level_index_type, table_index_type>& expired_table : expired_tables){
+        ss_table_controllers.at(expired_table.first).delete_sstable(expired_table.second);
+    }
+
+    this -> install_version();
+}
+
 bool LSM_Tree::compact_level(level_index_type index) {
     // check for overflow
     if(index + 1 < index) {
@@ -491,6 +1014,9 @@ bool LSM_Tree::compact_level(level_index_type index) {
 
     try {
         while(!ss_table_controllers.at(index).empty()) {
+            Statistics_Timer compaction_timer(this -> statistics, STATISTICS_COMPACTION_MICROS);
+            this -> statistics.record(STATISTICS_COMPACTIONS);
+
             // pair to save level index, and table index
             std::vector<std::pair<level_index_type, table_index_type>> overlapping_key_ranges;
 
@@ -502,9 +1028,12 @@ bool LSM_Tree::compact_level(level_index_type index) {
 
             // find all the overlapping keys and push them to the vector
             // if we are merging level 0 overlapping keys can be found in the same level
+            // all of them are merged, so the range checked against the next level has to cover all of them too
             if(index == 0) {
                 for(table_index_type i = 1; i < ss_table_controllers.front().get_ss_tables_count(); ++i) {
                     overlapping_key_ranges.push_back(std::make_pair(0, i));
+                    first_index = std::min(first_index, ss_table_controllers.front().at(i) -> get_first_index());
+                    last_index = std::max(last_index, ss_table_controllers.front().at(i) -> get_last_index());
                 }
             }
 
@@ -518,29 +1047,9 @@ bool LSM_Tree::compact_level(level_index_type index) {
             }
 
             //  create a directory and a new table
-            std::string filename_data(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
-            std::string filename_index(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
-            std::string filename_offset(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
-
             uint64_t ss_table_count = ss_table_controllers.size() > (uint64_t)(index + 1)? (ss_table_controllers.at(index + 1).get_current_name_counter()) : 0;
 
-            snprintf(&filename_data[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_DATA,  index + 1, ss_table_count);
-            snprintf(&filename_index[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_INDEX,  index + 1, ss_table_count);
-            snprintf(&filename_offset[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_OFFSET,  index + 1, ss_table_count);
-
-            std::string level_n_1_dir(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
-            snprintf(&level_n_1_dir[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_LEVEL_DIR, index + 1);
-            level_n_1_dir.resize(strlen(level_n_1_dir.c_str())); // trim nulls
-
-            if (!std::filesystem::exists(level_n_1_dir)) {
-                std::filesystem::create_directories(level_n_1_dir);
-            }
-
-            std::filesystem::path filepath_data(std::filesystem::path(level_n_1_dir) / filename_data);
-            std::filesystem::path filepath_index(std::filesystem::path(level_n_1_dir) / filename_index);
-            std::filesystem::path filepath_offset(std::filesystem::path(level_n_1_dir) / filename_offset);
-            
-            SS_Table* new_table = new SS_Table(filepath_data, filepath_index, filepath_offset);
+            std::shared_ptr<SS_Table> new_table = this -> create_ss_table(index + 1, ss_table_count);
 
             // create keynators and push them to a vector
             std::vector<SS_Table::Keynator> keynators;
@@ -549,7 +1058,7 @@ bool LSM_Tree::compact_level(level_index_type index) {
             for(const std::pair<level_index_type, table_index_type>& ss_table_data : overlapping_key_ranges) {
                 level_index_type level_index = ss_table_data.first;
                 table_index_type table_index = ss_table_data.second;
-                keynators.push_back(ss_table_controllers.at(level_index).at(table_index) -> get_keynator());
+                keynators.push_back(ss_table_controllers.at(level_index).at(table_index) -> get_keynator(this -> options.compaction_io_mode));
             }
 
             // using heap push to a new table
@@ -559,13 +1068,96 @@ bool LSM_Tree::compact_level(level_index_type index) {
                 heap.push(keynators.at(i).get_next_key(), overlapping_key_ranges.at(i).first, overlapping_key_ranges.at(i).second, &keynators.at(i));
             }
 
-            new_table -> init_writing();
+            std::vector<sequence_number_type> snapshots = this -> get_live_snapshots();
+
+            // nothing older than the output can hold its keys if there is no level below it
+            bool bottom_level = ss_table_controllers.size() <= (uint64_t)(index + 2);
+            uint64_t now = Entry::current_time();
+
+            new_table -> init_writing(this -> options.compaction_io_mode);
             while(!heap.empty()) {
-                Min_Heap::Heap_Element top_element = heap.top();
-                new_table -> write(top_element.key, top_element.keynator -> get_current_data_string());
-                heap.remove_by_key(top_element.key);
+                // the heap hands out the versions of a key newest first
+                Bits current_key = heap.top().key;
+                std::string current_key_string = current_key.get_string();
+                sequence_number_type newer_sequence_number = ENTRY_MAX_SEQUENCE_NUMBER;
+                bool newest_version = true;
+                // reads fold an operand into the versions below it, so those have to stay as long as it does
+                bool keep_all_versions = false;
+
+                while(!heap.empty() && heap.top().key == current_key) {
+                    // without snapshots nobody can see the older versions, skip them without reading
+                    if(!newest_version && snapshots.empty()) {
+                        heap.advance_top();
+                        continue;
+                    }
+
+                    std::string data_string = heap.top().keynator -> get_current_data_string();
+                    heap.advance_top();
+
+                    // without snapshots the operands are folded here, into their base if it is part of the compaction
+                    if(newest_version && snapshots.empty() && Entry::read_merge_operand(data_string)) {
+                        std::vector<std::string> merged = this -> merge_compaction_operands(current_key, current_key_string, data_string, heap, bottom_level);
+
+                        if(merged.size() != 1 || Entry::read_merge_operand(merged.front())) {
+                            for(const std::string& merged_data_string : merged) {
+                                new_table -> write(current_key, merged_data_string);
+                            }
+
+                            newest_version = false;
+                            continue;
+                        }
+
+                        data_string = merged.front();
+                    }
+
+                    sequence_number_type version_sequence_number = snapshots.empty()? ENTRY_NO_SEQUENCE_NUMBER : Entry(current_key_string, data_string).get_sequence_number();
+
+                    // a dropped newest version still hides the older ones, so it is kept as a tombstone without the value
+                    // at the bottom level with no snapshots there is nothing left for it to hide and the key goes away
+                    if(newest_version && this -> filter_compaction_record(index + 1, current_key_string, data_string, version_sequence_number, snapshots, now)) {
+                        if(bottom_level && snapshots.empty()) {
+                            newest_version = false;
+                            continue;
+                        }
+
+                        Entry tombstone(current_key_string, data_string);
+                        tombstone.update_value(Bits(ENTRY_PLACEHOLDER_VALUE));
+                        tombstone.set_value_pointer(false);
+                        tombstone.set_expiry_time(ENTRY_NO_EXPIRY);
+                        tombstone.set_tombstone(true);
+                        data_string = tombstone.get_string_data_bytes();
+                    }
+
+                    // the newest version always survives, older ones only while a snapshot can still see them
+                    if(newest_version || keep_all_versions || snapshot_needs_version(snapshots, version_sequence_number, newer_sequence_number)) {
+                        new_table -> write(current_key, data_string);
+                        keep_all_versions = keep_all_versions || Entry::read_merge_operand(data_string);
+                    }
+
+                    newest_version = false;
+                    newer_sequence_number = version_sequence_number;
+                }
+            }
+            if(new_table -> stop_writing() != 0) {
+                throw std::runtime_error(LSM_TREE_FAILED_COMPACTION_ERR_MSG);
+            }
+
+            // every key of the inputs may have expired
+            bool new_table_empty = new_table -> get_record_count() == 0;
+            if(!new_table_empty) {
+                new_table -> sync_files();
             }
-            new_table -> stop_writing();
+
+            // the new table and the removal of its inputs go into a single manifest record
+            // if we crash before it is written the inputs stay live and the new files are cleaned up on startup
+            Manifest_Version_Edit edit;
+            if(!new_table_empty) {
+                edit.add_table(new_table.get());
+            }
+            for(const std::pair<level_index_type, table_index_type>& ss_table_data : overlapping_key_ranges) {
+                edit.remove_table(ss_table_controllers.at(ss_table_data.first).at(ss_table_data.second));
+            }
+            this -> manifest.log_edit(edit);
 
             // sort the pair vector in ascending order
             std::sort(overlapping_key_ranges.begin(), overlapping_key_ranges.end(), [&](const std::pair<level_index_type, table_index_type>& a, const std::pair<level_index_type, table_index_type>& b) {
@@ -577,12 +1169,23 @@ bool LSM_Tree::compact_level(level_index_type index) {
                 overlapping_key_ranges.pop_back();
             }
 
+            if(new_table_empty) {
+                std::filesystem::remove(new_table -> data_path());
+                std::filesystem::remove(new_table -> index_path());
+                std::filesystem::remove(new_table -> offset_path());
+                std::filesystem::remove(new_table -> prefix_filter_path());
+                this -> install_version();
+                continue;
+            }
+
             // add the new table to our vector
             if(ss_table_controllers.size() <= (uint64_t)(index + 1)) {
-                ss_table_controllers.emplace_back(SS_TABLE_CONTROLLER_RATIO, ss_table_controllers.size());
+                ss_table_controllers.emplace_back(this -> options.level_size_ratio, ss_table_controllers.size(), this -> options.level_size_base);
             }
 
             ss_table_controllers.at(index + 1).add_sstable(new_table);
+            this -> install_version();
+            this -> statistics.record_level_bytes_written(index + 1, new_table -> get_data_file_size() + new_table -> get_index_file_size() + new_table -> get_index_offset_file_size());
         }
 
     } catch (std::exception& e) {
@@ -593,6 +1196,221 @@ bool LSM_Tree::compact_level(level_index_type index) {
     return true;
 }
 
+bool LSM_Tree::filter_compaction_record(level_index_type output_level, std::string& key, std::string& data_string, sequence_number_type version_sequence_number, const std::vector<sequence_number_type>& snapshots, uint64_t now){
+    uint64_t expiry_time = Entry::read_expiry_time(data_string);
+    if(expiry_time != ENTRY_NO_EXPIRY && expiry_time <= now){
+        return true;
+    }
+
+    if(!this -> compaction_filter){
+        return false;
+    }
+
+    Entry entry(key, data_string);
+    if(entry.is_deleted() || entry.is_merge_operand()){
+        return false;
+    }
+
+    // a snapshot reading the record has to keep getting it as it was
+    if(!snapshots.empty() && snapshots.back() >= version_sequence_number){
+        return false;
+    }
+
+    this -> resolve_value(entry);
+
+    std::string new_value;
+    ++this -> compaction_filter_records;
+    Compaction_Filter_Decision decision = this -> compaction_filter -> filter(output_level, key, entry.get_value_string(), new_value);
+
+    if(decision == COMPACTION_FILTER_DROP){
+        ++this -> compaction_filter_dropped;
+        return true;
+    }
+
+    if(decision == COMPACTION_FILTER_CHANGE_VALUE){
+        // the new value is kept in the table, a blob the old one lived in becomes garbage
+        entry.update_value(Bits(new_value));
+        entry.set_value_pointer(false);
+        data_string = entry.get_string_data_bytes();
+        ++this -> compaction_filter_changed;
+    }
+
+    return false;
+}
+
+std::vector<std::string> LSM_Tree::merge_compaction_operands(const Bits& key, std::string& key_string, std::string& newest_data_string, Min_Heap& heap, bool bottom_level){
+    std::vector<std::string> operand_data_strings{newest_data_string};
+    std::vector<std::string> operands{Entry(key_string, newest_data_string).get_value_string()};
+
+    bool has_base = false;
+    std::string base_value;
+    const std::string* existing_value = nullptr;
+
+    // the operands run down to the first version that is not one, everything older is hidden by it
+    while(!heap.empty() && heap.top().key == key) {
+        std::string data_string = heap.top().keynator -> get_current_data_string();
+        heap.advance_top();
+
+        Entry version(key_string, data_string);
+        if(version.is_merge_operand()) {
+            operands.push_back(version.get_value_string());
+            operand_data_strings.push_back(std::move(data_string));
+            continue;
+        }
+
+        has_base = true;
+        if(!version.is_deleted()) {
+            this -> resolve_value(version);
+            base_value = version.get_value_string();
+            existing_value = &base_value;
+        }
+        break;
+    }
+
+    // the result takes the place of the newest operand and keeps its sequence number
+    Entry merged(key_string, newest_data_string);
+    std::vector<std::string> merged_data_strings;
+
+    if(has_base || bottom_level) {
+        std::string value;
+        bool has_value = this -> apply_merge_operands(key_string, existing_value, operands, value);
+
+        if(!has_value && bottom_level) {
+            return merged_data_strings;
+        }
+
+        merged.set_merge_operand(false);
+        merged.update_value(has_value? Bits(value) : Bits(ENTRY_PLACEHOLDER_VALUE));
+        merged.set_tombstone(!has_value);
+        merged_data_strings.push_back(merged.get_string_data_bytes());
+        return merged_data_strings;
+    }
+
+    // the base is in a level below, so the operands stay operands, combined where the operator allows it
+    Entry combined(key_string, operand_data_strings.back());
+    for(uint64_t i = operand_data_strings.size() - 1; i-- > 0;) {
+        Entry newer(key_string, operand_data_strings[i]);
+        std::string combined_operand;
+
+        if(this -> combine_merge_operands(key_string, combined.get_value_string(), newer.get_value_string(), combined_operand)) {
+            newer.update_value(Bits(combined_operand));
+        }
+        else {
+            merged_data_strings.push_back(combined.get_string_data_bytes());
+        }
+
+        combined = newer;
+    }
+    merged_data_strings.push_back(combined.get_string_data_bytes());
+
+    std::reverse(merged_data_strings.begin(), merged_data_strings.end());
+    return merged_data_strings;
+}
+
+void LSM_Tree::set_compaction_filter(std::shared_ptr<const Compaction_Filter> filter){
+    this -> compaction_filter = std::move(filter);
+}
+
+LSM_Tree_Compaction_Filter_Stats LSM_Tree::get_compaction_filter_stats() const{
+    LSM_Tree_Compaction_Filter_Stats compaction_filter_stats;
+    compaction_filter_stats.records_filtered = this -> compaction_filter_records.load(std::memory_order_relaxed);
+    compaction_filter_stats.records_dropped = this -> compaction_filter_dropped.load(std::memory_order_relaxed);
+    compaction_filter_stats.values_changed = this -> compaction_filter_changed.load(std::memory_order_relaxed);
+    return compaction_filter_stats;
+}
+
+std::unique_ptr<Table_Scrubber> LSM_Tree::start_scrub(){
+    uint64_t now = Entry::current_time();
+    const SS_Table* oldest_scrubbed = nullptr;
+
+    // holding the version keeps the table around until the scrubber has its files open
+    std::shared_ptr<const Tree_Version> version = this -> get_version();
+    for(const SS_Table_Controller& ss_table_controller : version -> ss_table_controllers){
+        for(table_index_type i = 0; i < ss_table_controller.get_ss_tables_count(); ++i){
+            const SS_Table* ss_table = ss_table_controller.at(i);
+            if(!oldest_scrubbed || ss_table -> get_last_scrub_time() < oldest_scrubbed -> get_last_scrub_time()){
+                oldest_scrubbed = ss_table;
+            }
+        }
+    }
+
+    if(!oldest_scrubbed || (oldest_scrubbed -> get_last_scrub_time() != SS_TABLE_NEVER_SCRUBBED && now < oldest_scrubbed -> get_last_scrub_time() + LSM_TREE_SCRUB_INTERVAL_MS)){
+        return nullptr;
+    }
+
+    return std::make_unique<Table_Scrubber>(*oldest_scrubbed);
+}
+
+bool LSM_Tree::finish_scrub(const Table_Scrubber& scrubber){
+    ++this -> scrub_tables;
+    this -> scrub_bytes += scrubber.get_bytes_checked();
+
+    if(scrubber.is_corrupted()){
+        return false;
+    }
+
+    // the table may have been compacted away while it was being scrubbed
+    std::shared_ptr<const Tree_Version> version = this -> get_version();
+    if(version -> ss_table_controllers.size() > scrubber.get_level()){
+        const SS_Table_Controller& ss_table_controller = version -> ss_table_controllers.at(scrubber.get_level());
+        for(table_index_type i = 0; i < ss_table_controller.get_ss_tables_count(); ++i){
+            if(ss_table_controller.at(i) -> get_table_id() == scrubber.get_table_id()){
+                ss_table_controller.at(i) -> set_last_scrub_time(Entry::current_time());
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool LSM_Tree::quarantine_ss_table(level_index_type level, uint64_t table_id){
+    if(this -> ss_table_controllers.size() <= level){
+        return false;
+    }
+
+    SS_Table_Controller& ss_table_controller = this -> ss_table_controllers.at(level);
+    for(table_index_type i = 0; i < ss_table_controller.get_ss_tables_count(); ++i){
+        const SS_Table* ss_table = ss_table_controller.at(i);
+        if(ss_table -> get_table_id() != table_id){
+            continue;
+        }
+
+        // once the manifest forgets the table a crash can not bring it back
+        Manifest_Version_Edit edit;
+        edit.remove_table(ss_table);
+        this -> manifest.log_edit(edit);
+
+        std::filesystem::create_directories(this -> get_corrupt_files_dir());
+        for(const std::filesystem::path& file : {ss_table -> data_path(), ss_table -> index_path(), ss_table -> offset_path(), ss_table -> prefix_filter_path()}){
+            if(std::filesystem::exists(file)){
+                std::filesystem::rename(file, this -> get_corrupt_files_dir() / file.filename());
+            }
+        }
+
+        std::cerr << LSM_TREE_QUARANTINED_TABLE_MSG << this -> get_corrupt_files_dir().generic_string() << ": " << ss_table -> data_path().generic_string() << std::endl;
+
+        ss_table_controller.delete_sstable(i, false);
+        this -> install_version();
+        ++this -> scrub_quarantined;
+        return true;
+    }
+
+    return false;
+}
+
+LSM_Tree_Scrub_Stats LSM_Tree::get_scrub_stats() const{
+    LSM_Tree_Scrub_Stats scrub_stats;
+    scrub_stats.tables_scrubbed = this -> scrub_tables.load(std::memory_order_relaxed);
+    scrub_stats.bytes_scrubbed = this -> scrub_bytes.load(std::memory_order_relaxed);
+    scrub_stats.tables_quarantined = this -> scrub_quarantined.load(std::memory_order_relaxed);
+    return scrub_stats;
+}
+
+LSM_Tree_Startup_Stats LSM_Tree::get_startup_stats() const{
+    return this -> startup_stats;
+}
+
 std::vector<std::pair<uint16_t, double>> LSM_Tree::get_fill_ratios(){
     std::vector<std::pair<uint16_t, double>> ratios;
 
@@ -626,6 +1444,19 @@ std::pair<uint16_t, double> LSM_Tree::get_max_fill_ratio(){
     return max_pair;
 }
 
+std::vector<SS_Table_Controller_Stats> LSM_Tree::get_level_stats() const{
+    std::shared_ptr<const Tree_Version> version = this -> get_version();
+
+    std::vector<SS_Table_Controller_Stats> level_stats;
+    level_stats.reserve(version -> ss_table_controllers.size());
+
+    for(const SS_Table_Controller& ss_table_controller : version -> ss_table_controllers){
+        level_stats.push_back(ss_table_controller.get_stats());
+    }
+
+    return level_stats;
+}
+
 
 uint64_t LSM_Tree::get_max_file_limit(){
     #ifdef __linux__
@@ -646,120 +1477,382 @@ uint64_t LSM_Tree::get_max_file_limit(){
     #endif
 }
 
+std::filesystem::path LSM_Tree::get_level_dir(level_index_type level) const{
+    std::string level_dir(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
+    snprintf(&level_dir[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_LEVEL_DIR, level);
+    level_dir.resize(strlen(level_dir.c_str()));
+    return this -> options.data_dir / level_dir;
+}
+
+std::filesystem::path LSM_Tree::get_corrupt_files_dir() const{
+    return this -> options.data_dir / LSM_TREE_CORRUPT_FILES_DIR;
+}
+
+uint64_t LSM_Tree::collect_value_log_garbage(double min_garbage_ratio){
+    // an older version kept for a snapshot may still point into any of the files
+    if(!this -> get_live_snapshots().empty()){
+        return 0;
+    }
+
+    uint64_t reclaimed_bytes = 0;
 
-bool LSM_Tree::reconstruct_tree(){
     try{
+        // the active file is collected too, blobs rewritten below go to a new one
+        this -> value_log.seal();
+
+        std::vector<uint64_t> collected_files;
+        uint64_t rewritten_count = 0;
+
+        for(uint64_t file_id : this -> value_log.get_sealed_file_ids()){
+            uint64_t file_size = this -> value_log.get_file_size(file_id);
+            std::vector<Value_Log_Record> records = this -> value_log.read_records(file_id);
+
+            // a blob is live while the newest version of its key still points at it
+            std::vector<Value_Log_Record> live_records;
+            std::vector<std::vector<std::string>> live_operands;
+            std::vector<uint64_t> live_expiry_times;
+            uint64_t live_bytes = 0;
+            for(Value_Log_Record& record : records){
+                Entry entry = this -> find_entry(*this -> get_version(), Bits(record.key), LSM_TREE_LATEST_SNAPSHOT);
+
+                // the newest version decides when the key expires, operands on top of it still fold into the value below them
+                uint64_t expiry_time = entry.get_expiry_time();
+                std::vector<std::string> operands;
+                if(entry.is_merge_operand()){
+                    entry = this -> find_merge_base(*this -> get_version(), Bits(record.key), entry, operands);
+                }
 
-        
-        std::filesystem::path ss_level_path = LSM_TREE_SS_LEVEL_PATH;
-        if(!std::filesystem::exists(ss_level_path)){
-            return true;
-        }
-        
-        std::regex ss_table_pattern(R"(\.sst_l(\d+)_(data|index|offset)_(\d+)\.bin)");
-        std::regex folder_pattern(R"(Level_(\d+))");
-        // match[1] -> level number
-        // match[2] -> file type
-        // match[3] -> file ID
-
-        std::vector<std::pair<uint8_t, uint16_t>> corrupted_indexes;
-        std::vector<std::pair<uint8_t, std::filesystem::path>> levels;
-
-        for(const std::filesystem::directory_entry& level_path : std::filesystem::directory_iterator(ss_level_path)){
-            if(level_path.is_directory()){
-                std::string level_folder = level_path.path().filename().string();
-                std::smatch match;
-                if(std::regex_match(level_folder, match, folder_pattern)){
-                    uint8_t level = static_cast<uint8_t>(std::stoi(match[1]));
-                    levels.emplace_back(level, level_path);
+                Value_Pointer pointer;
+                if(entry.is_deleted() || !entry.is_value_pointer() || !Value_Pointer::decode(entry.get_value_string(), pointer)){
+                    continue;
+                }
+
+                if(pointer.file_id == record.pointer.file_id && pointer.offset == record.pointer.offset){
+                    live_bytes += record.pointer.length;
+                    live_records.push_back(std::move(record));
+                    live_operands.push_back(std::move(operands));
+                    live_expiry_times.push_back(expiry_time);
+                }
+            }
+
+            if(file_size == 0 || (double)(file_size - live_bytes) / file_size < min_garbage_ratio){
+                continue;
+            }
 
+            // the live blobs move to the active file and their keys are written again pointing at the new place
+            // a key with operands on top gets the folded value, a version written under the operands would shadow them
+            std::vector<sequence_number_type> snapshots;
+            for(size_t i = 0; i < live_records.size(); ++i){
+                const Value_Log_Record& record = live_records[i];
+                std::string value = this -> value_log.read(record.pointer);
+
+                bool has_value = true;
+                if(!live_operands[i].empty()){
+                    std::string base_value = std::move(value);
+                    has_value = this -> apply_merge_operands(record.key, &base_value, live_operands[i], value);
                 }
+
+                Entry entry(Bits(record.key), Bits(ENTRY_PLACEHOLDER_VALUE));
+                if(has_value){
+                    Value_Pointer new_pointer = this -> value_log.append(record.key, value);
+                    entry.update_value(Bits(new_pointer.encode()));
+                    entry.set_value_pointer(true);
+                }
+                else{
+                    entry.set_tombstone(true);
+                }
+                entry.set_sequence_number(++this -> last_sequence_number);
+                entry.set_expiry_time(live_expiry_times[i]);
+
+                std::ostringstream bytes = entry.get_ostream_bytes();
+                write_ahead_log.append_entry(bytes);
+                this -> mem_table -> insert_entry(entry, snapshots);
+                ++rewritten_count;
             }
+
+            collected_files.push_back(file_id);
+            reclaimed_bytes += file_size - live_bytes;
         }
 
-        std::sort(levels.begin(), levels.end(),
-                  [](const auto& a, const auto& b) {
-                      return a.first < b.first;
-                  });
-        
+        if(collected_files.empty()){
+            return 0;
+        }
+
+        // the new pointers only live in the wal, flush them into a table before the old blobs go away
+        if(rewritten_count > 0){
+            this -> value_log.sync();
+            flush_mem_table();
+            write_ahead_log.clear_entries();
+        }
+
+        for(uint64_t file_id : collected_files){
+            this -> value_log.remove_file(file_id);
+        }
+    }
+    catch(const std::exception& e){
+        std::cerr << e.what() << std::endl;
+        return 0;
+    }
 
-        for(std::vector<std::pair<uint8_t, std::filesystem::path>>::const_iterator it = levels.begin(); it != levels.end(); ++it){
-                ss_table_controllers.emplace_back(SS_TABLE_CONTROLLER_RATIO, ss_table_controllers.size());
+    return reclaimed_bytes;
+};
 
-                std::map<uint16_t, LSM_Tree::SS_Table_Files> table_map;
+void LSM_Tree::create_checkpoint(const std::filesystem::path& checkpoint_dir){
+    if(std::filesystem::exists(checkpoint_dir)){
+        throw File_Exception(LSM_TREE_CHECKPOINT_EXISTS_ERR_MSG, checkpoint_dir.generic_string().c_str());
+    }
 
-                std::vector<std::filesystem::path> ss_table_data_files;
-                std::vector<std::filesystem::path> ss_table_index_files;
-                std::vector<std::filesystem::path> ss_table_offset_files;
-                
-                for(const std::filesystem::directory_entry& ss_table_file : std::filesystem::directory_iterator(it -> second )){
-                    std::string filename = ss_table_file.path().filename().string();
-                    std::smatch match;
+    std::filesystem::path data_dir = checkpoint_dir / LSM_TREE_CHECKPOINT_DATA_DIR_NAME;
+    std::filesystem::path wal_dir = checkpoint_dir / LSM_TREE_CHECKPOINT_WAL_DIR_NAME;
 
-                    if(std::regex_match(filename, match, ss_table_pattern)){
-                        std::string type = match[2];
-                        uint16_t id = static_cast<uint16_t>(std::stoi(match[3]));
+    try{
+        std::filesystem::create_directories(data_dir);
+        std::filesystem::create_directories(wal_dir);
+
+        // the tables point into sealed files only once the active one is sealed, later appends go to a file the checkpoint does not share
+        this -> value_log.seal();
+        std::vector<uint64_t> value_log_file_ids = this -> value_log.get_sealed_file_ids();
+        if(!value_log_file_ids.empty()){
+            std::filesystem::path value_log_dir = data_dir / VALUE_LOG_DIR_NAME;
+            std::filesystem::create_directories(value_log_dir);
+
+            for(uint64_t file_id : value_log_file_ids){
+                std::filesystem::path file = this -> value_log.get_file_path(file_id);
+                link_or_copy_file(file, value_log_dir / file.filename());
+            }
+            sync_path(value_log_dir, true);
+        }
 
-                        SS_Table_Files& set = table_map[id];
+        std::vector<std::vector<Manifest_Table_Record>> live_tables(this -> ss_table_controllers.size());
+        for(level_index_type level = 0; level < this -> ss_table_controllers.size(); ++level){
+            const SS_Table_Controller& ss_table_controller = this -> ss_table_controllers.at(level);
+            if(ss_table_controller.empty()){
+                continue;
+            }
 
-                        if(type == LSM_TREE_TYPE_DATA)
-                            set.data_file = ss_table_file.path();
-                        else if (type == LSM_TREE_TYPE_INDEX)
-                            set.index_file = ss_table_file.path();
-                        else if (type == LSM_TREE_TYPE_OFFSET)
-                            set.offset_file = ss_table_file.path();
-                    }
+            std::filesystem::path level_dir = data_dir / this -> get_level_dir(level).filename();
+            std::filesystem::create_directories(level_dir);
+
+            for(table_index_type i = 0; i < ss_table_controller.get_ss_tables_count(); ++i){
+                const SS_Table* ss_table = ss_table_controller.at(i);
+                for(const std::filesystem::path& file : {ss_table -> data_path(), ss_table -> index_path(), ss_table -> offset_path()}){
+                    link_or_copy_file(file, level_dir / file.filename());
                 }
 
-                for(std::pair<const uint16_t, SS_Table_Files>& entry : table_map){
-                    // uint16_t id = entry.first;
-                    SS_Table_Files& set = entry.second;
+                // tables written without a prefix extractor have no filter
+                if(std::filesystem::exists(ss_table -> prefix_filter_path())){
+                    link_or_copy_file(ss_table -> prefix_filter_path(), level_dir / ss_table -> prefix_filter_path().filename());
+                }
 
-                    if(!set.data_file.empty() && !set.index_file.empty() && !set.offset_file.empty()){
-                        SS_Table* new_table = new SS_Table(entry.second.data_file, entry.second.index_file, entry.second.offset_file);
-                        new_table -> reconstruct_ss_table();
-                        ss_table_controllers.at(it -> first).add_sstable(new_table);
-                        
+                live_tables.at(level).push_back(make_manifest_table_record(ss_table));
+            }
+            sync_path(level_dir, true);
+        }
 
-                        //std::cout << entry.second.data_file.string() << std::endl;
-                        //std::cout << entry.second.index_file.string() << std::endl;
-                        //std::cout << entry.second.offset_file.string() << std::endl;
+        // the wal is appended to in place, so it is the one file that has to be copied
+        std::filesystem::path wal_file = this -> write_ahead_log.get_wal_file_location();
+        if(std::filesystem::exists(wal_file)){
+            std::filesystem::copy_file(wal_file, wal_dir / WAL_FILE_NAME);
+            sync_path(wal_dir / WAL_FILE_NAME, false);
+        }
+        sync_path(wal_dir, true);
 
-                        
-                    }
-                    else{
+        // rewrite() records the sequence number of the new manifest, the edit carries ours over
+        Manifest checkpoint_manifest(data_dir / MANIFEST_FILE_NAME, data_dir / MANIFEST_TMP_FILE_NAME);
+        checkpoint_manifest.rewrite(live_tables);
 
-                        if (!std::filesystem::exists(LSM_TREE_CORRUPT_FILES_PATH)) {
-                            std::filesystem::create_directories(LSM_TREE_CORRUPT_FILES_PATH);
-                        }
+        Manifest_Version_Edit edit;
+        edit.set_last_sequence_number(this -> last_sequence_number);
+        checkpoint_manifest.log_edit(edit);
 
-                        // move the entry.second.data_file, entry.second.index_file and entry.second.offset_file to the LMS_CORRUPT_FILES_PATH folder
+        sync_path(data_dir, true);
+        sync_path(checkpoint_dir, true);
+    }
+    catch(...){
+        std::error_code error;
+        std::filesystem::remove_all(checkpoint_dir, error);
+        throw;
+    }
+}
 
-                        if(std::filesystem::exists(set.data_file)){
-                            std::filesystem::path dest = LSM_TREE_CORRUPT_FILES_PATH / set.data_file.filename();
-                            std::filesystem::rename(set.data_file, dest);                         
-                        }
+void LSM_Tree::ingest_files(const std::vector<std::filesystem::path>& data_files, bool move_files){
+    if(data_files.empty()){
+        return;
+    }
 
-                        if(std::filesystem::exists(set.index_file)){
-                            std::filesystem::path dest = LSM_TREE_CORRUPT_FILES_PATH / set.index_file.filename();
-                            std::filesystem::rename(set.index_file, dest);
-                        }
+    if(!this -> get_live_snapshots().empty()){
+        throw std::runtime_error(LSM_TREE_INGEST_LIVE_SNAPSHOT_ERR_MSG);
+    }
 
+    // open the tables where they are, only their first and last keys and sizes are read
+    std::regex data_file_pattern(R"(\.sst_l(\d+)_data_(\d+)\.bin)");
+    std::vector<std::shared_ptr<SS_Table>> external_tables;
+    uint64_t ingest_size = 0;
+    for(const std::filesystem::path& data_file : data_files){
+        std::string filename = data_file.filename().string();
+        std::smatch match;
+        if(!std::regex_match(filename, match, data_file_pattern)){
+            throw File_Exception(LSM_TREE_INGEST_BAD_FILE_NAME_ERR_MSG, data_file.generic_string().c_str());
+        }
 
-                        if(std::filesystem::exists(set.offset_file)){
-                            std::filesystem::path dest = LSM_TREE_CORRUPT_FILES_PATH / set.offset_file.filename();
-                            std::filesystem::rename(set.offset_file, dest);
-                        }
-                    }
+        level_index_type level = static_cast<level_index_type>(std::stoul(match[1]));
+        uint64_t table_id = std::stoull(match[2]);
+        SS_Table_Files files = get_ss_table_files(data_file.parent_path(), level, table_id);
 
+        std::shared_ptr<SS_Table> external_table = std::make_shared<SS_Table>(files.data_file, files.index_file, files.offset_file, files.filter_file, level, table_id);
+        external_table -> reconstruct_ss_table();
+        external_tables.push_back(external_table);
+        ingest_size += external_table -> get_data_file_size() + external_table -> get_index_file_size() + external_table -> get_index_offset_file_size();
+    }
+
+    // the mem_table is checked before any table, writes waiting in it would shadow the newer ingested records
+    for(const std::shared_ptr<SS_Table>& external_table : external_tables){
+        Mem_Table::Iterator mem_table_iterator(*this -> mem_table, LSM_TREE_LATEST_SNAPSHOT);
+        mem_table_iterator.seek(external_table -> get_first_index(), ITERATOR_FORWARD);
+        if(mem_table_iterator.valid() && !(external_table -> get_last_index() < mem_table_iterator.entry().get_key())){
+            this -> flush_mem_table();
+            this -> write_ahead_log.clear_entries();
+            break;
+        }
+    }
+
+    // landing on a level that can hold them saves compaction from pushing the tables down again right away
+    // level 0 tables are all probed on every read, so tables that overlap nothing go at least to level 1
+    level_index_type deepest_level = std::max<level_index_type>(1, this -> ss_table_controllers.empty()? 0 : this -> ss_table_controllers.size() - 1);
+    while(deepest_level < LSM_TREE_INGEST_MAX_LEVEL && SS_Table_Controller(this -> options.level_size_ratio, deepest_level, this -> options.level_size_base).get_stats().max_size_bytes < ingest_size){
+        ++deepest_level;
+    }
+
+    // tables placed so far, an ingested table is newer than the ones before it
+    std::vector<std::pair<level_index_type, const SS_Table*>> placed_tables;
+    auto overlaps = [this, &placed_tables](level_index_type level, const SS_Table* table){
+        if(level < this -> ss_table_controllers.size()){
+            const SS_Table_Controller& ss_table_controller = this -> ss_table_controllers.at(level);
+            for(table_index_type i = 0; i < ss_table_controller.get_ss_tables_count(); ++i){
+                if(!(table -> get_last_index() < ss_table_controller.at(i) -> get_first_index() || ss_table_controller.at(i) -> get_last_index() < table -> get_first_index())){
+                    return true;
                 }
+            }
+        }
+
+        for(const std::pair<level_index_type, const SS_Table*>& placed_table : placed_tables){
+            if(placed_table.first == level && !(table -> get_last_index() < placed_table.second -> get_first_index() || placed_table.second -> get_last_index() < table -> get_first_index())){
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    // the deepest level with nothing overlapping on it or above it, level 0 takes the table as its newest one otherwise
+    for(const std::shared_ptr<SS_Table>& external_table : external_tables){
+        level_index_type level = 0;
+        if(!overlaps(0, external_table.get())){
+            while(level < deepest_level && !overlaps(level + 1, external_table.get())){
+                ++level;
+            }
+        }
+        placed_tables.emplace_back(level, external_table.get());
+    }
+
+    std::map<level_index_type, uint64_t> next_table_ids;
+    std::vector<std::shared_ptr<SS_Table>> ingested_tables;
+    std::vector<std::filesystem::path> linked_files;
+    Manifest_Version_Edit edit;
+
+    try{
+        for(size_t i = 0; i < external_tables.size(); ++i){
+            const SS_Table& external_table = *external_tables.at(i);
+            level_index_type level = placed_tables.at(i).first;
+
+            if(next_table_ids.find(level) == next_table_ids.end()){
+                next_table_ids[level] = level < this -> ss_table_controllers.size()? this -> ss_table_controllers.at(level).get_current_name_counter() : 0;
+            }
+            uint64_t table_id = next_table_ids[level]++;
+
+            SS_Table_Files files = this -> get_ss_table_files(level, table_id);
+            std::filesystem::create_directories(files.data_file.parent_path());
+
+            std::vector<std::pair<std::filesystem::path, std::filesystem::path>> links = {{external_table.data_path(), files.data_file}, {external_table.index_path(), files.index_file}, {external_table.offset_path(), files.offset_file}};
+            if(std::filesystem::exists(external_table.prefix_filter_path())){
+                links.emplace_back(external_table.prefix_filter_path(), files.filter_file);
+            }
+
+            for(const std::pair<std::filesystem::path, std::filesystem::path>& link : links){
+                link_or_copy_file(link.first, link.second);
+                linked_files.push_back(link.second);
+            }
+
+            std::shared_ptr<SS_Table> ss_table = std::make_shared<SS_Table>(files.data_file, files.index_file, files.offset_file, files.filter_file, level, table_id);
+            ss_table -> restore_metadata(external_table.get_first_index(), external_table.get_last_index(), external_table.get_record_count(), external_table.get_data_file_size(), external_table.get_index_file_size(), external_table.get_index_offset_file_size(), external_table.get_min_expiry_time(), external_table.get_max_expiry_time());
+            if(links.size() > 3){
+                ss_table -> load_prefix_filter();
+            }
 
+            // copied files are not on disk yet, linked ones are synced again for nothing
+            ss_table -> sync_files();
+            sync_path(files.data_file.parent_path(), true);
+
+            edit.add_table(ss_table.get());
+            ingested_tables.push_back(ss_table);
+        }
+
+        edit.set_last_sequence_number(this -> last_sequence_number);
+        this -> manifest.log_edit(edit);
+    }
+    catch(...){
+        std::error_code error;
+        for(const std::filesystem::path& linked_file : linked_files){
+            std::filesystem::remove(linked_file, error);
+        }
+        throw;
+    }
+
+    for(std::shared_ptr<SS_Table>& ss_table : ingested_tables){
+        while(this -> ss_table_controllers.size() <= ss_table -> get_level()){
+            this -> ss_table_controllers.emplace_back(this -> options.level_size_ratio, this -> ss_table_controllers.size(), this -> options.level_size_base);
+        }
+        this -> ss_table_controllers.at(ss_table -> get_level()).add_sstable(ss_table);
+    }
+    this -> install_version();
+
+    if(move_files){
+        std::error_code error;
+        for(const std::shared_ptr<SS_Table>& external_table : external_tables){
+            for(const std::filesystem::path& file : {external_table -> data_path(), external_table -> index_path(), external_table -> offset_path(), external_table -> prefix_filter_path()}){
+                std::filesystem::remove(file, error);
             }
+        }
+    }
+}
+
+bool LSM_Tree::reconstruct_tree(){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-            return true;
+    try{
+        if(this -> manifest.exists()){
+            this -> reconstruct_from_manifest();
+        }
+        else{
+            this -> reconstruct_from_files();
+        }
+
+        // the wal may hold writes newer than anything the manifest saw flushed
+        this -> last_sequence_number = std::max(this -> manifest.get_last_sequence_number(), this -> mem_table -> get_max_sequence_number());
 
+        // start a fresh manifest holding only the live tables, this also drops a torn tail record
+        std::vector<std::vector<Manifest_Table_Record>> live_tables(ss_table_controllers.size());
+        for(uint16_t i = 0; i < ss_table_controllers.size(); ++i){
+            for(table_index_type j = 0; j < ss_table_controllers.at(i).get_ss_tables_count(); ++j){
+                live_tables.at(i).push_back(make_manifest_table_record(ss_table_controllers.at(i).at(j)));
+            }
         }
 
+        this -> manifest.rewrite(live_tables);
+
+        this -> startup_stats.level_recovery_micros = micros_since(start) - this -> startup_stats.table_open_micros;
+        return true;
+    }
     catch (const std::filesystem::filesystem_error& e) {
         std::cerr << "Filesystem error: " << e.what() << std::endl;
         return false;
@@ -772,28 +1865,261 @@ bool LSM_Tree::reconstruct_tree(){
     return true;
 }
 
-std::string LSM_Tree::next_prefix(const std::string& prefix) {
-    std::string result = prefix;
-    while (!result.empty()) {
-        unsigned char &c = reinterpret_cast<unsigned char&>(result.back());
-        if (c != 0xFF){
-            c++;
-            return result;
+void LSM_Tree::reconstruct_from_manifest(){
+    const std::vector<std::vector<Manifest_Table_Record>>& levels = this -> manifest.recover();
+
+    std::regex ss_table_pattern(R"(\.sst_l(\d+)_(data|index|offset|filter)_(\d+)\.bin)");
+    std::regex folder_pattern(R"(Level_(\d+))");
+
+    // one directory listing per level instead of opening every table
+    std::map<level_index_type, std::set<std::filesystem::path>> files_on_disk;
+    for(const std::filesystem::directory_entry& level_path : std::filesystem::directory_iterator(this -> options.data_dir)){
+        std::string level_folder = level_path.path().filename().string();
+        std::smatch match;
+        if(!level_path.is_directory() || !std::regex_match(level_folder, match, folder_pattern)){
+            continue;
+        }
+
+        std::set<std::filesystem::path>& level_files = files_on_disk[static_cast<level_index_type>(std::stoi(match[1]))];
+        for(const std::filesystem::directory_entry& ss_table_file : std::filesystem::directory_iterator(level_path)){
+            std::string filename = ss_table_file.path().filename().string();
+            if(std::regex_match(filename, ss_table_pattern)){
+                level_files.insert(filename);
+            }
         }
-        result.pop_back();
     }
-    return std::string();
-};
 
-std::set<Bits> LSM_Tree::clear_larger_prefix(const std::set<Bits>& keys,const std::string& prefix){
-    std::set<Bits> filtered_keys;
+    std::vector<std::filesystem::path> corrupted_files;
+    std::vector<std::pair<std::shared_ptr<SS_Table>, bool>> tables;
 
-    std::string next_larger_prefix = next_prefix(prefix);
-    
-    std::set<Bits>::iterator it = keys.lower_bound(Bits(next_larger_prefix));
+    for(level_index_type level = 0; level < levels.size(); ++level){
+        ss_table_controllers.emplace_back(this -> options.level_size_ratio, level, this -> options.level_size_base);
+        std::set<std::filesystem::path>& level_files = files_on_disk[level];
 
-    filtered_keys.insert(keys.begin(), it);
+        for(const Manifest_Table_Record& record : levels.at(level)){
+            SS_Table_Files set = this -> get_ss_table_files(level, record.table_id);
 
-    return filtered_keys;
-};
+            bool has_data = level_files.erase(set.data_file.filename()) > 0;
+            bool has_index = level_files.erase(set.index_file.filename()) > 0;
+            bool has_offset = level_files.erase(set.offset_file.filename()) > 0;
+            bool has_filter = level_files.erase(set.filter_file.filename()) > 0;
+
+            if(!has_data || !has_index || !has_offset){
+                std::cerr << LSM_TREE_MANIFEST_MISSING_TABLE_ERR_MSG << set.data_file.generic_string() << std::endl;
+                if(has_data) corrupted_files.push_back(set.data_file);
+                if(has_index) corrupted_files.push_back(set.index_file);
+                if(has_offset) corrupted_files.push_back(set.offset_file);
+                if(has_filter) corrupted_files.push_back(set.filter_file);
+                continue;
+            }
+
+            std::shared_ptr<SS_Table> new_table = std::make_shared<SS_Table>(set.data_file, set.index_file, set.offset_file, set.filter_file, level, record.table_id);
+            new_table -> restore_metadata(Bits(record.first_key), Bits(record.last_key), record.record_count, record.data_file_size, record.index_file_size, record.index_offset_file_size, record.min_expiry_time, record.max_expiry_time);
+            ss_table_controllers.at(level).add_sstable(new_table);
+            tables.emplace_back(new_table, has_filter);
+        }
+    }
+
+    // the controllers only need the metadata, nobody reads the tables before the first version is installed
+    this -> open_ss_tables(tables, false);
+
+    // whatever is left was written by a flush or compaction that never reached the manifest
+    // after a torn manifest record they may belong to it, so they are kept aside instead of removed
+    for(std::pair<const level_index_type, std::set<std::filesystem::path>>& level_files : files_on_disk){
+        std::filesystem::path level_dir = this -> get_level_dir(level_files.first);
+
+        for(const std::filesystem::path& orphan : level_files.second){
+            if(this -> manifest.has_torn_tail()){
+                corrupted_files.push_back(level_dir / orphan);
+            }
+            else{
+                std::filesystem::remove(level_dir / orphan);
+            }
+        }
+    }
+
+    if(!corrupted_files.empty()){
+        if (!std::filesystem::exists(this -> get_corrupt_files_dir())) {
+            std::filesystem::create_directories(this -> get_corrupt_files_dir());
+        }
+
+        for(const std::filesystem::path& corrupted_file : corrupted_files){
+            std::filesystem::rename(corrupted_file, this -> get_corrupt_files_dir() / corrupted_file.filename());
+        }
+    }
+}
+
+void LSM_Tree::reconstruct_from_files(){
+    std::filesystem::path ss_level_path = this -> options.data_dir;
+    if(!std::filesystem::exists(ss_level_path)){
+        return;
+    }
+
+    std::regex ss_table_pattern(R"(\.sst_l(\d+)_(data|index|offset|filter)_(\d+)\.bin)");
+    std::regex folder_pattern(R"(Level_(\d+))");
+    // match[1] -> level number
+    // match[2] -> file type
+    // match[3] -> file ID
+
+    std::vector<std::pair<uint8_t, std::filesystem::path>> levels;
+
+    for(const std::filesystem::directory_entry& level_path : std::filesystem::directory_iterator(ss_level_path)){
+        if(level_path.is_directory()){
+            std::string level_folder = level_path.path().filename().string();
+            std::smatch match;
+            if(std::regex_match(level_folder, match, folder_pattern)){
+                uint8_t level = static_cast<uint8_t>(std::stoi(match[1]));
+                levels.emplace_back(level, level_path);
+            }
+        }
+    }
+
+    std::sort(levels.begin(), levels.end(),
+              [](const auto& a, const auto& b) {
+                  return a.first < b.first;
+              });
+
+    std::vector<std::pair<std::shared_ptr<SS_Table>, bool>> tables;
+
+    for(std::vector<std::pair<uint8_t, std::filesystem::path>>::const_iterator it = levels.begin(); it != levels.end(); ++it){
+        // keep levels dense even if a level directory is missing
+        while(ss_table_controllers.size() <= it -> first){
+            ss_table_controllers.emplace_back(this -> options.level_size_ratio, ss_table_controllers.size(), this -> options.level_size_base);
+        }
+
+        std::map<uint64_t, SS_Table_Files> table_map;
+
+        for(const std::filesystem::directory_entry& ss_table_file : std::filesystem::directory_iterator(it -> second )){
+            std::string filename = ss_table_file.path().filename().string();
+            std::smatch match;
+
+            if(std::regex_match(filename, match, ss_table_pattern)){
+                std::string type = match[2];
+                uint64_t id = std::stoull(match[3]);
+
+                SS_Table_Files& set = table_map[id];
+
+                if(type == LSM_TREE_TYPE_DATA)
+                    set.data_file = ss_table_file.path();
+                else if (type == LSM_TREE_TYPE_INDEX)
+                    set.index_file = ss_table_file.path();
+                else if (type == LSM_TREE_TYPE_OFFSET)
+                    set.offset_file = ss_table_file.path();
+                else if (type == LSM_TREE_TYPE_FILTER)
+                    set.filter_file = ss_table_file.path();
+            }
+        }
+
+        for(std::pair<const uint64_t, SS_Table_Files>& entry : table_map){
+            SS_Table_Files& set = entry.second;
+
+            if(!set.data_file.empty() && !set.index_file.empty() && !set.offset_file.empty()){
+                tables.emplace_back(std::make_shared<SS_Table>(set.data_file, set.index_file, set.offset_file, set.filter_file, it -> first, entry.first), !set.filter_file.empty());
+            }
+            else{
+                if (!std::filesystem::exists(this -> get_corrupt_files_dir())) {
+                    std::filesystem::create_directories(this -> get_corrupt_files_dir());
+                }
+
+                // move the entry.second.data_file, entry.second.index_file and entry.second.offset_file to the LMS_CORRUPT_FILES_PATH folder
+
+                if(std::filesystem::exists(set.data_file)){
+                    std::filesystem::path dest = this -> get_corrupt_files_dir() / set.data_file.filename();
+                    std::filesystem::rename(set.data_file, dest);
+                }
+
+                if(std::filesystem::exists(set.index_file)){
+                    std::filesystem::path dest = this -> get_corrupt_files_dir() / set.index_file.filename();
+                    std::filesystem::rename(set.index_file, dest);
+                }
+
+                if(std::filesystem::exists(set.offset_file)){
+                    std::filesystem::path dest = this -> get_corrupt_files_dir() / set.offset_file.filename();
+                    std::filesystem::rename(set.offset_file, dest);
+                }
+
+                if(std::filesystem::exists(set.filter_file)){
+                    std::filesystem::path dest = this -> get_corrupt_files_dir() / set.filter_file.filename();
+                    std::filesystem::rename(set.filter_file, dest);
+                }
+            }
+        }
+    }
 
+    // the key ranges have to be read before the controllers can sort the tables, they are added in level and id order as found
+    this -> open_ss_tables(tables, true);
+    for(const std::pair<std::shared_ptr<SS_Table>, bool>& table : tables){
+        ss_table_controllers.at(table.first -> get_level()).add_sstable(table.first);
+    }
+}
+
+void LSM_Tree::open_ss_tables(const std::vector<std::pair<std::shared_ptr<SS_Table>, bool>>& tables, bool reconstruct){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    run_in_parallel(tables.size(), this -> options.table_open_threads, [this, &tables, reconstruct](size_t i){
+        SS_Table& ss_table = *tables.at(i).first;
+        if(reconstruct){
+            ss_table.reconstruct_ss_table();
+        }
+
+        if(!tables.at(i).second){
+            return;
+        }
+
+        if(this -> options.lazy_table_open){
+            ss_table.defer_prefix_filter();
+        }
+        else{
+            ss_table.load_prefix_filter();
+        }
+    });
+
+    this -> startup_stats.table_open_micros += micros_since(start);
+    this -> startup_stats.tables += tables.size();
+    if(this -> options.lazy_table_open){
+        this -> startup_stats.deferred_filters += std::count_if(tables.begin(), tables.end(), [](const std::pair<std::shared_ptr<SS_Table>, bool>& table){
+            return table.second;
+        });
+    }
+}
+
+SS_Table_Files LSM_Tree::get_ss_table_files(level_index_type level, uint64_t table_id){
+    return get_ss_table_files(this -> get_level_dir(level), level, table_id);
+}
+
+SS_Table_Files LSM_Tree::get_ss_table_files(const std::filesystem::path& dir, level_index_type level, uint64_t table_id){
+    std::string filename_data(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
+    std::string filename_index(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
+    std::string filename_offset(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
+    std::string filename_filter(LSM_TREE_SS_TABLE_MAX_LENGTH, '\0');
+
+    snprintf(&filename_data[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_DATA, level, table_id);
+    snprintf(&filename_index[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_INDEX, level, table_id);
+    snprintf(&filename_offset[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_OFFSET, level, table_id);
+    snprintf(&filename_filter[0], LSM_TREE_SS_TABLE_MAX_LENGTH, LSM_TREE_SS_TABLE_FILE_NAME_FILTER, level, table_id);
+
+    // trim nulls
+    filename_data.resize(strlen(filename_data.c_str()));
+    filename_index.resize(strlen(filename_index.c_str()));
+    filename_offset.resize(strlen(filename_offset.c_str()));
+    filename_filter.resize(strlen(filename_filter.c_str()));
+
+    SS_Table_Files files;
+    files.data_file = dir / filename_data;
+    files.index_file = dir / filename_index;
+    files.offset_file = dir / filename_offset;
+    files.filter_file = dir / filename_filter;
+    return files;
+}
+
+std::shared_ptr<SS_Table> LSM_Tree::create_ss_table(level_index_type level, uint64_t table_id){
+    SS_Table_Files files = this -> get_ss_table_files(level, table_id);
+
+    if (!std::filesystem::exists(files.data_file.parent_path())) {
+        std::filesystem::create_directories(files.data_file.parent_path());
+    }
+
+    std::shared_ptr<SS_Table> ss_table = std::make_shared<SS_Table>(files.data_file, files.index_file, files.offset_file, files.filter_file, level, table_id);
+    ss_table -> set_prefix_extractor(this -> options.prefix_extractor, this -> options.prefix_filter_bits_per_key);
+    return ss_table;
+}
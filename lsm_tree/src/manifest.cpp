@@ -0,0 +1,412 @@
+#include "../include/manifest.h"
+#include "../include/file_exception.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace {
+    void put_u8(std::string& out, uint8_t value) {
+        out.push_back(static_cast<char>(value));
+    }
+
+    void put_u16(std::string& out, uint16_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put_u32(std::string& out, uint32_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put_u64(std::string& out, uint64_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put_string(std::string& out, const std::string& value) {
+        put_u32(out, value.size());
+        out.append(value);
+    }
+
+    // reader over a body, every get_* returns false once the body runs out
+    struct Body_Reader {
+        const std::string& body;
+        size_t position;
+
+        bool get_raw(void* dest, size_t length) {
+            if(body.size() - position < length) {
+                return false;
+            }
+            memcpy(dest, body.data() + position, length);
+            position += length;
+            return true;
+        }
+
+        bool get_string(std::string& value) {
+            uint32_t length = 0;
+            if(!get_raw(&length, sizeof(length)) || body.size() - position < length) {
+                return false;
+            }
+            value.assign(body.data() + position, length);
+            position += length;
+            return true;
+        }
+    };
+
+    void sync_directory(const std::filesystem::path& dir) {
+        int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+        if(dir_fd < 0) {
+            return;
+        }
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+Manifest_Table_Record make_manifest_table_record(const SS_Table* ss_table) {
+    Manifest_Table_Record record;
+    record.level = ss_table -> get_level();
+    record.table_id = ss_table -> get_table_id();
+    record.record_count = ss_table -> get_record_count();
+    record.data_file_size = ss_table -> get_data_file_size();
+    record.index_file_size = ss_table -> get_index_file_size();
+    record.index_offset_file_size = ss_table -> get_index_offset_file_size();
+    record.first_key = ss_table -> get_first_index().get_string();
+    record.last_key = ss_table -> get_last_index().get_string();
+    record.min_expiry_time = ss_table -> get_min_expiry_time();
+    record.max_expiry_time = ss_table -> get_max_expiry_time();
+    return record;
+}
+
+void Manifest_Version_Edit::add_table(const SS_Table* ss_table) {
+    this -> added_tables.push_back(make_manifest_table_record(ss_table));
+}
+
+void Manifest_Version_Edit::remove_table(const SS_Table* ss_table) {
+    this -> removed_tables.emplace_back(ss_table -> get_level(), ss_table -> get_table_id());
+}
+
+void Manifest_Version_Edit::set_last_sequence_number(sequence_number_type _last_sequence_number) {
+    this -> has_last_sequence_number = true;
+    this -> last_sequence_number = _last_sequence_number;
+}
+
+bool Manifest_Version_Edit::empty() const {
+    return this -> added_tables.empty() && this -> removed_tables.empty() && !this -> has_last_sequence_number;
+}
+
+Manifest::Manifest() : Manifest(MANIFEST_FILE_PATH, MANIFEST_TMP_FILE_PATH) {
+
+}
+
+Manifest::Manifest(const std::filesystem::path& _manifest_file, const std::filesystem::path& _manifest_tmp_file)
+    : manifest_file(_manifest_file), manifest_tmp_file(_manifest_tmp_file), fd(-1), file_size(0), last_sequence_number(ENTRY_NO_SEQUENCE_NUMBER), torn_tail(false) {
+
+}
+
+Manifest::~Manifest() {
+    this -> close_fd();
+}
+
+void Manifest::close_fd() {
+    if(this -> fd >= 0) {
+        ::close(this -> fd);
+        this -> fd = -1;
+    }
+}
+
+bool Manifest::exists() const {
+    return std::filesystem::exists(this -> manifest_file);
+}
+
+const std::vector<std::vector<Manifest_Table_Record>>& Manifest::get_levels() const {
+    return this -> levels;
+}
+
+bool Manifest::has_torn_tail() const {
+    return this -> torn_tail;
+}
+
+sequence_number_type Manifest::get_last_sequence_number() const {
+    return this -> last_sequence_number;
+}
+
+std::string Manifest::encode_edit(const Manifest_Version_Edit& edit) const {
+    std::string payload;
+
+    for(const std::pair<level_index_type, uint64_t>& removed : edit.removed_tables) {
+        std::string body;
+        put_u16(body, removed.first);
+        put_u64(body, removed.second);
+
+        put_u8(payload, MANIFEST_EDIT_REMOVE_TABLE);
+        put_string(payload, body);
+    }
+
+    for(const Manifest_Table_Record& record : edit.added_tables) {
+        std::string body;
+        put_u16(body, record.level);
+        put_u64(body, record.table_id);
+        put_u64(body, record.record_count);
+        put_u64(body, record.data_file_size);
+        put_u64(body, record.index_file_size);
+        put_u64(body, record.index_offset_file_size);
+        put_string(body, record.first_key);
+        put_string(body, record.last_key);
+        put_u64(body, record.min_expiry_time);
+        put_u64(body, record.max_expiry_time);
+
+        put_u8(payload, MANIFEST_EDIT_ADD_TABLE);
+        put_string(payload, body);
+    }
+
+    if(edit.has_last_sequence_number) {
+        std::string body;
+        put_u64(body, edit.last_sequence_number);
+
+        put_u8(payload, MANIFEST_EDIT_LAST_SEQUENCE_NUMBER);
+        put_string(payload, body);
+    }
+
+    return payload;
+}
+
+bool Manifest::decode_edit(const std::string& payload, Manifest_Version_Edit& edit) const {
+    Body_Reader payload_reader{payload, 0};
+
+    while(payload_reader.position < payload.size()) {
+        uint8_t tag = 0;
+        std::string body;
+        if(!payload_reader.get_raw(&tag, sizeof(tag)) || !payload_reader.get_string(body)) {
+            return false;
+        }
+
+        Body_Reader body_reader{body, 0};
+
+        switch(tag) {
+            case MANIFEST_EDIT_ADD_TABLE: {
+                Manifest_Table_Record record;
+                if(!body_reader.get_raw(&record.level, sizeof(record.level)) ||
+                   !body_reader.get_raw(&record.table_id, sizeof(record.table_id)) ||
+                   !body_reader.get_raw(&record.record_count, sizeof(record.record_count)) ||
+                   !body_reader.get_raw(&record.data_file_size, sizeof(record.data_file_size)) ||
+                   !body_reader.get_raw(&record.index_file_size, sizeof(record.index_file_size)) ||
+                   !body_reader.get_raw(&record.index_offset_file_size, sizeof(record.index_offset_file_size)) ||
+                   !body_reader.get_string(record.first_key) ||
+                   !body_reader.get_string(record.last_key)) {
+                    return false;
+                }
+
+                // optional, older bodies end after the keys
+                if(body_reader.position < body.size() &&
+                   (!body_reader.get_raw(&record.min_expiry_time, sizeof(record.min_expiry_time)) ||
+                    !body_reader.get_raw(&record.max_expiry_time, sizeof(record.max_expiry_time)))) {
+                    return false;
+                }
+                edit.added_tables.push_back(std::move(record));
+                break;
+            }
+            case MANIFEST_EDIT_REMOVE_TABLE: {
+                level_index_type level = 0;
+                uint64_t table_id = 0;
+                if(!body_reader.get_raw(&level, sizeof(level)) || !body_reader.get_raw(&table_id, sizeof(table_id))) {
+                    return false;
+                }
+                edit.removed_tables.emplace_back(level, table_id);
+                break;
+            }
+            case MANIFEST_EDIT_LAST_SEQUENCE_NUMBER: {
+                sequence_number_type last_sequence_number = ENTRY_NO_SEQUENCE_NUMBER;
+                if(!body_reader.get_raw(&last_sequence_number, sizeof(last_sequence_number))) {
+                    return false;
+                }
+                edit.set_last_sequence_number(last_sequence_number);
+                break;
+            }
+            default:
+                // written by a newer version, the body length lets us step over it
+                break;
+        }
+    }
+
+    return true;
+}
+
+void Manifest::apply(const Manifest_Version_Edit& edit) {
+    for(const std::pair<level_index_type, uint64_t>& removed : edit.removed_tables) {
+        if(removed.first >= this -> levels.size()) {
+            continue;
+        }
+
+        std::vector<Manifest_Table_Record>& level = this -> levels.at(removed.first);
+        for(std::vector<Manifest_Table_Record>::iterator it = level.begin(); it != level.end(); ++it) {
+            if(it -> table_id == removed.second) {
+                level.erase(it);
+                break;
+            }
+        }
+    }
+
+    for(const Manifest_Table_Record& record : edit.added_tables) {
+        if(record.level >= this -> levels.size()) {
+            this -> levels.resize(record.level + 1);
+        }
+        this -> levels.at(record.level).push_back(record);
+    }
+
+    if(edit.has_last_sequence_number) {
+        this -> last_sequence_number = std::max(this -> last_sequence_number, edit.last_sequence_number);
+    }
+}
+
+void Manifest::write_record(int target_fd, const std::string& payload) {
+    std::string payload_copy = payload;
+    uint32_t payload_length = payload.size();
+    uint32_t checksum = crc32(payload_copy);
+
+    std::string record;
+    record.reserve(sizeof(payload_length) + sizeof(checksum) + payload.size());
+    put_u32(record, payload_length);
+    put_u32(record, checksum);
+    record.append(payload);
+
+    size_t written = 0;
+    while(written < record.size()) {
+        ssize_t n = ::write(target_fd, record.data() + written, record.size() - written);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw File_Exception(MANIFEST_FAILED_WRITE_ERR_MSG, this -> manifest_file.c_str());
+        }
+        written += n;
+    }
+
+    if(::fdatasync(target_fd) != 0) {
+        throw File_Exception(MANIFEST_FAILED_SYNC_ERR_MSG, this -> manifest_file.c_str());
+    }
+
+    if(target_fd == this -> fd) {
+        this -> file_size += record.size();
+    }
+}
+
+const std::vector<std::vector<Manifest_Table_Record>>& Manifest::recover() {
+    this -> levels.clear();
+    this -> last_sequence_number = ENTRY_NO_SEQUENCE_NUMBER;
+    this -> torn_tail = false;
+
+    std::ifstream manifest_in(this -> manifest_file, std::ios::binary);
+    if(!manifest_in) {
+        throw File_Exception(MANIFEST_FAILED_TO_OPEN_ERR_MSG, this -> manifest_file.c_str());
+    }
+
+    uint64_t manifest_size = std::filesystem::file_size(this -> manifest_file);
+    uint64_t offset = 0;
+
+    uint32_t payload_length = 0;
+    uint32_t checksum = 0;
+    std::string payload;
+
+    while(offset < manifest_size) {
+        // a record reaching past the end of the file is the one a crash tore, it was never acknowledged
+        uint64_t remaining = manifest_size - offset;
+        if(remaining < sizeof(payload_length) + sizeof(checksum)) {
+            this -> torn_tail = true;
+            break;
+        }
+
+        if(!manifest_in.read(reinterpret_cast<char*>(&payload_length), sizeof(payload_length)) || !manifest_in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum))) {
+            throw File_Exception(MANIFEST_FAILED_TO_OPEN_ERR_MSG, this -> manifest_file.c_str());
+        }
+
+        remaining -= sizeof(payload_length) + sizeof(checksum);
+        if(payload_length > remaining) {
+            this -> torn_tail = true;
+            break;
+        }
+
+        payload.resize(payload_length);
+        if(!manifest_in.read(&payload[0], payload_length)) {
+            throw File_Exception(MANIFEST_FAILED_TO_OPEN_ERR_MSG, this -> manifest_file.c_str());
+        }
+        offset += sizeof(payload_length) + sizeof(checksum) + payload_length;
+
+        // a bad record is only a torn write if it is the last one, anything after it was written later and would be lost
+        Manifest_Version_Edit edit;
+        if(crc32(payload) != checksum || !this -> decode_edit(payload, edit)) {
+            if(offset < manifest_size) {
+                throw File_Exception(MANIFEST_CORRUPTED_ERR_MSG, this -> manifest_file.c_str());
+            }
+
+            this -> torn_tail = true;
+            break;
+        }
+
+        this -> apply(edit);
+    }
+
+    if(this -> torn_tail) {
+        std::cerr << MANIFEST_TORN_TAIL_MSG;
+    }
+
+    return this -> levels;
+}
+
+void Manifest::rewrite(const std::vector<std::vector<Manifest_Table_Record>>& tables) {
+    this -> close_fd();
+    this -> levels = tables;
+
+    Manifest_Version_Edit snapshot;
+    for(const std::vector<Manifest_Table_Record>& level : tables) {
+        snapshot.added_tables.insert(snapshot.added_tables.end(), level.begin(), level.end());
+    }
+    snapshot.set_last_sequence_number(this -> last_sequence_number);
+
+    std::filesystem::create_directories(this -> manifest_file.parent_path());
+
+    int tmp_fd = ::open(this -> manifest_tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(tmp_fd < 0) {
+        throw File_Exception(MANIFEST_FAILED_TO_OPEN_ERR_MSG, this -> manifest_tmp_file.c_str());
+    }
+
+    try {
+        this -> write_record(tmp_fd, this -> encode_edit(snapshot));
+    }
+    catch(...) {
+        ::close(tmp_fd);
+        throw;
+    }
+    ::close(tmp_fd);
+
+    if(::rename(this -> manifest_tmp_file.c_str(), this -> manifest_file.c_str()) != 0) {
+        throw File_Exception(MANIFEST_FAILED_RENAME_ERR_MSG, this -> manifest_file.c_str());
+    }
+    sync_directory(this -> manifest_file.parent_path());
+
+    this -> fd = ::open(this -> manifest_file.c_str(), O_WRONLY | O_APPEND);
+    if(this -> fd < 0) {
+        throw File_Exception(MANIFEST_FAILED_TO_OPEN_ERR_MSG, this -> manifest_file.c_str());
+    }
+    this -> file_size = std::filesystem::file_size(this -> manifest_file);
+}
+
+void Manifest::log_edit(const Manifest_Version_Edit& edit) {
+    if(this -> fd < 0) {
+        throw std::runtime_error(MANIFEST_NOT_OPEN_ERR_MSG);
+    }
+
+    if(edit.empty()) {
+        return;
+    }
+
+    this -> write_record(this -> fd, this -> encode_edit(edit));
+    this -> apply(edit);
+
+    if(this -> file_size > MANIFEST_REWRITE_THRESHOLD) {
+        std::vector<std::vector<Manifest_Table_Record>> current_levels = this -> levels;
+        this -> rewrite(current_levels);
+    }
+}
@@ -1,15 +1,21 @@
 #include "../include/mem_table.h"
 
-Mem_Table::Mem_Table(){
+Mem_Table::Mem_Table(uint64_t _max_size){
     avl_tree = AVL_Tree();
     entry_array_length = 0;
     total_mem_table_size = 0;
+    max_size = _max_size;
+    max_sequence_number = ENTRY_NO_SEQUENCE_NUMBER;
+    modification_count = 0;
 };
 
-Mem_Table::Mem_Table(Wal& wal){
+Mem_Table::Mem_Table(Wal& wal, uint64_t _max_size){
     avl_tree = AVL_Tree();
     entry_array_length = 0;
     total_mem_table_size = 0;
+    max_size = _max_size;
+    max_sequence_number = ENTRY_NO_SEQUENCE_NUMBER;
+    modification_count = 0;
 
     std::string wal_path = wal.get_wal_file_location();
     std::ifstream input(wal_path, std::ios::binary);
@@ -21,6 +27,14 @@ Mem_Table::Mem_Table(Wal& wal){
     uint64_t entry_length = 0;
     
     while (input.read(reinterpret_cast<char*>(&entry_length), sizeof(entry_length))) {
+
+        if (entry_length == WAL_BATCH_MARKER) {
+            // a batch torn by a crash was never acknowledged, drop it as a whole
+            if (!replay_batch(input)) {
+                break;
+            }
+            continue;
+        }
         
         if (entry_length <= sizeof(entry_length)) {
             throw std::runtime_error("Invalid entry length in WAL file.");
@@ -40,19 +54,8 @@ Mem_Table::Mem_Table(Wal& wal){
         try {
             Entry entry(entry_stream);
 
-            bool entry_key_exists = false;
-            Bits entry_key = entry.get_key();
-            Entry found_entry = avl_tree.search(entry_key, entry_key_exists);
-
-            if(entry_key_exists){
-                total_mem_table_size -= found_entry.get_entry_length();
-                total_mem_table_size += entry.get_entry_length();
-            }else{
-                entry_array_length++;
-                total_mem_table_size+=entry.get_entry_length();
-            }
-
-            avl_tree.insert(entry);
+            // nobody holds a snapshot yet, so only the newest version of every key is kept
+            insert_entry(entry);
 
         } catch (const std::exception& e) {
             throw std::runtime_error(std::string("Error reading WAL entry: ") + e.what());
@@ -60,33 +63,91 @@ Mem_Table::Mem_Table(Wal& wal){
     }
 }
 
+bool Mem_Table::replay_batch(std::ifstream& input){
+    uint64_t payload_length = 0;
+    uint32_t entry_count = 0;
+
+    if (!input.read(reinterpret_cast<char*>(&payload_length), sizeof(payload_length)) ||
+        !input.read(reinterpret_cast<char*>(&entry_count), sizeof(entry_count))) {
+        return false;
+    }
+
+    std::string payload(payload_length, '\0');
+    if (!input.read(payload.data(), payload_length)) {
+        return false;
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(entry_count);
+
+    uint64_t pos = 0;
+    for (uint32_t i = 0; i < entry_count; ++i) {
+        uint64_t entry_length = 0;
+        if (pos + sizeof(entry_length) > payload.size()) {
+            throw std::runtime_error("Invalid batch length in WAL file.");
+        }
+
+        memcpy(&entry_length, &payload[pos], sizeof(entry_length));
+        if (entry_length <= sizeof(entry_length) || pos + entry_length > payload.size()) {
+            throw std::runtime_error("Invalid entry length in WAL batch.");
+        }
+
+        std::stringstream entry_stream(payload.substr(pos, entry_length));
+        entries.emplace_back(entry_stream);
+        pos += entry_length;
+    }
+
+    insert_entries(entries);
+
+    return true;
+}
+
 Mem_Table::~Mem_Table(){
     //destroy AVL
 };
 
 int Mem_Table::get_entry_array_length(){
+    std::shared_lock<std::shared_mutex> lock(this -> mutex);
     return entry_array_length;
 };
 
 uint64_t Mem_Table::get_total_mem_table_size(){
+    std::shared_lock<std::shared_mutex> lock(this -> mutex);
     return total_mem_table_size;
 };
 
-bool Mem_Table::insert_entry(Entry entry){
+bool Mem_Table::insert_entry(Entry entry, const std::vector<sequence_number_type>& live_snapshots){
+    std::unique_lock<std::shared_mutex> lock(this -> mutex);
+    return this -> insert_entry_locked(entry, live_snapshots);
+};
+
+bool Mem_Table::insert_entries(std::vector<Entry>& entries, const std::vector<sequence_number_type>& live_snapshots){
+    std::unique_lock<std::shared_mutex> lock(this -> mutex);
+
+    bool inserted = true;
+    for(Entry& entry : entries){
+        inserted = this -> insert_entry_locked(entry, live_snapshots) && inserted;
+    }
+
+    return inserted;
+};
+
+bool Mem_Table::insert_entry_locked(Entry& entry, const std::vector<sequence_number_type>& live_snapshots){
+    ++this -> modification_count;
+
     try{
-        bool entry_key_exists = false;
         Bits entry_key = entry.get_key();
-        Entry found_entry = avl_tree.search(entry_key, entry_key_exists);
+        uint64_t old_versions_length = avl_tree.get_versions_length(entry_key);
 
-        if(entry_key_exists){
-            total_mem_table_size -= found_entry.get_entry_length();
-            total_mem_table_size += entry.get_entry_length();
-        }else{
+        if(old_versions_length == 0){
             entry_array_length++;
-            total_mem_table_size+=entry.get_entry_length();
         }
 
-        avl_tree.insert(entry);
+        avl_tree.insert(entry, live_snapshots);
+
+        total_mem_table_size -= old_versions_length;
+        total_mem_table_size += avl_tree.get_versions_length(entry_key);
+        max_sequence_number = std::max(max_sequence_number, entry.get_sequence_number());
         return true;
     }
     catch(const std::exception& e){
@@ -97,6 +158,9 @@ bool Mem_Table::insert_entry(Entry entry){
 };
 
 bool Mem_Table::remove_find_entry(Bits key){
+    std::unique_lock<std::shared_mutex> lock(this -> mutex);
+    ++this -> modification_count;
+
     bool is_entry_found;
     try{
         // for now create a copy, we can play with memory in the future
@@ -114,6 +178,9 @@ bool Mem_Table::remove_find_entry(Bits key){
 };
 
 bool Mem_Table::remove_entry(Entry& entry){
+    std::unique_lock<std::shared_mutex> lock(this -> mutex);
+    ++this -> modification_count;
+
     try{
         if(!entry.is_deleted()){
             entry.set_tombstone(true);
@@ -127,15 +194,22 @@ bool Mem_Table::remove_entry(Entry& entry){
     
 };
 
-Entry Mem_Table::find(Bits key, bool& found){
-    Entry found_entry = avl_tree.search(key, found);
+Entry Mem_Table::find(Bits key, bool& found, sequence_number_type snapshot){
+    std::shared_lock<std::shared_mutex> lock(this -> mutex);
+    Entry found_entry = avl_tree.search(key, found, snapshot);
 
     return found_entry;
 };
 
-bool Mem_Table::is_full(){
+sequence_number_type Mem_Table::get_max_sequence_number() const {
+    std::shared_lock<std::shared_mutex> lock(this -> mutex);
+    return max_sequence_number;
+};
+
+bool Mem_Table::is_full() const{
+    std::shared_lock<std::shared_mutex> lock(this -> mutex);
 
-    if(total_mem_table_size >= MEM_TABLE_BYTES_MAX_SIZE){
+    if(total_mem_table_size >= max_size){
         return true;
     }
 
@@ -143,9 +217,14 @@ bool Mem_Table::is_full(){
 };
 
 std::vector<Bits> Mem_Table::get_keys(){
+    std::shared_lock<std::shared_mutex> lock(this -> mutex);
     std::vector<Bits> keys;
 
     for(Entry entry : avl_tree.inorder()){
+        // older versions of a key follow the newest one
+        if(!keys.empty() && keys.back() == entry.get_key()){
+            continue;
+        }
         keys.emplace_back(entry.get_key());
     }
 
@@ -153,6 +232,7 @@ std::vector<Bits> Mem_Table::get_keys(){
 };
 
 std::vector<Entry> Mem_Table::dump_entries(){
+    std::shared_lock<std::shared_mutex> lock(this -> mutex);
     std::vector<Entry> results;
     results = avl_tree.inorder();
 
@@ -160,23 +240,71 @@ std::vector<Entry> Mem_Table::dump_entries(){
 };
 
 void Mem_Table::make_empty() {
+    std::unique_lock<std::shared_mutex> lock(this -> mutex);
+    ++this -> modification_count;
+
     this -> avl_tree.make_empty();
     this -> entry_array_length = 0;
     this -> total_mem_table_size = 0;
+    this -> max_sequence_number = ENTRY_NO_SEQUENCE_NUMBER;
+};
+
+std::unique_ptr<Entry_Iterator> Mem_Table::get_iterator(sequence_number_type snapshot) const{
+    return std::make_unique<Mem_Table::Iterator>(*this, snapshot);
+};
+
+// the avl iterator gets the root once seek() holds the lock
+Mem_Table::Iterator::Iterator(const Mem_Table& _mem_table, sequence_number_type _snapshot) : mem_table(_mem_table), snapshot(_snapshot), direction(ITERATOR_FORWARD), avl_iterator(nullptr, _snapshot), modification_count(0), is_valid(false), current_entry(Bits(ENTRY_PLACEHOLDER_KEY), Bits(ENTRY_PLACEHOLDER_VALUE)) {
+
 };
 
-std::vector<Bits> Mem_Table::get_keys_larger_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys){
-    return this -> avl_tree.get_keys_larger_than_alive(key, count, dead_keys);
+void Mem_Table::Iterator::copy_current() {
+    this -> is_valid = this -> avl_iterator.valid();
+    if(this -> is_valid) {
+        this -> current_entry = this -> avl_iterator.entry();
+    }
 };
 
-std::vector<Entry> Mem_Table::get_entries_larger_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys){
-    return this -> avl_tree.get_entries_larger_than_alive(key, count, dead_keys);
+void Mem_Table::Iterator::seek(const Bits& target, Iterator_Direction _direction) {
+    std::shared_lock<std::shared_mutex> lock(this -> mem_table.mutex);
+
+    this -> direction = _direction;
+    // rotations may have moved the root since the last seek
+    this -> avl_iterator = this -> mem_table.avl_tree.get_iterator(this -> snapshot);
+    this -> avl_iterator.seek(target, this -> direction);
+    this -> modification_count = this -> mem_table.modification_count;
+
+    this -> copy_current();
 };
 
-std::vector<Bits> Mem_Table::get_keys_smaller_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys){
-    return this -> avl_tree.get_keys_smaller_than_alive(key, count, dead_keys);
+bool Mem_Table::Iterator::valid() const {
+    return this -> is_valid;
+};
+
+void Mem_Table::Iterator::next() {
+    if(!this -> is_valid) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(this -> mem_table.mutex);
+
+    if(this -> modification_count != this -> mem_table.modification_count) {
+        // the nodes on the stack may be gone, find the current key again and step past it
+        this -> avl_iterator = this -> mem_table.avl_tree.get_iterator(this -> snapshot);
+        this -> avl_iterator.seek(this -> current_entry.get_key(), this -> direction);
+        this -> modification_count = this -> mem_table.modification_count;
+
+        if(this -> avl_iterator.valid() && this -> avl_iterator.entry().get_key() == this -> current_entry.get_key()) {
+            this -> avl_iterator.next();
+        }
+    }
+    else {
+        this -> avl_iterator.next();
+    }
+
+    this -> copy_current();
 };
 
-std::vector<Entry> Mem_Table::get_entries_smaller_than_alive(const Bits& key, uint32_t count, std::set<Bits>& dead_keys){
-    return this -> avl_tree.get_entries_smaller_than_alive(key, count, dead_keys);
+const Entry& Mem_Table::Iterator::entry() const {
+    return this -> current_entry;
 };
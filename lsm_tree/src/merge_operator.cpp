@@ -0,0 +1,66 @@
+#include "../include/merge_operator.h"
+#include <charconv>
+
+bool Merge_Operator::is_valid_operand(const std::string& operand) const {
+    return true;
+}
+
+bool Int64_Add_Merge_Operator::parse(const std::string& str, int64_t& number) {
+    const char* end = str.data() + str.size();
+    std::from_chars_result result = std::from_chars(str.data(), end, number);
+    return !str.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+bool Int64_Add_Merge_Operator::full_merge(const std::string& key, const std::string* existing_value, const std::string& operand, std::string& new_value) const {
+    int64_t existing_number = 0;
+    int64_t delta = 0;
+    int64_t sum = 0;
+
+    if(existing_value && !Int64_Add_Merge_Operator::parse(*existing_value, existing_number)) {
+        return false;
+    }
+
+    if(!Int64_Add_Merge_Operator::parse(operand, delta) || __builtin_add_overflow(existing_number, delta, &sum)) {
+        return false;
+    }
+
+    new_value = std::to_string(sum);
+    return true;
+}
+
+bool Int64_Add_Merge_Operator::partial_merge(const std::string& key, const std::string& older_operand, const std::string& newer_operand, std::string& new_operand) const {
+    int64_t older_delta = 0;
+    int64_t newer_delta = 0;
+    int64_t sum = 0;
+
+    // an overflowing pair is kept apart, the value it is applied to may bring it back in range
+    if(!Int64_Add_Merge_Operator::parse(older_operand, older_delta) || !Int64_Add_Merge_Operator::parse(newer_operand, newer_delta) || __builtin_add_overflow(older_delta, newer_delta, &sum)) {
+        return false;
+    }
+
+    new_operand = std::to_string(sum);
+    return true;
+}
+
+bool Int64_Add_Merge_Operator::is_valid_operand(const std::string& operand) const {
+    int64_t delta = 0;
+    return Int64_Add_Merge_Operator::parse(operand, delta);
+}
+
+const char* Int64_Add_Merge_Operator::name() const {
+    return "int64_add";
+}
+
+bool Append_Merge_Operator::full_merge(const std::string& key, const std::string* existing_value, const std::string& operand, std::string& new_value) const {
+    new_value = existing_value? *existing_value + operand : operand;
+    return true;
+}
+
+bool Append_Merge_Operator::partial_merge(const std::string& key, const std::string& older_operand, const std::string& newer_operand, std::string& new_operand) const {
+    new_operand = older_operand + newer_operand;
+    return true;
+}
+
+const char* Append_Merge_Operator::name() const {
+    return "append";
+}
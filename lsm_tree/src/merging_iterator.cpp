@@ -0,0 +1,72 @@
+#include "../include/merging_iterator.h"
+#include <algorithm>
+
+Merging_Iterator::Merging_Iterator(std::vector<std::unique_ptr<Entry_Iterator>> _children) : children(std::move(_children)), direction(ITERATOR_FORWARD) {
+    this -> heap.reserve(this -> children.size());
+}
+
+bool Merging_Iterator::comes_after(size_t a, size_t b) const {
+    const Entry& entry_a = this -> children.at(a) -> entry();
+    const Entry& entry_b = this -> children.at(b) -> entry();
+
+    if(entry_a != entry_b) {
+        return this -> direction == ITERATOR_FORWARD? entry_a > entry_b : entry_a < entry_b;
+    }
+
+    // same key, the newer child goes first
+    return a > b;
+}
+
+void Merging_Iterator::push_child(size_t child_index) {
+    this -> heap.push_back(child_index);
+    std::push_heap(this -> heap.begin(), this -> heap.end(), [this](size_t a, size_t b) {
+        return this -> comes_after(a, b);
+    });
+}
+
+size_t Merging_Iterator::pop_child() {
+    std::pop_heap(this -> heap.begin(), this -> heap.end(), [this](size_t a, size_t b) {
+        return this -> comes_after(a, b);
+    });
+
+    size_t child_index = this -> heap.back();
+    this -> heap.pop_back();
+    return child_index;
+}
+
+void Merging_Iterator::seek(const Bits& target, Iterator_Direction _direction) {
+    this -> direction = _direction;
+    this -> heap.clear();
+
+    for(size_t i = 0; i < this -> children.size(); ++i) {
+        this -> children.at(i) -> seek(target, this -> direction);
+        if(this -> children.at(i) -> valid()) {
+            this -> push_child(i);
+        }
+    }
+}
+
+bool Merging_Iterator::valid() const {
+    return !this -> heap.empty();
+}
+
+void Merging_Iterator::next() {
+    if(this -> heap.empty()) {
+        return;
+    }
+
+    // move every child that is on the current key past it, older versions of the key are dropped on the way
+    Entry current_entry = this -> entry();
+    while(!this -> heap.empty() && this -> children.at(this -> heap.front()) -> entry() == current_entry) {
+        size_t child_index = this -> pop_child();
+        this -> children.at(child_index) -> next();
+
+        if(this -> children.at(child_index) -> valid()) {
+            this -> push_child(child_index);
+        }
+    }
+}
+
+const Entry& Merging_Iterator::entry() const {
+    return this -> children.at(this -> heap.front()) -> entry();
+}
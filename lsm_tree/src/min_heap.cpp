@@ -42,6 +42,20 @@ void Min_Heap::pop(){
 
     return;
 }
+void Min_Heap::advance_top(){
+    if(this -> min_heap.empty()){
+        return;
+    }
+
+    Heap_Element element = this -> min_heap.top();
+    this -> min_heap.pop();
+
+    Bits next_key = element.keynator -> get_next_key();
+    if(next_key != Bits(ENTRY_PLACEHOLDER_KEY)){
+        this -> push(next_key, element.level, element.file_index, element.keynator);
+    }
+}
+
 // for when we need to pop all of the elements with the same key
 void Min_Heap::remove_by_key(Bits& key){
     if(this -> min_heap.empty()){
@@ -52,14 +66,8 @@ void Min_Heap::remove_by_key(Bits& key){
             break;
         } 
 
-        Heap_Element element = this -> min_heap.top();
-        if(element.key == key){
-            this -> min_heap.pop();
-            Bits next_key = element.keynator->get_next_key();
-            if(next_key != Bits(ENTRY_PLACEHOLDER_KEY)){
-                this -> push(next_key, element.level, element.file_index, element.keynator);
-            }
-            
+        if(this -> min_heap.top().key == key){
+            this -> advance_top();
         }
         else{
             break;
@@ -0,0 +1,86 @@
+#include "../include/prefix_extractor.h"
+#include <stdexcept>
+
+Prefix_Extractor::Prefix_Extractor() : type(PREFIX_EXTRACTOR_NONE), length(0), delimiter('\0') {
+
+}
+
+Prefix_Extractor Prefix_Extractor::fixed(uint16_t _length) {
+    Prefix_Extractor extractor;
+    if(_length > 0) {
+        extractor.type = PREFIX_EXTRACTOR_FIXED;
+        extractor.length = _length;
+    }
+    return extractor;
+}
+
+Prefix_Extractor Prefix_Extractor::delimited(char _delimiter) {
+    Prefix_Extractor extractor;
+    extractor.type = PREFIX_EXTRACTOR_DELIMITER;
+    extractor.delimiter = _delimiter;
+    return extractor;
+}
+
+Prefix_Extractor Prefix_Extractor::from_name(const std::string& name) {
+    size_t separator = name.find(':');
+    if(separator == std::string::npos) {
+        return Prefix_Extractor();
+    }
+
+    std::string type_name = name.substr(0, separator);
+    std::string argument = name.substr(separator + 1);
+
+    if(type_name == PREFIX_EXTRACTOR_FIXED_NAME) {
+        try {
+            unsigned long fixed_length = std::stoul(argument);
+            if(fixed_length <= UINT16_MAX) {
+                return Prefix_Extractor::fixed(static_cast<uint16_t>(fixed_length));
+            }
+        }
+        catch(const std::exception&) {
+
+        }
+    }
+    else if(type_name == PREFIX_EXTRACTOR_DELIMITER_NAME && argument.size() == 1) {
+        return Prefix_Extractor::delimited(argument[0]);
+    }
+
+    return Prefix_Extractor();
+}
+
+std::string Prefix_Extractor::name() const {
+    switch(this -> type) {
+        case PREFIX_EXTRACTOR_FIXED:
+            return std::string(PREFIX_EXTRACTOR_FIXED_NAME) + ":" + std::to_string(this -> length);
+        case PREFIX_EXTRACTOR_DELIMITER:
+            return std::string(PREFIX_EXTRACTOR_DELIMITER_NAME) + ":" + this -> delimiter;
+        default:
+            return "";
+    }
+}
+
+bool Prefix_Extractor::enabled() const {
+    return this -> type != PREFIX_EXTRACTOR_NONE;
+}
+
+bool Prefix_Extractor::extract(const std::string& key, std::string& prefix) const {
+    switch(this -> type) {
+        case PREFIX_EXTRACTOR_FIXED: {
+            if(key.size() < this -> length) {
+                return false;
+            }
+            prefix = key.substr(0, this -> length);
+            return true;
+        }
+        case PREFIX_EXTRACTOR_DELIMITER: {
+            size_t position = key.find(this -> delimiter);
+            if(position == std::string::npos) {
+                return false;
+            }
+            prefix = key.substr(0, position + 1);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
@@ -1,16 +1,30 @@
 #include "../include/ss_table.h"
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include "../include/entry.h"
 #include "../include/file_exception.h"
+#include "../include/crc32.h"
+#include <fcntl.h>
+#include <unistd.h>
 
 std::string SS_Table::read_stream_at_offset(uint64_t& offset) const {
-    std::ifstream data_in(this -> data_file, std::ios::binary);
-    if(!data_in) {
-        throw File_Exception(SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG, this -> data_file.generic_string().c_str());
+    std::ifstream data_in;
+    return this -> read_stream_at_offset(data_in, offset);
+}
+
+std::string SS_Table::read_stream_at_offset(std::ifstream& data_in, uint64_t offset) const {
+    if(!data_in.is_open()) {
+        data_in.open(this -> data_file, std::ios::binary);
+
+        if(!data_in) {
+            throw File_Exception(SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG, this -> data_file.generic_string().c_str());
+        }
     }
 
     data_in.seekg(offset, data_in.beg);
@@ -38,7 +52,7 @@ std::string SS_Table::read_stream_at_offset(uint64_t& offset) const {
 }
 
 // TEST AND check return values
-Entry SS_Table::get(const Bits& key, bool& found) const {
+Entry SS_Table::get(const Bits& key, bool& found, sequence_number_type snapshot) const {
     found = false;
 
     if(key < this -> first_index || key > this ->last_index) {
@@ -55,25 +69,335 @@ Entry SS_Table::get(const Bits& key, bool& found) const {
         throw File_Exception(SS_TABLE_FAILED_TO_OPEN_INDEX_OFFSET_FILE_MSG, this -> index_offset_file.generic_string().c_str());
     }
 
-    // first set the index to the middle
-    uint64_t binary_search_right = this -> record_count - 1;
-    uint64_t binary_search_left = 0;
-    uint64_t key_offset = 0;
-    uint64_t data_offset = 0;
-    key_len_type key_length = 0;
-    std::string key_str;
+    // versions of the key are stored next to each other newest first, start from the newest one
+    uint64_t key_index = this -> binary_search_nearest(index_in, index_offset_in, key, SS_TABLE_LARGER_OR_EQUAL);
 
-    // binary search for the key
-    while(binary_search_left <= binary_search_right) {
-        uint64_t binary_search_index = binary_search_left + (binary_search_right - binary_search_left) / 2;
+    std::ifstream data_in;
+    Entry entry = this -> read_visible_version(index_in, index_offset_in, data_in, key, key_index, found, snapshot);
+    if(found) {
+        this -> verify_record(entry);
+    }
 
-        // read the key offset
-        index_offset_in.seekg(binary_search_index * sizeof(uint64_t) , index_offset_in.beg);
-        if(index_offset_in.fail()) {
-            throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_OFFSET_EOF_MSG, this -> index_offset_file.generic_string().c_str());
+    return entry;
+}
+
+void SS_Table::multi_get(const std::vector<Bits>& keys, const std::vector<size_t>& key_indexes, std::vector<Entry>& entries, std::vector<bool>& found, sequence_number_type snapshot) const {
+    if(key_indexes.empty()) {
+        return;
+    }
+
+    Async_Reader& reader = Async_Reader::for_this_thread();
+    if(reader.is_async()) {
+        this -> multi_get_async(reader, keys, key_indexes, entries, found, snapshot);
+    }
+    else {
+        this -> multi_get_sync(keys, key_indexes, entries, found, snapshot);
+    }
+
+    for(size_t key_idx : key_indexes) {
+        if(found[key_idx]) {
+            this -> verify_record(entries[key_idx]);
+        }
+    }
+}
+
+void SS_Table::verify_record(Entry& entry) const {
+    if(this -> is_recently_scrubbed(Entry::current_time())) {
+        return;
+    }
+
+    if(!entry.check_checksum()) {
+        throw File_Exception(SS_TABLE_CHECKSUM_MISMATCH_ERR_MSG, this -> data_file.generic_string().c_str());
+    }
+}
+
+void SS_Table::multi_get_sync(const std::vector<Bits>& keys, const std::vector<size_t>& key_indexes, std::vector<Entry>& entries, std::vector<bool>& found, sequence_number_type snapshot) const {
+    std::ifstream index_in(this -> index_file, std::ios::binary);
+    if(!index_in) {
+        throw File_Exception(SS_TABLE_FAILED_TO_OPEN_INDEX_FILE_MSG, this -> index_file.generic_string().c_str());
+    }
+
+    std::ifstream index_offset_in(this -> index_offset_file, std::ios::binary);
+    if(!index_offset_in) {
+        throw File_Exception(SS_TABLE_FAILED_TO_OPEN_INDEX_OFFSET_FILE_MSG, this -> index_offset_file.generic_string().c_str());
+    }
+
+    std::ifstream data_in;
+
+    // keys come sorted, so the next one can not be before the records of the previous one
+    uint64_t search_left = 0;
+    for(size_t key_idx : key_indexes) {
+        const Bits& key = keys[key_idx];
+        if(key < this -> first_index || key > this -> last_index) {
+            continue;
+        }
+
+        uint64_t key_index = this -> binary_search_nearest(index_in, index_offset_in, key, SS_TABLE_LARGER_OR_EQUAL, search_left);
+        search_left = key_index;
+
+        bool key_found = false;
+        Entry entry = this -> read_visible_version(index_in, index_offset_in, data_in, key, key_index, key_found, snapshot);
+        if(key_found) {
+            entries[key_idx] = std::move(entry);
+            found[key_idx] = true;
+        }
+    }
+}
+
+// closes the descriptor when it goes out of scope
+struct SS_Table_Fd {
+    int fd;
+
+    SS_Table_Fd(const std::filesystem::path& path, const char* err_msg) : fd(open(path.c_str(), O_RDONLY | O_CLOEXEC)) {
+        if(this -> fd < 0) {
+            throw File_Exception(err_msg, path.generic_string().c_str());
+        }
+    }
+
+    ~SS_Table_Fd() {
+        close(this -> fd);
+    }
+
+    SS_Table_Fd(const SS_Table_Fd&) = delete;
+    SS_Table_Fd& operator=(const SS_Table_Fd&) = delete;
+};
+
+void SS_Table::multi_get_async(Async_Reader& reader, const std::vector<Bits>& keys, const std::vector<size_t>& key_indexes, std::vector<Entry>& entries, std::vector<bool>& found, sequence_number_type snapshot) const {
+    std::vector<size_t> lookups;
+    lookups.reserve(key_indexes.size());
+    for(size_t key_idx : key_indexes) {
+        if(keys[key_idx] >= this -> first_index && keys[key_idx] <= this -> last_index) {
+            lookups.push_back(key_idx);
+        }
+    }
+
+    if(lookups.empty()) {
+        return;
+    }
+
+    std::vector<std::string> lookup_keys;
+    lookup_keys.reserve(lookups.size());
+    for(size_t key_idx : lookups) {
+        lookup_keys.push_back(keys[key_idx].get_string());
+    }
+
+    SS_Table_Fd index_fd(this -> index_file, SS_TABLE_FAILED_TO_OPEN_INDEX_FILE_MSG);
+    SS_Table_Fd index_offset_fd(this -> index_offset_file, SS_TABLE_FAILED_TO_OPEN_INDEX_OFFSET_FILE_MSG);
+    SS_Table_Fd data_fd(this -> data_file, SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG);
+
+    size_t lookup_count = lookups.size();
+    std::vector<uint64_t> search_left(lookup_count, 0);
+    std::vector<uint64_t> search_right(lookup_count, this -> record_count);
+    std::vector<uint64_t> key_offsets(lookup_count, 0);
+    std::vector<std::string> index_records(lookup_count);
+    std::vector<size_t> active;
+    std::vector<Async_Read_Request> requests;
+
+    // reads the key offset of record_index[i] for every lookup in active
+    auto read_key_offsets = [&](const std::vector<uint64_t>& record_index) {
+        requests.clear();
+        for(size_t i : active) {
+            requests.push_back(Async_Read_Request{index_offset_fd.fd, record_index[i] * sizeof(uint64_t), sizeof(uint64_t), reinterpret_cast<char*>(&key_offsets[i]), 0});
+        }
+        reader.read_batch(requests);
+
+        for(const Async_Read_Request& request : requests) {
+            if(request.result != sizeof(uint64_t)) {
+                throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_OFFSET_EOF_MSG, this -> index_offset_file.generic_string().c_str());
+            }
+        }
+    };
+
+    // reads [key_len][key][data_offset] at the key offset of every lookup in active
+    // a record key longer than the searched one is cut, the part read is enough to order them
+    auto read_index_records = [&]() {
+        requests.clear();
+        for(size_t i : active) {
+            std::string& record = index_records[i];
+            record.assign(sizeof(key_len_type) + lookup_keys[i].size() + sizeof(uint64_t), '\0');
+            requests.push_back(Async_Read_Request{index_fd.fd, key_offsets[i], static_cast<uint32_t>(record.size()), &record[0], 0});
+        }
+        reader.read_batch(requests);
+
+        for(size_t r = 0; r < requests.size(); ++r) {
+            std::string& record = index_records[active[r]];
+            if(requests[r].result < static_cast<int64_t>(sizeof(key_len_type))) {
+                throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> index_file.generic_string().c_str());
+            }
+            record.resize(requests[r].result);
+        }
+    };
+
+    // compares the key of a record read by read_index_records with the searched key, like std::string::compare
+    auto compare_record_key = [&](size_t i) -> int {
+        const std::string& record = index_records[i];
+        const std::string& key = lookup_keys[i];
+
+        key_len_type record_key_len = 0;
+        memcpy(&record_key_len, &record[0], sizeof(record_key_len));
+
+        size_t common = std::min<size_t>(record_key_len, key.size());
+        if(record.size() < sizeof(key_len_type) + common) {
+            throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> index_file.generic_string().c_str());
+        }
+
+        int cmp = record.compare(sizeof(key_len_type), common, key, 0, common);
+        if(cmp != 0) {
+            return cmp;
+        }
+
+        return record_key_len < key.size() ? -1 : (record_key_len > key.size() ? 1 : 0);
+    };
+
+    // first record >= key for every key, one step of every search per round
+    std::vector<uint64_t> search_middle(lookup_count, 0);
+    for(;;) {
+        active.clear();
+        for(size_t i = 0; i < lookup_count; ++i) {
+            if(search_left[i] < search_right[i]) {
+                search_middle[i] = (search_left[i] + search_right[i]) / 2;
+                active.push_back(i);
+            }
+        }
+
+        if(active.empty()) {
+            break;
+        }
+
+        read_key_offsets(search_middle);
+        read_index_records();
+
+        for(size_t i : active) {
+            if(compare_record_key(i) < 0) {
+                search_left[i] = search_middle[i] + 1;
+            }
+            else {
+                search_right[i] = search_middle[i];
+            }
+        }
+    }
+
+    // versions are stored newest first, read the newest one of every key that is present
+    active.clear();
+    for(size_t i = 0; i < lookup_count; ++i) {
+        if(search_left[i] < this -> record_count) {
+            active.push_back(i);
+        }
+    }
+
+    if(active.empty()) {
+        return;
+    }
+
+    read_key_offsets(search_left);
+    read_index_records();
+
+    std::vector<size_t> present;
+    std::vector<uint64_t> data_offsets(lookup_count, 0);
+    for(size_t i : active) {
+        const std::string& key = lookup_keys[i];
+        if(compare_record_key(i) != 0) {
+            continue;
+        }
+
+        if(index_records[i].size() < sizeof(key_len_type) + key.size() + sizeof(uint64_t)) {
+            throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> index_file.generic_string().c_str());
+        }
+
+        memcpy(&data_offsets[i], &index_records[i][sizeof(key_len_type) + key.size()], sizeof(uint64_t));
+        present.push_back(i);
+    }
+
+    // [data_len][data], most records fit in the first read
+    std::vector<std::string> data_records(lookup_count);
+    requests.clear();
+    for(size_t i : present) {
+        data_records[i].assign(SS_TABLE_ASYNC_DATA_READ_SIZE, '\0');
+        requests.push_back(Async_Read_Request{data_fd.fd, data_offsets[i], SS_TABLE_ASYNC_DATA_READ_SIZE, &data_records[i][0], 0});
+    }
+    reader.read_batch(requests);
+
+    std::vector<size_t> partial;
+    for(size_t r = 0; r < requests.size(); ++r) {
+        size_t i = present[r];
+        if(requests[r].result < static_cast<int64_t>(sizeof(uint64_t))) {
+            throw File_Exception(SS_TABLE_UNEXPECTED_DATA_EOF_MSG, this -> data_file.generic_string().c_str());
+        }
+
+        uint64_t data_len = 0;
+        memcpy(&data_len, &data_records[i][0], sizeof(data_len));
+
+        uint64_t bytes_read = requests[r].result - sizeof(uint64_t);
+        data_records[i].erase(0, sizeof(uint64_t));
+        if(bytes_read >= data_len) {
+            data_records[i].resize(data_len);
+        }
+        else {
+            data_records[i].resize(bytes_read);
+            data_records[i].resize(data_len, '\0');
+            partial.push_back(i);
         }
+    }
 
+    if(!partial.empty()) {
+        requests.clear();
+        for(size_t i : partial) {
+            uint64_t bytes_read = SS_TABLE_ASYNC_DATA_READ_SIZE - sizeof(uint64_t);
+            requests.push_back(Async_Read_Request{data_fd.fd, data_offsets[i] + SS_TABLE_ASYNC_DATA_READ_SIZE, static_cast<uint32_t>(data_records[i].size() - bytes_read), &data_records[i][bytes_read], 0});
+        }
+        reader.read_batch(requests);
 
+        for(const Async_Read_Request& request : requests) {
+            if(request.result != static_cast<int64_t>(request.length)) {
+                throw File_Exception(SS_TABLE_UNEXPECTED_DATA_EOF_MSG, this -> data_file.generic_string().c_str());
+            }
+        }
+    }
+
+    std::ifstream index_in;
+    std::ifstream index_offset_in;
+    std::ifstream data_in;
+    for(size_t i : present) {
+        size_t key_idx = lookups[i];
+        Entry entry(lookup_keys[i], data_records[i]);
+
+        // the newest version is too new for the snapshot, walk the older ones the usual way
+        if(entry.get_sequence_number() > snapshot) {
+            if(!index_in.is_open()) {
+                index_in.open(this -> index_file, std::ios::binary);
+                index_offset_in.open(this -> index_offset_file, std::ios::binary);
+                if(!index_in || !index_offset_in) {
+                    throw File_Exception(SS_TABLE_FAILED_TO_OPEN_INDEX_FILE_MSG, this -> index_file.generic_string().c_str());
+                }
+            }
+
+            bool key_found = false;
+            entry = this -> read_visible_version(index_in, index_offset_in, data_in, keys[key_idx], search_left[i] + 1, key_found, snapshot);
+            if(!key_found) {
+                continue;
+            }
+        }
+
+        entries[key_idx] = std::move(entry);
+        found[key_idx] = true;
+    }
+}
+
+Entry SS_Table::read_visible_version(std::ifstream& index_in, std::ifstream& index_offset_in, std::ifstream& data_in, const Bits& key, uint64_t key_index, bool& found, sequence_number_type snapshot) const {
+    found = false;
+
+    index_offset_in.clear();
+    index_offset_in.seekg(key_index * sizeof(uint64_t), index_offset_in.beg);
+    if(index_offset_in.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_OFFSET_EOF_MSG, this -> index_offset_file.generic_string().c_str());
+    }
+
+    uint64_t key_offset = 0;
+    uint64_t data_offset = 0;
+    key_len_type key_length = 0;
+    std::string key_str;
+
+    for(; key_index < this -> record_count; ++key_index) {
         // read the keys offset
         index_offset_in.read(reinterpret_cast<char*>(&key_offset), sizeof(key_offset));
         if(index_offset_in.fail()) {
@@ -99,69 +423,63 @@ Entry SS_Table::get(const Bits& key, bool& found) const {
             throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> index_file.generic_string().c_str());
         }
 
-        // compare the key
-        int8_t compare = key.compare_to_str(key_str);
-
-        // std::cout << "Comparing: " << key_string << " and " << key.get_string() << " Compare value: " << int(compare) << std::endl;
-
-        // match found
-        if(compare == 0) {
-            index_in.read(reinterpret_cast<char*>(&data_offset), sizeof(data_offset));
-            if(index_in.fail()) {
-                throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> index_file.generic_string().c_str());
-            }
-
-            found = true;
+        // ran past the last version of the key
+        if(key.compare_to_str(key_str) != 0) {
             break;
         }
 
-        // Key is bigger
-        if(compare > 0) {
-            if(binary_search_index > this -> record_count) {
-                found = false;
-                break;
-            }
-
-            binary_search_left = binary_search_index + 1;
+        index_in.read(reinterpret_cast<char*>(&data_offset), sizeof(data_offset));
+        if(index_in.fail()) {
+            throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> index_file.generic_string().c_str());
         }
 
-        // Key is smaller
-        if(compare < 0) {
-            if(binary_search_index == 0) {
-                found = false;
-                break;
-            }
+        std::string data_str = this -> read_stream_at_offset(data_in, data_offset);
+        Entry entry(key_str, data_str);
 
-            binary_search_right = binary_search_index - 1;
+        if(entry.get_sequence_number() <= snapshot) {
+            found = true;
+            return entry;
         }
     }
 
     // if not found make a place holder found = false and return
-    if(!found) {
-        Bits key(ENTRY_PLACEHOLDER_KEY);
-        Bits value(ENTRY_PLACEHOLDER_VALUE);
-        Entry entry(key, value);
-        entry.set_tombstone(ENTRY_TOMBSTONE_ON);
-        return entry;
+    Bits placeholder_key(ENTRY_PLACEHOLDER_KEY);
+    Bits placeholder_value(ENTRY_PLACEHOLDER_VALUE);
+    Entry entry(placeholder_key, placeholder_value);
+    entry.set_tombstone(ENTRY_TOMBSTONE_ON);
+    return entry;
+}
+
+bool SS_Table::is_visible_version(const Entry& entry, const std::string& key, sequence_number_type snapshot, std::string& previous_visible_key) {
+    if(entry.get_sequence_number() > snapshot) {
+        return false;
     }
 
-    // read the value
-    std::string data_str = this -> read_stream_at_offset(data_offset);
+    if(previous_visible_key == key) {
+        return false;
+    }
 
-    // construct an entry and return AAAAAAAAA
-    return Entry(key_str, data_str);
+    previous_visible_key = key;
+    return true;
 }
 
 // needs a more complicated constructor --> or a reconstruct ss_table method
-SS_Table::SS_Table(const std::filesystem::path& _data_file, const std::filesystem::path& _index_file, std::filesystem::path& _index_offset_file)
-    : data_file(_data_file), index_file(_index_file), index_offset_file(_index_offset_file), first_index(ENTRY_PLACEHOLDER_KEY), last_index((ENTRY_PLACEHOLDER_KEY)), record_count(0), data_file_size(0), index_file_size(0), index_offset_file_size(0) {
+SS_Table::SS_Table(const std::filesystem::path& _data_file, const std::filesystem::path& _index_file, std::filesystem::path& _index_offset_file, const std::filesystem::path& _prefix_filter_file, level_index_type _level, uint64_t _table_id)
+    : data_file(_data_file), index_file(_index_file), index_offset_file(_index_offset_file), prefix_filter_file(_prefix_filter_file), level(_level), table_id(_table_id), first_index(ENTRY_PLACEHOLDER_KEY), last_index((ENTRY_PLACEHOLDER_KEY)), record_count(0), data_file_size(0), index_file_size(0), index_offset_file_size(0), min_expiry_time(SS_TABLE_NEVER_EXPIRES), max_expiry_time(SS_TABLE_NEVER_EXPIRES), last_scrub_time(SS_TABLE_NEVER_SCRUBBED), obsolete(false), prefix_filter_bits_per_key(BLOOM_FILTER_DEFAULT_BITS_PER_KEY), has_prefix_filter(false), prefix_filter_deferred(false) {
 
     };
 
 SS_Table:: ~SS_Table(){
-    // remove(this -> data_file);
-    // remove(this -> index_file);
-    // remove(this -> index_offset_file);
+    if(!this -> obsolete.load()){
+        return;
+    }
+
+    // a file that can not be removed is no longer in the manifest, the next startup removes it as an orphan
+    std::error_code error_code;
+    std::filesystem::remove(this -> data_file, error_code);
+    std::filesystem::remove(this -> index_file, error_code);
+    std::filesystem::remove(this -> index_offset_file, error_code);
+    std::filesystem::remove(this -> prefix_filter_file, error_code);
 };
 
 std::filesystem::path SS_Table::data_path() const {
@@ -176,6 +494,10 @@ std::filesystem::path SS_Table::offset_path() const {
     return this -> index_offset_file;
 }
 
+std::filesystem::path SS_Table::prefix_filter_path() const {
+    return this -> prefix_filter_file;
+}
+
 Bits SS_Table::get_last_index() const {
 	return this -> last_index;
 }
@@ -211,10 +533,16 @@ uint64_t SS_Table::fill_ss_table(const std::vector<Entry>& entry_vector) {
 	uint64_t data_offset = 0;
     uint64_t key_offset = 0;
 
+    this -> min_expiry_time = SS_TABLE_NEVER_EXPIRES;
+    this -> max_expiry_time = 0;
+
 	for(const Entry& entry : entry_vector) {
         std::string key_in = entry.get_string_key_bytes();
         std::string data_in = entry.get_string_data_bytes();
 
+        this -> add_key_to_prefix_filter(key_in);
+        this -> add_expiry_time(entry.get_expiry_time());
+
         key_len_type key_len = key_in.size();
         uint64_t data_len = data_in.size();
 
@@ -257,6 +585,9 @@ uint64_t SS_Table::fill_ss_table(const std::vector<Entry>& entry_vector) {
     this -> data_file_size = data_offset;
     this -> index_file_size = key_offset;
     this -> record_count = entry_vector.size();
+    this -> index_offset_file_size = this -> record_count * SS_TABLE_KEY_OFFSET_RECORD_SIZE;
+
+    this -> write_prefix_filter();
     
     return record_count;
 }
@@ -266,6 +597,13 @@ uint64_t SS_Table::append(const std::vector<Entry>& entry_vector) {
         return 0;
     }
 
+    // the filter does not know about the appended keys, without it the table is simply never skipped
+    if(this -> has_prefix_filter || this -> prefix_filter_deferred) {
+        this -> has_prefix_filter = false;
+        this -> prefix_filter_deferred = false;
+        std::filesystem::remove(this -> prefix_filter_file);
+    }
+
     if(this -> first_index == Bits(ENTRY_PLACEHOLDER_KEY)) {
         this -> first_index = entry_vector.front().get_key();
     }
@@ -295,6 +633,8 @@ uint64_t SS_Table::append(const std::vector<Entry>& entry_vector) {
         std::string key_in = entry.get_string_key_bytes();
         std::string data_in = entry.get_string_data_bytes();
 
+        this -> add_expiry_time(entry.get_expiry_time());
+
         key_len_type key_len = key_in.size();
         uint64_t data_len = data_in.size();
 
@@ -337,11 +677,12 @@ uint64_t SS_Table::append(const std::vector<Entry>& entry_vector) {
     this -> data_file_size = data_offset;
     this -> index_file_size = key_offset;
     this -> record_count += entry_vector.size();
+    this -> index_offset_file_size = this -> record_count * SS_TABLE_KEY_OFFSET_RECORD_SIZE;
 
     return entry_vector.size();
 }
 
-SS_Table::Keynator::Keynator(const std::filesystem::path& index_file, const std::filesystem::path& index_offset_file, const std::filesystem::path& data_file, uint64_t record_count) : index_stream(index_file, std::ios::binary), index_offset_stream(index_offset_file, std::ios::binary), data_file(data_file), current_data_offset(0), records_read(0), record_count(record_count) {
+SS_Table::Keynator::Keynator(const std::filesystem::path& index_file, const std::filesystem::path& index_offset_file, const std::filesystem::path& data_file, uint64_t record_count, File_Io_Mode io_mode) : index_stream(index_file, std::ios::binary), index_offset_stream(index_offset_file, std::ios::binary), data_stream(data_file, std::ios::binary), index_file(index_file), index_offset_file(index_offset_file), data_file(data_file), io_mode(io_mode), current_data_offset(0), records_read(0), record_count(record_count), data_stream_offset(0), dropped_data_offset(0) {
     if(index_stream.fail()) {
         throw std::runtime_error(SS_TABLE_KEYNATOR_FAILED_OPEN_INDEX_FILE_ERR_MSG);
     }
@@ -349,18 +690,59 @@ SS_Table::Keynator::Keynator(const std::filesystem::path& index_file, const std:
     if(index_offset_stream.fail()) {
         throw std::runtime_error(SS_TABLE_KEYNATOR_FAILED_OPEN_INDEX_OFFSET_FILE_ERR_MSG);
     }
+
+    if(data_stream.fail()) {
+        throw std::runtime_error(SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG);
+    }
 }
 
 SS_Table::Keynator::~Keynator() {
 
 }
 
+void SS_Table::Keynator::drop_read_pages(uint64_t data_length) {
+    // the index files are read in the same order as the data file, a fraction of it has been read from them as well
+    uint64_t index_length = 0;
+    uint64_t index_offset_length = 0;
+    if(data_length > 0) {
+        index_offset_length = this -> records_read * SS_TABLE_KEY_OFFSET_RECORD_SIZE;
+        index_length = this -> index_stream.tellg();
+    }
+
+    for(const std::pair<const std::filesystem::path*, uint64_t>& file : {std::make_pair(&this -> data_file, data_length), std::make_pair(&this -> index_file, index_length), std::make_pair(&this -> index_offset_file, index_offset_length)}) {
+        // nothing was read from this one yet
+        if(data_length > 0 && file.second == 0) {
+            continue;
+        }
+
+        // only a hint, failing to give it is not an error
+        int fd = ::open(file.first -> c_str(), O_RDONLY);
+        if(fd < 0) {
+            continue;
+        }
+
+        ::posix_fadvise(fd, 0, file.second, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+}
+
 Bits SS_Table::Keynator::get_next_key() {
     // probably complete unnecesarry
     if(this -> records_read >= this -> record_count) {
+        // the whole table went by, none of it is needed any more
+        if(this -> io_mode != FILE_IO_BUFFERED && this -> dropped_data_offset != UINT64_MAX) {
+            this -> drop_read_pages(0);
+            this -> dropped_data_offset = UINT64_MAX;
+        }
+
         return Bits(ENTRY_PLACEHOLDER_KEY);
     }
 
+    if(this -> io_mode != FILE_IO_BUFFERED && this -> current_data_offset - this -> dropped_data_offset >= SS_TABLE_KEYNATOR_DROP_BEHIND_SIZE) {
+        this -> drop_read_pages(this -> current_data_offset);
+        this -> dropped_data_offset = this -> current_data_offset;
+    }
+
     uint64_t current_key_offset = 0;
 
     index_offset_stream.read(reinterpret_cast<char*>(&current_key_offset), sizeof(current_key_offset));
@@ -395,14 +777,12 @@ Bits SS_Table::Keynator::get_next_key() {
 }
 
 std::string SS_Table::Keynator::get_current_data_string() {
-    std::ifstream data_stream(this -> data_file, std::ios::binary);
-    if(data_stream.fail()) {
-        throw std::runtime_error(SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG);
-    }
-
-    data_stream.seekg(this -> current_data_offset, data_stream.beg);
-    if(data_stream.fail()) {
-        throw std::runtime_error(SS_TABLE_UNEXPECTED_DATA_EOF_MSG);
+    // versions are read in file order, most of the time the stream is already in place
+    if(this -> data_stream_offset != this -> current_data_offset) {
+        data_stream.seekg(this -> current_data_offset, data_stream.beg);
+        if(data_stream.fail()) {
+            throw std::runtime_error(SS_TABLE_UNEXPECTED_DATA_EOF_MSG);
+        }
     }
 
     uint64_t data_string_length = 0;
@@ -417,73 +797,275 @@ std::string SS_Table::Keynator::get_current_data_string() {
         throw std::runtime_error(SS_TABLE_UNEXPECTED_DATA_EOF_MSG);
     }
 
+    this -> data_stream_offset = this -> current_data_offset + sizeof(data_string_length) + data_string_length;
+
     return data_string;
 }
 
-SS_Table::Keynator SS_Table::get_keynator() const {
-    return Keynator(this -> index_file, this -> index_offset_file, this -> data_file, this -> record_count);
+SS_Table::Keynator SS_Table::get_keynator(File_Io_Mode io_mode) const {
+    return Keynator(this -> index_file, this -> index_offset_file, this -> data_file, this -> record_count, io_mode);
 }
 
-int8_t SS_Table::init_writing() {
-    this -> data_ofstream.open(this -> data_file, std::ios::binary);
-    if(this -> data_ofstream.fail()) {
-        throw File_Exception(SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG, this -> data_file.generic_string().c_str());
+SS_Table::Iterator SS_Table::get_iterator(sequence_number_type snapshot) const {
+    return Iterator(this, snapshot);
+}
+
+SS_Table::Iterator::Iterator(const SS_Table* _ss_table, sequence_number_type _snapshot) : ss_table(_ss_table), snapshot(_snapshot), direction(ITERATOR_FORWARD), position(0), is_valid(false), current_entry(Bits(ENTRY_PLACEHOLDER_KEY), Bits(ENTRY_PLACEHOLDER_VALUE)) {
+
+}
+
+void SS_Table::Iterator::open_streams() {
+    if(!this -> index_stream.is_open()) {
+        this -> index_stream.open(this -> ss_table -> index_file, std::ios::binary);
+        if(this -> index_stream.fail()) {
+            throw File_Exception(SS_TABLE_FAILED_TO_OPEN_INDEX_FILE_MSG, this -> ss_table -> index_file.generic_string().c_str());
+        }
     }
 
-    this -> index_ofstream.open(this -> index_file, std::ios::binary);
-    if(this -> index_ofstream.fail()) {
-        throw File_Exception(SS_TABLE_FAILED_TO_OPEN_INDEX_FILE_MSG, this -> index_file.generic_string().c_str());
+    if(!this -> index_offset_stream.is_open()) {
+        this -> index_offset_stream.open(this -> ss_table -> index_offset_file, std::ios::binary);
+        if(this -> index_offset_stream.fail()) {
+            throw File_Exception(SS_TABLE_FAILED_TO_OPEN_INDEX_OFFSET_FILE_MSG, this -> ss_table -> index_offset_file.generic_string().c_str());
+        }
     }
 
-    this -> index_offset_ofstream.open(this -> index_offset_file, std::ios::binary);
-    if(this ->index_offset_ofstream.fail()) {
-        throw File_Exception(SS_TABLE_FAILED_TO_OPEN_INDEX_OFFSET_FILE_MSG, this -> index_offset_file.generic_string().c_str());
+    if(!this -> data_stream.is_open()) {
+        this -> data_stream.open(this -> ss_table -> data_file, std::ios::binary);
+        if(this -> data_stream.fail()) {
+            throw File_Exception(SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG, this -> ss_table -> data_file.generic_string().c_str());
+        }
     }
+}
 
-    return 0;
+std::string SS_Table::Iterator::read_key(uint64_t record_index, uint64_t& data_offset) {
+    this -> index_offset_stream.seekg(record_index * SS_TABLE_KEY_OFFSET_RECORD_SIZE, this -> index_offset_stream.beg);
+    if(this -> index_offset_stream.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_OFFSET_EOF_MSG, this -> ss_table -> index_offset_file.generic_string().c_str());
+    }
+
+    uint64_t key_offset = 0;
+    this -> index_offset_stream.read(reinterpret_cast<char*>(&key_offset), sizeof(key_offset));
+    if(this -> index_offset_stream.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_OFFSET_EOF_MSG, this -> ss_table -> index_offset_file.generic_string().c_str());
+    }
+
+    this -> index_stream.seekg(key_offset, this -> index_stream.beg);
+    if(this -> index_stream.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> ss_table -> index_file.generic_string().c_str());
+    }
+
+    key_len_type key_length = 0;
+    this -> index_stream.read(reinterpret_cast<char*>(&key_length), sizeof(key_length));
+    if(this -> index_stream.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> ss_table -> index_file.generic_string().c_str());
+    }
+
+    std::string key_str(key_length, '\0');
+    this -> index_stream.read(&key_str[0], key_length);
+    if(this -> index_stream.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> ss_table -> index_file.generic_string().c_str());
+    }
+
+    this -> index_stream.read(reinterpret_cast<char*>(&data_offset), sizeof(data_offset));
+    if(this -> index_stream.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_INDEX_EOF_MSG, this -> ss_table -> index_file.generic_string().c_str());
+    }
+
+    return key_str;
 }
 
-int8_t SS_Table::write(const Bits& key, const std::string& data_string) {
-    if(this -> first_index == Bits(ENTRY_PLACEHOLDER_KEY)) {
-        this -> first_index = key;
+std::string SS_Table::Iterator::read_data(uint64_t data_offset) {
+    this -> data_stream.seekg(data_offset, this -> data_stream.beg);
+    if(this -> data_stream.fail()) {
+        throw File_Exception(SS_TABLE_BAD_OFFSET_ERR_MSG, this -> ss_table -> data_file.generic_string().c_str());
     }
 
-    uint64_t data_offset = this -> data_ofstream.tellp();
-    uint64_t key_offset = this -> index_ofstream.tellp();
-    uint64_t data_length = data_string.length();
-    std::string key_string = key.get_string();
-    key_len_type key_length = key.size();
+    uint64_t data_length = 0;
+    this -> data_stream.read(reinterpret_cast<char*>(&data_length), sizeof(data_length));
+    if(this -> data_stream.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_DATA_EOF_MSG, this -> ss_table -> data_file.generic_string().c_str());
+    }
 
-    index_offset_ofstream.write(reinterpret_cast<char*>(&key_offset), sizeof(key_offset));
-    if(index_offset_ofstream.fail()) {
-        throw File_Exception(SS_TABLE_FAILED_INDEX_OFFSET_WRITE_ERR_MSG, this -> index_offset_file.generic_string().c_str());
+    std::string data_str(data_length, '\0');
+    this -> data_stream.read(&data_str[0], data_length);
+    if(this -> data_stream.fail()) {
+        throw File_Exception(SS_TABLE_UNEXPECTED_DATA_EOF_MSG, this -> ss_table -> data_file.generic_string().c_str());
     }
 
-    index_ofstream.write(reinterpret_cast<char*>(&key_length), sizeof(key_length));
-    if(index_ofstream.fail()) {
-        throw File_Exception(SS_TABLE_FAILED_INDEX_WRITE_ERR_MSG, this -> index_file.generic_string().c_str());
+    return data_str;
+}
+
+bool SS_Table::Iterator::read_group(uint64_t group_start, uint64_t& group_end) {
+    uint64_t data_offset = 0;
+    std::string key_str = this -> read_key(group_start, data_offset);
+    bool found = false;
+
+    // versions are stored newest first, once a visible one was read only the keys of the rest are needed
+    uint64_t record_index = group_start;
+    while(true) {
+        if(!found) {
+            std::string data_str = this -> read_data(data_offset);
+            Entry entry(key_str, data_str);
+            if(entry.get_sequence_number() <= this -> snapshot) {
+                this -> current_entry = entry;
+                found = true;
+            }
+        }
+
+        ++record_index;
+        if(record_index >= this -> ss_table -> record_count) {
+            break;
+        }
+
+        if(this -> read_key(record_index, data_offset) != key_str) {
+            break;
+        }
     }
 
-    index_ofstream.write(&key_string[0], key_length);
-    if(index_ofstream.fail()) {
-        throw File_Exception(SS_TABLE_FAILED_INDEX_WRITE_ERR_MSG, this -> index_file.generic_string().c_str());
+    group_end = record_index;
+    return found;
+}
+
+void SS_Table::Iterator::step_forward() {
+    while(this -> position < this -> ss_table -> record_count) {
+        uint64_t group_end = 0;
+        bool found = this -> read_group(this -> position, group_end);
+        this -> position = group_end;
+
+        if(found) {
+            this -> is_valid = true;
+            return;
+        }
     }
 
-    index_ofstream.write(reinterpret_cast<char*>(&data_offset), sizeof(data_offset));
-    if(index_ofstream.fail()) {
-        throw File_Exception(SS_TABLE_FAILED_INDEX_WRITE_ERR_MSG, this -> index_file.generic_string().c_str());
+    this -> is_valid = false;
+}
+
+void SS_Table::Iterator::step_backward() {
+    while(this -> position > 0) {
+        // walk back to the newest version of the key
+        uint64_t data_offset = 0;
+        uint64_t group_start = this -> position - 1;
+        std::string key_str = this -> read_key(group_start, data_offset);
+        while(group_start > 0 && this -> read_key(group_start - 1, data_offset) == key_str) {
+            --group_start;
+        }
+
+        uint64_t group_end = 0;
+        bool found = this -> read_group(group_start, group_end);
+        this -> position = group_start;
+
+        if(found) {
+            this -> is_valid = true;
+            return;
+        }
     }
 
-    data_ofstream.write(reinterpret_cast<char*>(&data_length), sizeof(data_length));
-    if(data_ofstream.fail()) {
-        throw File_Exception(SS_TABLE_FAILED_DATA_WRITE_ERR_MSG, this -> data_file.generic_string().c_str());
+    this -> is_valid = false;
+}
+
+void SS_Table::Iterator::seek(const Bits& target, Iterator_Direction _direction) {
+    this -> direction = _direction;
+    this -> is_valid = false;
+
+    if(this -> ss_table -> record_count == 0) {
+        return;
+    }
+
+    this -> open_streams();
+
+    if(this -> direction == ITERATOR_FORWARD) {
+        if(target <= this -> ss_table -> first_index) {
+            this -> position = 0;
+        }
+        else if(target > this -> ss_table -> last_index) {
+            this -> position = this -> ss_table -> record_count;
+        }
+        else {
+            this -> position = this -> ss_table -> binary_search_nearest(this -> index_stream, this -> index_offset_stream, target, SS_TABLE_LARGER_OR_EQUAL);
+        }
+
+        this -> step_forward();
+    }
+    else {
+        if(target >= this -> ss_table -> last_index) {
+            this -> position = this -> ss_table -> record_count;
+        }
+        else if(target < this -> ss_table -> first_index) {
+            this -> position = 0;
+        }
+        else {
+            // the search returns the first record past target
+            this -> position = this -> ss_table -> binary_search_nearest(this -> index_stream, this -> index_offset_stream, target, SS_TABLE_SMALLER_OR_EQUAL);
+        }
+
+        this -> step_backward();
     }
+}
 
-    data_ofstream.write(&data_string[0], data_length);
-    if(data_ofstream.fail()) {
+bool SS_Table::Iterator::valid() const {
+    return this -> is_valid;
+}
+
+void SS_Table::Iterator::next() {
+    if(!this -> is_valid) {
+        return;
+    }
+
+    if(this -> direction == ITERATOR_FORWARD) {
+        this -> step_forward();
+    }
+    else {
+        this -> step_backward();
+    }
+}
+
+const Entry& SS_Table::Iterator::entry() const {
+    return this -> current_entry;
+}
+
+int8_t SS_Table::init_writing(File_Io_Mode io_mode) {
+    this -> data_writer = std::make_unique<Buffered_File_Writer>(this -> data_file, io_mode);
+    this -> index_writer = std::make_unique<Buffered_File_Writer>(this -> index_file, io_mode);
+    this -> index_offset_writer = std::make_unique<Buffered_File_Writer>(this -> index_offset_file, io_mode);
+
+    return 0;
+}
+
+int8_t SS_Table::write(const Bits& key, const std::string& data_string) {
+    if(!this -> data_writer || !this -> index_writer || !this -> index_offset_writer) {
         throw File_Exception(SS_TABLE_FAILED_DATA_WRITE_ERR_MSG, this -> data_file.generic_string().c_str());
     }
 
+    if(this -> first_index == Bits(ENTRY_PLACEHOLDER_KEY)) {
+        this -> first_index = key;
+    }
+
+    if(this -> record_count == 0) {
+        this -> min_expiry_time = SS_TABLE_NEVER_EXPIRES;
+        this -> max_expiry_time = 0;
+    }
+
+    uint64_t data_offset = this -> data_writer -> position();
+    uint64_t key_offset = this -> index_writer -> position();
+    uint64_t data_length = data_string.length();
+    std::string key_string = key.get_string();
+    key_len_type key_length = key.size();
+
+    // [u16 key_len][key][u64 data_offset] goes out in one piece
+    std::string index_record(sizeof(key_length) + key_length + sizeof(data_offset), '\0');
+    std::memcpy(&index_record[0], &key_length, sizeof(key_length));
+    std::memcpy(&index_record[sizeof(key_length)], key_string.data(), key_length);
+    std::memcpy(&index_record[sizeof(key_length) + key_length], &data_offset, sizeof(data_offset));
+
+    this -> index_offset_writer -> append(reinterpret_cast<const char*>(&key_offset), sizeof(key_offset));
+    this -> index_writer -> append(index_record.data(), index_record.size());
+    this -> data_writer -> append(reinterpret_cast<const char*>(&data_length), sizeof(data_length));
+    this -> data_writer -> append(data_string.data(), data_length);
+
+    this -> add_key_to_prefix_filter(key_string);
+    this -> add_expiry_time(Entry::read_expiry_time(data_string));
+
     ++this -> record_count;
     this -> last_index = key;
     return 0;
@@ -492,38 +1074,246 @@ int8_t SS_Table::write(const Bits& key, const std::string& data_string) {
 int8_t SS_Table::stop_writing() {
     int8_t ret_value = 0;
 
-    this -> data_ofstream.close();
-    if(data_ofstream.is_open()) {
+    if(!this -> data_writer || !this -> index_writer || !this -> index_offset_writer) {
+        return DATA_CLOSE_FAILED | INDEX_CLOSE_FAILED | INDEX_OFFSET_CLOSE_FAILED;
+    }
+
+    this -> data_file_size = this -> data_writer -> position();
+    this -> index_file_size = this -> index_writer -> position();
+    this -> index_offset_file_size = this -> index_offset_writer -> position();
+
+    if(!this -> data_writer -> close()) {
         ret_value |= DATA_CLOSE_FAILED;
     }
 
-    this -> index_ofstream.close();
-    if(index_ofstream.is_open()) {
+    if(!this -> index_writer -> close()) {
         ret_value |= INDEX_CLOSE_FAILED;
     }
 
-    this -> index_offset_ofstream.close();
-    if(index_offset_ofstream.is_open()) {
-        ret_value |= INDEX_CLOSE_FAILED;
+    if(!this -> index_offset_writer -> close()) {
+        ret_value |= INDEX_OFFSET_CLOSE_FAILED;
+    }
+
+    this -> data_writer.reset();
+    this -> index_writer.reset();
+    this -> index_offset_writer.reset();
+
+    if(ret_value == 0) {
+        this -> write_prefix_filter();
     }
 
     return ret_value;
 }
 
-bool SS_Table::overlap(const Bits& first_index, const Bits& last_index) const {
-    return !(last_index < this -> first_index || first_index > this -> last_index);
+void SS_Table::set_prefix_extractor(const Prefix_Extractor& extractor, uint32_t bits_per_key) {
+    this -> prefix_extractor = extractor;
+    this -> prefix_filter_bits_per_key = bits_per_key;
+}
+
+void SS_Table::add_key_to_prefix_filter(const std::string& key) {
+    if(!this -> prefix_extractor.enabled()) {
+        return;
+    }
+
+    std::string prefix;
+    if(!this -> prefix_extractor.extract(key, prefix) || (!this -> prefix_hashes.empty() && prefix == this -> last_prefix)) {
+        return;
+    }
+
+    this -> prefix_hashes.push_back(Bloom_Filter::hash_key(prefix));
+    this -> last_prefix = prefix;
+}
+
+void SS_Table::write_prefix_filter() {
+    if(!this -> prefix_extractor.enabled()) {
+        return;
+    }
+
+    this -> prefix_filter = Bloom_Filter::build(this -> prefix_hashes, this -> prefix_filter_bits_per_key);
+    this -> prefix_hashes.clear();
+    this -> prefix_hashes.shrink_to_fit();
+    this -> last_prefix.clear();
+
+    std::string extractor_name = this -> prefix_extractor.name();
+    key_len_type name_length = extractor_name.size();
+
+    std::string payload(reinterpret_cast<const char*>(&name_length), sizeof(name_length));
+    payload.append(extractor_name);
+    payload.append(this -> prefix_filter.encode());
+
+    uint32_t checksum = crc32(payload);
+
+    std::ofstream filter_out(this -> prefix_filter_file, std::ios::binary | std::ios::trunc);
+    filter_out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    filter_out.write(payload.data(), payload.size());
+    filter_out.close();
+
+    if(filter_out.fail()) {
+        throw File_Exception(SS_TABLE_FAILED_PREFIX_FILTER_WRITE_ERR_MSG, this -> prefix_filter_file.generic_string().c_str());
+    }
+
+    this -> has_prefix_filter = true;
+}
+
+bool SS_Table::load_prefix_filter() {
+    this -> prefix_filter_deferred = false;
+    return this -> read_prefix_filter();
+}
+
+void SS_Table::defer_prefix_filter() {
+    this -> prefix_filter_deferred = true;
+}
+
+bool SS_Table::read_prefix_filter() const {
+    this -> has_prefix_filter = false;
+
+    std::ifstream filter_in(this -> prefix_filter_file, std::ios::binary);
+    if(!filter_in) {
+        return false;
+    }
+
+    uint32_t checksum = 0;
+    filter_in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+    std::string payload((std::istreambuf_iterator<char>(filter_in)), std::istreambuf_iterator<char>());
+    if(filter_in.bad() || payload.size() < sizeof(key_len_type) || crc32(payload) != checksum) {
+        return false;
+    }
+
+    key_len_type name_length = 0;
+    std::memcpy(&name_length, payload.data(), sizeof(name_length));
+    if(payload.size() < sizeof(name_length) + name_length) {
+        return false;
+    }
+
+    Prefix_Extractor extractor = Prefix_Extractor::from_name(payload.substr(sizeof(name_length), name_length));
+    if(!extractor.enabled() || !this -> prefix_filter.decode(payload.substr(sizeof(name_length) + name_length))) {
+        return false;
+    }
+
+    this -> prefix_extractor = extractor;
+    this -> has_prefix_filter = true;
+    return true;
+}
+
+bool SS_Table::may_contain_prefix(const std::string& prefix) const {
+    if(this -> prefix_filter_deferred) {
+        std::call_once(this -> prefix_filter_once, [this]() {
+            this -> read_prefix_filter();
+        });
+    }
+
+    if(!this -> has_prefix_filter) {
+        return true;
+    }
+
+    std::string extracted;
+    if(!this -> prefix_extractor.extract(prefix, extracted)) {
+        return true;
+    }
+
+    return this -> prefix_filter.may_contain(extracted);
+}
+
+void SS_Table::add_expiry_time(uint64_t expiry_time) {
+    uint64_t bound = expiry_time == ENTRY_NO_EXPIRY? SS_TABLE_NEVER_EXPIRES : expiry_time;
+    this -> min_expiry_time = std::min(this -> min_expiry_time, bound);
+    this -> max_expiry_time = std::max(this -> max_expiry_time, bound);
+}
+
+void SS_Table::restore_metadata(const Bits& _first_index, const Bits& _last_index, uint64_t _record_count, uint64_t _data_file_size, uint64_t _index_file_size, uint64_t _index_offset_file_size, uint64_t _min_expiry_time, uint64_t _max_expiry_time) {
+    this -> first_index = _first_index;
+    this -> last_index = _last_index;
+    this -> record_count = _record_count;
+    this -> data_file_size = _data_file_size;
+    this -> index_file_size = _index_file_size;
+    this -> index_offset_file_size = _index_offset_file_size;
+    this -> min_expiry_time = _min_expiry_time;
+    this -> max_expiry_time = _max_expiry_time;
+}
+
+void SS_Table::sync_files() const {
+    std::vector<std::filesystem::path> files = {this -> data_file, this -> index_file, this -> index_offset_file};
+    if(this -> has_prefix_filter) {
+        files.push_back(this -> prefix_filter_file);
+    }
+
+    for(const std::filesystem::path& file : files) {
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if(fd < 0) {
+            throw File_Exception(SS_TABLE_FAILED_SYNC_ERR_MSG, file.generic_string().c_str());
+        }
+
+        if(::fdatasync(fd) != 0) {
+            ::close(fd);
+            throw File_Exception(SS_TABLE_FAILED_SYNC_ERR_MSG, file.generic_string().c_str());
+        }
+        ::close(fd);
+    }
+}
+
+level_index_type SS_Table::get_level() const {
+    return this -> level;
+}
+
+uint64_t SS_Table::get_table_id() const {
+    return this -> table_id;
+}
+
+uint64_t SS_Table::get_record_count() const {
+    return this -> record_count;
+}
+
+uint64_t SS_Table::get_data_file_size() const {
+    return this -> data_file_size;
+}
+
+uint64_t SS_Table::get_index_file_size() const {
+    return this -> index_file_size;
+}
+
+uint64_t SS_Table::get_index_offset_file_size() const {
+    return this -> index_offset_file_size;
+}
+
+uint64_t SS_Table::get_min_expiry_time() const {
+    return this -> min_expiry_time;
+}
+
+uint64_t SS_Table::get_max_expiry_time() const {
+    return this -> max_expiry_time;
+}
+
+bool SS_Table::is_fully_expired(uint64_t now) const {
+    return this -> record_count > 0 && this -> max_expiry_time != SS_TABLE_NEVER_EXPIRES && this -> max_expiry_time <= now;
+}
+
+uint64_t SS_Table::get_last_scrub_time() const {
+    return this -> last_scrub_time.load(std::memory_order_relaxed);
+}
+
+void SS_Table::set_last_scrub_time(uint64_t _last_scrub_time) const {
+    this -> last_scrub_time.store(_last_scrub_time, std::memory_order_relaxed);
 }
 
-std::vector<Bits> SS_Table::get_all_keys_alive(std::set<Bits> &dead_keys) const {
-    return this -> get_all_keys(SS_TABLE_FILTER_ALIVE_ENTRIES, dead_keys);
+bool SS_Table::is_recently_scrubbed(uint64_t now) const {
+    uint64_t scrub_time = this -> last_scrub_time.load(std::memory_order_relaxed);
+    return scrub_time != SS_TABLE_NEVER_SCRUBBED && now < scrub_time + SS_TABLE_SCRUB_TRUST_PERIOD_MS;
+}
+
+void SS_Table::mark_obsolete() const {
+    this -> obsolete = true;
+}
+
+bool SS_Table::overlap(const Bits& first_index, const Bits& last_index) const {
+    return !(last_index < this -> first_index || first_index > this -> last_index);
 }
 
 std::vector<Bits> SS_Table::get_all_keys() const {
     std::set<Bits> dead_Keys;
-    return this -> get_all_keys(SS_TABLE_FILTER_ALL_ENTRIES, dead_Keys);
+    return this -> get_all_keys(SS_TABLE_FILTER_ALL_ENTRIES, dead_Keys, ENTRY_MAX_SEQUENCE_NUMBER);
 }
 
-std::vector<Bits> SS_Table::get_all_keys(SS_Table_Entry_Filter key_filter, std::set<Bits>& dead_keys) const {
+std::vector<Bits> SS_Table::get_all_keys(SS_Table_Entry_Filter key_filter, std::set<Bits>& dead_keys, sequence_number_type snapshot) const {
     std::vector<Bits> keys;
     
     keys.reserve(this -> record_count);
@@ -543,6 +1333,7 @@ std::vector<Bits> SS_Table::get_all_keys(SS_Table_Entry_Filter key_filter, std::
     }
 
     uint64_t current_key_offset = 0;
+    std::string previous_visible_key;
 
     while(offset_ifstream.read(reinterpret_cast<char*>(&current_key_offset), sizeof(current_key_offset))) {
         index_ifstream.seekg(current_key_offset, index_ifstream.beg);
@@ -588,6 +1379,10 @@ std::vector<Bits> SS_Table::get_all_keys(SS_Table_Entry_Filter key_filter, std::
             }
             // check the tombstone flag
             Entry current_entry(current_key, current_data);
+            if(!is_visible_version(current_entry, current_key, snapshot, previous_visible_key)) {
+                continue;
+            }
+
             Bits curr_key = current_entry.get_key();
             if(current_entry.is_deleted()) {
                 dead_keys.emplace(curr_key);
@@ -596,7 +1391,9 @@ std::vector<Bits> SS_Table::get_all_keys(SS_Table_Entry_Filter key_filter, std::
                 keys.emplace_back(curr_key);
             }
         }
-        else {
+        else if(previous_visible_key != current_key) {
+            // older versions follow the newest one
+            previous_visible_key = current_key;
             keys.emplace_back(current_key);
         }
     }
@@ -607,7 +1404,7 @@ std::vector<Bits> SS_Table::get_all_keys(SS_Table_Entry_Filter key_filter, std::
     return keys;
 }
 
-uint64_t SS_Table::binary_search_nearest(std::ifstream& index_ifstream, std::ifstream& offset_ifstream, const Bits& target_key, SS_Table_Binary_Search_Type search_type) const {
+uint64_t SS_Table::binary_search_nearest(std::ifstream& index_ifstream, std::ifstream& offset_ifstream, const Bits& target_key, SS_Table_Binary_Search_Type search_type, uint64_t search_left) const {
     if(!index_ifstream.is_open()) {
         index_ifstream.open(this -> index_file, std::ios::binary);
 
@@ -624,7 +1421,7 @@ uint64_t SS_Table::binary_search_nearest(std::ifstream& index_ifstream, std::ifs
         }
     }
     // binary search to find the first key larger than or equal to key
-    uint64_t binary_search_left = 0;
+    uint64_t binary_search_left = std::min(search_left, this -> record_count);
     uint64_t binary_search_right = this -> record_count;
 
     // read all the keys from there and return as a vector
@@ -685,7 +1482,7 @@ uint64_t SS_Table::binary_search_nearest(std::ifstream& index_ifstream, std::ifs
     return binary_search_left;
 }
 
-std::vector<Entry> SS_Table::get_n_entries(SS_Table_Entry_Filter key_filter, uint32_t count, std::set<Bits>& dead_keys) const {
+std::vector<Entry> SS_Table::get_n_entries(SS_Table_Entry_Filter key_filter, uint32_t count, std::set<Bits>& dead_keys, sequence_number_type snapshot) const {
     std::vector<Entry> entries;
     
     entries.reserve(count);
@@ -705,6 +1502,7 @@ std::vector<Entry> SS_Table::get_n_entries(SS_Table_Entry_Filter key_filter, uin
     }
 
     uint64_t current_key_offset = 0;
+    std::string previous_visible_key;
 
     while(offset_ifstream.read(reinterpret_cast<char*>(&current_key_offset), sizeof(current_key_offset))) {
         index_ifstream.seekg(current_key_offset, index_ifstream.beg);
@@ -749,6 +1547,10 @@ std::vector<Entry> SS_Table::get_n_entries(SS_Table_Entry_Filter key_filter, uin
         }
         // check the tombstone flag
         Entry current_entry(current_key, current_data);
+        if(!is_visible_version(current_entry, current_key, snapshot, previous_visible_key)) {
+            continue;
+        }
+
         Bits curr_key = current_entry.get_key();
 
         if(key_filter == SS_Table_Entry_Filter::SS_TABLE_FILTER_ALL_ENTRIES) {
@@ -776,14 +1578,14 @@ std::vector<Entry> SS_Table::get_n_entries(SS_Table_Entry_Filter key_filter, uin
     return entries;
 }
 
-std::vector<Entry> SS_Table::get_entries_key_smaller_or_equal(const Bits& target_key, SS_Table_Entry_Filter key_filter, uint32_t count, std::set<Bits>& dead_keys) const {
+std::vector<Entry> SS_Table::get_entries_key_smaller_or_equal(const Bits& target_key, SS_Table_Entry_Filter key_filter, uint32_t count, std::set<Bits>& dead_keys, sequence_number_type snapshot) const {
     std::vector<Entry> entries;
     if(target_key < this -> first_index) {
         return entries;
     }
 
     if(this -> last_index <= target_key) {
-        return this -> get_n_entries(key_filter, count, dead_keys);
+        return this -> get_n_entries(key_filter, count, dead_keys, snapshot);
     }
 
     entries.reserve(this -> record_count);
@@ -823,6 +1625,7 @@ std::vector<Entry> SS_Table::get_entries_key_smaller_or_equal(const Bits& target
     }
 
     uint64_t current_key_offset = 0;
+    std::string previous_visible_key;
     index_ifstream.seekg(0, index_ifstream.beg);
     for(uint64_t i = 0; i < smaller_equal_index; ++i) {
         offset_ifstream.read(reinterpret_cast<char*>(&current_key_offset), sizeof(current_key_offset));
@@ -875,6 +1678,10 @@ std::vector<Entry> SS_Table::get_entries_key_smaller_or_equal(const Bits& target
 
         // check tombstone
         Entry current_entry(current_key, current_data);
+        if(!is_visible_version(current_entry, current_key, snapshot, previous_visible_key)) {
+            continue;
+        }
+
         Bits curr_key = current_entry.get_key();
         if(key_filter == SS_Table_Entry_Filter::SS_TABLE_FILTER_ALL_ENTRIES) {
             entries.emplace_back(current_entry);
@@ -897,14 +1704,14 @@ std::vector<Entry> SS_Table::get_entries_key_smaller_or_equal(const Bits& target
     return entries_partial;
 }
 
-std::vector<Entry> SS_Table::get_entries_key_larger_or_equal(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys) const {
+std::vector<Entry> SS_Table::get_entries_key_larger_or_equal(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys, sequence_number_type snapshot) const {
     std::vector<Entry> entries;
     if(target_key > this -> last_index) {
         return entries;
     }
 
     if(target_key <= this -> first_index) {
-        return this -> get_n_entries(entry_filter, count, dead_keys);
+        return this -> get_n_entries(entry_filter, count, dead_keys, snapshot);
     }
 
     entries.reserve(count);
@@ -937,6 +1744,7 @@ std::vector<Entry> SS_Table::get_entries_key_larger_or_equal(const Bits& target_
         throw File_Exception(SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG, this -> data_file.generic_string().c_str());
     }
 
+    std::string previous_visible_key;
     while(offset_ifstream.read(reinterpret_cast<char*>(&current_key_offset), sizeof(current_key_offset))) {
         index_ifstream.seekg(current_key_offset, index_ifstream.beg);
         if(index_ifstream.fail()) {
@@ -982,6 +1790,10 @@ std::vector<Entry> SS_Table::get_entries_key_larger_or_equal(const Bits& target_
 
         // check tombstone
         Entry current_entry(current_key, current_data);
+        if(!is_visible_version(current_entry, current_key, snapshot, previous_visible_key)) {
+            continue;
+        }
+
         if(entry_filter == SS_Table_Entry_Filter::SS_TABLE_FILTER_ALL_ENTRIES) {
             entries.push_back(current_entry);
         }
@@ -1006,29 +1818,17 @@ std::vector<Entry> SS_Table::get_entries_key_larger_or_equal(const Bits& target_
 
 std::vector<Entry> SS_Table::get_entries_key_smaller_or_equal(const Bits& target_key, uint32_t count) const {
     std::set<Bits> dead_keys;
-    return this -> get_entries_key_smaller_or_equal(target_key, SS_TABLE_FILTER_ALL_ENTRIES, count, dead_keys);
+    return this -> get_entries_key_smaller_or_equal(target_key, SS_TABLE_FILTER_ALL_ENTRIES, count, dead_keys, ENTRY_MAX_SEQUENCE_NUMBER);
 }
 
 std::vector<Entry> SS_Table::get_entries_key_larger_or_equal(const Bits& target_key, uint32_t count) const {
     std::set<Bits> dead_keys;
-    return this -> get_entries_key_larger_or_equal(target_key, SS_TABLE_FILTER_ALL_ENTRIES, count, dead_keys);
-}
-
-std::vector<Entry> SS_Table::get_entries_key_smaller_or_equal_alive(const Bits& target_key, uint32_t count, std::set<Bits>& dead_keys) const {
-       return this -> get_entries_key_smaller_or_equal(target_key, SS_TABLE_FILTER_ALIVE_ENTRIES, count, dead_keys);
-}
-
-std::vector<Entry> SS_Table::get_entries_key_larger_or_equal_alive(const Bits& target_key, uint32_t count, std::set<Bits>& dead_keys) const {
-    return this -> get_entries_key_larger_or_equal(target_key, SS_TABLE_FILTER_ALIVE_ENTRIES, count, dead_keys);
-}
-
-std::vector<Entry> SS_Table::get_n_entries_alive(uint32_t count, std::set<Bits>& dead_keys) const {
-    return this -> get_n_entries(SS_TABLE_FILTER_ALIVE_ENTRIES, count, dead_keys);
+    return this -> get_entries_key_larger_or_equal(target_key, SS_TABLE_FILTER_ALL_ENTRIES, count, dead_keys, ENTRY_MAX_SEQUENCE_NUMBER);
 }
 
 std::vector<Entry> SS_Table::get_n_entries(uint32_t count) const {
     std::set<Bits> dead_keys;
-    return this -> get_n_entries(SS_TABLE_FILTER_ALL_ENTRIES, count, dead_keys);
+    return this -> get_n_entries(SS_TABLE_FILTER_ALL_ENTRIES, count, dead_keys, ENTRY_MAX_SEQUENCE_NUMBER);
 }
 
 void SS_Table::reconstruct_ss_table(){
@@ -1133,16 +1933,12 @@ void SS_Table::reconstruct_ss_table(){
     this -> record_count = index_offset_file_size / SS_TABLE_KEY_OFFSET_RECORD_SIZE;
 }
 
-std::vector<Bits> SS_Table::get_n_next_keys_alive(const Bits& target_key, uint32_t count, std::set<Bits>& dead_keys) const {
-    return this -> get_n_next_keys(target_key, SS_Table_Entry_Filter::SS_TABLE_FILTER_ALIVE_ENTRIES, count, dead_keys);
-}
-
 std::vector<Bits> SS_Table::get_n_next_keys(const Bits& target_key, uint32_t count) const {
     std::set<Bits> dead_keys;
-    return this -> get_n_next_keys(target_key, SS_Table_Entry_Filter::SS_TABLE_FILTER_ALL_ENTRIES, count, dead_keys);
+    return this -> get_n_next_keys(target_key, SS_Table_Entry_Filter::SS_TABLE_FILTER_ALL_ENTRIES, count, dead_keys, ENTRY_MAX_SEQUENCE_NUMBER);
 }
 
-std::vector<Bits> SS_Table::get_n_next_keys(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys) const {
+std::vector<Bits> SS_Table::get_n_next_keys(const Bits& target_key, SS_Table_Entry_Filter entry_filter, uint32_t count, std::set<Bits>& dead_keys, sequence_number_type snapshot) const {
     std::vector<Bits> keys;
     if(target_key > this -> last_index) {
         return keys;
@@ -1178,6 +1974,7 @@ std::vector<Bits> SS_Table::get_n_next_keys(const Bits& target_key, SS_Table_Ent
         throw File_Exception(SS_TABLE_FAILED_TO_OPEN_DATA_FILE_MSG, this -> data_file.generic_string().c_str());
     }
 
+    std::string previous_visible_key;
     while(offset_ifstream.read(reinterpret_cast<char*>(&current_key_offset), sizeof(current_key_offset))) {
         index_ifstream.seekg(current_key_offset, index_ifstream.beg);
         if(index_ifstream.fail()) {
@@ -1223,6 +2020,10 @@ std::vector<Bits> SS_Table::get_n_next_keys(const Bits& target_key, SS_Table_Ent
 
         // check tombstone
         Entry current_entry(current_key, current_data);
+        if(!is_visible_version(current_entry, current_key, snapshot, previous_visible_key)) {
+            continue;
+        }
+
         Bits curr_key(current_key);
         if(entry_filter == SS_Table_Entry_Filter::SS_TABLE_FILTER_ALL_ENTRIES) {
             keys.push_back(curr_key);
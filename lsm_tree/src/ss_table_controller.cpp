@@ -1,18 +1,52 @@
 #include "../include/ss_table_controller.h"
-void SS_Table_Controller::add_sstable(const SS_Table* sstable){
-    this -> sstables.push_back(sstable);
-    ++this -> current_name_counter;
+void SS_Table_Controller::add_sstable(std::shared_ptr<const SS_Table> sstable){
+    this -> size_bytes += sstable -> get_data_file_size() + sstable -> get_index_file_size() + sstable -> get_index_offset_file_size();
+
+    SS_Table_Key_Range key_range{sstable -> get_first_index(), sstable -> get_last_index(), sstable.get()};
+    std::vector<SS_Table_Key_Range>::iterator it = std::upper_bound(this -> key_ranges.begin(), this -> key_ranges.end(), key_range, [](const SS_Table_Key_Range& a, const SS_Table_Key_Range& b){
+        return a.first_key < b.first_key;
+    });
+    this -> key_ranges.insert(it, key_range);
+
+    // ids are not dense after compactions, never hand out an id that is still in use
+    this -> current_name_counter = std::max(this -> current_name_counter, sstable -> get_table_id() + 1);
+
+    this -> sstables.push_back(std::move(sstable));
 }
 
 
-Entry SS_Table_Controller::get(const Bits& key, bool& found) const{
+Entry SS_Table_Controller::get(const Bits& key, bool& found, sequence_number_type snapshot, uint64_t* tables_probed) const{
     found = false;
 
     std::string placeholder_key(ENTRY_PLACEHOLDER_KEY);
 	std::string placeholder_value(ENTRY_PLACEHOLDER_VALUE);
 
-    for(std::vector<const SS_Table*>::const_reverse_iterator it = sstables.rbegin(); it != sstables.rend(); ++it){
-        Entry e = (*it) -> get(key, found);
+    if(this -> level > 0){
+        const SS_Table* ss_table = this -> find_table(key);
+        if(ss_table){
+            if(tables_probed){
+                ++(*tables_probed);
+            }
+
+            Entry e = ss_table -> get(key, found, snapshot);
+            if(found){
+                return e;
+            }
+        }
+
+        return Entry(Bits(placeholder_key), Bits(placeholder_value));
+    }
+
+    for(std::vector<std::shared_ptr<const SS_Table>>::const_reverse_iterator it = sstables.rbegin(); it != sstables.rend(); ++it){
+        if(key < (*it) -> get_first_index() || key > (*it) -> get_last_index()){
+            continue;
+        }
+
+        if(tables_probed){
+            ++(*tables_probed);
+        }
+
+        Entry e = (*it) -> get(key, found, snapshot);
         if(found){
             return e;
         }
@@ -21,7 +55,116 @@ Entry SS_Table_Controller::get(const Bits& key, bool& found) const{
     return Entry(Bits(placeholder_key), Bits(placeholder_value));
 }
 
-SS_Table_Controller:: SS_Table_Controller(uint16_t ratio, level_index_type current_level): current_name_counter(0){
+void SS_Table_Controller::multi_get(const std::vector<Bits>& keys, std::vector<Entry>& entries, std::vector<bool>& found, sequence_number_type snapshot, uint64_t* tables_probed) const{
+    std::vector<size_t> key_indexes;
+
+    if(this -> level > 0){
+        // ranges are disjoint and sorted like the keys, so both can be walked side by side
+        size_t key_idx = 0;
+        for(const SS_Table_Key_Range& key_range : this -> key_ranges){
+            while(key_idx < keys.size() && keys[key_idx] < key_range.first_key){
+                ++key_idx;
+            }
+
+            key_indexes.clear();
+            for(; key_idx < keys.size() && keys[key_idx] <= key_range.last_key; ++key_idx){
+                if(!found[key_idx]){
+                    key_indexes.push_back(key_idx);
+                }
+            }
+
+            if(!key_indexes.empty()){
+                if(tables_probed){
+                    ++(*tables_probed);
+                }
+
+                key_range.ss_table -> multi_get(keys, key_indexes, entries, found, snapshot);
+            }
+
+            if(key_idx == keys.size()){
+                break;
+            }
+        }
+
+        return;
+    }
+
+    for(std::vector<std::shared_ptr<const SS_Table>>::const_reverse_iterator it = sstables.rbegin(); it != sstables.rend(); ++it){
+        std::vector<Bits>::const_iterator range_begin = std::lower_bound(keys.begin(), keys.end(), (*it) -> get_first_index());
+        std::vector<Bits>::const_iterator range_end = std::upper_bound(range_begin, keys.end(), (*it) -> get_last_index());
+
+        key_indexes.clear();
+        for(std::vector<Bits>::const_iterator key_it = range_begin; key_it != range_end; ++key_it){
+            size_t key_idx = key_it - keys.begin();
+            if(!found[key_idx]){
+                key_indexes.push_back(key_idx);
+            }
+        }
+
+        if(key_indexes.empty()){
+            continue;
+        }
+
+        if(tables_probed){
+            ++(*tables_probed);
+        }
+
+        (*it) -> multi_get(keys, key_indexes, entries, found, snapshot);
+    }
+}
+
+const SS_Table* SS_Table_Controller::find_table(const Bits& key) const{
+    // the first table that does not end before key
+    std::vector<SS_Table_Key_Range>::const_iterator it = std::partition_point(this -> key_ranges.begin(), this -> key_ranges.end(), [&](const SS_Table_Key_Range& key_range){
+        return key_range.last_key < key;
+    });
+
+    if(it == this -> key_ranges.end() || key < it -> first_key){
+        return nullptr;
+    }
+
+    return it -> ss_table;
+}
+
+void SS_Table_Controller::add_iterators(std::vector<std::unique_ptr<Entry_Iterator>>& iterators, sequence_number_type snapshot, const std::string& prefix, uint64_t* tables_skipped) const{
+    if(this -> sstables.empty()){
+        return;
+    }
+
+    uint64_t skipped = 0;
+
+    if(this -> level == 0){
+        for(std::vector<std::shared_ptr<const SS_Table>>::const_reverse_iterator it = sstables.rbegin(); it != sstables.rend(); ++it){
+            if(!(*it) -> may_contain_prefix(prefix)){
+                ++skipped;
+                continue;
+            }
+            iterators.push_back(std::make_unique<SS_Table::Iterator>((*it) -> get_iterator(snapshot)));
+        }
+    }
+    else{
+        std::vector<const SS_Table*> ordered_tables;
+        ordered_tables.reserve(this -> key_ranges.size());
+        for(const SS_Table_Key_Range& key_range : this -> key_ranges){
+            // the level stays a sorted run without the skipped tables
+            if(!key_range.ss_table -> may_contain_prefix(prefix)){
+                ++skipped;
+                continue;
+            }
+            ordered_tables.push_back(key_range.ss_table);
+        }
+
+        if(!ordered_tables.empty()){
+            iterators.push_back(std::make_unique<Level_Iterator>(ordered_tables, snapshot));
+        }
+    }
+
+    if(tables_skipped){
+        *tables_skipped += skipped;
+    }
+}
+
+SS_Table_Controller:: SS_Table_Controller(uint16_t ratio, level_index_type current_level, uint64_t level_size_base): size_bytes(0), current_name_counter(0){
         this -> level = current_level;
         sstables.reserve(SS_TABLE_CONTROLLER_MAX_VECTOR_SIZE);
 
@@ -30,65 +173,47 @@ SS_Table_Controller:: SS_Table_Controller(uint16_t ratio, level_index_type curre
         // 2 LEVEL -> 10^3 * 1MB = 1000MB
         // ...
         // 
-        max_size = static_cast<uint64_t>(std::pow(ratio, level + 1)) * SS_TABLE_CONTROLLER_LEVEL_SIZE_BASE;
+        max_size = static_cast<uint64_t>(std::pow(ratio, level + 1)) * level_size_base;
 };
 
 SS_Table_Controller:: ~SS_Table_Controller(){
 
 };
 
-uint64_t SS_Table_Controller:: calculate_size_bytes(){
-    uint64_t size = 0;
-    // for now only data files
-    for(const SS_Table*& sst : sstables){
-        size += std::filesystem::file_size(sst -> data_path());
-        size += std::filesystem::file_size(sst -> index_path());
-        size += std::filesystem::file_size(sst -> offset_path());
-
-        //size += std::filesystem::file_size(sst -> index_path());
-    }
-
-    //std::cout << "Level: " << this -> level <<  " SS_tables count: " << sstables.size() << " Curent name counter " << this -> current_name_counter << std::endl; 
-
-    return size;
+uint64_t SS_Table_Controller:: calculate_size_bytes() const{
+    return this -> size_bytes;
 }
 
-bool SS_Table_Controller:: is_over_limit(){
+bool SS_Table_Controller:: is_over_limit() const{
     return calculate_size_bytes() > max_size;
 }
 
-uint16_t SS_Table_Controller::get_ss_tables_count(){
+uint16_t SS_Table_Controller::get_ss_tables_count() const{
     return sstables.size();
 }
 
 
-const SS_Table* SS_Table_Controller::operator[](std::size_t index){
-    return sstables.at(index);
+const SS_Table* SS_Table_Controller::operator[](std::size_t index) const{
+    return sstables.at(index).get();
 }
 
-uint16_t SS_Table_Controller::get_level(){
+uint16_t SS_Table_Controller::get_level() const{
     return this -> level;
 }
 
-void  SS_Table_Controller::delete_sstable(table_index_type index){
-    std::filesystem::path data_path = this -> sstables.at(index) -> data_path();
-    if(!std::filesystem::remove(data_path)){
-        throw File_Exception(SS_TABLE_FAILED_INDEX_OFFSET_WRITE_ERR_MSG, this -> sstables.at(index) -> data_path().generic_string().c_str());
-    }
-
-    std::filesystem::path index_path = this -> sstables.at(index) -> index_path();
-    if(!std::filesystem::remove(index_path)){
-        throw File_Exception(SS_TABLE_FAILED_INDEX_OFFSET_WRITE_ERR_MSG, this -> sstables.at(index) -> index_path().generic_string().c_str());
-    }
+void  SS_Table_Controller::delete_sstable(table_index_type index, bool remove_files){
+    const SS_Table* ss_table = this -> sstables.at(index).get();
 
-    std::filesystem::path offset_path = this -> sstables.at(index) -> offset_path();
-    if(!std::filesystem::remove(offset_path)){
-        throw File_Exception(SS_TABLE_FAILED_INDEX_OFFSET_WRITE_ERR_MSG, this -> sstables.at(index) -> offset_path().generic_string().c_str());
+    // versions of the tree pinned by readers may still hold the table, the files go with the last of them
+    if(remove_files){
+        ss_table -> mark_obsolete();
     }
 
-    const SS_Table *ss_table = this -> sstables.at(index);
-    delete(ss_table);
+    this -> size_bytes -= ss_table -> get_data_file_size() + ss_table -> get_index_file_size() + ss_table -> get_index_offset_file_size();
 
+    this -> key_ranges.erase(std::find_if(this -> key_ranges.begin(), this -> key_ranges.end(), [&](const SS_Table_Key_Range& key_range){
+        return key_range.ss_table == ss_table;
+    }));
 
     this -> sstables.erase(sstables.begin() + index);
     return;
@@ -102,17 +227,27 @@ bool SS_Table_Controller::empty() const {
     return this -> sstables.empty();
 }
 
-const SS_Table*& SS_Table_Controller::at(table_index_type index) {
-    return this -> sstables.at(index);
+const SS_Table* SS_Table_Controller::at(table_index_type index) const{
+    return this -> sstables.at(index).get();
 }
 
-const SS_Table*& SS_Table_Controller::front() {
-    return this -> sstables.front();
+const SS_Table* SS_Table_Controller::front() const{
+    return this -> sstables.front().get();
 }
 
-double SS_Table_Controller::get_fill_ratio(){
+double SS_Table_Controller::get_fill_ratio() const{
     if(max_size == 0){
         return 0.0;
     }
     return static_cast<double>((calculate_size_bytes()) /  static_cast<double>(max_size));
 }
+
+SS_Table_Controller_Stats SS_Table_Controller::get_stats() const{
+    SS_Table_Controller_Stats stats;
+    stats.level = this -> level;
+    stats.table_count = this -> sstables.size();
+    stats.size_bytes = this -> size_bytes;
+    stats.max_size_bytes = this -> max_size;
+    stats.fill_ratio = this -> get_fill_ratio();
+    return stats;
+}
@@ -0,0 +1,67 @@
+#include "../include/ss_table_writer.h"
+
+SS_Table_Writer::SS_Table_Writer(const std::filesystem::path& _output_dir, const LSM_Options& options, uint64_t _table_size) :
+    output_dir(_output_dir),
+    table_size(_table_size),
+    prefix_extractor(options.prefix_extractor),
+    prefix_filter_bits_per_key(options.prefix_filter_bits_per_key),
+    entries_size(0),
+    finished(false)
+{
+    std::filesystem::create_directories(this -> output_dir);
+}
+
+void SS_Table_Writer::put(const std::string& key, const std::string& value){
+    this -> add(Entry(Bits(key), Bits(value)));
+}
+
+void SS_Table_Writer::remove(const std::string& key){
+    Entry entry(Bits(key), Bits(ENTRY_PLACEHOLDER_VALUE));
+    entry.set_tombstone(ENTRY_TOMBSTONE_ON);
+    this -> add(std::move(entry));
+}
+
+void SS_Table_Writer::add(Entry&& entry){
+    if(this -> finished){
+        throw std::logic_error(SS_TABLE_WRITER_FINISHED_ERR_MSG);
+    }
+
+    // a table holds one version per key, so the order has to be strict
+    std::string key = entry.get_key_string();
+    if((!this -> entries.empty() || !this -> data_files.empty()) && key <= this -> last_key){
+        throw std::invalid_argument(SS_TABLE_WRITER_UNSORTED_KEY_ERR_MSG);
+    }
+
+    this -> entries_size += entry.get_entry_length();
+    this -> entries.push_back(std::move(entry));
+    this -> last_key = std::move(key);
+
+    if(this -> entries_size >= this -> table_size){
+        this -> write_table();
+    }
+}
+
+void SS_Table_Writer::write_table(){
+    if(this -> entries.empty()){
+        return;
+    }
+
+    SS_Table_Files files = LSM_Tree::get_ss_table_files(this -> output_dir, 0, this -> data_files.size());
+    SS_Table ss_table(files.data_file, files.index_file, files.offset_file, files.filter_file, 0, this -> data_files.size());
+    ss_table.set_prefix_extractor(this -> prefix_extractor, this -> prefix_filter_bits_per_key);
+    ss_table.fill_ss_table(this -> entries);
+    ss_table.sync_files();
+
+    this -> data_files.push_back(files.data_file);
+    this -> entries.clear();
+    this -> entries_size = 0;
+}
+
+std::vector<std::filesystem::path> SS_Table_Writer::finish(){
+    if(!this -> finished){
+        this -> write_table();
+        this -> finished = true;
+    }
+
+    return this -> data_files;
+}
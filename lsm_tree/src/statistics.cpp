@@ -0,0 +1,212 @@
+#include "../include/statistics.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+Statistics::Statistics() {
+    for(Shard& shard : this -> shards) {
+        for(std::atomic<uint64_t>& ticker : shard.tickers) {
+            ticker.store(0, std::memory_order_relaxed);
+        }
+
+        for(std::atomic<uint64_t>& level_bytes : shard.level_bytes_written) {
+            level_bytes.store(0, std::memory_order_relaxed);
+        }
+
+        for(Histogram& histogram : shard.histograms) {
+            histogram.count.store(0, std::memory_order_relaxed);
+            histogram.sum.store(0, std::memory_order_relaxed);
+            histogram.max.store(0, std::memory_order_relaxed);
+            for(std::atomic<uint64_t>& bucket : histogram.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+Statistics::Shard& Statistics::get_shard() {
+    static std::atomic<uint32_t> next_shard_index{0};
+    thread_local uint32_t shard_index = next_shard_index.fetch_add(1, std::memory_order_relaxed) % STATISTICS_SHARD_COUNT;
+    return this -> shards[shard_index];
+}
+
+uint8_t Statistics::get_bucket(uint64_t value) {
+    if(value == 0) {
+        return 0;
+    }
+
+    uint8_t bucket = 64 - __builtin_clzll(value);
+    return bucket < STATISTICS_HISTOGRAM_BUCKET_COUNT? bucket : STATISTICS_HISTOGRAM_BUCKET_COUNT - 1;
+}
+
+void Statistics::record(Statistics_Ticker ticker, uint64_t count) {
+    this -> get_shard().tickers[ticker].fetch_add(count, std::memory_order_relaxed);
+}
+
+void Statistics::record_level_bytes_written(uint16_t level, uint64_t bytes) {
+    if(level >= STATISTICS_MAX_LEVELS) {
+        level = STATISTICS_MAX_LEVELS - 1;
+    }
+
+    this -> get_shard().level_bytes_written[level].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Statistics::record_time(Statistics_Histogram histogram, uint64_t micros) {
+    Histogram& shard_histogram = this -> get_shard().histograms[histogram];
+
+    shard_histogram.count.fetch_add(1, std::memory_order_relaxed);
+    shard_histogram.sum.fetch_add(micros, std::memory_order_relaxed);
+    shard_histogram.buckets[Statistics::get_bucket(micros)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = shard_histogram.max.load(std::memory_order_relaxed);
+    while(micros > max && !shard_histogram.max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {
+
+    }
+}
+
+uint64_t Statistics::get_ticker(Statistics_Ticker ticker) const {
+    uint64_t total = 0;
+    for(const Shard& shard : this -> shards) {
+        total += shard.tickers[ticker].load(std::memory_order_relaxed);
+    }
+
+    return total;
+}
+
+void Statistics::add_counters(std::map<std::string, uint64_t>& counters) const {
+    for(uint8_t ticker = 0; ticker < STATISTICS_TICKER_COUNT; ++ticker) {
+        counters[Statistics::get_ticker_name(static_cast<Statistics_Ticker>(ticker))] += this -> get_ticker(static_cast<Statistics_Ticker>(ticker));
+    }
+
+    for(uint16_t level = 0; level < STATISTICS_MAX_LEVELS; ++level) {
+        uint64_t bytes = 0;
+        for(const Shard& shard : this -> shards) {
+            bytes += shard.level_bytes_written[level].load(std::memory_order_relaxed);
+        }
+
+        if(bytes > 0) {
+            counters["level." + std::to_string(level) + ".bytes_written"] += bytes;
+        }
+    }
+
+    for(uint8_t histogram = 0; histogram < STATISTICS_HISTOGRAM_COUNT; ++histogram) {
+        std::string name = Statistics::get_histogram_name(static_cast<Statistics_Histogram>(histogram));
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        uint64_t buckets[STATISTICS_HISTOGRAM_BUCKET_COUNT] = {};
+
+        for(const Shard& shard : this -> shards) {
+            const Histogram& shard_histogram = shard.histograms[histogram];
+            count += shard_histogram.count.load(std::memory_order_relaxed);
+            sum += shard_histogram.sum.load(std::memory_order_relaxed);
+            max = std::max(max, shard_histogram.max.load(std::memory_order_relaxed));
+
+            for(uint8_t bucket = 0; bucket < STATISTICS_HISTOGRAM_BUCKET_COUNT; ++bucket) {
+                buckets[bucket] += shard_histogram.buckets[bucket].load(std::memory_order_relaxed);
+            }
+        }
+
+        counters[name + ".count"] += count;
+        counters[name + ".sum"] += sum;
+        uint64_t& merged_max = counters[name + STATISTICS_MAX_SUFFIX];
+        merged_max = std::max(merged_max, max);
+
+        for(uint8_t bucket = 0; bucket < STATISTICS_HISTOGRAM_BUCKET_COUNT; ++bucket) {
+            if(buckets[bucket] > 0) {
+                counters[name + STATISTICS_BUCKET_INFIX + std::to_string(bucket)] += buckets[bucket];
+            }
+        }
+    }
+}
+
+const char* Statistics::get_ticker_name(Statistics_Ticker ticker) {
+    switch(ticker) {
+        case STATISTICS_GETS: return "gets";
+        case STATISTICS_GET_TABLES_PROBED: return "get_tables_probed";
+        case STATISTICS_MULTI_GET_KEYS: return "multi_get_keys";
+        case STATISTICS_WRITES: return "writes";
+        case STATISTICS_WAL_BYTES: return "wal_bytes";
+        case STATISTICS_FLUSHES: return "flushes";
+        case STATISTICS_COMPACTIONS: return "compactions";
+        default: return "unknown";
+    }
+}
+
+const char* Statistics::get_histogram_name(Statistics_Histogram histogram) {
+    switch(histogram) {
+        case STATISTICS_GET_MICROS: return "get_micros";
+        case STATISTICS_WRITE_MICROS: return "write_micros";
+        case STATISTICS_WAL_SYNC_MICROS: return "wal_sync_micros";
+        case STATISTICS_FLUSH_MICROS: return "flush_micros";
+        case STATISTICS_COMPACTION_MICROS: return "compaction_micros";
+        default: return "unknown";
+    }
+}
+
+void Statistics::merge_counters(std::map<std::string, uint64_t>& into, const std::map<std::string, uint64_t>& counters) {
+    static const std::string max_suffix(STATISTICS_MAX_SUFFIX);
+
+    for(const std::pair<const std::string, uint64_t>& counter : counters) {
+        uint64_t& merged = into[counter.first];
+        bool is_max = counter.first.size() >= max_suffix.size() && counter.first.compare(counter.first.size() - max_suffix.size(), max_suffix.size(), max_suffix) == 0;
+        merged = is_max? std::max(merged, counter.second) : merged + counter.second;
+    }
+}
+
+void Statistics::summarize_histograms(std::map<std::string, uint64_t>& counters) {
+    static const std::string bucket_infix(STATISTICS_BUCKET_INFIX);
+    std::map<std::string, std::vector<uint64_t>> histograms;
+
+    for(std::map<std::string, uint64_t>::iterator it = counters.begin(); it != counters.end();) {
+        size_t infix_pos = it -> first.rfind(bucket_infix);
+        if(infix_pos == std::string::npos) {
+            ++it;
+            continue;
+        }
+
+        std::vector<uint64_t>& buckets = histograms[it -> first.substr(0, infix_pos)];
+        buckets.resize(STATISTICS_HISTOGRAM_BUCKET_COUNT, 0);
+
+        uint64_t bucket = std::strtoull(it -> first.c_str() + infix_pos + bucket_infix.size(), nullptr, 10);
+        if(bucket < STATISTICS_HISTOGRAM_BUCKET_COUNT) {
+            buckets[bucket] += it -> second;
+        }
+
+        it = counters.erase(it);
+    }
+
+    for(const std::pair<const std::string, std::vector<uint64_t>>& histogram : histograms) {
+        uint64_t total = 0;
+        for(uint64_t bucket_count : histogram.second) {
+            total += bucket_count;
+        }
+
+        uint64_t max = counters[histogram.first + STATISTICS_MAX_SUFFIX];
+        for(uint64_t percentile : {50, 95, 99}) {
+            // the rank of the percentile, rounded up
+            uint64_t rank = (total * percentile + 99) / 100;
+            uint64_t seen = 0;
+            uint64_t value = 0;
+
+            for(uint8_t bucket = 0; bucket < STATISTICS_HISTOGRAM_BUCKET_COUNT; ++bucket) {
+                seen += histogram.second[bucket];
+                if(seen >= rank) {
+                    value = bucket == 0? 0 : (bucket >= 64? UINT64_MAX : (1ULL << bucket) - 1);
+                    break;
+                }
+            }
+
+            counters[histogram.first + ".p" + std::to_string(percentile)] = std::min(value, max);
+        }
+    }
+}
+
+Statistics_Timer::Statistics_Timer(Statistics& _statistics, Statistics_Histogram _histogram) : statistics(_statistics), histogram(_histogram), start(std::chrono::steady_clock::now()) {
+
+}
+
+Statistics_Timer::~Statistics_Timer() {
+    uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this -> start).count();
+    this -> statistics.record_time(this -> histogram, micros);
+}
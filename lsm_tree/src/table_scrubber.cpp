@@ -0,0 +1,59 @@
+#include "../include/table_scrubber.h"
+#include <exception>
+
+Table_Scrubber::Table_Scrubber(const SS_Table& ss_table) : level(ss_table.get_level()), table_id(ss_table.get_table_id()), record_count(ss_table.get_record_count()), records_checked(0), bytes_checked(0), corrupted(false), keynator(ss_table.get_keynator()) {
+
+}
+
+bool Table_Scrubber::step(uint64_t max_bytes) {
+    uint64_t step_start = this -> bytes_checked;
+
+    try {
+        while(!this -> is_done() && this -> bytes_checked - step_start < max_bytes) {
+            std::string key = this -> keynator.get_next_key().get_string();
+            std::string data_string = this -> keynator.get_current_data_string();
+
+            // versions of a key sit next to each other, so the keys never go down
+            if(key < this -> previous_key) {
+                this -> corrupted = true;
+                break;
+            }
+
+            Entry entry(key, data_string);
+            if(!entry.check_checksum()) {
+                this -> corrupted = true;
+                break;
+            }
+
+            this -> bytes_checked += sizeof(key_len_type) + key.size() + SS_TABLE_KEY_OFFSET_RECORD_SIZE + sizeof(uint64_t) + data_string.size();
+            ++this -> records_checked;
+            this -> previous_key = std::move(key);
+        }
+    }
+    catch(const std::exception& e) {
+        // a record that can not even be read is as bad as one with the wrong checksum
+        this -> corrupted = true;
+    }
+
+    return this -> is_done();
+}
+
+bool Table_Scrubber::is_done() const {
+    return this -> corrupted || this -> records_checked >= this -> record_count;
+}
+
+bool Table_Scrubber::is_corrupted() const {
+    return this -> corrupted;
+}
+
+level_index_type Table_Scrubber::get_level() const {
+    return this -> level;
+}
+
+uint64_t Table_Scrubber::get_table_id() const {
+    return this -> table_id;
+}
+
+uint64_t Table_Scrubber::get_bytes_checked() const {
+    return this -> bytes_checked;
+}
@@ -0,0 +1,21 @@
+#include "../include/tree_version.h"
+
+Version_Iterator::Version_Iterator(std::shared_ptr<const Tree_Version> _version, std::unique_ptr<Entry_Iterator> _iterator) : version(std::move(_version)), iterator(std::move(_iterator)) {
+
+}
+
+void Version_Iterator::seek(const Bits& target, Iterator_Direction direction) {
+    this -> iterator -> seek(target, direction);
+}
+
+bool Version_Iterator::valid() const {
+    return this -> iterator -> valid();
+}
+
+void Version_Iterator::next() {
+    this -> iterator -> next();
+}
+
+const Entry& Version_Iterator::entry() const {
+    return this -> iterator -> entry();
+}
@@ -0,0 +1,274 @@
+#include "../include/value_log.h"
+#include "../include/crc32.h"
+#include "../include/entry.h"
+#include "../include/file_exception.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <regex>
+#include <unistd.h>
+
+#define VALUE_LOG_RECORD_HEADER_SIZE (sizeof(uint32_t) + sizeof(key_len_type) + sizeof(value_len_type))
+
+std::string Value_Pointer::encode() const {
+    std::string encoded(sizeof(file_id) + sizeof(offset) + sizeof(length), '\0');
+    char* ptr = encoded.data();
+
+    memcpy(ptr, &this -> file_id, sizeof(this -> file_id));
+    ptr += sizeof(this -> file_id);
+
+    memcpy(ptr, &this -> offset, sizeof(this -> offset));
+    ptr += sizeof(this -> offset);
+
+    memcpy(ptr, &this -> length, sizeof(this -> length));
+    return encoded;
+}
+
+bool Value_Pointer::decode(const std::string& encoded, Value_Pointer& pointer) {
+    if(encoded.size() != sizeof(pointer.file_id) + sizeof(pointer.offset) + sizeof(pointer.length)) {
+        return false;
+    }
+
+    const char* ptr = encoded.data();
+
+    memcpy(&pointer.file_id, ptr, sizeof(pointer.file_id));
+    ptr += sizeof(pointer.file_id);
+
+    memcpy(&pointer.offset, ptr, sizeof(pointer.offset));
+    ptr += sizeof(pointer.offset);
+
+    memcpy(&pointer.length, ptr, sizeof(pointer.length));
+    return true;
+}
+
+Value_Log::Value_Log() : Value_Log(VALUE_LOG_DIR) {
+
+}
+
+Value_Log::Value_Log(const std::filesystem::path& _directory) : directory(_directory), active_file_id(0), active_file_size(0), active_fd(-1) {
+    std::filesystem::create_directories(this -> directory);
+
+    // a crash may have torn the tail of the last file, appending after it is never attempted
+    std::vector<uint64_t> file_ids = this -> get_sealed_file_ids();
+    if(!file_ids.empty()) {
+        this -> active_file_id = file_ids.back() + 1;
+    }
+}
+
+Value_Log::~Value_Log() {
+    this -> close_active_file();
+}
+
+std::filesystem::path Value_Log::get_file_path(uint64_t file_id) const {
+    std::string filename(VALUE_LOG_FILE_NAME_MAX_LENGTH, '\0');
+    snprintf(&filename[0], VALUE_LOG_FILE_NAME_MAX_LENGTH, VALUE_LOG_FILE_NAME, file_id);
+    filename.resize(strlen(filename.c_str()));
+    return this -> directory / filename;
+}
+
+void Value_Log::close_active_file() {
+    if(this -> active_fd >= 0) {
+        ::close(this -> active_fd);
+        this -> active_fd = -1;
+    }
+}
+
+Value_Pointer Value_Log::append(const std::string& key, const std::string& value) {
+    if(this -> active_fd < 0) {
+        std::filesystem::path file = this -> get_file_path(this -> active_file_id);
+        this -> active_fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(this -> active_fd < 0) {
+            throw File_Exception(VALUE_LOG_FAILED_OPEN_ERR_MSG, file.generic_string().c_str());
+        }
+        this -> active_file_size = 0;
+    }
+
+    key_len_type key_length = key.size();
+    value_len_type value_length = value.size();
+
+    std::string checked = key + value;
+    uint32_t checksum = crc32(checked);
+
+    std::string record(VALUE_LOG_RECORD_HEADER_SIZE, '\0');
+    char* ptr = record.data();
+    memcpy(ptr, &checksum, sizeof(checksum));
+    ptr += sizeof(checksum);
+    memcpy(ptr, &key_length, sizeof(key_length));
+    ptr += sizeof(key_length);
+    memcpy(ptr, &value_length, sizeof(value_length));
+    record.append(checked);
+
+    Value_Pointer pointer;
+    pointer.file_id = this -> active_file_id;
+    pointer.offset = this -> active_file_size;
+    pointer.length = record.size();
+
+    const char* data = record.data();
+    uint64_t left = record.size();
+    while(left > 0) {
+        ssize_t written = ::write(this -> active_fd, data, left);
+        if(written < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw File_Exception(VALUE_LOG_FAILED_WRITE_ERR_MSG, this -> get_file_path(this -> active_file_id).generic_string().c_str());
+        }
+        data += written;
+        left -= written;
+    }
+
+    this -> active_file_size += record.size();
+
+    if(this -> active_file_size >= VALUE_LOG_MAX_FILE_SIZE) {
+        this -> seal();
+    }
+
+    return pointer;
+}
+
+void Value_Log::sync() {
+    if(this -> active_fd >= 0 && ::fdatasync(this -> active_fd) != 0) {
+        throw File_Exception(VALUE_LOG_FAILED_SYNC_ERR_MSG, this -> get_file_path(this -> active_file_id).generic_string().c_str());
+    }
+}
+
+void Value_Log::seal() {
+    if(this -> active_fd < 0) {
+        return;
+    }
+
+    // blobs written before the seal may not have been synced yet
+    this -> sync();
+    this -> close_active_file();
+    ++this -> active_file_id;
+    this -> active_file_size = 0;
+}
+
+std::string Value_Log::read(const Value_Pointer& pointer) const {
+    std::filesystem::path file = this -> get_file_path(pointer.file_id);
+
+    if(pointer.length < VALUE_LOG_RECORD_HEADER_SIZE) {
+        throw File_Exception(VALUE_LOG_BAD_POINTER_ERR_MSG, file.generic_string().c_str());
+    }
+
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw File_Exception(VALUE_LOG_FAILED_OPEN_ERR_MSG, file.generic_string().c_str());
+    }
+
+    std::string record(pointer.length, '\0');
+    uint64_t done = 0;
+    while(done < pointer.length) {
+        ssize_t bytes = ::pread(fd, &record[done], pointer.length - done, pointer.offset + done);
+        if(bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if(bytes <= 0) {
+            ::close(fd);
+            throw File_Exception(VALUE_LOG_FAILED_READ_ERR_MSG, file.generic_string().c_str());
+        }
+        done += bytes;
+    }
+    ::close(fd);
+
+    uint32_t checksum = 0;
+    key_len_type key_length = 0;
+    value_len_type value_length = 0;
+    const char* ptr = record.data();
+    memcpy(&checksum, ptr, sizeof(checksum));
+    ptr += sizeof(checksum);
+    memcpy(&key_length, ptr, sizeof(key_length));
+    ptr += sizeof(key_length);
+    memcpy(&value_length, ptr, sizeof(value_length));
+
+    if(VALUE_LOG_RECORD_HEADER_SIZE + (uint64_t)key_length + value_length != pointer.length) {
+        throw File_Exception(VALUE_LOG_BAD_POINTER_ERR_MSG, file.generic_string().c_str());
+    }
+
+    std::string checked = record.substr(VALUE_LOG_RECORD_HEADER_SIZE);
+    if(crc32(checked) != checksum) {
+        throw File_Exception(VALUE_LOG_CHECKSUM_MISMATCH_ERR_MSG, file.generic_string().c_str());
+    }
+
+    return checked.substr(key_length);
+}
+
+std::vector<uint64_t> Value_Log::get_sealed_file_ids() const {
+    std::vector<uint64_t> file_ids;
+    std::regex blob_pattern(R"(blob_(\d+)\.bin)");
+
+    std::error_code error;
+    for(const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(this -> directory, error)) {
+        std::string filename = file.path().filename().string();
+        std::smatch match;
+        if(!std::regex_match(filename, match, blob_pattern)) {
+            continue;
+        }
+
+        uint64_t file_id = std::stoull(match[1]);
+        if(this -> active_fd >= 0 && file_id == this -> active_file_id) {
+            continue;
+        }
+        file_ids.push_back(file_id);
+    }
+
+    std::sort(file_ids.begin(), file_ids.end());
+    return file_ids;
+}
+
+std::vector<Value_Log_Record> Value_Log::read_records(uint64_t file_id) const {
+    std::vector<Value_Log_Record> records;
+    std::filesystem::path file = this -> get_file_path(file_id);
+
+    std::ifstream in(file, std::ios::binary);
+    if(!in) {
+        throw File_Exception(VALUE_LOG_FAILED_OPEN_ERR_MSG, file.generic_string().c_str());
+    }
+
+    uint64_t file_size = this -> get_file_size(file_id);
+    uint64_t offset = 0;
+
+    while(offset + VALUE_LOG_RECORD_HEADER_SIZE <= file_size) {
+        uint32_t checksum = 0;
+        key_len_type key_length = 0;
+        value_len_type value_length = 0;
+
+        in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+        in.read(reinterpret_cast<char*>(&key_length), sizeof(key_length));
+        in.read(reinterpret_cast<char*>(&value_length), sizeof(value_length));
+
+        uint64_t record_length = VALUE_LOG_RECORD_HEADER_SIZE + (uint64_t)key_length + value_length;
+        if(!in || offset + record_length > file_size) {
+            break;
+        }
+
+        Value_Log_Record record;
+        record.key.resize(key_length);
+        in.read(&record.key[0], key_length);
+        in.seekg(value_length, std::ios::cur);
+        if(!in) {
+            break;
+        }
+
+        record.pointer.file_id = file_id;
+        record.pointer.offset = offset;
+        record.pointer.length = record_length;
+        records.push_back(std::move(record));
+
+        offset += record_length;
+    }
+
+    return records;
+}
+
+uint64_t Value_Log::get_file_size(uint64_t file_id) const {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(this -> get_file_path(file_id), error);
+    return error? 0 : size;
+}
+
+void Value_Log::remove_file(uint64_t file_id) {
+    std::filesystem::remove(this -> get_file_path(file_id));
+}
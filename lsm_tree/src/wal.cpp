@@ -1,15 +1,16 @@
 #include "../include/wal.h"
 
-Wal::Wal(){
-   
-    // move to define
-    std::filesystem::path wal_dir = WAL_FOLDER_PATH;
+Wal::Wal() : Wal(std::filesystem::path(WAL_FOLDER_PATH)){
+
+}
+
+Wal::Wal(const std::filesystem::path& wal_dir){
     if (!std::filesystem::exists(wal_dir)) {
         std::filesystem::create_directories(wal_dir);
     }
 
-    wal_name = "wal.log";
-    wal_file_location = WAL_FOLDER_PATH + wal_name;
+    wal_name = WAL_FILE_NAME;
+    wal_file_location = (wal_dir / wal_name).string();
     entry_count = 0;
     is_read_only = false;
 
@@ -32,7 +33,7 @@ Wal::Wal(std::string _wal_name, std::string _wal_file_location){
 }
 
 Wal::~Wal(){
-    clear_entries();
+    // entries still in the log belong to the mem table and are replayed on the next start
     if (wal_file.is_open()) {
         wal_file.close();
     }
@@ -76,6 +77,35 @@ void Wal::append_entry(std::ostringstream& entry){
     wal_file.flush();
 }
 
+void Wal::append_batch(const std::string& entries_bytes, uint32_t entry_count){
+    if (!wal_file.is_open()) {
+        std::cerr << "WAL file is not open" << std::endl;
+        return;
+    }
+
+    if (entry_count == 0) {
+        return;
+    }
+
+    uint64_t batch_marker = WAL_BATCH_MARKER;
+    uint64_t payload_length = entries_bytes.size();
+
+    std::string content;
+    content.reserve(sizeof(batch_marker) + sizeof(payload_length) + sizeof(entry_count) + payload_length);
+    content.append(reinterpret_cast<const char*>(&batch_marker), sizeof(batch_marker));
+    content.append(reinterpret_cast<const char*>(&payload_length), sizeof(payload_length));
+    content.append(reinterpret_cast<const char*>(&entry_count), sizeof(entry_count));
+    content.append(entries_bytes);
+
+    wal_file.write(content.c_str(), content.size());
+
+    if (!wal_file.good()) {
+        std::cerr << "Write failed" << std::endl;
+    }
+
+    wal_file.flush();
+}
+
 void Wal::clear_entries(){
     entry_count = 0;
     
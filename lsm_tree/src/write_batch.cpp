@@ -0,0 +1,31 @@
+#include "../include/write_batch.h"
+
+void Write_Batch::put(const std::string& key, const std::string& value){
+    this -> entries.emplace_back(Bits(key), Bits(value));
+};
+
+void Write_Batch::remove(const std::string& key){
+    Entry entry(Bits(key), Bits(ENTRY_PLACEHOLDER_VALUE));
+    entry.set_tombstone(ENTRY_TOMBSTONE_ON);
+    this -> entries.push_back(entry);
+};
+
+void Write_Batch::append(const Write_Batch& other){
+    this -> entries.insert(this -> entries.end(), other.entries.begin(), other.entries.end());
+};
+
+size_t Write_Batch::size() const{
+    return this -> entries.size();
+};
+
+bool Write_Batch::empty() const{
+    return this -> entries.empty();
+};
+
+void Write_Batch::clear(){
+    this -> entries.clear();
+};
+
+const std::vector<Entry>& Write_Batch::get_entries() const{
+    return this -> entries;
+};
@@ -0,0 +1,100 @@
+// Writes tables for LSM_Tree::ingest_files() out of sorted text records, without going through any tree
+// every input line is "key\tvalue", a line without a tab removes its key, keys have to be strictly increasing
+// prefix filters follow the LSM_TREE_* environment variables, so set them as the tree the tables go to has them
+// usage: ./bin/sst_writer --output=DIR [--input=FILE] [--table_size=BYTES]
+//        reads stdin without --input, prints the data file of every table written
+
+#include "../include/ss_table_writer.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+struct Writer_Config {
+    std::string input;
+    std::string output;
+    uint64_t table_size;
+};
+
+// @returns false if an argument is not understood
+static bool parse_args(int argc, char* argv[], Writer_Config& config) {
+    config.table_size = SS_TABLE_WRITER_DEFAULT_TABLE_SIZE;
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        if(arg.rfind("--", 0) != 0 || equals == std::string::npos) {
+            return false;
+        }
+
+        std::string flag = arg.substr(2, equals - 2);
+        std::string value = arg.substr(equals + 1);
+
+        try {
+            if(flag == "input") {
+                config.input = value;
+            }
+            else if(flag == "output") {
+                config.output = value;
+            }
+            else if(flag == "table_size") {
+                config.table_size = std::stoull(value);
+            }
+            else {
+                return false;
+            }
+        }
+        catch(const std::exception& e) {
+            return false;
+        }
+    }
+
+    return !config.output.empty() && config.table_size > 0;
+}
+
+int main(int argc, char* argv[]) {
+    Writer_Config config;
+    if(!parse_args(argc, argv, config)) {
+        std::cerr << "usage: " << argv[0] << " --output=DIR [--input=FILE] [--table_size=BYTES]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input_file;
+    if(!config.input.empty()) {
+        input_file.open(config.input);
+        if(!input_file) {
+            std::cerr << "failed to open " << config.input << std::endl;
+            return 1;
+        }
+    }
+
+    std::istream& input = config.input.empty() ? std::cin : input_file;
+
+    try {
+        SS_Table_Writer writer(config.output, LSM_Options::from_environment(), config.table_size);
+
+        std::string line;
+        while(std::getline(input, line)) {
+            if(line.empty()) {
+                continue;
+            }
+
+            size_t tab = line.find('\t');
+            if(tab == std::string::npos) {
+                writer.remove(line);
+            }
+            else {
+                writer.put(line.substr(0, tab), line.substr(tab + 1));
+            }
+        }
+
+        for(const std::filesystem::path& data_file : writer.finish()) {
+            std::cout << data_file.string() << std::endl;
+        }
+    }
+    catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
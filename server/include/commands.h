@@ -12,6 +12,14 @@
 #define COMMAND_GET_FF "GET_FF" // GET_FF <KEY>
 #define COMMAND_GET_FB "GET_FB" // GET_FB <KEY>
 #define COMMAND_REMOVE "REMOVE" // REMOVE <KEY>
+#define COMMAND_MSET "MSET" // MSET <KEY> <VALUE> [<KEY> <VALUE> ...]
+#define COMMAND_MGET "MGET" // MGET <KEY> [<KEY> ...]
+#define COMMAND_SET_TTL "SET_TTL" // SET_TTL <KEY> <VALUE> <TTL_MS>
+#define COMMAND_INCR "INCR" // INCR <KEY> <DELTA>
+#define COMMAND_APPEND "APPEND" // APPEND <KEY> <VALUE>
+#define COMMAND_STATS "STATS" // STATS
+#define COMMAND_CHECKPOINT "CHECKPOINT" // CHECKPOINT <NAME>
+#define COMMAND_INGEST "INGEST" // INGEST <NAME>
 
 using command_code_t = uint16_t;
 #define command_hton(x) htons(x)
@@ -33,6 +41,14 @@ typedef enum Command_Code : command_code_t {
 
     // send nothing but header + code
     COMMAND_CODE_DATA_NOT_FOUND,
+    COMMAND_CODE_MSET,
+    COMMAND_CODE_MGET,
+    COMMAND_CODE_SET_TTL,
+    COMMAND_CODE_INCR,
+    COMMAND_CODE_APPEND,
+    COMMAND_CODE_STATS,
+    COMMAND_CODE_CHECKPOINT,
+    COMMAND_CODE_INGEST,
     INVALID_COMMAND_CODE
 } Command_Code;
 
@@ -14,6 +14,7 @@
 
 using cursor_name_len_t = uint8_t;
 using cursor_cap_t = uint16_t;
+using cursor_snapshot_id_t = uint32_t;
 
 #define cursor_cap_hton(x) htons(x)
 #define cursor_cap_ntoh(x) ntohs(x)
@@ -21,13 +22,20 @@ using cursor_cap_t = uint16_t;
 #define cursor_name_len_hton(x) (x)
 #define cursor_name_len_ntoh(x) (x)
 
+#define cursor_snapshot_id_hton(x) htonl(x)
+#define cursor_snapshot_id_ntoh(x) ntohl(x)
+
 #define PROTOCOL_EDGE_FB_FLAG_POS (sizeof(protocol_msg_len_t) + sizeof(protocol_id_t) + sizeof(protocol_array_len_t) - sizeof(cursor_cap_t) - 1)
+// the leading bytes of the array length tell partitions which snapshot the cursor reads from
+#define PROTOCOL_CURSOR_SNAPSHOT_ID_POS (sizeof(protocol_msg_len_t) + sizeof(protocol_id_t))
 
 // used by paritition servers to track cursor info without cursor class overhead
 typedef struct Cursor_Info {
     std::string name;
     cursor_name_len_t name_len;
     cursor_cap_t cap;
+    // changes every time the cursor is (re)created
+    cursor_snapshot_id_t snapshot_id;
 } Cursor_Info;
 
 class Cursor {
@@ -53,6 +61,9 @@ class Cursor {
         // stores last called parition id
         uint16_t l_called_pid;
 
+        // unique per CREATE_CURSOR, partitions pin one lsm snapshot per id so every page reads the same state
+        cursor_snapshot_id_t snapshot_id;
+
     public:
         Cursor();
 
@@ -125,6 +136,10 @@ class Cursor {
         void append_entries_front(std::vector<Entry>&& entries);
 
         std::string get_prefix() const;
+
+        cursor_snapshot_id_t get_snapshot_id() const;
+
+        void set_snapshot_id(cursor_snapshot_id_t snapshot_id);
 };
 
 #endif // YSQL_CURSORS_H_INCLUDED
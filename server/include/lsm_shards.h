@@ -0,0 +1,191 @@
+#ifndef YSQL_LSM_SHARDS_H_INCLUDED
+#define YSQL_LSM_SHARDS_H_INCLUDED
+
+#include "../../lsm_tree/include/lsm_tree.h"
+#include "../../lsm_tree/include/ss_table_writer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// number of independent lsm trees a partition server splits its keys over, each has its own wal and its own writer lock
+#define LSM_SHARDS_COUNT_ENV_VAR "PARTITION_SERVER_SHARD_COUNT"
+#define LSM_SHARDS_DEFAULT_COUNT 1
+#define LSM_SHARDS_MAX_COUNT 256
+
+// "hash" (default) spreads the keys evenly, "range" keeps every shard a contiguous key range so scans read the shards one after another
+#define LSM_SHARDS_ROUTING_ENV_VAR "PARTITION_SERVER_SHARD_ROUTING"
+
+// comma separated keys the ranges are split at with "range" routing, shard i holds the keys in [split i - 1, split i)
+// unset splits on the first byte of the key into equal parts
+#define LSM_SHARDS_SPLIT_KEYS_ENV_VAR "PARTITION_SERVER_SHARD_SPLIT_KEYS"
+
+// with more than one shard, shard i lives in <LSM_SHARDS_DATA_DIR>/shard_<i>/{val,wal}
+#define LSM_SHARDS_DATA_DIR "./data"
+#define LSM_SHARDS_DIR_FORMAT "shard_%u"
+// the routing the shards were created with, keys would be looked for in the wrong shard if it changed
+#define LSM_SHARDS_LAYOUT_FILE_NAME "SHARDS"
+// tables of an ingest spanning several shards are split into <ingest_dir>/<LSM_SHARDS_SPLIT_DIR_NAME>/<table id>/shard_<i>
+#define LSM_SHARDS_SPLIT_DIR_NAME "split"
+// a table being split is written to <table id><LSM_SHARDS_SPLIT_PARTIAL_SUFFIX> until all of its parts are there
+#define LSM_SHARDS_SPLIT_PARTIAL_SUFFIX ".partial"
+
+// a write group leader takes queued writes until the group holds at least this many operations
+#define LSM_SHARDS_MAX_WRITE_GROUP_OPERATIONS 1024
+
+#define LSM_SHARDS_LAYOUT_MISMATCH_ERR_MSG "Shard layout differs from the one the data was written with: "
+#define LSM_SHARDS_LAYOUT_WRITE_ERR_MSG "Failed to write the shard layout file\n"
+#define LSM_SHARDS_CHECKPOINT_EXISTS_ERR_MSG "Checkpoint directory already exists: "
+#define LSM_SHARDS_SPLIT_KEYS_ERR_MSG "Shard split keys must be strictly increasing and one fewer than the shard count\n"
+
+typedef enum Shard_Routing {
+    SHARD_ROUTING_HASH,
+    SHARD_ROUTING_RANGE
+} Shard_Routing;
+
+// The lsm trees of one partition server, each with its own lock so writers to one shard do not stall writers to the others
+// readers take no lock at all, every tree hands them a version of itself that writes do not change
+// point operations go to the shard owning the key, scans merge the shards in key order
+// every method takes the locks it needs, callers never lock a shard themselves
+class LSM_Shards {
+    private:
+        // a write waiting in the queue of its shard, the leader of its group fills in written and sets done
+        struct Pending_Write {
+            const Write_Batch& batch;
+            bool done;
+            bool written;
+        };
+
+        struct Shard {
+            LSM_Tree lsm_tree;
+
+            // set, remove, merge and write take it unique, one writer at a time
+            // acquire_snapshots takes it shared so no write is half way done when a snapshot is taken
+            std::shared_mutex mutex;
+
+            // writes waiting for the shard in arrival order, the one in front leads the next group
+            std::mutex write_queue_mutex;
+            std::condition_variable write_queue_cv;
+            std::deque<Pending_Write*> write_queue;
+
+            explicit Shard(const LSM_Options& options);
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        Shard_Routing routing;
+
+        // with range routing shard i + 1 starts at split_keys[i]
+        std::vector<std::string> split_keys;
+
+        // groups written by write_group() and the writes they held, writes / groups is the average group size
+        std::atomic<uint64_t> write_groups;
+        std::atomic<uint64_t> grouped_writes;
+
+        // how long the constructor took to open every shard
+        uint64_t open_micros;
+
+        // @brief queues batch behind the writes already waiting for shard, the first writer in the queue becomes the leader
+        // the leader takes the shard lock once, writes its own batch and the ones queued after it as a single LSM_Tree::write
+        // (one wal record, one mem_table lock) and hands every follower the result, followers just wait for it
+        // @returns true if the group holding batch was written
+        bool write_group(Shard& shard, const Write_Batch& batch);
+
+        // @returns shard count, routing and split keys as stored in the layout file
+        std::string get_layout(uint32_t shard_count) const;
+
+        // THROWS
+        // @brief writes the layout file on the first start, compares against it on every following one
+        void check_layout(const std::filesystem::path& data_dir, uint32_t shard_count) const;
+
+        // THROWS
+        void write_layout(const std::filesystem::path& data_dir, uint32_t shard_count) const;
+
+        // @returns data_dir/shard_<shard_index>, where the trees of shard shard_index live when there is more than one shard
+        static std::filesystem::path get_shard_dir(const std::filesystem::path& data_dir, uint32_t shard_index);
+
+        // merges per shard pages of up to n keys into the first n keys overall in the direction of the scan
+        // next_key becomes the first key left out over all shards, or ENTRY_PLACEHOLDER_KEY if nothing was
+        template<typename T>
+        static std::pair<std::set<T>, std::string> merge_pages(std::vector<std::pair<std::set<T>, std::string>>& pages, uint16_t n, bool forward);
+
+        // @brief reads a page of up to n items starting at cursor, read_shard reads a page from one shard
+        // hash routing asks every shard and merges the pages, range routing walks the shards from the one owning cursor until the page is full
+        template<typename T, typename Read>
+        std::pair<std::set<T>, std::string> read_page(const std::string& cursor, uint16_t n, bool forward, Read read_shard);
+
+    public:
+        // THROWS
+        // @brief opens the shards picked by the LSM_SHARDS_* environment variables, each on a thread of its own
+        // a single shard keeps the unsharded layout of LSM_Options::from_environment() so existing data stays readable
+        LSM_Shards();
+
+        // @returns index of the shard owning key
+        uint32_t get_shard_index(const std::string& key) const;
+
+        uint32_t get_shard_count() const;
+
+        Shard_Routing get_routing() const;
+
+        // THROWS
+        // @brief sets without a ttl and removes go through write_group(), so concurrent writers to a shard share a wal write
+        bool set(const std::string& key, const std::string& value, uint64_t ttl = LSM_TREE_NO_TTL);
+
+        // THROWS
+        bool remove(const std::string& key);
+
+        bool merge(const std::string& key, merge_operator_id_type merge_operator_id, const std::string& operand);
+
+        Entry get(const std::string& key);
+
+        // @brief a batch for a single shard joins its write group, others are split by shard and the parts written while holding the locks of every shard involved
+        // reads at snapshots from acquire_snapshots() see all of it or none, reads of the latest state may see one shard's part before another's
+        // each shard logs its part to its own wal, after a crash a batch spanning shards may be replayed in part
+        bool write(const Write_Batch& batch);
+
+        // @returns the entries of keys in the same order, looked up with one multi_get per shard
+        std::vector<Entry> multi_get(const std::vector<std::string>& keys, const std::vector<sequence_number_type>& snapshots = {});
+
+        // @brief counters of all of the shards added up by Statistics::merge_counters, with the write group counts
+        std::map<std::string, uint64_t> get_statistics();
+
+        // @brief acquires one snapshot per shard while holding all of their shared locks, so together they are one point in time
+        std::vector<sequence_number_type> acquire_snapshots();
+
+        void release_snapshots(const std::vector<sequence_number_type>& snapshots);
+
+        // the cursor reads below take the snapshots of acquire_snapshots(), an empty vector reads the latest state
+        std::pair<std::set<Bits>, std::string> get_keys_cursor(const std::string& cursor, uint16_t n, const std::vector<sequence_number_type>& snapshots = {});
+
+        std::pair<std::set<Bits>, std::string> get_keys_cursor_prefix(const std::string& prefix, const std::string& cursor, uint16_t n, const std::vector<sequence_number_type>& snapshots = {});
+
+        std::pair<std::set<Entry>, std::string> get_ff(const std::string& key, uint16_t n, const std::vector<sequence_number_type>& snapshots = {});
+
+        std::pair<std::set<Entry>, std::string> get_fb(const std::string& key, uint16_t n, const std::vector<sequence_number_type>& snapshots = {});
+
+        // @brief starts scrubbing the next table of shard shard_index that is due, see LSM_Tree::start_scrub
+        std::unique_ptr<Table_Scrubber> start_scrub(uint32_t shard_index);
+
+        bool finish_scrub(uint32_t shard_index, const Table_Scrubber& scrubber);
+
+        bool quarantine_ss_table(uint32_t shard_index, level_index_type level, uint64_t table_id);
+
+        // THROWS
+        // @brief writes a checkpoint of every shard to checkpoint_dir, laid out like LSM_SHARDS_DATA_DIR so it can be copied back in place of it
+        // the unique locks of all shards are held throughout, so the shards are checkpointed at one point in time, see LSM_Tree::create_checkpoint
+        void create_checkpoint(const std::filesystem::path& checkpoint_dir);
+
+        // THROWS
+        // @brief ingests every table SS_Table_Writer wrote into ingest_dir, see LSM_Tree::ingest_files, the files are moved into the shards
+        // a table whose keys all belong to one shard goes to it as it is, the others are first split into one table per shard
+        // each shard is locked only while its tables go in, throws if a snapshot is live in any shard it reaches
+        // split tables are removed only after every shard ingested, calling it again after a throw ingests what the shards have not taken yet
+        void ingest_files(const std::filesystem::path& ingest_dir);
+};
+
+#endif // YSQL_LSM_SHARDS_H_INCLUDED
@@ -6,9 +6,14 @@
 #include "protocol.h"
 #include "server.h"
 #include <cstdio>
-#include "../../lsm_tree/include/lsm_tree.h"
+#include "lsm_shards.h"
 #include "server_message.h"
 #include <shared_mutex>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
 
 #define PARTITION_SERVER_NAME_PREFIX "yessql-partition_server-"
 #define PARTITION_SERVER_PORT 9001
@@ -17,6 +22,29 @@
 
 #define PARTITION_SERVER_FAILED_TO_EXTRACT_DATA_ERR_MSG "Failed to extract data from message - too short\n"
 
+#define PARTITION_SERVER_STARTUP_MSG "Partition opened "
+
+// bytes per second the background scrub reads the tables at, 0 turns it off
+#define PARTITION_SERVER_SCRUB_RATE_ENV_VAR "PARTITION_SERVER_SCRUB_RATE"
+#define PARTITION_SERVER_DEFAULT_SCRUB_RATE (4 << 20)
+// the scrub reads this much between pauses
+#define PARTITION_SERVER_SCRUB_STEP_SIZE (256 << 10)
+// how long the scrub waits before looking again once every table was scrubbed recently
+#define PARTITION_SERVER_SCRUB_IDLE_MS 60000
+
+// CHECKPOINT <name> writes a checkpoint of the partition to <PARTITION_SERVER_CHECKPOINT_DIR>/<name>
+#define PARTITION_SERVER_CHECKPOINT_DIR_ENV_VAR "PARTITION_SERVER_CHECKPOINT_DIR"
+#define PARTITION_SERVER_DEFAULT_CHECKPOINT_DIR "./checkpoints"
+
+// INGEST <name> ingests the tables bulk_loader wrote for this partition, once they were copied to <PARTITION_SERVER_INGEST_DIR>/<name>
+#define PARTITION_SERVER_INGEST_DIR_ENV_VAR "PARTITION_SERVER_INGEST_DIR"
+#define PARTITION_SERVER_DEFAULT_INGEST_DIR "./ingest"
+
+#define PARTITION_SERVER_BAD_DIR_NAME_ERR_MSG "Checkpoint and ingest names must be plain file names\n"
+
+// partitions are not told when a cursor is deleted, a pinned snapshot is released once its cursor was idle this long
+#define PARTITION_SERVER_CURSOR_SNAPSHOT_TTL_SEC 60
+
 #define COLOR_RED     "\033[31m"
 #define COLOR_GREEN   "\033[32m"
 #define COLOR_RESET   "\033[0m"
@@ -26,15 +54,60 @@
 
 class Partition_Server : public Server {
     private:
-        LSM_Tree lsm_tree;
-        
-        // mutex used for locking operations of the lsm tree
-        // all getters get shared_lock
-        // remove and set gets unique_lock
-        std::shared_mutex lsm_tree_mutex;
+        // the lsm trees of this partition, every shard is locked on its own
+        // getters read a version of the tree without any lock
+        // concurrent sets and removes of a shard are written in groups, one wal write per group
+        LSM_Shards lsm_shards;
+
+        // lsm snapshots pinned by a cursor, one per shard, so all of its pages read the same state of the partition
+        struct Cursor_Snapshot {
+            cursor_snapshot_id_t snapshot_id;
+            std::vector<sequence_number_type> snapshots;
+            std::chrono::steady_clock::time_point last_used;
+        };
+
+        // keyed by client id and cursor name
+        std::mutex cursor_snapshots_mutex;
+        std::unordered_map<std::string, Cursor_Snapshot> cursor_snapshots;
+
+        // @brief returns the snapshots pinned by the cursor, pins new ones on the first request of a (re)created cursor
+        // also releases snapshots of cursors that have been idle for longer than PARTITION_SERVER_CURSOR_SNAPSHOT_TTL_SEC
+        std::vector<sequence_number_type> pin_cursor_snapshot(protocol_id_t client_id, const Cursor_Info& curs_info);
 
         void process_remove_queue() override;
 
+        // background scrub checking every table against its checksums, paced to scrub_rate bytes per second
+        uint64_t scrub_rate;
+        bool scrubber_stopping;
+        std::mutex scrubber_mutex;
+        std::condition_variable scrubber_cv;
+        std::thread scrubber_thread;
+
+        // @returns the scrub rate picked with PARTITION_SERVER_SCRUB_RATE_ENV_VAR
+        uint64_t get_scrub_rate() const;
+
+        // @brief prints how long opening the shards took and where the time went
+        void log_startup_stats();
+
+        // checkpoints go to this directory and ingested tables come from this one, one subdirectory each
+        std::filesystem::path checkpoint_dir;
+        std::filesystem::path ingest_dir;
+
+        // @returns the value of env_var, default_dir if it is not set
+        static std::filesystem::path get_dir(const char* env_var, const char* default_dir);
+
+        // THROWS
+        // @returns the subdirectory name of dir named in the message, it has to be a plain file name
+        std::filesystem::path extract_subdir(const std::filesystem::path& dir, const Server_Message& message) const;
+
+        // @brief scrubs one table after another, going round the shards, until the server shuts down
+        // tables are opened and read without any lock, only quarantining a corrupted one takes the unique lock of its shard
+        void run_scrubber();
+
+        // @brief waits for duration or until the server shuts down
+        // @returns false if it is shutting down
+        bool scrubber_wait(std::chrono::milliseconds duration);
+
     public:
         Partition_Server(uint16_t port, uint8_t verbose = SERVER_DEFAULT_VERBOSE_VAL, uint32_t thread_pool_size = SERVER_DEFAULT_THREAD_POOL_VAL);
 
@@ -44,18 +117,41 @@ class Partition_Server : public Server {
         // extracts the first value string contained in the message
         std::string extract_value(const std::string& raw_message) const;
 
+        // THROWS
+        // extracts the ttl following the first value, as sent with SET_TTL
+        protocol_ttl_t extract_ttl(const std::string& raw_message) const;
+
         // Processes the clients request GET SET etc...
         int8_t process_request(socket_t socket_fd, Server_Message& serv_msg);
 
-        // handles SET, responds to the socket_fd, upon failure returns <0 on success >= 0 
+        // handles SET and SET_TTL, responds to the socket_fd, upon failure returns <0 on success >= 0 
         int8_t handle_set_request(socket_t socket_fd, const Server_Message& message);
 
+        // handles INCR and APPEND as merges into the key, responds to the socket_fd, upon failure returns <0 on success >= 0
+        int8_t handle_merge_request(socket_t socket_fd, const Server_Message& message, Command_Code com_code);
+
         // handles GET, responds to the socket_fd, upon failure returns <0 on success >= 0 
         int8_t handle_get_request(socket_t socket_fd, const Server_Message& message);
 
         // handles REMOVE, responds to the socket_fd, upon failure returns <0 on success >= 0 
         int8_t handle_remove_request(socket_t socket_fd, const Server_Message& message);
 
+        // handles MSET, writes all of the pairs as one batch under a single lock, responds to the socket_fd, upon failure returns <0 on success >= 0
+        int8_t handle_mset_request(socket_t socket_fd, const Server_Message& message);
+
+        // handles MGET, looks all of the keys up with one multi_get, responds with the ones found, upon failure returns <0 on success >= 0
+        int8_t handle_mget_request(socket_t socket_fd, const Server_Message& message);
+
+        // handles STATS, responds with every counter of the lsm tree as a name and decimal value pair, upon failure returns <0 on success >= 0
+        int8_t handle_stats_request(socket_t socket_fd, const Server_Message& message);
+
+        // handles CHECKPOINT, writes a checkpoint of every shard under checkpoint_dir, responds OK once it is on disk, upon failure returns <0 on success >= 0
+        int8_t handle_checkpoint_request(socket_t socket_fd, const Server_Message& message);
+
+        // handles INGEST, ingests the tables in a subdirectory of ingest_dir into the shards, responds OK once they are in, upon failure returns <0 on success >= 0
+        // releases the snapshots of open cursors first, their next page reads the partition with the ingested tables in
+        int8_t handle_ingest_request(socket_t socket_fd, const Server_Message& message);
+
         int8_t handle_get_keys_request(socket_t socket_fd, Server_Message& message);
 
         int8_t handle_get_keys_prefix_request(socket_t socket_fd, Server_Message& message);
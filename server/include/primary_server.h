@@ -15,6 +15,8 @@
 #include "partition_server.h"
 #include "../include/partition_entry.h"
 #include <limits>
+#include <map>
+#include <mutex>
 #include <unistd.h>
 #include "fd_context.h"
 #include "cursor.h"
@@ -44,8 +46,6 @@
 #define PRIMARY_SERVER_PARTITION_MONITORING
 #define PRIMARY_SERVER_PARTITION_STR_PREFIX "Partition "
 
-#define PRIMARY_SERVER_BYTES_IN_KEY_PREFIX 4
-
 // primary server must:
 // periodically send request to all partitions to figure out if they are all alive
 // rerout requests based on which partition we want to send to
@@ -65,13 +65,30 @@ class Primary_Server : public Server {
         // id pool for new clients
         std::atomic<uint64_t> req_id{1};
 
-        uint32_t partition_count;
+        // id pool for cursor snapshots, a recreated cursor gets a new id so partitions pin a fresh snapshot
+        std::atomic<cursor_snapshot_id_t> cursor_snapshot_id{1};
 
-        uint32_t partition_range_length;
+        uint32_t partition_count;
 
         std::shared_mutex partitions_mutex;
         std::vector<Partition_Entry> partitions;
 
+        // MSET, MGET, STATS, CHECKPOINT or INGEST split across partitions, the client is answered once every partition replied
+        struct Pending_Scatter {
+            Command_Code com_code;
+            uint32_t remaining;
+            bool failed;
+            // MGET only, the keys in request order and the values gathered so far
+            std::vector<std::string> keys;
+            std::unordered_map<std::string, std::string> values;
+            // STATS only, the counters of every partition that replied added up
+            std::map<std::string, uint64_t> counters;
+        };
+
+        // maps client_id to its request still waiting for partition replies
+        std::mutex pending_scatters_mutex;
+        std::unordered_map<protocol_id_t, Pending_Scatter> pending_scatters;
+
         // map for client cursors
         std::shared_mutex client_cursor_map_mutex;
         std::unordered_map<socket_t, std::unordered_map<std::string, Cursor>> client_cursor_map;
@@ -81,8 +98,6 @@ class Primary_Server : public Server {
         void display_partitions_status() const;
         void start_partition_monitor_thread() const;
 
-        uint32_t key_prefix_to_uint32(const std::string& key) const;
-
         Partition_Entry get_partition_for_key(const std::string& key);
 
         std::vector<Partition_Entry> get_partitions_ff(const std::string& key) const;
@@ -98,6 +113,21 @@ class Primary_Server : public Server {
 
         int8_t process_partition_response(Server_Message&& msg);
 
+        // splits the MSET pairs by partition and sends every partition its slice
+        int8_t process_mset_request(socket_t client_fd, const Server_Message& msg);
+
+        // splits the MGET keys by partition and sends every partition its slice, all of them at once
+        int8_t process_mget_request(socket_t client_fd, const Server_Message& msg);
+
+        // sends com_code with args to every partition, STATS gets their counters added up with histograms summarized into percentiles
+        // CHECKPOINT and INGEST get OK once every partition wrote its checkpoint or ingested its tables
+        int8_t process_broadcast_request(socket_t client_fd, const Server_Message& msg, Command_Code com_code, const std::vector<std::string>& args);
+
+        // @brief counts a partition reply towards the pending MSET / MGET / STATS / CHECKPOINT / INGEST of client_id, answers the client after the last one
+        // reply is nullptr if the slice never reached its partition
+        // @returns false if client_id has nothing pending
+        bool settle_pending_scatter(protocol_id_t client_id, const Server_Message* reply);
+
         void add_partitions_to_epoll();
 
         // sets client_fd to epollout and adds a message to its write_buffer
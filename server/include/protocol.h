@@ -39,6 +39,10 @@ using protocol_value_len_t = value_len_type;
 #define protocol_value_len_hton(x) htonl(x)
 #define protocol_value_len_ntoh(x) ntohl(x)
 
+using protocol_ttl_t = uint64_t;
+#define protocol_ttl_hton(x) htonll(x)
+#define protocol_ttl_ntoh(x) ntohll(x)
+
 using protocol_id_t = uint64_t;
 #define protocol_id_hton(x) htonll(x)
 #define protocol_id_ntoh(x) ntohll(x)
@@ -84,6 +88,57 @@ using protocol_id_t = uint64_t;
 *    For primary [msg_len]GET_FF[num_of_els][cid][key_len][key][val_len][val]....[next_key_len][next_key][curs_len][cursor_name]
 */
 
+/* MSET
+ *  For client [msg_len][num_of_pairs][MSET]([key_len][key][val_len][val])...
+ *  For partition [msg_len][cid][num_of_pairs][MSET]([key_len][key][val_len][val])... only the pairs owned by that partition
+ *  each partition applies its pairs as one batch and answers OK or ERR, the client gets a single OK once every partition did
+ */
+
+/* MGET
+ *  For client [msg_len][num_of_keys][MGET]([key_len][key])...
+ *  For partition [msg_len][cid][num_of_keys][MGET]([key_len][key])... only the keys owned by that partition
+ *  partitions answer with OK followed by the ([key_len][key][val_len][val]) they found
+ *  the client gets one OK with the found pairs in the order the keys were asked for, keys that were not found are left out
+ */
+
+/* SET_TTL
+ *  For client [msg_len][num_of_els][SET_TTL][key_len][key][val_len][val][ttl]
+ *  For partition [msg_len][cid][num_of_els][SET_TTL][key_len][key][val_len][val][ttl]
+ *  (uint64_t)[ttl] milliseconds until the key expires, routed and answered like SET
+ *  once expired the key reads as not found and compaction drops it
+ */
+
+/* INCR, APPEND
+ *  For client [msg_len][num_of_els][INCR/APPEND][key_len][key][val_len][val]
+ *  For partition [msg_len][cid][num_of_els][INCR/APPEND][key_len][key][val_len][val]
+ *  INCR adds [val], a signed 64 bit integer in decimal, to the value of the key, APPEND adds [val] to its end
+ *  a missing key counts as 0 or empty, routed like SET and answered with OK without the new value
+ *  the update is stored as a merge operand and applied on read, an INCR on a value that is not a number is ignored
+ *  ERR if an INCR delta is not a decimal integer
+ */
+
+/* STATS
+ *  For client [msg_len][0][STATS]
+ *  For partition [msg_len][cid][0][STATS]
+ *  partitions answer with OK followed by ([name_len][name][val_len][val])... where [val] is the counter in decimal
+ *  histograms come as <name>.count, <name>.sum, <name>.max and their raw <name>.bucket.<i> counts
+ *  the client gets one OK with the counters of every partition added up, buckets replaced by <name>.p50, <name>.p95 and <name>.p99
+ */
+
+/* CHECKPOINT
+ *  For client [msg_len][1][CHECKPOINT][name_len][name]
+ *  For partition [msg_len][cid][1][CHECKPOINT][name_len][name]
+ *  every partition writes a checkpoint of its data to <PARTITION_SERVER_CHECKPOINT_DIR>/<name>, laid out like its ./data
+ *  OK once every partition wrote its checkpoint, ERR if any failed, the name is taken already or it is not a plain file name
+ */
+
+/* INGEST
+ *  For client [msg_len][1][INGEST][name_len][name]
+ *  For partition [msg_len][cid][1][INGEST][name_len][name]
+ *  every partition ingests the tables waiting in <PARTITION_SERVER_INGEST_DIR>/<name>, as bulk_loader wrote them for it
+ *  OK once every partition ingested its tables, ERR if any failed, e.g. because a cursor pins a snapshot
+ */
+
 /* CREATE/DELETE cursor
  *  [msg_len][cursor_size][cursor_cmd][curs_len][curs_name][key_len][key]
  *   (uint64_t)[msg_len](uint64)[array_len]=0  (uint16_t)[cursor_cmd](uint8_t)[curs_len][curs_name](uint16_t)[key_len][key]
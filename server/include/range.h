@@ -2,10 +2,23 @@
 #define YSQL_RANGE_H_INCLUDED
 
 #include <cstdint>
+#include <string>
+
+// keys are placed on [0, UINT32_MAX] by this many of their first bytes
+#define RANGE_BYTES_IN_KEY_PREFIX 4
 
 typedef struct Range {
     uint32_t beg;
     uint32_t end;
 } Range;
 
-#endif // YSQL_RANGE_H_INCLUDED
\ No newline at end of file
+// @returns the first RANGE_BYTES_IN_KEY_PREFIX bytes of key as a big endian number, shorter keys are padded with zeros
+uint32_t key_prefix_to_uint32(const std::string& key);
+
+// @returns the range of partition partition_index when [0, UINT32_MAX] is split evenly, the last partition reaches UINT32_MAX
+Range get_partition_range(uint32_t partition_index, uint32_t partition_count);
+
+// @returns index of the partition whose range holds key, the same one Primary_Server sends key to
+uint32_t get_partition_index(const std::string& key, uint32_t partition_count);
+
+#endif // YSQL_RANGE_H_INCLUDED
@@ -172,6 +172,28 @@ class Server {
 
         protocol_array_len_t extract_array_size(std::string msg, bool contains_cid);
 
+        // THROWS
+        // @brief reads the element count of a message and checks the message is long enough to hold that many elements of min_element_size
+        protocol_array_len_t extract_key_count(const std::string& message, bool contains_cid, uint64_t min_element_size) const;
+
+        // @brief writes [msg_len][cid][array_len][com_code] at the start of message, which must already have its full size
+        // @returns the position right after the header
+        size_t write_message_header(std::string& message, Command_Code com_code, protocol_array_len_t array_len, bool contain_cid, protocol_id_t client_id) const;
+
+        // THROWS
+        // @brief extracts every [key_len][key][val_len][val] pair following the command code, as sent with MSET
+        std::vector<std::pair<std::string, std::string>> extract_key_value_pairs(const std::string& message, bool contains_cid) const;
+
+        // @brief builds a message of com_code followed by the key value pairs, the inverse of extract_key_value_pairs
+        Server_Message create_key_value_pairs_message(Command_Code com_code, const std::vector<std::pair<std::string, std::string>>& pairs, bool contain_cid, protocol_id_t client_id) const;
+
+        // THROWS
+        // @brief extracts every [key_len][key] following the command code, as sent with MGET
+        std::vector<std::string> extract_keys(const std::string& message, bool contains_cid) const;
+
+        // @brief builds a message of com_code followed by the keys, the inverse of extract_keys
+        Server_Message create_keys_message(Command_Code com_code, const std::vector<std::string>& keys, bool contain_cid, protocol_id_t client_id) const;
+
         
     public:
         // THROWS
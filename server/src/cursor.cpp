@@ -3,7 +3,7 @@
 #include <stdexcept>
 #include "../include/server_error.h"
 
-Cursor::Cursor() : cid(0), name(""), size(0), capacity(0), next_key_str(""), max_key(false) {
+Cursor::Cursor() : cid(0), name(""), size(0), capacity(0), next_key_str(""), max_key(false), snapshot_id(0) {
 
 }
 
@@ -16,6 +16,7 @@ Cursor::Cursor(const std::string& cursor_name) {
     this -> name = cursor_name;
     this -> size = 0;
     this -> max_key = false;
+    this -> snapshot_id = 0;
 }
 
 
@@ -30,6 +31,7 @@ Cursor::Cursor(const std::string& cursor_name, const protocol_id_t& client_id) {
     this -> size = 0;
     this -> next_key_str = "";
     this -> max_key = false;
+    this -> snapshot_id = 0;
 }
 
 Cursor::Cursor(const std::string& cursor_name, const protocol_id_t& client_id, const std::string& next_key, const protocol_key_len_t& key_len) {
@@ -44,6 +46,7 @@ Cursor::Cursor(const std::string& cursor_name, const protocol_id_t& client_id, c
     this -> next_key_len = key_len;
     this -> size = 0;
     this -> max_key = false;
+    this -> snapshot_id = 0;
 }
 
 protocol_id_t Cursor::get_cid() const {
@@ -160,4 +163,12 @@ void Cursor::append_entries_front(std::vector<Entry>&& entries) {
     this -> fetched_entries.insert(this -> fetched_entries.begin(), std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
 
     this -> size = fetched_entries.size();
-}
\ No newline at end of file
+}
+
+cursor_snapshot_id_t Cursor::get_snapshot_id() const {
+    return this -> snapshot_id;
+}
+
+void Cursor::set_snapshot_id(cursor_snapshot_id_t snapshot_id) {
+    this -> snapshot_id = snapshot_id;
+}
@@ -0,0 +1,684 @@
+#include "../include/lsm_shards.h"
+#include "../../lsm_tree/include/crc32.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+// @returns the key an item of a page is ordered by
+static std::string get_page_key(const Bits& bits) {
+    return bits.get_string();
+}
+
+static std::string get_page_key(const Entry& entry) {
+    return entry.get_key_string();
+}
+
+static sequence_number_type get_snapshot(const std::vector<sequence_number_type>& snapshots, uint32_t shard_index) {
+    return shard_index < snapshots.size()? snapshots[shard_index] : LSM_TREE_LATEST_SNAPSHOT;
+}
+
+LSM_Shards::Shard::Shard(const LSM_Options& options) : lsm_tree(options) {
+
+}
+
+LSM_Shards::LSM_Shards() : routing(SHARD_ROUTING_HASH), write_groups(0), grouped_writes(0), open_micros(0) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint32_t shard_count = LSM_SHARDS_DEFAULT_COUNT;
+    const char* shard_count_str = std::getenv(LSM_SHARDS_COUNT_ENV_VAR);
+    if(shard_count_str) {
+        uint64_t count = strtoull(shard_count_str, nullptr, 10);
+        if(count >= 1 && count <= LSM_SHARDS_MAX_COUNT) {
+            shard_count = count;
+        }
+    }
+
+    const char* routing_str = std::getenv(LSM_SHARDS_ROUTING_ENV_VAR);
+    if(routing_str && std::string(routing_str) == "range") {
+        this -> routing = SHARD_ROUTING_RANGE;
+    }
+
+    if(this -> routing == SHARD_ROUTING_RANGE && shard_count > 1) {
+        const char* split_keys_str = std::getenv(LSM_SHARDS_SPLIT_KEYS_ENV_VAR);
+        if(split_keys_str) {
+            std::string split_keys_list(split_keys_str);
+            size_t start = 0;
+            while(true) {
+                size_t comma = split_keys_list.find(',', start);
+                this -> split_keys.push_back(split_keys_list.substr(start, comma == std::string::npos? std::string::npos : comma - start));
+                if(comma == std::string::npos) {
+                    break;
+                }
+                start = comma + 1;
+            }
+        }
+        else {
+            for(uint32_t i = 1; i < shard_count; ++i) {
+                this -> split_keys.push_back(std::string(1, static_cast<char>(i * 256 / shard_count)));
+            }
+        }
+
+        if(this -> split_keys.size() != shard_count - 1 || this -> split_keys.front().empty()) {
+            throw std::invalid_argument(LSM_SHARDS_SPLIT_KEYS_ERR_MSG);
+        }
+
+        for(size_t i = 1; i < this -> split_keys.size(); ++i) {
+            if(this -> split_keys[i - 1] >= this -> split_keys[i]) {
+                throw std::invalid_argument(LSM_SHARDS_SPLIT_KEYS_ERR_MSG);
+            }
+        }
+    }
+
+    LSM_Options options = LSM_Options::from_environment();
+    std::filesystem::path data_dir(LSM_SHARDS_DATA_DIR);
+
+    this -> check_layout(data_dir, shard_count);
+
+    if(shard_count == 1) {
+        this -> shards.push_back(std::make_unique<Shard>(options));
+        this -> open_micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        return;
+    }
+
+    // the shards replay their wals and open their tables side by side, sharing the table open threads between them
+    this -> shards.resize(shard_count);
+    std::vector<std::exception_ptr> errors(shard_count);
+    std::vector<std::thread> openers;
+    for(uint32_t i = 0; i < shard_count; ++i) {
+        LSM_Options shard_options = options;
+        shard_options.data_dir = get_shard_dir(data_dir, i) / "val";
+        shard_options.wal_dir = get_shard_dir(data_dir, i) / "wal";
+        shard_options.table_open_threads = std::max<uint32_t>(1, options.table_open_threads / shard_count);
+
+        openers.emplace_back([this, i, shard_options, &errors]() {
+            try {
+                this -> shards[i] = std::make_unique<Shard>(shard_options);
+            }
+            catch(...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+
+    for(std::thread& opener : openers) {
+        opener.join();
+    }
+
+    for(const std::exception_ptr& error : errors) {
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    this -> open_micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string LSM_Shards::get_layout(uint32_t shard_count) const {
+    if(shard_count == 1) {
+        return "1";
+    }
+
+    std::string layout = std::to_string(shard_count);
+    if(this -> routing == SHARD_ROUTING_HASH) {
+        return layout + " hash";
+    }
+
+    layout += " range";
+    for(const std::string& split_key : this -> split_keys) {
+        layout += " " + split_key;
+    }
+
+    return layout;
+}
+
+void LSM_Shards::check_layout(const std::filesystem::path& data_dir, uint32_t shard_count) const {
+    std::filesystem::path layout_path = data_dir / LSM_SHARDS_LAYOUT_FILE_NAME;
+    std::string layout = this -> get_layout(shard_count);
+
+    std::ifstream layout_in(layout_path);
+    if(layout_in) {
+        std::string stored_layout;
+        std::getline(layout_in, stored_layout);
+        if(stored_layout != layout) {
+            throw std::runtime_error(LSM_SHARDS_LAYOUT_MISMATCH_ERR_MSG + stored_layout + " != " + layout + "\n");
+        }
+        return;
+    }
+
+    this -> write_layout(data_dir, shard_count);
+}
+
+void LSM_Shards::write_layout(const std::filesystem::path& data_dir, uint32_t shard_count) const {
+    std::filesystem::create_directories(data_dir);
+    std::ofstream layout_out(data_dir / LSM_SHARDS_LAYOUT_FILE_NAME, std::ios::trunc);
+    layout_out << this -> get_layout(shard_count) << "\n";
+    if(!layout_out) {
+        throw std::runtime_error(LSM_SHARDS_LAYOUT_WRITE_ERR_MSG);
+    }
+}
+
+std::filesystem::path LSM_Shards::get_shard_dir(const std::filesystem::path& data_dir, uint32_t shard_index) {
+    char shard_dir[32];
+    snprintf(shard_dir, sizeof(shard_dir), LSM_SHARDS_DIR_FORMAT, shard_index);
+    return data_dir / shard_dir;
+}
+
+uint32_t LSM_Shards::get_shard_index(const std::string& key) const {
+    if(this -> shards.size() == 1) {
+        return 0;
+    }
+
+    if(this -> routing == SHARD_ROUTING_RANGE) {
+        return std::upper_bound(this -> split_keys.begin(), this -> split_keys.end(), key) - this -> split_keys.begin();
+    }
+
+    std::string key_copy(key);
+    return crc32(key_copy) % this -> shards.size();
+}
+
+uint32_t LSM_Shards::get_shard_count() const {
+    return this -> shards.size();
+}
+
+Shard_Routing LSM_Shards::get_routing() const {
+    return this -> routing;
+}
+
+bool LSM_Shards::write_group(Shard& shard, const Write_Batch& batch) {
+    Pending_Write pending{batch, false, false};
+
+    std::unique_lock<std::mutex> queue_lock(shard.write_queue_mutex);
+    shard.write_queue.push_back(&pending);
+    shard.write_queue_cv.wait(queue_lock, [&shard, &pending](){
+        return pending.done || shard.write_queue.front() == &pending;
+    });
+
+    if(pending.done) {
+        return pending.written;
+    }
+
+    // everything queued behind the leader so far goes along, writers arriving meanwhile wait for the next group
+    std::vector<Pending_Write*> group;
+    size_t operation_count = 0;
+    for(Pending_Write* queued : shard.write_queue) {
+        if(!group.empty() && operation_count + queued -> batch.size() > LSM_SHARDS_MAX_WRITE_GROUP_OPERATIONS) {
+            break;
+        }
+        group.push_back(queued);
+        operation_count += queued -> batch.size();
+    }
+    queue_lock.unlock();
+
+    bool written;
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if(group.size() == 1) {
+            written = shard.lsm_tree.write(batch);
+        }
+        else {
+            // the batches keep the order they were queued in, so a later write to a key still wins
+            Write_Batch group_batch;
+            for(Pending_Write* member : group) {
+                group_batch.append(member -> batch);
+            }
+            written = shard.lsm_tree.write(group_batch);
+        }
+    }
+
+    ++this -> write_groups;
+    this -> grouped_writes += group.size();
+
+    queue_lock.lock();
+    for(Pending_Write* member : group) {
+        member -> written = written;
+        member -> done = true;
+        shard.write_queue.pop_front();
+    }
+    queue_lock.unlock();
+
+    // wakes the followers and whoever leads the next group
+    shard.write_queue_cv.notify_all();
+    return written;
+}
+
+bool LSM_Shards::set(const std::string& key, const std::string& value, uint64_t ttl) {
+    Shard& shard = *this -> shards[this -> get_shard_index(key)];
+
+    // a write batch has no ttl, these are rare enough to go on their own
+    if(ttl != LSM_TREE_NO_TTL) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.lsm_tree.set(key, value, ttl);
+    }
+
+    Write_Batch batch;
+    batch.put(key, value);
+    return this -> write_group(shard, batch);
+}
+
+bool LSM_Shards::remove(const std::string& key) {
+    Write_Batch batch;
+    batch.remove(key);
+    return this -> write_group(*this -> shards[this -> get_shard_index(key)], batch);
+}
+
+bool LSM_Shards::merge(const std::string& key, merge_operator_id_type merge_operator_id, const std::string& operand) {
+    Shard& shard = *this -> shards[this -> get_shard_index(key)];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.lsm_tree.merge(key, merge_operator_id, operand);
+}
+
+Entry LSM_Shards::get(const std::string& key) {
+    return this -> shards[this -> get_shard_index(key)] -> lsm_tree.get(key);
+}
+
+bool LSM_Shards::write(const Write_Batch& batch) {
+    if(batch.empty()) {
+        return true;
+    }
+
+    if(this -> shards.size() == 1) {
+        return this -> write_group(*this -> shards[0], batch);
+    }
+
+    // the operations keep their order within each shard, so later ones still win over earlier ones on the same key
+    std::vector<Write_Batch> shard_batches(this -> shards.size());
+    for(const Entry& entry : batch.get_entries()) {
+        std::string key = entry.get_key_string();
+        Write_Batch& shard_batch = shard_batches[this -> get_shard_index(key)];
+        if(entry.is_deleted()) {
+            shard_batch.remove(key);
+        }
+        else {
+            shard_batch.put(key, entry.get_value_string());
+        }
+    }
+
+    uint32_t involved_shards = std::count_if(shard_batches.begin(), shard_batches.end(), [](const Write_Batch& shard_batch){
+        return !shard_batch.empty();
+    });
+    if(involved_shards == 1) {
+        uint32_t shard_index = this -> get_shard_index(batch.get_entries().front().get_key_string());
+        return this -> write_group(*this -> shards[shard_index], shard_batches[shard_index]);
+    }
+
+    // locked in index order, every multi shard operation does the same so they cannot deadlock
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    for(uint32_t i = 0; i < this -> shards.size(); ++i) {
+        if(!shard_batches[i].empty()) {
+            locks.emplace_back(this -> shards[i] -> mutex);
+        }
+    }
+
+    bool written = true;
+    for(uint32_t i = 0; i < this -> shards.size(); ++i) {
+        if(!shard_batches[i].empty()) {
+            written = this -> shards[i] -> lsm_tree.write(shard_batches[i]) && written;
+        }
+    }
+
+    return written;
+}
+
+std::vector<Entry> LSM_Shards::multi_get(const std::vector<std::string>& keys, const std::vector<sequence_number_type>& snapshots) {
+    if(this -> shards.size() == 1) {
+        return this -> shards[0] -> lsm_tree.multi_get(keys, get_snapshot(snapshots, 0));
+    }
+
+    // positions of the keys of every shard in keys
+    std::vector<std::vector<size_t>> shard_positions(this -> shards.size());
+    for(size_t i = 0; i < keys.size(); ++i) {
+        shard_positions[this -> get_shard_index(keys[i])].push_back(i);
+    }
+
+    std::vector<Entry> entries(keys.size(), Entry(Bits(ENTRY_PLACEHOLDER_KEY), Bits(ENTRY_PLACEHOLDER_VALUE)));
+    for(uint32_t i = 0; i < this -> shards.size(); ++i) {
+        if(shard_positions[i].empty()) {
+            continue;
+        }
+
+        std::vector<std::string> shard_keys;
+        shard_keys.reserve(shard_positions[i].size());
+        for(size_t position : shard_positions[i]) {
+            shard_keys.push_back(keys[position]);
+        }
+
+        std::vector<Entry> shard_entries = this -> shards[i] -> lsm_tree.multi_get(shard_keys, get_snapshot(snapshots, i));
+
+        for(size_t j = 0; j < shard_entries.size(); ++j) {
+            entries[shard_positions[i][j]] = std::move(shard_entries[j]);
+        }
+    }
+
+    return entries;
+}
+
+std::map<std::string, uint64_t> LSM_Shards::get_statistics() {
+    std::map<std::string, uint64_t> counters;
+    for(std::unique_ptr<Shard>& shard : this -> shards) {
+        Statistics::merge_counters(counters, shard -> lsm_tree.get_statistics());
+    }
+
+    counters["write_group.groups"] = this -> write_groups.load(std::memory_order_relaxed);
+    counters["write_group.writes"] = this -> grouped_writes.load(std::memory_order_relaxed);
+
+    // the startup.* counters of the trees add up over the shards, this is how long opening all of them took
+    counters["startup.open_micros"] = this -> open_micros;
+
+    return counters;
+}
+
+std::vector<sequence_number_type> LSM_Shards::acquire_snapshots() {
+    std::vector<std::shared_lock<std::shared_mutex>> locks;
+    locks.reserve(this -> shards.size());
+    for(std::unique_ptr<Shard>& shard : this -> shards) {
+        locks.emplace_back(shard -> mutex);
+    }
+
+    std::vector<sequence_number_type> snapshots;
+    snapshots.reserve(this -> shards.size());
+    for(std::unique_ptr<Shard>& shard : this -> shards) {
+        snapshots.push_back(shard -> lsm_tree.acquire_snapshot());
+    }
+
+    return snapshots;
+}
+
+void LSM_Shards::release_snapshots(const std::vector<sequence_number_type>& snapshots) {
+    for(uint32_t i = 0; i < snapshots.size() && i < this -> shards.size(); ++i) {
+        this -> shards[i] -> lsm_tree.release_snapshot(snapshots[i]);
+    }
+}
+
+template<typename T>
+std::pair<std::set<T>, std::string> LSM_Shards::merge_pages(std::vector<std::pair<std::set<T>, std::string>>& pages, uint16_t n, bool forward) {
+    std::set<T> merged;
+    for(std::pair<std::set<T>, std::string>& page : pages) {
+        merged.merge(page.first);
+    }
+
+    std::set<T> items;
+    std::string next_key;
+    bool has_next = false;
+
+    // every shard gave its first n items and the one after them, so the first n + 1 overall are among them
+    // the items past the first n are candidates for next_key just like the next keys of the shards
+    if(forward) {
+        typename std::set<T>::iterator it = merged.begin();
+        for(; it != merged.end() && items.size() < n; ++it) {
+            items.insert(*it);
+        }
+        if(it != merged.end()) {
+            next_key = get_page_key(*it);
+            has_next = true;
+        }
+    }
+    else {
+        typename std::set<T>::reverse_iterator it = merged.rbegin();
+        for(; it != merged.rend() && items.size() < n; ++it) {
+            items.insert(*it);
+        }
+        if(it != merged.rend()) {
+            next_key = get_page_key(*it);
+            has_next = true;
+        }
+    }
+
+    for(const std::pair<std::set<T>, std::string>& page : pages) {
+        if(page.second == ENTRY_PLACEHOLDER_KEY) {
+            continue;
+        }
+
+        if(!has_next || (forward? page.second < next_key : page.second > next_key)) {
+            next_key = page.second;
+            has_next = true;
+        }
+    }
+
+    return std::make_pair(std::move(items), has_next? next_key : std::string(ENTRY_PLACEHOLDER_KEY));
+}
+
+template<typename T, typename Read>
+std::pair<std::set<T>, std::string> LSM_Shards::read_page(const std::string& cursor, uint16_t n, bool forward, Read read_shard) {
+    if(this -> shards.size() == 1) {
+        return read_shard(0, n);
+    }
+
+    if(this -> routing == SHARD_ROUTING_HASH) {
+        std::vector<std::pair<std::set<T>, std::string>> pages;
+        pages.reserve(this -> shards.size());
+        for(uint32_t i = 0; i < this -> shards.size(); ++i) {
+            pages.push_back(read_shard(i, n));
+        }
+
+        return LSM_Shards::merge_pages(pages, n, forward);
+    }
+
+    // every key of a shard sorts before every key of the following one, the page continues in the neighbour until it is full
+    // a shard is read with what is left of n even once that is 0, so the page still gets its next key
+    std::set<T> items;
+    std::string next_key(ENTRY_PLACEHOLDER_KEY);
+    int64_t shard_index = this -> get_shard_index(cursor);
+    while(shard_index >= 0 && shard_index < static_cast<int64_t>(this -> shards.size())) {
+        std::pair<std::set<T>, std::string> page = read_shard(shard_index, n - items.size());
+        items.merge(page.first);
+        if(page.second != ENTRY_PLACEHOLDER_KEY) {
+            next_key = std::move(page.second);
+            break;
+        }
+
+        shard_index += forward? 1 : -1;
+    }
+
+    return std::make_pair(std::move(items), next_key);
+}
+
+std::pair<std::set<Bits>, std::string> LSM_Shards::get_keys_cursor(const std::string& cursor, uint16_t n, const std::vector<sequence_number_type>& snapshots) {
+    return this -> read_page<Bits>(cursor, n, true, [this, &cursor, &snapshots](uint32_t shard_index, uint16_t shard_n){
+        return this -> shards[shard_index] -> lsm_tree.get_keys_cursor(cursor, shard_n, get_snapshot(snapshots, shard_index));
+    });
+}
+
+std::pair<std::set<Bits>, std::string> LSM_Shards::get_keys_cursor_prefix(const std::string& prefix, const std::string& cursor, uint16_t n, const std::vector<sequence_number_type>& snapshots) {
+    return this -> read_page<Bits>(cursor, n, true, [this, &prefix, &cursor, &snapshots](uint32_t shard_index, uint16_t shard_n){
+        return this -> shards[shard_index] -> lsm_tree.get_keys_cursor_prefix(prefix, cursor, shard_n, get_snapshot(snapshots, shard_index));
+    });
+}
+
+std::pair<std::set<Entry>, std::string> LSM_Shards::get_ff(const std::string& key, uint16_t n, const std::vector<sequence_number_type>& snapshots) {
+    return this -> read_page<Entry>(key, n, true, [this, &key, &snapshots](uint32_t shard_index, uint16_t shard_n){
+        return this -> shards[shard_index] -> lsm_tree.get_ff(key, shard_n, get_snapshot(snapshots, shard_index));
+    });
+}
+
+std::pair<std::set<Entry>, std::string> LSM_Shards::get_fb(const std::string& key, uint16_t n, const std::vector<sequence_number_type>& snapshots) {
+    return this -> read_page<Entry>(key, n, false, [this, &key, &snapshots](uint32_t shard_index, uint16_t shard_n){
+        return this -> shards[shard_index] -> lsm_tree.get_fb(key, shard_n, get_snapshot(snapshots, shard_index));
+    });
+}
+
+std::unique_ptr<Table_Scrubber> LSM_Shards::start_scrub(uint32_t shard_index) {
+    return this -> shards.at(shard_index) -> lsm_tree.start_scrub();
+}
+
+bool LSM_Shards::finish_scrub(uint32_t shard_index, const Table_Scrubber& scrubber) {
+    return this -> shards.at(shard_index) -> lsm_tree.finish_scrub(scrubber);
+}
+
+bool LSM_Shards::quarantine_ss_table(uint32_t shard_index, level_index_type level, uint64_t table_id) {
+    Shard& shard = *this -> shards.at(shard_index);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.lsm_tree.quarantine_ss_table(level, table_id);
+}
+
+void LSM_Shards::create_checkpoint(const std::filesystem::path& checkpoint_dir) {
+    // in index order like write(), so the two can not deadlock
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    locks.reserve(this -> shards.size());
+    for(const std::unique_ptr<Shard>& shard : this -> shards) {
+        locks.emplace_back(shard -> mutex);
+    }
+
+    // checked under the locks, a concurrent checkpoint with the same name must not be removed by the cleanup below
+    if(std::filesystem::exists(checkpoint_dir)) {
+        throw std::runtime_error(LSM_SHARDS_CHECKPOINT_EXISTS_ERR_MSG + checkpoint_dir.generic_string() + "\n");
+    }
+
+    try {
+        // a single shard keeps the unsharded layout, its val and wal go right into checkpoint_dir
+        if(this -> shards.size() == 1) {
+            this -> shards.front() -> lsm_tree.create_checkpoint(checkpoint_dir);
+        }
+        else {
+            for(uint32_t i = 0; i < this -> shards.size(); ++i) {
+                this -> shards[i] -> lsm_tree.create_checkpoint(get_shard_dir(checkpoint_dir, i));
+            }
+        }
+
+        this -> write_layout(checkpoint_dir, this -> shards.size());
+    }
+    catch(...) {
+        std::error_code error;
+        std::filesystem::remove_all(checkpoint_dir, error);
+        throw;
+    }
+}
+
+void LSM_Shards::ingest_files(const std::filesystem::path& ingest_dir) {
+    std::regex data_file_pattern(R"(\.sst_l(\d+)_data_(\d+)\.bin)");
+
+    // SS_Table_Writer numbers its tables in key order
+    auto list_data_files = [&data_file_pattern](const std::filesystem::path& dir) {
+        std::map<uint64_t, std::filesystem::path> data_files;
+        if(!std::filesystem::is_directory(dir)) {
+            return data_files;
+        }
+
+        for(const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(dir)) {
+            std::string filename = file.path().filename().string();
+            std::smatch match;
+            if(file.is_regular_file() && std::regex_match(filename, match, data_file_pattern)) {
+                data_files[std::stoull(match[2])] = file.path();
+            }
+        }
+
+        return data_files;
+    };
+
+    std::map<uint64_t, std::filesystem::path> data_files = list_data_files(ingest_dir);
+
+    // a split that was finished by an earlier call is ingested from what the shards have not taken of it yet, not split again
+    std::filesystem::path split_dir = ingest_dir / LSM_SHARDS_SPLIT_DIR_NAME;
+    std::set<uint64_t> split_ids;
+    if(std::filesystem::is_directory(split_dir)) {
+        for(const std::filesystem::directory_entry& table_dir : std::filesystem::directory_iterator(split_dir)) {
+            std::string name = table_dir.path().filename().string();
+            if(table_dir.is_directory() && !name.empty() && name.find_first_not_of("0123456789") == std::string::npos) {
+                split_ids.insert(std::stoull(name));
+            }
+        }
+    }
+
+    std::set<uint64_t> table_ids = split_ids;
+    for(const std::pair<const uint64_t, std::filesystem::path>& data_file : data_files) {
+        table_ids.insert(data_file.first);
+    }
+
+    // split tables get the prefix filters the shards would build
+    LSM_Options options = LSM_Options::from_environment();
+
+    std::vector<std::vector<std::filesystem::path>> shard_files(this -> shards.size());
+    std::vector<SS_Table_Files> split_tables;
+    for(uint64_t table_id : table_ids) {
+        std::filesystem::path table_split_dir = split_dir / std::to_string(table_id);
+        std::map<uint64_t, std::filesystem::path>::iterator data_file = data_files.find(table_id);
+
+        if(data_file != data_files.end()) {
+            std::smatch match;
+            std::string filename = data_file -> second.filename().string();
+            std::regex_match(filename, match, data_file_pattern);
+            level_index_type level = static_cast<level_index_type>(std::stoul(match[1]));
+            SS_Table_Files files = LSM_Tree::get_ss_table_files(ingest_dir, level, table_id);
+
+            if(split_ids.count(table_id) == 0) {
+                if(this -> shards.size() == 1) {
+                    shard_files.front().push_back(data_file -> second);
+                    continue;
+                }
+
+                SS_Table ss_table(files.data_file, files.index_file, files.offset_file, files.filter_file, level, table_id);
+                ss_table.reconstruct_ss_table();
+
+                uint32_t first_shard = this -> get_shard_index(ss_table.get_first_index().get_string());
+                if(this -> routing == SHARD_ROUTING_RANGE && first_shard == this -> get_shard_index(ss_table.get_last_index().get_string())) {
+                    shard_files[first_shard].push_back(data_file -> second);
+                    continue;
+                }
+
+                // the parts are written next to their final place and renamed into it once all of them are there,
+                // so a failure while splitting leaves nothing a later call would take for a finished split
+                std::filesystem::path partial_dir = split_dir / (std::to_string(table_id) + LSM_SHARDS_SPLIT_PARTIAL_SUFFIX);
+                std::filesystem::remove_all(partial_dir);
+
+                // the records are written once more, still far fewer times than going through the wal, mem_table and compactions
+                std::vector<std::unique_ptr<SS_Table_Writer>> writers;
+                writers.reserve(this -> shards.size());
+                for(uint32_t i = 0; i < this -> shards.size(); ++i) {
+                    writers.push_back(std::make_unique<SS_Table_Writer>(get_shard_dir(partial_dir, i), options));
+                }
+
+                SS_Table::Iterator iterator = ss_table.get_iterator();
+                for(iterator.seek(ss_table.get_first_index(), ITERATOR_FORWARD); iterator.valid(); iterator.next()) {
+                    const Entry& entry = iterator.entry();
+                    SS_Table_Writer& writer = *writers[this -> get_shard_index(entry.get_key_string())];
+                    if(entry.is_deleted()) {
+                        writer.remove(entry.get_key_string());
+                    }
+                    else {
+                        writer.put(entry.get_key_string(), entry.get_value_string());
+                    }
+                }
+
+                for(std::unique_ptr<SS_Table_Writer>& writer : writers) {
+                    writer -> finish();
+                }
+
+                std::filesystem::rename(partial_dir, table_split_dir);
+            }
+
+            // the table itself stays until every shard took its part of it
+            split_tables.push_back(files);
+        }
+
+        for(uint32_t i = 0; i < this -> shards.size(); ++i) {
+            for(const std::pair<const uint64_t, std::filesystem::path>& part : list_data_files(get_shard_dir(table_split_dir, i))) {
+                shard_files[i].push_back(part.second);
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < this -> shards.size(); ++i) {
+        if(shard_files[i].empty()) {
+            continue;
+        }
+
+        Shard& shard = *this -> shards[i];
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.lsm_tree.ingest_files(shard_files[i], true);
+    }
+
+    // the data file goes first, a table without it is not picked up again
+    for(const SS_Table_Files& files : split_tables) {
+        for(const std::filesystem::path& file : {files.data_file, files.index_file, files.offset_file, files.filter_file}) {
+            std::filesystem::remove(file);
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::remove_all(split_dir, error);
+}
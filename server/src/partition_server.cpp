@@ -1,14 +1,132 @@
 #include "../include/partition_server.h"
 #include <cstdint>
 #include <cstring>
+#include <iostream>
 #include <stdexcept>
 
-Partition_Server::Partition_Server(uint16_t port, uint8_t verbose, uint32_t thread_pool_size) : Server(port, verbose, thread_pool_size), lsm_tree() {
+Partition_Server::Partition_Server(uint16_t port, uint8_t verbose, uint32_t thread_pool_size) : Server(port, verbose, thread_pool_size), lsm_shards(), scrub_rate(get_scrub_rate()), scrubber_stopping(false), checkpoint_dir(get_dir(PARTITION_SERVER_CHECKPOINT_DIR_ENV_VAR, PARTITION_SERVER_DEFAULT_CHECKPOINT_DIR)), ingest_dir(get_dir(PARTITION_SERVER_INGEST_DIR_ENV_VAR, PARTITION_SERVER_DEFAULT_INGEST_DIR)) {
+    if(this -> verbose > 0) {
+        this -> log_startup_stats();
+    }
 
+    if(this -> scrub_rate > 0) {
+        this -> scrubber_thread = std::thread(&Partition_Server::run_scrubber, this);
+    }
 }
 
 Partition_Server::~Partition_Server() {
+    {
+        std::lock_guard<std::mutex> scrubber_lock(this -> scrubber_mutex);
+        this -> scrubber_stopping = true;
+    }
+    this -> scrubber_cv.notify_all();
+
+    if(this -> scrubber_thread.joinable()) {
+        this -> scrubber_thread.join();
+    }
+}
+
+void Partition_Server::log_startup_stats() {
+    std::map<std::string, uint64_t> counters = this -> lsm_shards.get_statistics();
+
+    std::cout << PARTITION_SERVER_STARTUP_MSG << this -> lsm_shards.get_shard_count() << " shard(s), " << counters["startup.tables"] << " tables in " << counters["startup.open_micros"] / 1000 << " ms"
+              << " (summed over shards: wal replay " << counters["startup.wal_replay_micros"] / 1000 << " ms"
+              << ", level recovery " << counters["startup.level_recovery_micros"] / 1000 << " ms"
+              << ", table open " << counters["startup.table_open_micros"] / 1000 << " ms"
+              << ", " << counters["startup.deferred_filters"] << " prefix filters deferred)" << std::endl;
+}
+
+uint64_t Partition_Server::get_scrub_rate() const {
+    const char* scrub_rate_str = std::getenv(PARTITION_SERVER_SCRUB_RATE_ENV_VAR);
+    if(!scrub_rate_str) {
+        return PARTITION_SERVER_DEFAULT_SCRUB_RATE;
+    }
+
+    return strtoull(scrub_rate_str, nullptr, 10);
+}
+
+std::filesystem::path Partition_Server::get_dir(const char* env_var, const char* default_dir) {
+    const char* dir_str = std::getenv(env_var);
+    if(!dir_str || !*dir_str) {
+        return default_dir;
+    }
+
+    return dir_str;
+}
+
+std::filesystem::path Partition_Server::extract_subdir(const std::filesystem::path& dir, const Server_Message& message) const {
+    std::string name = this -> extract_key_str_from_msg(message.string(), true);
+
+    // the subdirectory has to stay inside dir
+    if(name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos) {
+        throw std::invalid_argument(PARTITION_SERVER_BAD_DIR_NAME_ERR_MSG);
+    }
+
+    return dir / name;
+}
+
+bool Partition_Server::scrubber_wait(std::chrono::milliseconds duration) {
+    std::unique_lock<std::mutex> scrubber_lock(this -> scrubber_mutex);
+    return !this -> scrubber_cv.wait_for(scrubber_lock, duration, [this](){
+        return this -> scrubber_stopping;
+    });
+}
+
+void Partition_Server::run_scrubber() {
+    uint32_t shard_index = 0;
+    // shards in a row that had nothing due, once every one of them is idle the scrub sleeps
+    uint32_t idle_shards = 0;
+
+    while(true) {
+        std::unique_ptr<Table_Scrubber> scrubber;
+        try {
+            scrubber = this -> lsm_shards.start_scrub(shard_index);
+        }
+        catch(const std::exception& e) {
+            if(this -> verbose > 0) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+
+        if(!scrubber) {
+            shard_index = (shard_index + 1) % this -> lsm_shards.get_shard_count();
+            if(++idle_shards < this -> lsm_shards.get_shard_count()) {
+                continue;
+            }
+
+            idle_shards = 0;
+            if(!this -> scrubber_wait(std::chrono::milliseconds(PARTITION_SERVER_SCRUB_IDLE_MS))) {
+                return;
+            }
+            continue;
+        }
+        idle_shards = 0;
+
+        // the scrubber has its own open files, so writers are not held up while it reads
+        bool done = false;
+        while(!done) {
+            uint64_t bytes_before = scrubber -> get_bytes_checked();
+            done = scrubber -> step(PARTITION_SERVER_SCRUB_STEP_SIZE);
+
+            uint64_t pause_ms = (scrubber -> get_bytes_checked() - bytes_before) * 1000 / this -> scrub_rate;
+            if(!this -> scrubber_wait(std::chrono::milliseconds(pause_ms))) {
+                return;
+            }
+        }
+
+        if(!this -> lsm_shards.finish_scrub(shard_index, *scrubber)) {
+            try {
+                this -> lsm_shards.quarantine_ss_table(shard_index, scrubber -> get_level(), scrubber -> get_table_id());
+            }
+            catch(const std::exception& e) {
+                if(this -> verbose > 0) {
+                    std::cerr << e.what() << std::endl;
+                }
+            }
+        }
 
+        shard_index = (shard_index + 1) % this -> lsm_shards.get_shard_count();
+    }
 }
 
 int8_t Partition_Server::start() {
@@ -189,6 +307,36 @@ std::string Partition_Server::extract_value(const std::string& raw_message) cons
     return value_str;
 }
 
+protocol_ttl_t Partition_Server::extract_ttl(const std::string& raw_message) const {
+    // skip the key and the value
+    size_t curr_pos = PROTOCOL_FIRST_KEY_LEN_POS;
+    protocol_key_len_t key_len;
+    if(curr_pos + sizeof(key_len) > raw_message.size()) {
+        throw std::runtime_error(PARTITION_SERVER_FAILED_TO_EXTRACT_DATA_ERR_MSG);
+    }
+
+    memcpy(&key_len, &raw_message[curr_pos], sizeof(key_len));
+    key_len = protocol_key_len_ntoh(key_len);
+    curr_pos += key_len + sizeof(key_len);
+
+    protocol_value_len_t value_len;
+    if(curr_pos + sizeof(value_len) > raw_message.size()) {
+        throw std::runtime_error(PARTITION_SERVER_FAILED_TO_EXTRACT_DATA_ERR_MSG);
+    }
+
+    memcpy(&value_len, &raw_message[curr_pos], sizeof(value_len));
+    value_len = protocol_value_len_ntoh(value_len);
+    curr_pos += value_len + sizeof(value_len);
+
+    protocol_ttl_t ttl;
+    if(curr_pos + sizeof(ttl) > raw_message.size()) {
+        throw std::runtime_error(PARTITION_SERVER_FAILED_TO_EXTRACT_DATA_ERR_MSG);
+    }
+
+    memcpy(&ttl, &raw_message[curr_pos], sizeof(ttl));
+    return protocol_ttl_ntoh(ttl);
+}
+
 int8_t Partition_Server::process_request(socket_t socket_fd, Server_Message& serv_msg) {
         // extract the command code
     Command_Code com_code = this -> extract_command_code(serv_msg.string(), true);
@@ -197,7 +345,8 @@ int8_t Partition_Server::process_request(socket_t socket_fd, Server_Message& ser
         case COMMAND_CODE_GET: {
             return this -> handle_get_request(socket_fd, serv_msg);
         }
-        case COMMAND_CODE_SET: {
+        case COMMAND_CODE_SET:
+        case COMMAND_CODE_SET_TTL: {
             // extract the key
             return this -> handle_set_request(socket_fd, serv_msg);
         }
@@ -219,6 +368,31 @@ int8_t Partition_Server::process_request(socket_t socket_fd, Server_Message& ser
             return this -> handle_remove_request(socket_fd, serv_msg);
         }
 
+        case COMMAND_CODE_MSET: {
+            return this -> handle_mset_request(socket_fd, serv_msg);
+        }
+
+        case COMMAND_CODE_MGET: {
+            return this -> handle_mget_request(socket_fd, serv_msg);
+        }
+
+        case COMMAND_CODE_INCR:
+        case COMMAND_CODE_APPEND: {
+            return this -> handle_merge_request(socket_fd, serv_msg, com_code);
+        }
+
+        case COMMAND_CODE_STATS: {
+            return this -> handle_stats_request(socket_fd, serv_msg);
+        }
+
+        case COMMAND_CODE_CHECKPOINT: {
+            return this -> handle_checkpoint_request(socket_fd, serv_msg);
+        }
+
+        case COMMAND_CODE_INGEST: {
+            return this -> handle_ingest_request(socket_fd, serv_msg);
+        }
+
         default: {
 
         }
@@ -244,8 +418,12 @@ int8_t Partition_Server::handle_set_request(socket_t socket_fd, const Server_Mes
 
     // extract the data
     std::string value_str;
+    protocol_ttl_t ttl = LSM_TREE_NO_TTL;
     try {
         value_str = this -> extract_value(serv_msg.string());
+        if(this -> extract_command_code(serv_msg.string(), true) == COMMAND_CODE_SET_TTL) {
+            ttl = this -> extract_ttl(serv_msg.string());
+        }
     }
     catch (const std::exception& e) {
         if(this -> verbose > 0) {
@@ -256,12 +434,8 @@ int8_t Partition_Server::handle_set_request(socket_t socket_fd, const Server_Mes
         return 0;
     }
 
-    // insert the key value pair into the inner lsm tree
-    bool set = false;
-    {
-        std::unique_lock<std::shared_mutex> lsm_lock(this -> lsm_tree_mutex);
-        set = this -> lsm_tree.set(key_str, value_str);
-    }
+    // insert the key value pair into the shard owning the key
+    bool set = this -> lsm_shards.set(key_str, value_str, ttl);
 
     if(set) {
         this -> queue_socket_for_ok_response(socket_fd, serv_msg.get_cid());
@@ -274,6 +448,177 @@ int8_t Partition_Server::handle_set_request(socket_t socket_fd, const Server_Mes
     return -1;
 }
 
+int8_t Partition_Server::handle_merge_request(socket_t socket_fd, const Server_Message& serv_msg, Command_Code com_code) {
+    std::string key_str;
+    std::string operand_str;
+    try {
+        key_str = this -> extract_key_str_from_msg(serv_msg.string(), true);
+        operand_str = this -> extract_value(serv_msg.string());
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+        return 0;
+    }
+
+    merge_operator_id_type merge_operator_id = com_code == COMMAND_CODE_INCR? MERGE_OPERATOR_INT64_ADD : MERGE_OPERATOR_APPEND;
+
+    bool merged = this -> lsm_shards.merge(key_str, merge_operator_id, operand_str);
+
+    if(merged) {
+        this -> queue_socket_for_ok_response(socket_fd, serv_msg.get_cid());
+    }
+    else {
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+    }
+
+    return 0;
+}
+
+int8_t Partition_Server::handle_mset_request(socket_t socket_fd, const Server_Message& serv_msg) {
+    Write_Batch batch;
+    try {
+        std::vector<std::pair<std::string, std::string>> pairs = this -> extract_key_value_pairs(serv_msg.string(), true);
+        for(const std::pair<std::string, std::string>& pair : pairs) {
+            batch.put(pair.first, pair.second);
+        }
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+        return 0;
+    }
+
+    bool written = this -> lsm_shards.write(batch);
+
+    if(written) {
+        this -> queue_socket_for_ok_response(socket_fd, serv_msg.get_cid());
+    }
+    else {
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+    }
+
+    return 0;
+}
+
+int8_t Partition_Server::handle_mget_request(socket_t socket_fd, const Server_Message& serv_msg) {
+    std::vector<std::string> keys;
+    try {
+        keys = this -> extract_keys(serv_msg.string(), true);
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+        return 0;
+    }
+
+    try {
+        std::vector<Entry> entries = this -> lsm_shards.multi_get(keys);
+
+        // only the keys that were found are sent back
+        std::vector<Entry> found_entries;
+        found_entries.reserve(entries.size());
+        for(Entry& entry : entries) {
+            if(!entry.is_deleted() && entry.get_string_key_bytes() != ENTRY_PLACEHOLDER_KEY) {
+                found_entries.push_back(std::move(entry));
+            }
+        }
+
+        std::string entries_resp = this -> create_entries_response(found_entries, true, serv_msg.get_cid());
+        Server_Message serv_resp(entries_resp, serv_msg.get_cid());
+        this -> queue_partition_for_response(socket_fd, std::move(serv_resp));
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+    }
+
+    return 0;
+}
+
+int8_t Partition_Server::handle_stats_request(socket_t socket_fd, const Server_Message& serv_msg) {
+    try {
+        std::map<std::string, uint64_t> counters = this -> lsm_shards.get_statistics();
+
+        std::vector<Entry> entries;
+        entries.reserve(counters.size());
+        for(const std::pair<const std::string, uint64_t>& counter : counters) {
+            entries.emplace_back(Bits(counter.first), Bits(std::to_string(counter.second)));
+        }
+
+        std::string entries_resp = this -> create_entries_response(entries, true, serv_msg.get_cid());
+        Server_Message serv_resp(entries_resp, serv_msg.get_cid());
+        this -> queue_partition_for_response(socket_fd, std::move(serv_resp));
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+    }
+
+    return 0;
+}
+
+int8_t Partition_Server::handle_checkpoint_request(socket_t socket_fd, const Server_Message& serv_msg) {
+    try {
+        std::filesystem::path checkpoint = this -> extract_subdir(this -> checkpoint_dir, serv_msg);
+        std::filesystem::create_directories(this -> checkpoint_dir);
+        this -> lsm_shards.create_checkpoint(checkpoint);
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+        return 0;
+    }
+
+    this -> queue_socket_for_ok_response(socket_fd, serv_msg.get_cid());
+    return 0;
+}
+
+int8_t Partition_Server::handle_ingest_request(socket_t socket_fd, const Server_Message& serv_msg) {
+    try {
+        std::filesystem::path ingest_subdir = this -> extract_subdir(this -> ingest_dir, serv_msg);
+
+        // the shards refuse to ingest under a live snapshot, open cursors give theirs up and pin new ones on their next page
+        // the lock is held until the tables are in so no cursor pins one in between
+        std::lock_guard<std::mutex> lock(this -> cursor_snapshots_mutex);
+        for(std::pair<const std::string, Cursor_Snapshot>& cursor_snapshot : this -> cursor_snapshots) {
+            this -> lsm_shards.release_snapshots(cursor_snapshot.second.snapshots);
+        }
+        this -> cursor_snapshots.clear();
+
+        this -> lsm_shards.ingest_files(ingest_subdir);
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+
+        this -> queue_socket_for_err_response(socket_fd, serv_msg.get_cid());
+        return 0;
+    }
+
+    this -> queue_socket_for_ok_response(socket_fd, serv_msg.get_cid());
+    return 0;
+}
+
 int8_t Partition_Server::handle_get_request(socket_t socket_fd, const Server_Message& serv_msg) {
     std::string key_str;
     try {
@@ -290,11 +635,7 @@ int8_t Partition_Server::handle_get_request(socket_t socket_fd, const Server_Mes
 
     std::string value_str;
     try {
-        Entry entry(Bits(ENTRY_PLACEHOLDER_KEY), Bits(ENTRY_PLACEHOLDER_VALUE));
-        {
-            std::shared_lock<std::shared_mutex> lsm_lock(this -> lsm_tree_mutex);
-            entry = lsm_tree.get(key_str);
-        }
+        Entry entry = this -> lsm_shards.get(key_str);
         if(entry.is_deleted() || entry.get_string_key_bytes() == ENTRY_PLACEHOLDER_KEY) {
             this -> queue_socket_for_not_found_response(socket_fd, serv_msg.get_cid());
             return 0;
@@ -330,11 +671,7 @@ int8_t Partition_Server::handle_remove_request(socket_t socket_fd, const Server_
         return 0;
     }
 
-    bool remove = false;
-    {
-        std::unique_lock<std::shared_mutex> lsm_lock(this -> lsm_tree_mutex);
-        remove = lsm_tree.remove(key_str);
-    }
+    bool remove = this -> lsm_shards.remove(key_str);
 
     if(remove) {
         this -> queue_socket_for_ok_response(socket_fd, serv_msg.get_cid());
@@ -426,6 +763,10 @@ std::pair<std::string, Cursor_Info> Partition_Server::extract_key_and_cursinf(Se
     memcpy(&cap, &message.c_str()[pos], sizeof(cursor_cap_t));
     cap = cursor_cap_ntoh(cap);
 
+    cursor_snapshot_id_t snapshot_id = 0;
+    memcpy(&snapshot_id, &message.c_str()[PROTOCOL_CURSOR_SNAPSHOT_ID_POS], sizeof(cursor_snapshot_id_t));
+    snapshot_id = cursor_snapshot_id_ntoh(snapshot_id);
+
     pos = PROTOCOL_FIRST_KEY_LEN_POS;
 
     if(pos + sizeof(protocol_key_len_t)  > message.size()) {
@@ -485,22 +826,59 @@ std::pair<std::string, Cursor_Info> Partition_Server::extract_key_and_cursinf(Se
     curs_inf.name = std::move(curs_name);
     curs_inf.cap = cap;
     curs_inf.name_len = curs_name_len;
+    curs_inf.snapshot_id = snapshot_id;
 
     return std::make_pair(key_str, curs_inf);
 }
+
+std::vector<sequence_number_type> Partition_Server::pin_cursor_snapshot(protocol_id_t client_id, const Cursor_Info& curs_info) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::string cursor_key = std::to_string(client_id) + ":" + curs_info.name;
+
+    std::lock_guard<std::mutex> lock(this -> cursor_snapshots_mutex);
+
+    for(std::unordered_map<std::string, Cursor_Snapshot>::iterator it = this -> cursor_snapshots.begin(); it != this -> cursor_snapshots.end();) {
+        if(now - it -> second.last_used > std::chrono::seconds(PARTITION_SERVER_CURSOR_SNAPSHOT_TTL_SEC)) {
+            this -> lsm_shards.release_snapshots(it -> second.snapshots);
+            it = this -> cursor_snapshots.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    std::unordered_map<std::string, Cursor_Snapshot>::iterator it = this -> cursor_snapshots.find(cursor_key);
+    if(it != this -> cursor_snapshots.end() && it -> second.snapshot_id == curs_info.snapshot_id) {
+        it -> second.last_used = now;
+        return it -> second.snapshots;
+    }
+
+    // the cursor was recreated under the same name, its old snapshot is no longer needed
+    if(it != this -> cursor_snapshots.end()) {
+        this -> lsm_shards.release_snapshots(it -> second.snapshots);
+    }
+
+    Cursor_Snapshot cursor_snapshot;
+    cursor_snapshot.snapshot_id = curs_info.snapshot_id;
+    cursor_snapshot.snapshots = this -> lsm_shards.acquire_snapshots();
+    cursor_snapshot.last_used = now;
+    this -> cursor_snapshots[cursor_key] = cursor_snapshot;
+
+    return cursor_snapshot.snapshots;
+}
 // NOT CURRENTLY WORKING!!!! STOPPED CODDING FROM HERE
 int8_t Partition_Server::handle_get_keys_request(socket_t socket_fd, Server_Message& message) {
     std::pair<std::string, Cursor_Info> key_and_curs;
     std::pair<std::set<Bits>, std::string> entries_key;
     try {
         key_and_curs = this -> extract_key_and_cursinf(message);
-        std::shared_lock<std::shared_mutex> lsm_lock(this -> lsm_tree_mutex);
+        std::vector<sequence_number_type> snapshots = this -> pin_cursor_snapshot(message.get_cid(), key_and_curs.second);
         if(this -> is_fb_edge_flag_set(message.get_string_data())) {
             std::string max_key(UINT16_MAX, '\xFF');
-            entries_key = this -> lsm_tree.get_keys_cursor(max_key, key_and_curs.second.cap);
+            entries_key = this -> lsm_shards.get_keys_cursor(max_key, key_and_curs.second.cap, snapshots);
         }
         else {  
-            entries_key = this -> lsm_tree.get_keys_cursor(key_and_curs.first, key_and_curs.second.cap);
+            entries_key = this -> lsm_shards.get_keys_cursor(key_and_curs.first, key_and_curs.second.cap, snapshots);
         }
 
         Server_Message serv_msg = this -> create_keys_set_resp(Command_Code::COMMAND_CODE_GET_KEYS, entries_key.first, entries_key.second, message.get_cid(), key_and_curs.second);
@@ -524,23 +902,23 @@ int8_t Partition_Server::handle_get_fx_request(socket_t socket_fd, Server_Messag
     std::pair<std::set<Entry>, std::string> entries_key;
     try {
         key_and_curs = this -> extract_key_and_cursinf(message);
-        std::shared_lock<std::shared_mutex> lsm_lock(this -> lsm_tree_mutex);
+        std::vector<sequence_number_type> snapshots = this -> pin_cursor_snapshot(message.get_cid(), key_and_curs.second);
         if(com_code == Command_Code::COMMAND_CODE_GET_FB) {
             if(this -> is_fb_edge_flag_set(message.get_string_data())) {
                 std::string max_key(UINT16_MAX, '\xFF');
-                entries_key = this -> lsm_tree.get_fb(max_key, key_and_curs.second.cap);
+                entries_key = this -> lsm_shards.get_fb(max_key, key_and_curs.second.cap, snapshots);
             }
             else {
-                entries_key = this -> lsm_tree.get_fb(key_and_curs.first, key_and_curs.second.cap);
+                entries_key = this -> lsm_shards.get_fb(key_and_curs.first, key_and_curs.second.cap, snapshots);
             }
         }
         else if(com_code == Command_Code::COMMAND_CODE_GET_FF) {
             if(this -> is_fb_edge_flag_set(message.get_string_data())) {
                 std::string max_key(UINT16_MAX, '\xFF');
-                entries_key = this -> lsm_tree.get_ff(max_key, key_and_curs.second.cap);
+                entries_key = this -> lsm_shards.get_ff(max_key, key_and_curs.second.cap, snapshots);
             }
             else {
-                entries_key = this -> lsm_tree.get_ff(key_and_curs.first, key_and_curs.second.cap);
+                entries_key = this -> lsm_shards.get_ff(key_and_curs.first, key_and_curs.second.cap, snapshots);
             }
         }
         else {
@@ -708,13 +1086,13 @@ int8_t Partition_Server::handle_get_keys_prefix_request(socket_t socket_fd, Serv
     std::string prefix;
     try {
         key_and_curs = this -> extract_key_and_cursinf(message, &prefix);
-        std::shared_lock<std::shared_mutex> lsm_lock(this -> lsm_tree_mutex);
+        std::vector<sequence_number_type> snapshots = this -> pin_cursor_snapshot(message.get_cid(), key_and_curs.second);
         if(this -> is_fb_edge_flag_set(message.get_string_data())) {
             std::string max_key(UINT16_MAX, '\xFF');
-            entries_key = this -> lsm_tree.get_keys_cursor_prefix(prefix, max_key, key_and_curs.second.cap);
+            entries_key = this -> lsm_shards.get_keys_cursor_prefix(prefix, max_key, key_and_curs.second.cap, snapshots);
         }
         else {  
-            entries_key = this -> lsm_tree.get_keys_cursor_prefix(prefix, key_and_curs.first, key_and_curs.second.cap);
+            entries_key = this -> lsm_shards.get_keys_cursor_prefix(prefix, key_and_curs.first, key_and_curs.second.cap, snapshots);
         }
 
         Server_Message serv_msg = this -> create_keys_set_resp(Command_Code::COMMAND_CODE_GET_KEYS_PREFIX, entries_key.first, entries_key.second, message.get_cid(), key_and_curs.second);
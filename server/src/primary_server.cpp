@@ -17,8 +17,6 @@ Primary_Server::Primary_Server(uint16_t port, uint8_t verbose, uint32_t thread_p
         throw std::runtime_error(PRIMARY_SERVER_PARTITION_COUNT_ZERO_ERR_MSG);
     }
 
-    this -> partition_range_length = std::numeric_limits<uint32_t>::max() / this -> partition_count;
-
     this -> partitions.reserve(partition_count);
 
     for(uint32_t i = 0; i < this -> partition_count; ++i) {
@@ -38,13 +36,7 @@ Primary_Server::Primary_Server(uint16_t port, uint8_t verbose, uint32_t thread_p
             partition_entry.status = Partition_Status::PARTITION_FREE;
         }
         
-        partition_entry.range.beg = this -> partition_range_length * i;
-        partition_entry.range.end = this ->  partition_range_length * (i + 1);
-
-        // for the last partition is everything until the max index
-        if(i == this -> partition_count - 1) {
-            partition_entry.range.end = std::numeric_limits<uint32_t>::max();
-        }
+        partition_entry.range = get_partition_range(i, this -> partition_count);
 
         partition_entry.id = i;
 
@@ -86,26 +78,8 @@ std::vector<bool> Primary_Server::get_partitions_status() const {
     return partitions_status;
 }
 
-uint32_t Primary_Server::key_prefix_to_uint32(const std::string& key) const {
-    uint32_t uint32_prefix_key = 0;
-
-    uint32_t key_limit = std::min<uint32_t>(PRIMARY_SERVER_BYTES_IN_KEY_PREFIX, key.length());
-
-    for(uint32_t i = 0; i < key_limit; ++i) {
-        uint32_prefix_key |= static_cast<uint32_t>(static_cast<uint8_t>(key[i]) << (8 * (PRIMARY_SERVER_BYTES_IN_KEY_PREFIX - 1 - i)));
-    }
-
-    return uint32_prefix_key;
-}
-
 Partition_Entry Primary_Server::get_partition_for_key(const std::string& key) {
-    uint32_t uint32_key_prefix = this -> key_prefix_to_uint32(key);
-
-    uint32_t partition_index = static_cast<uint32_t>(uint32_key_prefix / this -> partition_range_length);
-
-    if(partition_index >= this -> partitions.size()) {
-        --partition_index;
-    }
+    uint32_t partition_index = get_partition_index(key, this -> partition_count);
 
     std::shared_lock<std::shared_mutex> lock(this -> partitions_mutex);
     return this -> partitions.at(partition_index);
@@ -384,6 +358,9 @@ int8_t Primary_Server::process_client_in(socket_t client_fd, Server_Message msg)
     switch(com_code) {
         case COMMAND_CODE_GET:
         case COMMAND_CODE_SET: 
+        case COMMAND_CODE_SET_TTL:
+        case COMMAND_CODE_INCR:
+        case COMMAND_CODE_APPEND:
         case COMMAND_CODE_REMOVE: {
             // extract the key string
             std::string key_str;
@@ -422,12 +399,38 @@ int8_t Primary_Server::process_client_in(socket_t client_fd, Server_Message msg)
 
             break;
         }
+        case COMMAND_CODE_MSET: {
+            return this -> process_mset_request(client_fd, msg);
+        }
+        case COMMAND_CODE_MGET: {
+            return this -> process_mget_request(client_fd, msg);
+        }
+        case COMMAND_CODE_STATS: {
+            return this -> process_broadcast_request(client_fd, msg, com_code, {});
+        }
+        case COMMAND_CODE_CHECKPOINT:
+        case COMMAND_CODE_INGEST: {
+            std::string name;
+            try {
+                name = this -> extract_key_str_from_msg(msg.string(), true);
+            }
+            catch(const std::exception& e) {
+                if(this -> verbose) {
+                    std::cerr << e.what() << std::endl;
+                }
+                this -> queue_client_for_error_response(client_fd, msg.get_cid(), Server_Error_Codes::MSG_TOO_SHORT);
+                return 0;
+            }
+
+            return this -> process_broadcast_request(client_fd, msg, com_code, {name});
+        }
         case CREATE_CURSOR: {
             Cursor cursor;
             try {
                 cursor = this -> extract_cursor_creation(msg);
                 Partition_Entry p_id = this -> get_partition_for_key(cursor.get_next_key());
                 cursor.set_last_called_part_id(p_id.id);
+                cursor.set_snapshot_id(this -> cursor_snapshot_id.fetch_add(1, std::memory_order_relaxed));
             } 
             catch(const Server_Error& se) {
                 if(this -> verbose > 0) {
@@ -790,6 +793,13 @@ int8_t Primary_Server::process_partition_response(Server_Message&& msg) {
         }
 
         default: {
+            // replies to an MSET / MGET / STATS / CHECKPOINT / INGEST slice are collected until every partition answered
+            if(com_code == Command_Code::COMMAND_CODE_OK || com_code == Command_Code::COMMAND_CODE_ERR) {
+                if(this -> settle_pending_scatter(msg.get_cid(), &msg)) {
+                    return 0;
+                }
+            }
+
             // by default try to send the response to the client
             try {
                 msg.remove_cid();
@@ -808,6 +818,271 @@ int8_t Primary_Server::process_partition_response(Server_Message&& msg) {
     return 0;
 }
 
+int8_t Primary_Server::process_mset_request(socket_t client_fd, const Server_Message& msg) {
+    std::vector<std::pair<std::string, std::string>> pairs;
+    try {
+        pairs = this -> extract_key_value_pairs(msg.string(), true);
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+        this -> queue_client_for_error_response(client_fd, msg.get_cid(), Server_Error_Codes::MSG_TOO_SHORT);
+        return 0;
+    }
+
+    if(pairs.empty()) {
+        this -> queue_client_for_ok_response(client_fd, msg.get_cid());
+        return 0;
+    }
+
+    // group the pairs by the partition that owns them, keeping their order
+    std::map<int16_t, std::vector<std::pair<std::string, std::string>>> partition_pairs;
+    std::map<int16_t, Partition_Entry> partition_entries;
+    for(std::pair<std::string, std::string>& pair : pairs) {
+        Partition_Entry partition_entry = this -> get_partition_for_key(pair.first);
+        partition_entries[partition_entry.id] = partition_entry;
+        partition_pairs[partition_entry.id].emplace_back(std::move(pair));
+    }
+
+    // nothing is sent unless every partition involved is reachable
+    for(std::pair<const int16_t, Partition_Entry>& partition_entry : partition_entries) {
+        if(!ensure_partition_connection(partition_entry.second)) {
+            this -> queue_client_for_error_response(client_fd, msg.get_cid(), Server_Error_Codes::PARTITION_DIED);
+            return 0;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this -> pending_scatters_mutex);
+        Pending_Scatter& pending_scatter = this -> pending_scatters[msg.get_cid()];
+        pending_scatter = Pending_Scatter{};
+        pending_scatter.com_code = COMMAND_CODE_MSET;
+        pending_scatter.remaining = partition_pairs.size();
+        pending_scatter.failed = false;
+    }
+
+    for(std::pair<const int16_t, std::vector<std::pair<std::string, std::string>>>& slice : partition_pairs) {
+        Partition_Entry& partition_entry = partition_entries[slice.first];
+        Server_Message slice_msg = this -> create_key_value_pairs_message(COMMAND_CODE_MSET, slice.second, true, msg.get_cid());
+
+        try {
+            this -> queue_partition_for_response(partition_entry.socket_fd, std::move(slice_msg));
+        }
+        catch(const std::exception& e) {
+            if(this -> verbose > 0) {
+                std::cerr << e.what() << std::endl;
+            }
+            this -> partitions[partition_entry.id].status = Partition_Status::PARTITION_DEAD;
+            this -> settle_pending_scatter(msg.get_cid(), nullptr);
+        }
+    }
+
+    return 0;
+}
+
+int8_t Primary_Server::process_mget_request(socket_t client_fd, const Server_Message& msg) {
+    std::vector<std::string> keys;
+    try {
+        keys = this -> extract_keys(msg.string(), true);
+    }
+    catch(const std::exception& e) {
+        if(this -> verbose > 0) {
+            std::cerr << e.what() << std::endl;
+        }
+        this -> queue_client_for_error_response(client_fd, msg.get_cid(), Server_Error_Codes::MSG_TOO_SHORT);
+        return 0;
+    }
+
+    if(keys.empty()) {
+        Server_Message serv_resp;
+        serv_resp.set_message_eat(this -> create_entries_response({}, false, msg.get_cid()));
+        serv_resp.set_cid(msg.get_cid());
+        this -> queue_client_for_response(std::move(serv_resp));
+        return 0;
+    }
+
+    std::map<int16_t, std::vector<std::string>> partition_keys;
+    std::map<int16_t, Partition_Entry> partition_entries;
+    for(const std::string& key : keys) {
+        Partition_Entry partition_entry = this -> get_partition_for_key(key);
+        partition_entries[partition_entry.id] = partition_entry;
+        partition_keys[partition_entry.id].push_back(key);
+    }
+
+    for(std::pair<const int16_t, Partition_Entry>& partition_entry : partition_entries) {
+        if(!ensure_partition_connection(partition_entry.second)) {
+            this -> queue_client_for_error_response(client_fd, msg.get_cid(), Server_Error_Codes::PARTITION_DIED);
+            return 0;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this -> pending_scatters_mutex);
+        Pending_Scatter& pending_scatter = this -> pending_scatters[msg.get_cid()];
+        pending_scatter = Pending_Scatter{};
+        pending_scatter.com_code = COMMAND_CODE_MGET;
+        pending_scatter.remaining = partition_keys.size();
+        pending_scatter.failed = false;
+        pending_scatter.keys = std::move(keys);
+    }
+
+    // every slice is queued before any reply is waited for, so the partitions look their keys up in parallel
+    for(std::pair<const int16_t, std::vector<std::string>>& slice : partition_keys) {
+        Partition_Entry& partition_entry = partition_entries[slice.first];
+        Server_Message slice_msg = this -> create_keys_message(COMMAND_CODE_MGET, slice.second, true, msg.get_cid());
+
+        try {
+            this -> queue_partition_for_response(partition_entry.socket_fd, std::move(slice_msg));
+        }
+        catch(const std::exception& e) {
+            if(this -> verbose > 0) {
+                std::cerr << e.what() << std::endl;
+            }
+            this -> partitions[partition_entry.id].status = Partition_Status::PARTITION_DEAD;
+            this -> settle_pending_scatter(msg.get_cid(), nullptr);
+        }
+    }
+
+    return 0;
+}
+
+int8_t Primary_Server::process_broadcast_request(socket_t client_fd, const Server_Message& msg, Command_Code com_code, const std::vector<std::string>& args) {
+    // every partition is asked, an unreachable one fails the request instead of leaving its part out silently
+    std::vector<Partition_Entry> partition_entries;
+    {
+        std::shared_lock<std::shared_mutex> lock(this -> partitions_mutex);
+        partition_entries = this -> partitions;
+    }
+
+    for(Partition_Entry& partition_entry : partition_entries) {
+        if(!ensure_partition_connection(partition_entry)) {
+            this -> queue_client_for_error_response(client_fd, msg.get_cid(), Server_Error_Codes::PARTITION_DIED);
+            return 0;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this -> pending_scatters_mutex);
+        Pending_Scatter& pending_scatter = this -> pending_scatters[msg.get_cid()];
+        pending_scatter = Pending_Scatter{};
+        pending_scatter.com_code = com_code;
+        pending_scatter.remaining = partition_entries.size();
+        pending_scatter.failed = false;
+    }
+
+    for(Partition_Entry& partition_entry : partition_entries) {
+        Server_Message slice_msg = this -> create_keys_message(com_code, args, true, msg.get_cid());
+
+        try {
+            this -> queue_partition_for_response(partition_entry.socket_fd, std::move(slice_msg));
+        }
+        catch(const std::exception& e) {
+            if(this -> verbose > 0) {
+                std::cerr << e.what() << std::endl;
+            }
+            this -> partitions[partition_entry.id].status = Partition_Status::PARTITION_DEAD;
+            this -> settle_pending_scatter(msg.get_cid(), nullptr);
+        }
+    }
+
+    return 0;
+}
+
+bool Primary_Server::settle_pending_scatter(protocol_id_t client_id, const Server_Message* reply) {
+    Pending_Scatter pending_scatter;
+    {
+        std::lock_guard<std::mutex> lock(this -> pending_scatters_mutex);
+        std::unordered_map<protocol_id_t, Pending_Scatter>::iterator p_s_it = this -> pending_scatters.find(client_id);
+        if(p_s_it == this -> pending_scatters.end()) {
+            return false;
+        }
+
+        bool succeeded = reply && this -> extract_command_code(reply -> string(), true) == COMMAND_CODE_OK;
+        if(succeeded && p_s_it -> second.com_code == COMMAND_CODE_MGET) {
+            try {
+                for(std::pair<std::string, std::string>& pair : this -> extract_key_value_pairs(reply -> string(), true)) {
+                    p_s_it -> second.values.insert(std::move(pair));
+                }
+            }
+            catch(const std::exception& e) {
+                if(this -> verbose > 0) {
+                    std::cerr << e.what() << std::endl;
+                }
+                succeeded = false;
+            }
+        }
+        else if(succeeded && p_s_it -> second.com_code == COMMAND_CODE_STATS) {
+            try {
+                std::map<std::string, uint64_t> counters;
+                for(const std::pair<std::string, std::string>& pair : this -> extract_key_value_pairs(reply -> string(), true)) {
+                    counters[pair.first] = std::stoull(pair.second);
+                }
+                Statistics::merge_counters(p_s_it -> second.counters, counters);
+            }
+            catch(const std::exception& e) {
+                if(this -> verbose > 0) {
+                    std::cerr << e.what() << std::endl;
+                }
+                succeeded = false;
+            }
+        }
+
+        p_s_it -> second.failed = p_s_it -> second.failed || !succeeded;
+        if(--p_s_it -> second.remaining > 0) {
+            return true;
+        }
+
+        pending_scatter = std::move(p_s_it -> second);
+        this -> pending_scatters.erase(p_s_it);
+    }
+
+    socket_t client_fd = this -> find_client_fd(client_id);
+    if(client_fd < 0) {
+        return true;
+    }
+
+    if(pending_scatter.failed) {
+        this -> queue_client_for_error_response(client_fd, client_id);
+        return true;
+    }
+
+    if(pending_scatter.com_code == COMMAND_CODE_MSET || pending_scatter.com_code == COMMAND_CODE_CHECKPOINT || pending_scatter.com_code == COMMAND_CODE_INGEST) {
+        this -> queue_client_for_ok_response(client_fd, client_id);
+        return true;
+    }
+
+    std::vector<Entry> entries;
+    if(pending_scatter.com_code == COMMAND_CODE_STATS) {
+        Statistics::summarize_histograms(pending_scatter.counters);
+        entries.reserve(pending_scatter.counters.size());
+        for(const std::pair<const std::string, uint64_t>& counter : pending_scatter.counters) {
+            entries.push_back(Entry(Bits(counter.first), Bits(std::to_string(counter.second))));
+        }
+
+        Server_Message serv_resp;
+        serv_resp.set_message_eat(this -> create_entries_response(entries, false, client_id));
+        serv_resp.set_cid(client_id);
+        this -> queue_client_for_response(std::move(serv_resp));
+        return true;
+    }
+
+    // found keys in the order they were asked for, missing ones are left out
+    entries.reserve(pending_scatter.keys.size());
+    for(const std::string& key : pending_scatter.keys) {
+        std::unordered_map<std::string, std::string>::const_iterator value_it = pending_scatter.values.find(key);
+        if(value_it != pending_scatter.values.end()) {
+            entries.push_back(Entry(Bits(key), Bits(value_it -> second)));
+        }
+    }
+
+    Server_Message serv_resp;
+    serv_resp.set_message_eat(this -> create_entries_response(entries, false, client_id));
+    serv_resp.set_cid(client_id);
+    this -> queue_client_for_response(std::move(serv_resp));
+    return true;
+}
+
 void Primary_Server::queue_client_for_response(Server_Message &&msg) {
     socket_t client_fd;
     {
@@ -898,6 +1173,12 @@ void Primary_Server::process_remove_queue() {
                     while(!clients_to_err.empty()) {
                         Server_Message msg = clients_to_err.front();
                         clients_to_err.pop();
+
+                        // a lost MSET / MGET / STATS / CHECKPOINT / INGEST slice fails the whole request, the client is answered when its last slice settles
+                        if(this -> settle_pending_scatter(msg.get_cid(), nullptr)) {
+                            continue;
+                        }
+
                         socket_t client_fd;
                         {
                             std::shared_lock<std::shared_mutex> lock(this -> id_client_map_mutex);
@@ -987,6 +1268,11 @@ void Primary_Server::remove_client(socket_t client_fd) {
         id_client_map.erase(cid);
     }
 
+    if(found) {
+        std::lock_guard<std::mutex> lock(this -> pending_scatters_mutex);
+        this -> pending_scatters.erase(cid);
+    }
+
     {
         std::unique_lock<std::shared_mutex> lock(this -> fd_type_map_mutex);
         std::unordered_map<socket_t, Fd_Type>::iterator fd_t_it = this -> fd_type_map.find(client_fd);
@@ -1262,6 +1548,9 @@ int8_t Primary_Server::query_partition_by_cursor(Cursor& cursor, Command_Code co
         memcpy(&msg_str[pos], &prefix[0], prefix_len);
     }
     
+    cursor_snapshot_id_t net_snapshot_id = cursor_snapshot_id_hton(cursor.get_snapshot_id());
+    memcpy(&msg_str[PROTOCOL_CURSOR_SNAPSHOT_ID_POS], &net_snapshot_id, sizeof(cursor_snapshot_id_t));
+
     pos = PROTOCOL_EDGE_FB_FLAG_POS;
     if(edge_fb_case) {
         uint8_t flag = 1;
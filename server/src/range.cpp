@@ -0,0 +1,41 @@
+#include "../include/range.h"
+#include <algorithm>
+#include <limits>
+
+uint32_t key_prefix_to_uint32(const std::string& key) {
+    uint32_t uint32_prefix_key = 0;
+
+    uint32_t key_limit = std::min<uint32_t>(RANGE_BYTES_IN_KEY_PREFIX, key.length());
+
+    for(uint32_t i = 0; i < key_limit; ++i) {
+        uint32_prefix_key |= static_cast<uint32_t>(static_cast<uint8_t>(key[i]) << (8 * (RANGE_BYTES_IN_KEY_PREFIX - 1 - i)));
+    }
+
+    return uint32_prefix_key;
+}
+
+Range get_partition_range(uint32_t partition_index, uint32_t partition_count) {
+    uint32_t partition_range_length = std::numeric_limits<uint32_t>::max() / partition_count;
+
+    Range range;
+    range.beg = partition_range_length * partition_index;
+    range.end = partition_range_length * (partition_index + 1);
+
+    // for the last partition is everything until the max index
+    if(partition_index == partition_count - 1) {
+        range.end = std::numeric_limits<uint32_t>::max();
+    }
+
+    return range;
+}
+
+uint32_t get_partition_index(const std::string& key, uint32_t partition_count) {
+    uint32_t partition_range_length = std::numeric_limits<uint32_t>::max() / partition_count;
+    uint32_t partition_index = static_cast<uint32_t>(key_prefix_to_uint32(key) / partition_range_length);
+
+    if(partition_index >= partition_count) {
+        --partition_index;
+    }
+
+    return partition_index;
+}
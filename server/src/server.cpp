@@ -1,4 +1,5 @@
 #include "../include/server.h"
+#include <algorithm>
 #include <cerrno>
 #include <fcntl.h>
 #include <stdexcept>
@@ -491,4 +492,172 @@ protocol_array_len_t Server::extract_array_size(std::string msg, bool contains_c
     memcpy(&array_len, &msg[sizeof(protocol_msg_len_t) + (contains_cid? sizeof(protocol_id_t) : 0)], sizeof(protocol_array_len_t));
     array_len = protocol_arr_len_ntoh(array_len);
     return array_len;
-}
\ No newline at end of file
+}
+
+protocol_array_len_t Server::extract_key_count(const std::string& message, bool contains_cid, uint64_t min_element_size) const {
+    uint64_t pos = sizeof(protocol_msg_len_t) + (contains_cid? sizeof(protocol_id_t) : 0);
+    if(pos + sizeof(protocol_array_len_t) > message.size()) {
+        throw std::length_error(SERVER_MESSAGE_TOO_SHORT_ERR_MSG);
+    }
+
+    protocol_array_len_t element_count = 0;
+    memcpy(&element_count, &message[pos], sizeof(protocol_array_len_t));
+    element_count = protocol_arr_len_ntoh(element_count);
+
+    // every element takes at least its length fields, do not trust the count any further than that
+    pos = contains_cid? PROTOCOL_FIRST_KEY_LEN_POS : PROTOCOL_FIRST_KEY_LEN_POS_NOCID;
+    if(element_count > (message.size() - std::min<uint64_t>(pos, message.size())) / min_element_size) {
+        throw std::length_error(SERVER_MESSAGE_TOO_SHORT_ERR_MSG);
+    }
+
+    return element_count;
+}
+
+size_t Server::write_message_header(std::string& message, Command_Code com_code, protocol_array_len_t array_len, bool contain_cid, protocol_id_t client_id) const {
+    size_t curr_pos = 0;
+
+    protocol_msg_len_t net_msg_len = protocol_msg_len_hton(message.size());
+    memcpy(&message[curr_pos], &net_msg_len, sizeof(net_msg_len));
+    curr_pos += sizeof(net_msg_len);
+
+    if(contain_cid) {
+        protocol_id_t net_cid = protocol_id_hton(client_id);
+        memcpy(&message[curr_pos], &net_cid, sizeof(net_cid));
+        curr_pos += sizeof(net_cid);
+    }
+
+    protocol_array_len_t net_arr_len = protocol_arr_len_hton(array_len);
+    memcpy(&message[curr_pos], &net_arr_len, sizeof(net_arr_len));
+    curr_pos += sizeof(net_arr_len);
+
+    command_code_t net_com_code = command_hton(com_code);
+    memcpy(&message[curr_pos], &net_com_code, sizeof(net_com_code));
+    curr_pos += sizeof(net_com_code);
+
+    return curr_pos;
+}
+
+std::vector<std::pair<std::string, std::string>> Server::extract_key_value_pairs(const std::string& message, bool contains_cid) const {
+    protocol_array_len_t pair_count = this -> extract_key_count(message, contains_cid, sizeof(protocol_key_len_t) + sizeof(protocol_value_len_t));
+    uint64_t pos = contains_cid? PROTOCOL_FIRST_KEY_LEN_POS : PROTOCOL_FIRST_KEY_LEN_POS_NOCID;
+
+    std::vector<std::pair<std::string, std::string>> pairs;
+    pairs.reserve(pair_count);
+
+    for(protocol_array_len_t i = 0; i < pair_count; ++i) {
+        protocol_key_len_t key_len = 0;
+        if(pos + sizeof(key_len) > message.size()) {
+            throw std::length_error(SERVER_MESSAGE_TOO_SHORT_ERR_MSG);
+        }
+        memcpy(&key_len, &message[pos], sizeof(key_len));
+        key_len = protocol_key_len_ntoh(key_len);
+        pos += sizeof(key_len);
+
+        if(pos + key_len > message.size()) {
+            throw std::length_error(SERVER_MESSAGE_TOO_SHORT_ERR_MSG);
+        }
+        std::string key_str = message.substr(pos, key_len);
+        pos += key_len;
+
+        protocol_value_len_t value_len = 0;
+        if(pos + sizeof(value_len) > message.size()) {
+            throw std::length_error(SERVER_MESSAGE_TOO_SHORT_ERR_MSG);
+        }
+        memcpy(&value_len, &message[pos], sizeof(value_len));
+        value_len = protocol_value_len_ntoh(value_len);
+        pos += sizeof(value_len);
+
+        if(pos + value_len > message.size()) {
+            throw std::length_error(SERVER_MESSAGE_TOO_SHORT_ERR_MSG);
+        }
+        std::string value_str = message.substr(pos, value_len);
+        pos += value_len;
+
+        pairs.emplace_back(std::move(key_str), std::move(value_str));
+    }
+
+    return pairs;
+}
+
+Server_Message Server::create_key_value_pairs_message(Command_Code com_code, const std::vector<std::pair<std::string, std::string>>& pairs, bool contain_cid, protocol_id_t client_id) const {
+    protocol_msg_len_t message_length = sizeof(protocol_msg_len_t) + sizeof(protocol_array_len_t) + sizeof(command_code_t);
+    if(contain_cid) {
+        message_length += sizeof(protocol_id_t);
+    }
+
+    for(const std::pair<std::string, std::string>& pair : pairs) {
+        message_length += sizeof(protocol_key_len_t) + pair.first.size() + sizeof(protocol_value_len_t) + pair.second.size();
+    }
+
+    std::string message(message_length, '\0');
+    size_t curr_pos = this -> write_message_header(message, com_code, pairs.size(), contain_cid, client_id);
+
+    for(const std::pair<std::string, std::string>& pair : pairs) {
+        protocol_key_len_t net_key_len = protocol_key_len_hton(pair.first.size());
+        memcpy(&message[curr_pos], &net_key_len, sizeof(net_key_len));
+        curr_pos += sizeof(net_key_len);
+
+        memcpy(&message[curr_pos], pair.first.data(), pair.first.size());
+        curr_pos += pair.first.size();
+
+        protocol_value_len_t net_value_len = protocol_value_len_hton(pair.second.size());
+        memcpy(&message[curr_pos], &net_value_len, sizeof(net_value_len));
+        curr_pos += sizeof(net_value_len);
+
+        memcpy(&message[curr_pos], pair.second.data(), pair.second.size());
+        curr_pos += pair.second.size();
+    }
+
+    return Server_Message(message, client_id);
+}
+
+std::vector<std::string> Server::extract_keys(const std::string& message, bool contains_cid) const {
+    protocol_array_len_t key_count = this -> extract_key_count(message, contains_cid, sizeof(protocol_key_len_t));
+    uint64_t pos = contains_cid? PROTOCOL_FIRST_KEY_LEN_POS : PROTOCOL_FIRST_KEY_LEN_POS_NOCID;
+
+    std::vector<std::string> keys;
+    keys.reserve(key_count);
+
+    for(protocol_array_len_t i = 0; i < key_count; ++i) {
+        protocol_key_len_t key_len = 0;
+        if(pos + sizeof(key_len) > message.size()) {
+            throw std::length_error(SERVER_MESSAGE_TOO_SHORT_ERR_MSG);
+        }
+        memcpy(&key_len, &message[pos], sizeof(key_len));
+        key_len = protocol_key_len_ntoh(key_len);
+        pos += sizeof(key_len);
+
+        if(pos + key_len > message.size()) {
+            throw std::length_error(SERVER_MESSAGE_TOO_SHORT_ERR_MSG);
+        }
+        keys.push_back(message.substr(pos, key_len));
+        pos += key_len;
+    }
+
+    return keys;
+}
+
+Server_Message Server::create_keys_message(Command_Code com_code, const std::vector<std::string>& keys, bool contain_cid, protocol_id_t client_id) const {
+    protocol_msg_len_t message_length = sizeof(protocol_msg_len_t) + sizeof(protocol_array_len_t) + sizeof(command_code_t);
+    if(contain_cid) {
+        message_length += sizeof(protocol_id_t);
+    }
+
+    for(const std::string& key : keys) {
+        message_length += sizeof(protocol_key_len_t) + key.size();
+    }
+
+    std::string message(message_length, '\0');
+    size_t curr_pos = this -> write_message_header(message, com_code, keys.size(), contain_cid, client_id);
+
+    for(const std::string& key : keys) {
+        protocol_key_len_t net_key_len = protocol_key_len_hton(key.size());
+        memcpy(&message[curr_pos], &net_key_len, sizeof(net_key_len));
+        curr_pos += sizeof(net_key_len);
+
+        memcpy(&message[curr_pos], key.data(), key.size());
+        curr_pos += key.size();
+    }
+
+    return Server_Message(message, client_id);
+}
@@ -0,0 +1,124 @@
+// Splits sorted text records by the key ranges Primary_Server gives its partitions and writes each part as ingestible tables
+// every input line is "key\tvalue", a line without a tab removes its key, keys have to be strictly increasing
+// partition i + 1 gets its tables in DIR/<PARTITION_SERVER_NAME_PREFIX><i + 1>, copy that directory to the ingest directory
+// of the partition under a common name and send INGEST <name> to the primary server
+// prefix filters follow the LSM_TREE_* environment variables, so set them as the partitions have them
+// usage: ./bin/bulk_loader --partitions=N --output=DIR [--input=FILE] [--table_size=BYTES]
+//        reads stdin without --input, prints the data file of every table written
+
+#include "../include/partition_server.h"
+#include "../include/range.h"
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Loader_Config {
+    std::string input;
+    std::string output;
+    uint32_t partitions;
+    uint64_t table_size;
+};
+
+// @returns false if an argument is not understood
+static bool parse_args(int argc, char* argv[], Loader_Config& config) {
+    config.partitions = 0;
+    config.table_size = SS_TABLE_WRITER_DEFAULT_TABLE_SIZE;
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        if(arg.rfind("--", 0) != 0 || equals == std::string::npos) {
+            return false;
+        }
+
+        std::string flag = arg.substr(2, equals - 2);
+        std::string value = arg.substr(equals + 1);
+
+        try {
+            if(flag == "input") {
+                config.input = value;
+            }
+            else if(flag == "output") {
+                config.output = value;
+            }
+            else if(flag == "partitions") {
+                config.partitions = std::stoul(value);
+            }
+            else if(flag == "table_size") {
+                config.table_size = std::stoull(value);
+            }
+            else {
+                return false;
+            }
+        }
+        catch(const std::exception& e) {
+            return false;
+        }
+    }
+
+    return !config.output.empty() && config.partitions > 0 && config.table_size > 0;
+}
+
+int main(int argc, char* argv[]) {
+    Loader_Config config;
+    if(!parse_args(argc, argv, config)) {
+        std::cerr << "usage: " << argv[0] << " --partitions=N --output=DIR [--input=FILE] [--table_size=BYTES]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input_file;
+    if(!config.input.empty()) {
+        input_file.open(config.input);
+        if(!input_file) {
+            std::cerr << "failed to open " << config.input << std::endl;
+            return 1;
+        }
+    }
+
+    std::istream& input = config.input.empty() ? std::cin : input_file;
+
+    try {
+        LSM_Options options = LSM_Options::from_environment();
+
+        // partitions own contiguous key ranges, so sorted input reaches every writer sorted too
+        // every partition gets a directory, an empty one ingests nothing, so INGEST can go to all of them
+        std::vector<std::unique_ptr<SS_Table_Writer>> writers;
+        writers.reserve(config.partitions);
+        for(uint32_t i = 0; i < config.partitions; ++i) {
+            std::filesystem::path partition_dir = std::filesystem::path(config.output) / (PARTITION_SERVER_NAME_PREFIX + std::to_string(i + 1));
+            writers.push_back(std::make_unique<SS_Table_Writer>(partition_dir, options, config.table_size));
+        }
+
+        std::string line;
+        while(std::getline(input, line)) {
+            if(line.empty()) {
+                continue;
+            }
+
+            size_t tab = line.find('\t');
+            std::string key = tab == std::string::npos ? line : line.substr(0, tab);
+
+            std::unique_ptr<SS_Table_Writer>& writer = writers[get_partition_index(key, config.partitions)];
+            if(tab == std::string::npos) {
+                writer -> remove(key);
+            }
+            else {
+                writer -> put(key, line.substr(tab + 1));
+            }
+        }
+
+        for(std::unique_ptr<SS_Table_Writer>& writer : writers) {
+            for(const std::filesystem::path& data_file : writer -> finish()) {
+                std::cout << data_file.string() << std::endl;
+            }
+        }
+    }
+    catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}